@@ -0,0 +1,357 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "../PrecompiledHeaders.h"
+#include "SharedMemoryCache.h"
+
+#include <boost/functional/hash.hpp>
+
+#include <stdlib.h>  // This fixes a problem in glog for recent
+                     // releases of MinGW
+#include <glog/logging.h>
+
+namespace Orthanc
+{
+  class SharedMemoryCache::Page : public boost::noncopyable
+  {
+  public:
+    // This mutex is locked while the page is being loaded, then by
+    // each "Accessor" to the page
+    boost::mutex  mutex_;
+
+    // NULL iff the page is still being loaded, or if its loading failed
+    std::auto_ptr<IDynamicObject>  content_;
+
+    // The size that is accounted in the cache. This field is
+    // protected by the mutex of the shard.
+    size_t  size_;
+
+    Page() : size_(0)
+    {
+    }
+  };
+
+
+  struct SharedMemoryCache::Shard : public boost::noncopyable
+  {
+    boost::mutex  mutex_;
+    LeastRecentlyUsedIndex<std::string, PagePointer>  index_;
+    uint64_t  hits_;
+    uint64_t  misses_;
+    uint64_t  evictions_;
+
+    Shard() : 
+      hits_(0),
+      misses_(0),
+      evictions_(0)
+    {
+    }
+  };
+
+
+  size_t SharedMemoryCache::GetShardIndex(const std::string& id) const
+  {
+    boost::hash<std::string> hasher;
+    return hasher(id) % shards_.size();
+  }
+
+
+  void SharedMemoryCache::AddSize(size_t size)
+  {
+    boost::mutex::scoped_lock lock(sizeMutex_);
+    currentSize_ += size;
+  }
+
+
+  void SharedMemoryCache::RemoveSize(size_t size)
+  {
+    boost::mutex::scoped_lock lock(sizeMutex_);
+    assert(currentSize_ >= size);
+    currentSize_ -= size;
+  }
+
+
+  bool SharedMemoryCache::IsFull()
+  {
+    boost::mutex::scoped_lock lock(sizeMutex_);
+    return currentSize_ > maximumSize_;
+  }
+
+
+  void SharedMemoryCache::MakeRoom(size_t firstShard)
+  {
+    // The budget is global to all the shards. The first pass drops
+    // the oldest pages of each shard, starting with the shard that
+    // has just grown, but keeps its most recent page (i.e. the page
+    // that was just loaded). The second pass only happens if this
+    // page alone exceeds the budget: It is then dropped as well, and
+    // will only live as long as its accessors.
+    for (unsigned int pass = 0; pass < 2; pass++)
+    {
+      for (size_t i = 0; i < shards_.size(); i++)
+      {
+        Shard& shard = *shards_[(firstShard + i) % shards_.size()];
+        size_t minimum = (pass == 0 && i == 0) ? 1 : 0;
+
+        boost::mutex::scoped_lock lock(shard.mutex_);
+
+        while (shard.index_.GetSize() > minimum &&
+               IsFull())
+        {
+          VLOG(1) << "Dropping the oldest cache page";
+          PagePointer oldest;
+          shard.index_.RemoveOldest(oldest);
+          RemoveSize(oldest->size_);
+          shard.evictions_++;
+        }
+      }
+
+      if (!IsFull())
+      {
+        return;
+      }
+    }
+  }
+
+
+  SharedMemoryCache::PagePointer SharedMemoryCache::Load(const std::string& id)
+  {
+    size_t shardIndex = GetShardIndex(id);
+    Shard& shard = *shards_[shardIndex];
+    PagePointer page;
+
+    {
+      boost::mutex::scoped_lock lock(shard.mutex_);
+
+      if (shard.index_.Contains(id, page))
+      {
+        // Reuse the cache page if it already exists. It might be
+        // still under construction by another thread: In such a
+        // case, the accessor will wait for its construction.
+        VLOG(1) << "Reusing a cache page";
+        shard.index_.MakeMostRecent(id);
+        shard.hits_++;
+        return page;
+      }
+
+      // Register a new page, and lock it until its content is
+      // available, so that concurrent accesses to the same page
+      // wait for its content instead of loading it twice
+      page.reset(new Page);
+      page->mutex_.lock();
+      shard.index_.Add(id, page);
+      shard.misses_++;
+    }
+
+    std::auto_ptr<IDynamicObject> content;
+
+    try
+    {
+      size_t size = 0;
+      content.reset(provider_.Provide(size, id));
+
+      if (content.get() == NULL)
+      {
+        throw OrthancException(ErrorCode_InternalError);
+      }
+
+      bool accounted = false;
+
+      {
+        boost::mutex::scoped_lock lock(shard.mutex_);
+
+        PagePointer current;
+        if (shard.index_.Contains(id, current) &&
+            current == page)
+        {
+          // The page has not been invalidated while loading
+          page->size_ = size;
+          AddSize(size);
+          accounted = true;
+        }
+      }
+
+      if (accounted)
+      {
+        // The lock on the shard must be released, as making room
+        // might lock the other shards
+        MakeRoom(shardIndex);
+      }
+    }
+    catch (...)
+    {
+      {
+        boost::mutex::scoped_lock lock(shard.mutex_);
+
+        PagePointer current;
+        if (shard.index_.Contains(id, current) &&
+            current == page)
+        {
+          shard.index_.Invalidate(id);
+          RemoveSize(page->size_);
+        }
+      }
+
+      page->mutex_.unlock();
+      throw;
+    }
+
+    VLOG(1) << "Registering new data in a cache page";
+    page->content_ = content;
+    page->mutex_.unlock();
+
+    return page;
+  }
+
+
+  SharedMemoryCache::SharedMemoryCache(ISizedCachePageProvider& provider,
+                                       size_t maximumSize,
+                                       unsigned int countShards) :
+    provider_(provider),
+    maximumSize_(maximumSize),
+    currentSize_(0)
+  {
+    if (countShards == 0)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    shards_.resize(countShards);
+    for (size_t i = 0; i < countShards; i++)
+    {
+      shards_[i] = new Shard;
+    }
+  }
+
+
+  SharedMemoryCache::~SharedMemoryCache()
+  {
+    for (size_t i = 0; i < shards_.size(); i++)
+    {
+      assert(shards_[i] != NULL);
+      delete shards_[i];
+    }
+  }
+
+
+  void SharedMemoryCache::Invalidate(const std::string& id)
+  {
+    Shard& shard = *shards_[GetShardIndex(id)];
+    boost::mutex::scoped_lock lock(shard.mutex_);
+
+    if (shard.index_.Contains(id))
+    {
+      PagePointer page = shard.index_.Invalidate(id);
+      RemoveSize(page->size_);
+    }
+  }
+
+
+  size_t SharedMemoryCache::GetCurrentSize()
+  {
+    boost::mutex::scoped_lock lock(sizeMutex_);
+    return currentSize_;
+  }
+
+
+  size_t SharedMemoryCache::GetNumberOfPages()
+  {
+    size_t count = 0;
+
+    for (size_t i = 0; i < shards_.size(); i++)
+    {
+      boost::mutex::scoped_lock lock(shards_[i]->mutex_);
+      count += shards_[i]->index_.GetSize();
+    }
+
+    return count;
+  }
+
+
+  void SharedMemoryCache::GetStatistics(uint64_t& hits,
+                                        uint64_t& misses,
+                                        uint64_t& evictions)
+  {
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+
+    for (size_t i = 0; i < shards_.size(); i++)
+    {
+      boost::mutex::scoped_lock lock(shards_[i]->mutex_);
+      hits += shards_[i]->hits_;
+      misses += shards_[i]->misses_;
+      evictions += shards_[i]->evictions_;
+    }
+  }
+
+
+  SharedMemoryCache::Accessor::Accessor(SharedMemoryCache& cache,
+                                        const std::string& id)
+  {
+    for (;;)
+    {
+      page_ = cache.Load(id);
+
+      // Wait for the page to be loaded, if another thread is
+      // currently loading it
+      lock_.reset(new boost::mutex::scoped_lock(page_->mutex_));
+
+      if (page_->content_.get() != NULL)
+      {
+        return;
+      }
+
+      // The loading of this page has failed in another thread (the
+      // page was removed from the index): Try again
+      lock_.reset(NULL);
+      page_.reset();
+    }
+  }
+
+
+  SharedMemoryCache::Accessor::~Accessor()
+  {
+    // Release the lock before the page, as the page might be deleted
+    // if it was dropped from the cache in the meantime
+    lock_.reset(NULL);
+    page_.reset();
+  }
+
+
+  IDynamicObject& SharedMemoryCache::Accessor::GetContent()
+  {
+    assert(page_->content_.get() != NULL);
+    return *page_->content_;
+  }
+}
@@ -0,0 +1,136 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include "LeastRecentlyUsedIndex.h"
+#include "ISizedCachePageProvider.h"
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace Orthanc
+{
+  /**
+   * Thread-safe cache with least recently used (LRU) recycling
+   * policy, whose capacity is expressed as a maximum number of
+   * bytes. The index is split into several shards, each protected by
+   * its own mutex, so that concurrent accesses to different pages do
+   * not contend. The maximum size is a budget that is shared by all
+   * the shards. Once loaded, a page is accessed by one accessor at
+   * a time, as its content might not be safe to read concurrently
+   * (e.g. the DCMTK objects). A page that is dropped from the cache
+   * while it is still accessed is only freed once its accessor is
+   * released.
+   **/
+  class SharedMemoryCache : public boost::noncopyable
+  {
+  private:
+    class Page;
+    typedef boost::shared_ptr<Page>  PagePointer;
+
+    struct Shard;
+
+    ISizedCachePageProvider& provider_;
+    size_t maximumSize_;
+    std::vector<Shard*> shards_;
+
+    // Protects "currentSize_". If both are needed, the mutex of a
+    // shard must be locked before this mutex.
+    boost::mutex sizeMutex_;
+    size_t currentSize_;
+
+    size_t GetShardIndex(const std::string& id) const;
+
+    void AddSize(size_t size);
+
+    void RemoveSize(size_t size);
+
+    bool IsFull();
+
+    void MakeRoom(size_t firstShard);
+
+    PagePointer Load(const std::string& id);
+
+  public:
+    class Accessor : public boost::noncopyable
+    {
+    private:
+      PagePointer  page_;
+      std::auto_ptr<boost::mutex::scoped_lock>  lock_;
+
+    public:
+      Accessor(SharedMemoryCache& cache,
+               const std::string& id);
+
+      ~Accessor();
+
+      /**
+       * The other threads accessing the same page wait for this
+       * accessor to be released. The content of the page remains
+       * in the cache, and must therefore be treated as read-only.
+       **/
+      IDynamicObject& GetContent();
+    };
+
+    /**
+     * Create a cache.
+     * \param provider The object that creates the pages that are not in the cache yet.
+     * \param maximumSize The maximum total size of the cached pages, in bytes.
+     * \param countShards The number of independently-locked shards of the index.
+     **/
+    SharedMemoryCache(ISizedCachePageProvider& provider,
+                      size_t maximumSize,
+                      unsigned int countShards);
+
+    ~SharedMemoryCache();
+
+    void Invalidate(const std::string& id);
+
+    size_t GetMaximumSize() const
+    {
+      return maximumSize_;
+    }
+
+    size_t GetCurrentSize();
+
+    size_t GetNumberOfPages();
+
+    void GetStatistics(uint64_t& hits,
+                       uint64_t& misses,
+                       uint64_t& evictions);
+  };
+}
@@ -158,8 +158,27 @@ namespace Orthanc
     writer_.Open();
   }
 
+  HierarchicalZipWriter::HierarchicalZipWriter(ZipWriter::IOutputStream& stream)
+  {
+    // The archive is lazily opened, as its ZIP64 flag is not known yet
+    writer_.SetOutputStream(stream);
+  }
+
   HierarchicalZipWriter::~HierarchicalZipWriter()
   {
+    if (!writer_.IsStreaming())
+    {
+      writer_.Close();
+    }
+
+    // A streamed archive must be explicitly closed by Close(), so
+    // that an exception does not produce a truncated archive that
+    // looks complete
+  }
+
+  void HierarchicalZipWriter::Close()
+  {
+    writer_.Open();  // Properly create an empty archive if no file was added
     writer_.Close();
   }
 
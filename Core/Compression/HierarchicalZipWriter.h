@@ -92,8 +92,12 @@ namespace Orthanc
   public:
     HierarchicalZipWriter(const char* path);
 
+    HierarchicalZipWriter(ZipWriter::IOutputStream& stream);
+
     ~HierarchicalZipWriter();
 
+    void Close();
+
     void SetZip64(bool isZip64)
     {
       writer_.SetZip64(isZip64);
@@ -0,0 +1,632 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "../PrecompiledHeaders.h"
+#include "ZipReader.h"
+
+#include "../OrthancException.h"
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <string.h>
+#include <zlib.h>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+namespace Orthanc
+{
+  // http://www.pkware.com/documents/casestudies/APPNOTE.TXT
+  static const uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+  static const uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+  static const uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+  static const uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064b50;
+  static const uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+  static const uint16_t ZIP64_EXTRA_FIELD = 0x0001;
+
+  static const size_t LOCAL_HEADER_SIZE = 30;
+  static const size_t CENTRAL_HEADER_SIZE = 46;
+  static const size_t END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+  static const size_t ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE = 56;
+  static const size_t ZIP64_LOCATOR_SIZE = 20;
+  static const size_t MAX_COMMENT_SIZE = 65535;
+
+  static const uint16_t METHOD_STORED = 0;
+  static const uint16_t METHOD_DEFLATE = 8;
+
+  static const size_t CHUNK_SIZE = 65536;
+
+  // The best compression ratio that deflate can achieve (each match
+  // of 258 bytes is encoded by at least 2 bits)
+  static const uint64_t MAX_DEFLATE_RATIO = 1032;
+
+
+  static void ResizeContent(std::string& content,
+                            size_t size)
+  {
+    try
+    {
+      content.resize(size);
+    }
+    catch (std::bad_alloc&)
+    {
+      throw OrthancException(ErrorCode_NotEnoughMemory);
+    }
+    catch (std::length_error&)
+    {
+      throw OrthancException(ErrorCode_NotEnoughMemory);
+    }
+  }
+
+
+  static uint16_t ReadUInt16(const std::string& buffer,
+                             size_t pos)
+  {
+    if (pos + 2 > buffer.size())
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(buffer.c_str()) + pos;
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+  }
+
+
+  static uint32_t ReadUInt32(const std::string& buffer,
+                             size_t pos)
+  {
+    if (pos + 4 > buffer.size())
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(buffer.c_str()) + pos;
+    return (static_cast<uint32_t>(p[0]) |
+            (static_cast<uint32_t>(p[1]) << 8) |
+            (static_cast<uint32_t>(p[2]) << 16) |
+            (static_cast<uint32_t>(p[3]) << 24));
+  }
+
+
+  static uint64_t ReadUInt64(const std::string& buffer,
+                             size_t pos)
+  {
+    return (static_cast<uint64_t>(ReadUInt32(buffer, pos)) |
+            (static_cast<uint64_t>(ReadUInt32(buffer, pos + 4)) << 32));
+  }
+
+
+  class ZipReader::ISource : public boost::noncopyable
+  {
+  public:
+    virtual ~ISource()
+    {
+    }
+
+    virtual uint64_t GetSize() const = 0;
+
+    virtual void Read(void* target,
+                      uint64_t offset,
+                      size_t size) = 0;
+
+    void Read(std::string& target,
+              uint64_t offset,
+              size_t size)
+    {
+      if (offset > GetSize() ||
+          size > GetSize() - offset)
+      {
+        throw OrthancException(ErrorCode_BadFileFormat);
+      }
+
+      target.resize(size);
+      if (size > 0)
+      {
+        Read(&target[0], offset, size);
+      }
+    }
+  };
+
+
+  namespace
+  {
+    class MemorySource : public ZipReader::ISource
+    {
+    private:
+      const uint8_t* archive_;
+      size_t size_;
+
+    public:
+      MemorySource(const void* archive,
+                   size_t size) :
+        archive_(static_cast<const uint8_t*>(archive)),
+        size_(size)
+      {
+      }
+
+      virtual uint64_t GetSize() const
+      {
+        return size_;
+      }
+
+      virtual void Read(void* target,
+                        uint64_t offset,
+                        size_t size)
+      {
+        // The bounds have been checked by ISource::Read()
+        memcpy(target, archive_ + offset, size);
+      }
+    };
+
+
+    class FileSource : public ZipReader::ISource
+    {
+    private:
+      boost::filesystem::ifstream stream_;
+      uint64_t size_;
+
+    public:
+      FileSource(const std::string& path)
+      {
+        stream_.open(path, std::ifstream::in | std::ifstream::binary);
+        if (!stream_.good())
+        {
+          throw OrthancException(ErrorCode_InexistentFile);
+        }
+
+        size_ = static_cast<uint64_t>(boost::filesystem::file_size(path));
+      }
+
+      virtual uint64_t GetSize() const
+      {
+        return size_;
+      }
+
+      virtual void Read(void* target,
+                        uint64_t offset,
+                        size_t size)
+      {
+        // Clear the error flags that a previous, failed read (e.g. of
+        // a corrupted entry) may have left on the stream
+        stream_.clear();
+        stream_.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+        stream_.read(static_cast<char*>(target), size);
+
+        if (!stream_.good())
+        {
+          throw OrthancException(ErrorCode_CorruptedFile);
+        }
+      }
+    };
+  }
+
+
+  ZipReader::ZipReader()
+  {
+  }
+
+
+  ZipReader::~ZipReader()
+  {
+  }
+
+
+  void ZipReader::OpenMemory(const void* archive,
+                             size_t size)
+  {
+    source_.reset(new MemorySource(archive, size));
+    ReadCentralDirectory();
+  }
+
+
+  void ZipReader::OpenMemory(const std::string& archive)
+  {
+    OpenMemory(archive.c_str(), archive.size());
+  }
+
+
+  void ZipReader::OpenFile(const std::string& path)
+  {
+    source_.reset(new FileSource(path));
+    ReadCentralDirectory();
+  }
+
+
+  void ZipReader::ReadCentralDirectory()
+  {
+    entries_.clear();
+
+    const uint64_t size = source_->GetSize();
+    if (size < END_OF_CENTRAL_DIRECTORY_SIZE)
+    {
+      source_.reset();
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    try
+    {
+      // Locate the "end of central directory" record, that is
+      // followed by a comment of at most 64KB
+      uint64_t tailSize = END_OF_CENTRAL_DIRECTORY_SIZE + MAX_COMMENT_SIZE;
+      if (tailSize > size)
+      {
+        tailSize = size;
+      }
+
+      std::string tail;
+      source_->Read(tail, size - tailSize, static_cast<size_t>(tailSize));
+
+      size_t pos = tail.size() - END_OF_CENTRAL_DIRECTORY_SIZE;
+      for (;;)
+      {
+        if (ReadUInt32(tail, pos) == END_OF_CENTRAL_DIRECTORY_SIGNATURE &&
+            pos + END_OF_CENTRAL_DIRECTORY_SIZE + ReadUInt16(tail, pos + 20) == tail.size())
+        {
+          break;
+        }
+
+        if (pos == 0)
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+
+        pos--;
+      }
+
+      const uint64_t eocdOffset = size - tailSize + pos;
+
+      if (ReadUInt16(tail, pos + 4) != 0 ||
+          ReadUInt16(tail, pos + 6) != 0)
+      {
+        // Archives spanning over several disks
+        throw OrthancException(ErrorCode_NotImplemented);
+      }
+
+      uint64_t count = ReadUInt16(tail, pos + 10);
+      uint64_t directorySize = ReadUInt32(tail, pos + 12);
+      uint64_t directoryOffset = ReadUInt32(tail, pos + 16);
+
+      if (count == 0xffff ||
+          directorySize == 0xffffffff ||
+          directoryOffset == 0xffffffff)
+      {
+        // ZIP64 archive: Follow the locator that precedes the "end of
+        // central directory" record
+        if (eocdOffset < ZIP64_LOCATOR_SIZE)
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+
+        std::string locator;
+        source_->Read(locator, eocdOffset - ZIP64_LOCATOR_SIZE, ZIP64_LOCATOR_SIZE);
+        if (ReadUInt32(locator, 0) != ZIP64_LOCATOR_SIGNATURE)
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+
+        std::string eocd64;
+        source_->Read(eocd64, ReadUInt64(locator, 8), ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE);
+        if (ReadUInt32(eocd64, 0) != ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE)
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+
+        count = ReadUInt64(eocd64, 32);
+        directorySize = ReadUInt64(eocd64, 40);
+        directoryOffset = ReadUInt64(eocd64, 48);
+      }
+
+      if (directorySize > eocdOffset ||
+          directoryOffset > eocdOffset - directorySize ||
+          count > directorySize / CENTRAL_HEADER_SIZE)
+      {
+        throw OrthancException(ErrorCode_BadFileFormat);
+      }
+
+      std::string directory;
+      source_->Read(directory, directoryOffset, static_cast<size_t>(directorySize));
+
+      entries_.resize(static_cast<size_t>(count));
+
+      pos = 0;
+      for (size_t i = 0; i < entries_.size(); i++)
+      {
+        if (ReadUInt32(directory, pos) != CENTRAL_HEADER_SIGNATURE)
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+
+        if (ReadUInt16(directory, pos + 8) & 0x0001)
+        {
+          // Encrypted entry
+          throw OrthancException(ErrorCode_NotImplemented);
+        }
+
+        Entry& entry = entries_[i];
+        entry.method_ = ReadUInt16(directory, pos + 10);
+        entry.crc32_ = ReadUInt32(directory, pos + 16);
+        entry.compressedSize_ = ReadUInt32(directory, pos + 20);
+        entry.uncompressedSize_ = ReadUInt32(directory, pos + 24);
+        entry.localHeaderOffset_ = ReadUInt32(directory, pos + 42);
+
+        size_t nameLength = ReadUInt16(directory, pos + 28);
+        size_t extraLength = ReadUInt16(directory, pos + 30);
+        size_t commentLength = ReadUInt16(directory, pos + 32);
+
+        size_t next = pos + CENTRAL_HEADER_SIZE + nameLength + extraLength + commentLength;
+        if (next > directory.size())
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+
+        entry.name_ = directory.substr(pos + CENTRAL_HEADER_SIZE, nameLength);
+
+        // Look for the ZIP64 extended information, that only contains
+        // the fields whose 32bit value is saturated
+        size_t extra = pos + CENTRAL_HEADER_SIZE + nameLength;
+        const size_t extraEnd = extra + extraLength;
+        while (extra + 4 <= extraEnd)
+        {
+          uint16_t id = ReadUInt16(directory, extra);
+          size_t length = ReadUInt16(directory, extra + 2);
+          if (extra + 4 + length > extraEnd)
+          {
+            throw OrthancException(ErrorCode_BadFileFormat);
+          }
+
+          if (id == ZIP64_EXTRA_FIELD)
+          {
+            std::string field = directory.substr(extra + 4, length);
+            size_t p = 0;
+
+            if (entry.uncompressedSize_ == 0xffffffff)
+            {
+              entry.uncompressedSize_ = ReadUInt64(field, p);
+              p += 8;
+            }
+
+            if (entry.compressedSize_ == 0xffffffff)
+            {
+              entry.compressedSize_ = ReadUInt64(field, p);
+              p += 8;
+            }
+
+            if (entry.localHeaderOffset_ == 0xffffffff)
+            {
+              entry.localHeaderOffset_ = ReadUInt64(field, p);
+            }
+          }
+
+          extra += 4 + length;
+        }
+
+        pos = next;
+      }
+    }
+    catch (OrthancException&)
+    {
+      entries_.clear();
+      source_.reset();
+      throw;
+    }
+  }
+
+
+  const ZipReader::Entry& ZipReader::GetEntry(size_t index) const
+  {
+    if (source_.get() == NULL)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (index >= entries_.size())
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    return entries_[index];
+  }
+
+
+  bool ZipReader::IsDirectory(size_t index) const
+  {
+    const std::string& name = GetEntry(index).name_;
+    return (!name.empty() &&
+            (name[name.size() - 1] == '/' ||
+             name[name.size() - 1] == '\\'));
+  }
+
+
+  void ZipReader::ReadFile(std::string& content,
+                           size_t index)
+  {
+    const Entry& entry = GetEntry(index);
+
+    if (entry.method_ != METHOD_STORED &&
+        entry.method_ != METHOD_DEFLATE)
+    {
+      throw OrthancException(ErrorCode_NotImplemented);
+    }
+
+    if (static_cast<uint64_t>(static_cast<size_t>(entry.uncompressedSize_)) != entry.uncompressedSize_)
+    {
+      throw OrthancException(ErrorCode_NotEnoughMemory);
+    }
+
+    // The local header repeats the name, but its extra field may
+    // differ from that of the central directory
+    std::string header;
+    source_->Read(header, entry.localHeaderOffset_, LOCAL_HEADER_SIZE);
+    if (ReadUInt32(header, 0) != LOCAL_HEADER_SIGNATURE)
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    uint64_t offset = (entry.localHeaderOffset_ + LOCAL_HEADER_SIZE +
+                       ReadUInt16(header, 26) + ReadUInt16(header, 28));
+    if (offset > source_->GetSize() ||
+        entry.compressedSize_ > source_->GetSize() - offset)
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    // The sizes come from the archive, and cannot be trusted: Reject
+    // the sizes that no genuine entry can have, so that a forged
+    // header cannot trigger the allocation of an arbitrary amount of
+    // memory. The stored entries are bounded by the archive size.
+    if ((entry.method_ == METHOD_STORED &&
+         entry.compressedSize_ != entry.uncompressedSize_) ||
+        (entry.method_ == METHOD_DEFLATE &&
+         entry.uncompressedSize_ > entry.compressedSize_ * MAX_DEFLATE_RATIO))
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    const size_t uncompressedSize = static_cast<size_t>(entry.uncompressedSize_);
+
+    if (entry.method_ == METHOD_STORED)
+    {
+      ResizeContent(content, uncompressedSize);
+
+      if (!content.empty())
+      {
+        source_->Read(&content[0], offset, content.size());
+      }
+    }
+    else
+    {
+      // Raw deflate stream, without the zlib header
+      z_stream stream;
+      memset(&stream, 0, sizeof(stream));
+      if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+      {
+        throw OrthancException(ErrorCode_NotEnoughMemory);
+      }
+
+      std::string chunk;
+      uint64_t remaining = entry.compressedSize_;
+      size_t produced = 0;
+      int code = Z_OK;
+
+      try
+      {
+        // Even within the bound on the compression ratio, the
+        // announced size is not allocated upfront: The buffer grows
+        // as the data is actually inflated
+        ResizeContent(content, std::min(uncompressedSize, CHUNK_SIZE));
+
+        while (code != Z_STREAM_END)
+        {
+          if (produced == content.size() &&
+              content.size() < uncompressedSize)
+          {
+            ResizeContent(content, (content.size() > uncompressedSize / 2 ?
+                                    uncompressedSize : 2 * content.size()));
+          }
+
+          if (stream.avail_in == 0)
+          {
+            if (remaining == 0)
+            {
+              throw OrthancException(ErrorCode_CorruptedFile);
+            }
+
+            size_t length = (remaining < CHUNK_SIZE ? static_cast<size_t>(remaining) : CHUNK_SIZE);
+            chunk.resize(length);
+            source_->Read(&chunk[0], offset, length);
+            offset += length;
+            remaining -= length;
+
+            stream.next_in = reinterpret_cast<Bytef*>(&chunk[0]);
+            stream.avail_in = static_cast<uInt>(length);
+          }
+
+          // "avail_out" is 32bit wide: Inflate by blocks of 1GB. Once
+          // the announced size is reached, a one-byte sentinel
+          // detects the streams that would produce more data.
+          size_t available = std::min(content.size() - produced, static_cast<size_t>(1 << 30));
+          Bytef sentinel;
+          if (available == 0)
+          {
+            stream.next_out = &sentinel;
+            stream.avail_out = 1;
+          }
+          else
+          {
+            stream.next_out = reinterpret_cast<Bytef*>(&content[produced]);
+            stream.avail_out = static_cast<uInt>(available);
+          }
+
+          code = inflate(&stream, Z_NO_FLUSH);
+
+          if ((code != Z_OK && code != Z_STREAM_END) ||
+              (available == 0 && stream.avail_out == 0))
+          {
+            throw OrthancException(ErrorCode_CorruptedFile);
+          }
+
+          if (available != 0)
+          {
+            produced += available - stream.avail_out;
+          }
+        }
+      }
+      catch (OrthancException&)
+      {
+        inflateEnd(&stream);
+        throw;
+      }
+
+      inflateEnd(&stream);
+
+      if (produced != uncompressedSize)
+      {
+        throw OrthancException(ErrorCode_CorruptedFile);
+      }
+    }
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    size_t pos = 0;
+    while (pos < content.size())
+    {
+      size_t length = std::min(content.size() - pos, static_cast<size_t>(1 << 30));
+      crc = crc32(crc, reinterpret_cast<const Bytef*>(&content[pos]), static_cast<uInt>(length));
+      pos += length;
+    }
+
+    if (static_cast<uint32_t>(crc) != entry.crc32_)
+    {
+      throw OrthancException(ErrorCode_CorruptedFile);
+    }
+  }
+}
@@ -0,0 +1,116 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace Orthanc
+{
+  /**
+   * Reader for ZIP archives (including ZIP64 archives), as produced
+   * by ZipWriter or by the usual archivers. Only the "stored" and the
+   * "deflate" compression methods are supported. The archive is read
+   * either from a memory buffer, or directly from a file: In the
+   * latter case, only the central directory and the entry being
+   * extracted are loaded into memory.
+   **/
+  class ZipReader : public boost::noncopyable
+  {
+  public:
+    class ISource;
+
+  private:
+    struct Entry
+    {
+      std::string  name_;
+      uint16_t     method_;
+      uint32_t     crc32_;
+      uint64_t     compressedSize_;
+      uint64_t     uncompressedSize_;
+      uint64_t     localHeaderOffset_;
+    };
+
+    boost::shared_ptr<ISource> source_;
+    std::vector<Entry> entries_;
+
+    void ReadCentralDirectory();
+
+    const Entry& GetEntry(size_t index) const;
+
+  public:
+    ZipReader();
+
+    ~ZipReader();
+
+    /**
+     * The buffer is not copied: It must not be modified nor destroyed
+     * as long as this reader is used.
+     **/
+    void OpenMemory(const void* archive,
+                    size_t size);
+
+    void OpenMemory(const std::string& archive);
+
+    void OpenFile(const std::string& path);
+
+    bool IsOpen() const
+    {
+      return source_.get() != NULL;
+    }
+
+    size_t GetFilesCount() const
+    {
+      return entries_.size();
+    }
+
+    const std::string& GetFileName(size_t index) const
+    {
+      return GetEntry(index).name_;
+    }
+
+    uint64_t GetUncompressedSize(size_t index) const
+    {
+      return GetEntry(index).uncompressedSize_;
+    }
+
+    bool IsDirectory(size_t index) const;
+
+    void ReadFile(std::string& content,
+                  size_t index);
+  };
+}
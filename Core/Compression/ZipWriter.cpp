@@ -39,6 +39,8 @@
 #include "ZipWriter.h"
 
 #include <limits>
+#include <memory>
+#include <string.h>
 #include <boost/filesystem.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
@@ -75,9 +77,150 @@ static void PrepareFileInfo(zip_fileinfo& zfi)
 
 namespace Orthanc
 {
+  /**
+   * Seekable window over the tail of a streamed archive. Minizip
+   * only seeks backward to update the local header of the entry that
+   * is being written, so the bytes can be sent as soon as this entry
+   * is closed.
+   **/
+  class ZipWriter::StreamBuffer : public boost::noncopyable
+  {
+  private:
+    IOutputStream& stream_;
+    std::string buffer_;   // Bytes that have not been sent yet
+    uint64_t offset_;      // Offset of "buffer_" inside the archive
+    uint64_t position_;    // Current position of minizip inside the archive
+
+    static voidpf OpenCallback(voidpf opaque, const void* /*filename*/, int /*mode*/)
+    {
+      return opaque;
+    }
+
+    static uLong ReadCallback(voidpf /*opaque*/, voidpf /*stream*/, void* /*buf*/, uLong /*size*/)
+    {
+      return 0;   // Minizip never reads an archive it creates
+    }
+
+    static uLong WriteCallback(voidpf /*opaque*/, voidpf stream, const void* buf, uLong size)
+    {
+      return reinterpret_cast<StreamBuffer*>(stream)->Write(buf, size);
+    }
+
+    static ZPOS64_T TellCallback(voidpf /*opaque*/, voidpf stream)
+    {
+      return reinterpret_cast<StreamBuffer*>(stream)->position_;
+    }
+
+    static long SeekCallback(voidpf /*opaque*/, voidpf stream, ZPOS64_T offset, int origin)
+    {
+      return reinterpret_cast<StreamBuffer*>(stream)->Seek(offset, origin);
+    }
+
+    static int CloseCallback(voidpf /*opaque*/, voidpf /*stream*/)
+    {
+      return 0;
+    }
+
+    static int ErrorCallback(voidpf /*opaque*/, voidpf /*stream*/)
+    {
+      return 0;
+    }
+
+    uLong Write(const void* data, uLong size)
+    {
+      if (position_ < offset_)
+      {
+        return 0;  // These bytes have already been sent
+      }
+
+      size_t pos = static_cast<size_t>(position_ - offset_);
+      if (pos + size > buffer_.size())
+      {
+        buffer_.resize(pos + size);
+      }
+
+      if (size > 0)
+      {
+        memcpy(&buffer_[pos], data, size);
+      }
+
+      position_ += size;
+      return size;
+    }
+
+    long Seek(ZPOS64_T offset, int origin)
+    {
+      const uint64_t end = offset_ + buffer_.size();
+      uint64_t target;
+
+      switch (origin)
+      {
+        case ZLIB_FILEFUNC_SEEK_SET:
+          target = offset;
+          break;
+
+        case ZLIB_FILEFUNC_SEEK_CUR:
+          target = position_ + offset;
+          break;
+
+        case ZLIB_FILEFUNC_SEEK_END:
+          target = end + offset;
+          break;
+
+        default:
+          return -1;
+      }
+
+      if (target < offset_ || target > end)
+      {
+        return -1;
+      }
+
+      position_ = target;
+      return 0;
+    }
+
+  public:
+    StreamBuffer(IOutputStream& stream) :
+      stream_(stream),
+      offset_(0),
+      position_(0)
+    {
+    }
+
+    void SetupCallbacks(zlib_filefunc64_def& callbacks)
+    {
+      callbacks.zopen64_file = OpenCallback;
+      callbacks.zread_file = ReadCallback;
+      callbacks.zwrite_file = WriteCallback;
+      callbacks.ztell64_file = TellCallback;
+      callbacks.zseek64_file = SeekCallback;
+      callbacks.zclose_file = CloseCallback;
+      callbacks.zerror_file = ErrorCallback;
+      callbacks.opaque = this;
+    }
+
+    void Flush()
+    {
+      if (position_ != offset_ + buffer_.size())
+      {
+        throw OrthancException(ErrorCode_InternalError);
+      }
+
+      if (buffer_.size() > 0)
+      {
+        stream_.Write(buffer_);
+        offset_ += buffer_.size();
+        buffer_.clear();
+      }
+    }
+  };
+
+
   struct ZipWriter::PImpl
   {
     zipFile file_;
+    std::auto_ptr<StreamBuffer> buffer_;
 
     PImpl() : file_(NULL)
     {
@@ -89,15 +232,36 @@ namespace Orthanc
     isZip64_(false),
     hasFileInZip_(false),
     append_(false),
-    compressionLevel_(6)
+    compressionLevel_(6),
+    stream_(NULL)
   {
   }
 
   ZipWriter::~ZipWriter()
   {
+    if (IsStreaming() && IsOpen())
+    {
+      // The streamed archive was not explicitly closed, presumably
+      // because of an exception: Do not complete it, so that the
+      // receiver cannot mistake it for a full archive
+      zipClose(pimpl_->file_, NULL);
+      pimpl_->file_ = NULL;
+      pimpl_->buffer_.reset(NULL);
+    }
+
     Close();
   }
 
+  void ZipWriter::FlushStream()
+  {
+    if (pimpl_->buffer_.get() == NULL)
+    {
+      throw OrthancException(ErrorCode_InternalError);
+    }
+
+    pimpl_->buffer_->Flush();
+  }
+
   void ZipWriter::Close()
   {
     if (IsOpen())
@@ -105,6 +269,13 @@ namespace Orthanc
       zipClose(pimpl_->file_, "Created by Orthanc");
       pimpl_->file_ = NULL;
       hasFileInZip_ = false;
+
+      if (IsStreaming())
+      {
+        FlushStream();
+        pimpl_->buffer_.reset(NULL);
+        stream_->Close();
+      }
     }
   }
 
@@ -120,6 +291,29 @@ namespace Orthanc
       return;
     }
 
+    if (IsStreaming())
+    {
+      if (append_)
+      {
+        throw OrthancException("Cannot append to a streamed archive");
+      }
+
+      hasFileInZip_ = false;
+
+      zlib_filefunc64_def callbacks;
+      pimpl_->buffer_.reset(new StreamBuffer(*stream_));
+      pimpl_->buffer_->SetupCallbacks(callbacks);
+
+      pimpl_->file_ = zipOpen2_64(NULL, APPEND_STATUS_CREATE, NULL, &callbacks);
+      if (!pimpl_->file_)
+      {
+        pimpl_->buffer_.reset(NULL);
+        throw OrthancException(ErrorCode_CannotWriteFile);
+      }
+
+      return;
+    }
+
     if (path_.size() == 0)
     {
       throw OrthancException("Please call SetOutputPath() before creating the file");
@@ -153,6 +347,14 @@ namespace Orthanc
   {
     Close();
     path_ = path;
+    stream_ = NULL;
+  }
+
+  void ZipWriter::SetOutputStream(IOutputStream& stream)
+  {
+    Close();
+    path_.clear();
+    stream_ = &stream;
   }
 
   void ZipWriter::SetZip64(bool isZip64)
@@ -176,6 +378,18 @@ namespace Orthanc
   {
     Open();
 
+    if (IsStreaming() && hasFileInZip_)
+    {
+      // Complete the previous entry, then send it
+      if (zipCloseFileInZip(pimpl_->file_) != 0)
+      {
+        throw OrthancException(ErrorCode_CannotWriteFile);
+      }
+
+      hasFileInZip_ = false;
+      FlushStream();
+    }
+
     zip_fileinfo zfi;
     PrepareFileInfo(zfi);
 
@@ -35,6 +35,7 @@
 #include <stdint.h>
 #include <string>
 #include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
 
 #if ORTHANC_BUILD_UNIT_TESTS == 1
 #include <gtest/gtest_prod.h>
@@ -44,8 +45,28 @@ namespace Orthanc
 {
   class ZipWriter
   {
+  public:
+    /**
+     * Sink receiving the bytes of an archive that is streamed instead
+     * of being written to the filesystem. The chunks are received in
+     * order, and are never modified once they have been sent.
+     **/
+    class IOutputStream : public boost::noncopyable
+    {
+    public:
+      virtual ~IOutputStream()
+      {
+      }
+
+      virtual void Write(const std::string& chunk) = 0;
+
+      virtual void Close() = 0;
+    };
+
   private:
     struct PImpl;
+    class StreamBuffer;
+
     boost::shared_ptr<PImpl> pimpl_;
 
     bool isZip64_;
@@ -53,6 +74,9 @@ namespace Orthanc
     bool append_;
     uint8_t compressionLevel_;
     std::string path_;
+    IOutputStream* stream_;
+
+    void FlushStream();
 
   public:
     ZipWriter();
@@ -93,6 +117,19 @@ namespace Orthanc
       return path_;
     }
 
+    /**
+     * Stream the archive to "stream" instead of writing it to a
+     * file. Each entry of the archive is kept in memory until it is
+     * complete (so that its local header can be updated), then sent
+     * to the stream. The stream is closed together with the archive.
+     **/
+    void SetOutputStream(IOutputStream& stream);
+
+    bool IsStreaming() const
+    {
+      return stream_ != NULL;
+    }
+
     void OpenFile(const char* path);
 
     void Write(const char* data, size_t length);
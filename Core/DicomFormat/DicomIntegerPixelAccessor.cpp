@@ -44,8 +44,334 @@
 #include <cassert>
 #include <stdio.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define ORTHANC_PIXEL_DECODING_SSE2 1
+#  include <emmintrin.h>
+#else
+#  define ORTHANC_PIXEL_DECODING_SSE2 0
+#endif
+
 namespace Orthanc
 {
+  namespace
+  {
+    struct DecodingParameters
+    {
+      unsigned int  shift_;
+      uint32_t      valueMask_;  // Bits of the stored value, including the sign bit
+      uint32_t      signMask_;   // Sign bit (0 if the pixels are unsigned)
+    };
+
+
+    template <size_t bytesPerValue>
+    inline uint32_t ReadLittleEndian(const uint8_t* p);
+
+    template <>
+    inline uint32_t ReadLittleEndian<1>(const uint8_t* p)
+    {
+      return p[0];
+    }
+
+    template <>
+    inline uint32_t ReadLittleEndian<2>(const uint8_t* p)
+    {
+      return (static_cast<uint32_t>(p[0]) | 
+              (static_cast<uint32_t>(p[1]) << 8));
+    }
+
+    template <>
+    inline uint32_t ReadLittleEndian<3>(const uint8_t* p)
+    {
+      return (static_cast<uint32_t>(p[0]) | 
+              (static_cast<uint32_t>(p[1]) << 8) |
+              (static_cast<uint32_t>(p[2]) << 16));
+    }
+
+    template <>
+    inline uint32_t ReadLittleEndian<4>(const uint8_t* p)
+    {
+      return (static_cast<uint32_t>(p[0]) | 
+              (static_cast<uint32_t>(p[1]) << 8) |
+              (static_cast<uint32_t>(p[2]) << 16) |
+              (static_cast<uint32_t>(p[3]) << 24));
+    }
+
+
+    template <typename TargetType,
+              bool clamp>
+    inline TargetType ConvertValue(int32_t v)
+    {
+      if (clamp)
+      {
+        const TargetType minValue = std::numeric_limits<TargetType>::min();
+        const TargetType maxValue = std::numeric_limits<TargetType>::max();
+
+        if (v < static_cast<int32_t>(minValue))
+        {
+          return minValue;
+        }
+        else if (v > static_cast<int32_t>(maxValue))
+        {
+          return maxValue;
+        }
+      }
+
+      return static_cast<TargetType>(v);
+    }
+
+
+    /**
+     * Decodes "count" consecutive samples of the source buffer. The
+     * sign extension is branchless: If "signMask" is the sign bit,
+     * "(v ^ signMask) - signMask" is the two's complement value of
+     * "v", which is the same as in "GetValue()".
+     **/
+    template <typename TargetType,
+              size_t bytesPerValue,
+              bool isSigned,
+              bool clamp>
+    void DecodeSamples(TargetType* target,
+                       size_t targetStep,
+                       const uint8_t* source,
+                       unsigned int count,
+                       const DecodingParameters& parameters)
+    {
+      const unsigned int shift = parameters.shift_;
+      const uint32_t valueMask = parameters.valueMask_;
+      const uint32_t signMask = parameters.signMask_;
+
+      for (unsigned int i = 0; i < count; i++, target += targetStep, source += bytesPerValue)
+      {
+        uint32_t v = (ReadLittleEndian<bytesPerValue>(source) >> shift) & valueMask;
+
+        int32_t value;
+        if (isSigned)
+        {
+          value = static_cast<int32_t>(v ^ signMask) - static_cast<int32_t>(signMask);
+        }
+        else
+        {
+          value = static_cast<int32_t>(v);
+        }
+
+        *target = ConvertValue<TargetType, clamp>(value);
+      }
+    }
+
+
+    template <typename TargetType,
+              size_t bytesPerValue,
+              bool isSigned,
+              bool clamp>
+    struct SamplesDecoder
+    {
+      static void Apply(TargetType* target,
+                        size_t targetStep,
+                        const uint8_t* source,
+                        unsigned int count,
+                        const DecodingParameters& parameters)
+      {
+        DecodeSamples<TargetType, bytesPerValue, isSigned, clamp>
+          (target, targetStep, source, count, parameters);
+      }
+    };
+
+
+#if ORTHANC_PIXEL_DECODING_SSE2 == 1
+    /**
+     * 16bpp samples that fit in the 16bpp target without clamping
+     * (the most common case for CT and MR): 8 samples at once. The
+     * 16bit arithmetic is exact as "BitsStored <= 16".
+     **/
+    template <typename TargetType,
+              bool isSigned>
+    struct Samples16Decoder
+    {
+      static void Apply(TargetType* target,
+                        size_t targetStep,
+                        const uint8_t* source,
+                        unsigned int count,
+                        const DecodingParameters& parameters)
+      {
+        unsigned int i = 0;
+
+        if (targetStep == 1)
+        {
+          const __m128i shift = _mm_cvtsi32_si128(parameters.shift_);
+          const __m128i valueMask = _mm_set1_epi16(static_cast<short>(parameters.valueMask_));
+          const __m128i signMask = _mm_set1_epi16(static_cast<short>(parameters.signMask_));
+
+          for (; i + 8 <= count; i += 8, source += 16, target += 8)
+          {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+            v = _mm_and_si128(_mm_srl_epi16(v, shift), valueMask);
+
+            if (isSigned)
+            {
+              v = _mm_sub_epi16(_mm_xor_si128(v, signMask), signMask);
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(target), v);
+          }
+        }
+
+        DecodeSamples<TargetType, 2, isSigned, false>
+          (target, targetStep, source, count - i, parameters);
+      }
+    };
+
+    template <>
+    struct SamplesDecoder<uint16_t, 2, false, false> : public Samples16Decoder<uint16_t, false>
+    {
+    };
+
+    template <>
+    struct SamplesDecoder<int16_t, 2, true, false> : public Samples16Decoder<int16_t, true>
+    {
+    };
+#endif
+
+
+    template <typename TargetType,
+              size_t bytesPerValue,
+              bool isSigned,
+              bool clamp>
+    void DecodeFrame(ImageAccessor& target,
+                     const DicomImageInformation& information,
+                     const uint8_t* frame,
+                     size_t frameOffset,
+                     size_t rowOffset,
+                     const DecodingParameters& parameters)
+    {
+      typedef SamplesDecoder<TargetType, bytesPerValue, isSigned, clamp>  Decoder;
+
+      const unsigned int width = information.GetWidth();
+      const unsigned int height = information.GetHeight();
+      const unsigned int channels = information.GetChannelCount();
+
+      if (!information.IsPlanar() || 
+          channels == 1)
+      {
+        // The samples of one row are contiguous, both in the source
+        // and in the target images
+        for (unsigned int y = 0; y < height; y++)
+        {
+          Decoder::Apply(reinterpret_cast<TargetType*>(target.GetRow(y)), 1,
+                         frame + y * rowOffset, width * channels, parameters);
+        }
+      }
+      else
+      {
+        // Each color plane is contiguous in the source image
+        const size_t planeOffset = frameOffset / channels;
+
+        for (unsigned int y = 0; y < height; y++)
+        {
+          TargetType* row = reinterpret_cast<TargetType*>(target.GetRow(y));
+
+          for (unsigned int c = 0; c < channels; c++)
+          {
+            Decoder::Apply(row + c, channels, frame + c * planeOffset + y * rowOffset,
+                           width, parameters);
+          }
+        }
+      }
+    }
+
+
+    template <typename TargetType,
+              size_t bytesPerValue>
+    void DecodeFrame(ImageAccessor& target,
+                     const DicomImageInformation& information,
+                     const uint8_t* frame,
+                     size_t frameOffset,
+                     size_t rowOffset,
+                     const DecodingParameters& parameters)
+    {
+      // Clamping is only needed if the range of the stored values
+      // does not fit in the range of the target pixel format
+      int64_t minValue, maxValue;
+      if (information.IsSigned())
+      {
+        minValue = -static_cast<int64_t>(parameters.signMask_);
+        maxValue = static_cast<int64_t>(parameters.signMask_) - 1;
+      }
+      else
+      {
+        minValue = 0;
+        maxValue = static_cast<int64_t>(parameters.valueMask_);
+      }
+
+      bool clamp = (minValue < static_cast<int64_t>(std::numeric_limits<TargetType>::min()) ||
+                    maxValue > static_cast<int64_t>(std::numeric_limits<TargetType>::max()));
+
+      if (information.IsSigned())
+      {
+        if (clamp)
+        {
+          DecodeFrame<TargetType, bytesPerValue, true, true>
+            (target, information, frame, frameOffset, rowOffset, parameters);
+        }
+        else
+        {
+          DecodeFrame<TargetType, bytesPerValue, true, false>
+            (target, information, frame, frameOffset, rowOffset, parameters);
+        }
+      }
+      else
+      {
+        if (clamp)
+        {
+          DecodeFrame<TargetType, bytesPerValue, false, true>
+            (target, information, frame, frameOffset, rowOffset, parameters);
+        }
+        else
+        {
+          DecodeFrame<TargetType, bytesPerValue, false, false>
+            (target, information, frame, frameOffset, rowOffset, parameters);
+        }
+      }
+    }
+
+
+    template <typename TargetType>
+    void DecodeFrame(ImageAccessor& target,
+                     const DicomImageInformation& information,
+                     const uint8_t* frame,
+                     size_t frameOffset,
+                     size_t rowOffset,
+                     const DecodingParameters& parameters)
+    {
+      if (target.GetBytesPerPixel() != information.GetChannelCount() * sizeof(TargetType))
+      {
+        throw OrthancException(ErrorCode_IncompatibleImageFormat);
+      }
+
+      switch (information.GetBytesPerValue())
+      {
+        case 1:
+          DecodeFrame<TargetType, 1>(target, information, frame, frameOffset, rowOffset, parameters);
+          break;
+
+        case 2:
+          DecodeFrame<TargetType, 2>(target, information, frame, frameOffset, rowOffset, parameters);
+          break;
+
+        case 3:
+          DecodeFrame<TargetType, 3>(target, information, frame, frameOffset, rowOffset, parameters);
+          break;
+
+        case 4:
+          DecodeFrame<TargetType, 4>(target, information, frame, frameOffset, rowOffset, parameters);
+          break;
+
+        default:
+          throw OrthancException(ErrorCode_NotImplemented);
+      }
+    }
+  }
+
+
   DicomIntegerPixelAccessor::DicomIntegerPixelAccessor(const DicomMap& values,
                                                        const void* pixelData,
                                                        size_t size) :
@@ -194,4 +520,40 @@ namespace Orthanc
     frame_ = frame;
   }
 
+
+  void DicomIntegerPixelAccessor::ExtractFrame(ImageAccessor& target) const
+  {
+    if (target.GetWidth() != information_.GetWidth() ||
+        target.GetHeight() != information_.GetHeight())
+    {
+      throw OrthancException(ErrorCode_IncompatibleImageSize);
+    }
+
+    DecodingParameters parameters;
+    parameters.shift_ = information_.GetShift();
+    parameters.valueMask_ = mask_ | signMask_;
+    parameters.signMask_ = signMask_;
+
+    const uint8_t* frame = reinterpret_cast<const uint8_t*>(pixelData_) + frame_ * frameOffset_;
+
+    switch (target.GetFormat())
+    {
+      case PixelFormat_RGB24:
+      case PixelFormat_RGBA32:
+      case PixelFormat_Grayscale8:
+        DecodeFrame<uint8_t>(target, information_, frame, frameOffset_, rowOffset_, parameters);
+        break;
+        
+      case PixelFormat_Grayscale16:
+        DecodeFrame<uint16_t>(target, information_, frame, frameOffset_, rowOffset_, parameters);
+        break;
+
+      case PixelFormat_SignedGrayscale16:
+        DecodeFrame<int16_t>(target, information_, frame, frameOffset_, rowOffset_, parameters);
+        break;
+
+      default:
+        throw OrthancException(ErrorCode_NotImplemented);
+    }
+  }
 }
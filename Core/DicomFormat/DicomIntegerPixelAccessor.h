@@ -35,6 +35,7 @@
 #include "DicomMap.h"
 
 #include "DicomImageInformation.h"
+#include "../ImageFormats/ImageAccessor.h"
 
 #include <stdint.h>
 
@@ -76,6 +77,15 @@ namespace Orthanc
 
     int32_t GetValue(unsigned int x, unsigned int y, unsigned int channel = 0) const;
 
+    /**
+     * Decodes the current frame into "target", whose size must match
+     * that of the image. The result is the same as calling
+     * "GetValue()" on each sample and clamping the value to the range
+     * of the target pixel format, but the inner loops are specialized
+     * according to the layout of the pixel data.
+     **/
+    void ExtractFrame(ImageAccessor& target) const;
+
     const void* GetPixelData() const
     {
       return pixelData_;
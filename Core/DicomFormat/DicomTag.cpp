@@ -254,4 +254,20 @@ namespace Orthanc
             *this == DICOM_TAG_SERIES_INSTANCE_UID ||
             *this == DICOM_TAG_SOP_INSTANCE_UID);
   }
+
+
+  bool DicomTag::IsSearchable() const
+  {
+    // Main DICOM tags (other than the identifiers) whose values are
+    // indexed, as they are frequently used as C-FIND matching keys
+    return (*this == DICOM_TAG_PATIENT_NAME ||
+            *this == DICOM_TAG_PATIENT_BIRTH_DATE ||
+            *this == DICOM_TAG_PATIENT_SEX ||
+            *this == DICOM_TAG_STUDY_DATE ||
+            *this == DICOM_TAG_STUDY_DESCRIPTION ||
+            *this == DICOM_TAG_STUDY_ID ||
+            *this == DICOM_TAG_SERIES_DATE ||
+            *this == DICOM_TAG_SERIES_DESCRIPTION ||
+            *this == DICOM_TAG_MODALITY);
+  }
 }
@@ -46,6 +46,15 @@ namespace Orthanc
   FileInfo CompressedFileStorageAccessor::WriteInternal(const void* data,
                                                         size_t size,
                                                         FileContentType type)
+  {
+    return Write(data, size, type, compressionType_);
+  }
+
+
+  FileInfo CompressedFileStorageAccessor::Write(const void* data,
+                                                size_t size,
+                                                FileContentType type,
+                                                CompressionType compression)
   {
     std::string uuid = Toolbox::GenerateUuid();
 
@@ -56,7 +65,7 @@ namespace Orthanc
       Toolbox::ComputeMD5(md5, data, size);
     }
 
-    switch (compressionType_)
+    switch (compression)
     {
     case CompressionType_None:
     {
@@ -66,8 +75,12 @@ namespace Orthanc
 
     case CompressionType_Zlib:
     {
+      // The zlib compressor keeps no state between two calls: Using
+      // a local instance avoids any locking between the writers
+      ZlibCompressor zlib;
+
       std::string compressed;
-      zlib_.Compress(compressed, data, size);
+      zlib.Compress(compressed, data, size);
 
       std::string compressedMD5;
       
@@ -95,6 +108,42 @@ namespace Orthanc
   }
 
 
+  FileInfo CompressedFileStorageAccessor::Write(const std::string& content,
+                                                FileContentType type,
+                                                CompressionType compression)
+  {
+    if (content.size() == 0)
+    {
+      return Write(NULL, 0, type, compression);
+    }
+    else
+    {
+      return Write(&content[0], content.size(), type, compression);
+    }
+  }
+
+
+  FileInfo CompressedFileStorageAccessor::WriteFile(const std::string& path,
+                                                    uint64_t size,
+                                                    const std::string& md5,
+                                                    FileContentType type,
+                                                    CompressionType compression)
+  {
+    if (compression != CompressionType_None)
+    {
+      // The compression needs the whole file in memory
+      std::string content;
+      Toolbox::ReadFile(content, path);
+      return Write(content, type, compression);
+    }
+
+    std::string uuid = Toolbox::GenerateUuid();
+    GetStorageArea().CreateFromFile(uuid, path, type);
+
+    return FileInfo(uuid, type, size, storeMD5_ ? md5 : std::string());
+  }
+
+
   CompressedFileStorageAccessor::CompressedFileStorageAccessor() : 
     storage_(NULL),
     compressionType_(CompressionType_None)
@@ -125,7 +174,16 @@ namespace Orthanc
                                            const std::string& uuid,
                                            FileContentType type)
   {
-    switch (compressionType_)
+    Read(content, uuid, type, compressionType_);
+  }
+
+
+  void CompressedFileStorageAccessor::Read(std::string& content,
+                                           const std::string& uuid,
+                                           FileContentType type,
+                                           CompressionType compression)
+  {
+    switch (compression)
     {
     case CompressionType_None:
       GetStorageArea().Read(content, uuid, type);
@@ -135,7 +193,9 @@ namespace Orthanc
     {
       std::string compressed;
       GetStorageArea().Read(compressed, uuid, type);
-      zlib_.Uncompress(content, compressed);
+
+      ZlibCompressor zlib;
+      zlib.Uncompress(content, compressed);
       break;
     }
 
@@ -144,10 +204,52 @@ namespace Orthanc
     }
   }
 
+  void CompressedFileStorageAccessor::ReadRange(std::string& content,
+                                                const std::string& uuid,
+                                                FileContentType type,
+                                                CompressionType compression,
+                                                uint64_t start,
+                                                uint64_t end)
+  {
+    switch (compression)
+    {
+    case CompressionType_None:
+      GetStorageArea().ReadRange(content, uuid, type, start, end);
+      break;
+
+    case CompressionType_Zlib:
+    {
+      std::string uncompressed;
+      Read(uncompressed, uuid, type, compression);
+
+      if (start > end ||
+          end > uncompressed.size())
+      {
+        throw OrthancException(ErrorCode_ParameterOutOfRange);
+      }
+
+      content.assign(uncompressed, static_cast<size_t>(start), static_cast<size_t>(end - start));
+      break;
+    }
+
+    default:
+      throw OrthancException(ErrorCode_NotImplemented);
+    }
+  }
+
+
   HttpFileSender* CompressedFileStorageAccessor::ConstructHttpFileSender(const std::string& uuid,
                                                                          FileContentType type)
   {
-    switch (compressionType_)
+    return ConstructHttpFileSender(uuid, type, compressionType_);
+  }
+
+
+  HttpFileSender* CompressedFileStorageAccessor::ConstructHttpFileSender(const std::string& uuid,
+                                                                         FileContentType type,
+                                                                         CompressionType compression)
+  {
+    switch (compression)
     {
     case CompressionType_None:
     {
@@ -161,7 +263,9 @@ namespace Orthanc
       GetStorageArea().Read(compressed, uuid, type);
 
       std::auto_ptr<BufferHttpSender> sender(new BufferHttpSender);
-      zlib_.Uncompress(sender->GetBuffer(), compressed);
+
+      ZlibCompressor zlib;
+      zlib.Uncompress(sender->GetBuffer(), compressed);
 
       return sender.release();
     }        
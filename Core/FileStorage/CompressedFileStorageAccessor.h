@@ -42,7 +42,6 @@ namespace Orthanc
   {
   private:
     IStorageArea* storage_;
-    ZlibCompressor zlib_;
     CompressionType compressionType_;
 
   protected:
@@ -84,6 +83,56 @@ namespace Orthanc
     virtual HttpFileSender* ConstructHttpFileSender(const std::string& uuid,
                                                     FileContentType type);
 
+    /**
+     * The following methods do not depend on the compression that is
+     * set by "SetCompressionForNextOperations()", and do not modify
+     * the state of the accessor. They can therefore be invoked
+     * concurrently from several threads on the same accessor, as
+     * long as the underlying storage area is itself thread-safe (as
+     * "FilesystemStorage" is).
+     **/
+
+    using StorageAccessor::Write;
+
+    FileInfo Write(const void* data,
+                   size_t size,
+                   FileContentType type,
+                   CompressionType compression);
+
+    FileInfo Write(const std::string& content,
+                   FileContentType type,
+                   CompressionType compression);
+
+    /**
+     * Stores the content of a file of the local filesystem, whose
+     * size and MD5 hash are already known (e.g. because they were
+     * computed while receiving the file). Without compression, the
+     * file is adopted by the storage area without being read.
+     **/
+    FileInfo WriteFile(const std::string& path,
+                       uint64_t size,
+                       const std::string& md5,
+                       FileContentType type,
+                       CompressionType compression);
+
+    void Read(std::string& content,
+              const std::string& uuid,
+              FileContentType type,
+              CompressionType compression);
+
+    // Reads the bytes [start, end) of the uncompressed file. Only the
+    // uncompressed files benefit from random access.
+    void ReadRange(std::string& content,
+                   const std::string& uuid,
+                   FileContentType type,
+                   CompressionType compression,
+                   uint64_t start,
+                   uint64_t end);
+
+    HttpFileSender* ConstructHttpFileSender(const std::string& uuid,
+                                            FileContentType type,
+                                            CompressionType compression);
+
     virtual void Remove(const std::string& uuid,
                         FileContentType type);
   };
@@ -34,6 +34,7 @@
 #include "FileStorageAccessor.h"
 
 #include "../HttpServer/BufferHttpSender.h"
+#include "../HttpServer/FilesystemHttpSender.h"
 #include "../Uuid.h"
 
 #include <memory>
@@ -62,6 +63,16 @@ namespace Orthanc
   HttpFileSender* FileStorageAccessor::ConstructHttpFileSender(const std::string& uuid,
                                                                FileContentType type)
   {
+    FilesystemStorage* filesystem = dynamic_cast<FilesystemStorage*>(&storage_);
+    if (filesystem != NULL)
+    {
+      // Stream the file directly from the filesystem, without loading
+      // it entirely in RAM
+      std::auto_ptr<FilesystemHttpSender> sender(new FilesystemHttpSender(*filesystem, uuid));
+      sender->ResetContentType();
+      return sender.release();
+    }
+
     std::auto_ptr<BufferHttpSender> sender(new BufferHttpSender);
 
     storage_.Read(sender->GetBuffer(), uuid, type);
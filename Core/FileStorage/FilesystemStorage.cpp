@@ -85,10 +85,9 @@ namespace Orthanc
     Toolbox::CreateDirectory(root);
   }
 
-  void FilesystemStorage::Create(const std::string& uuid,
-                                 const void* content, 
-                                 size_t size,
-                                 FileContentType /*type*/)
+  // Returns the path to a new file of the storage area, after having
+  // created its parent directory if need be
+  boost::filesystem::path FilesystemStorage::PrepareNewFile(const std::string& uuid) const
   {
     boost::filesystem::path path;
     
@@ -110,12 +109,26 @@ namespace Orthanc
     }
     else
     {
-      if (!boost::filesystem::create_directories(path.parent_path()))
+      // Another thread may be concurrently creating the same
+      // subdirectory: Only fail if the directory is still missing
+      if (!boost::filesystem::create_directories(path.parent_path()) &&
+          !boost::filesystem::is_directory(path.parent_path()))
       {
         throw OrthancException("Unable to create a subdirectory in the file storage");        
       }
     }
 
+    return path;
+  }
+
+
+  void FilesystemStorage::Create(const std::string& uuid,
+                                 const void* content, 
+                                 size_t size,
+                                 FileContentType /*type*/)
+  {
+    boost::filesystem::path path = PrepareNewFile(uuid);
+
     boost::filesystem::ofstream f;
     f.open(path, std::ofstream::out | std::ios::binary);
     if (!f.good())
@@ -137,6 +150,36 @@ namespace Orthanc
   }
 
 
+  void FilesystemStorage::CreateFromFile(const std::string& uuid,
+                                         const std::string& source,
+                                         FileContentType /*type*/)
+  {
+    boost::filesystem::path path = PrepareNewFile(uuid);
+
+    try
+    {
+      // A hard link makes the source file part of the storage area,
+      // without copying it. The source file can then be removed.
+      boost::filesystem::create_hard_link(source, path);
+      return;
+    }
+    catch (boost::filesystem::filesystem_error&)
+    {
+      // Hard links are unavailable, for instance because the source
+      // file lies on another filesystem: Fall back to a copy
+    }
+
+    try
+    {
+      boost::filesystem::copy_file(source, path);
+    }
+    catch (boost::filesystem::filesystem_error&)
+    {
+      throw OrthancException("Unable to copy a file into the file storage");
+    }
+  }
+
+
   void FilesystemStorage::Read(std::string& content,
                                const std::string& uuid,
                                FileContentType /*type*/)
@@ -146,6 +189,47 @@ namespace Orthanc
   }
 
 
+  void FilesystemStorage::ReadRange(std::string& content,
+                                    const std::string& uuid,
+                                    FileContentType /*type*/,
+                                    uint64_t start,
+                                    uint64_t end)
+  {
+    boost::filesystem::path path = GetPath(uuid);
+
+    if (start > end ||
+        end > static_cast<uint64_t>(boost::filesystem::file_size(path)))
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    content.resize(static_cast<size_t>(end - start));
+
+    if (content.empty())
+    {
+      return;
+    }
+
+    boost::filesystem::ifstream f;
+    f.open(path, std::ifstream::in | std::ios::binary);
+    if (!f.good())
+    {
+      throw OrthancException(ErrorCode_InexistentFile);
+    }
+
+    f.seekg(static_cast<std::streamoff>(start), std::ios::beg);
+    f.read(&content[0], content.size());
+
+    if (!f.good())
+    {
+      f.close();
+      throw OrthancException(ErrorCode_InexistentFile);
+    }
+
+    f.close();
+  }
+
+
   uintmax_t FilesystemStorage::GetSize(const std::string& uuid) const
   {
     boost::filesystem::path path = GetPath(uuid);
@@ -50,6 +50,8 @@ namespace Orthanc
 
     boost::filesystem::path GetPath(const std::string& uuid) const;
 
+    boost::filesystem::path PrepareNewFile(const std::string& uuid) const;
+
   public:
     FilesystemStorage(std::string root);
 
@@ -58,6 +60,10 @@ namespace Orthanc
                         size_t size,
                         FileContentType type);
 
+    virtual void CreateFromFile(const std::string& uuid,
+                                const std::string& path,
+                                FileContentType type);
+
     virtual void Read(std::string& content,
                       const std::string& uuid,
                       FileContentType type);
@@ -65,6 +71,12 @@ namespace Orthanc
     virtual void Remove(const std::string& uuid,
                         FileContentType type);
 
+    virtual void ReadRange(std::string& content,
+                           const std::string& uuid,
+                           FileContentType type,
+                           uint64_t start,
+                           uint64_t end);
+
     void ListAllFiles(std::set<std::string>& result) const;
 
     uintmax_t GetSize(const std::string& uuid) const;
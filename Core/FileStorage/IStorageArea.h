@@ -33,7 +33,11 @@
 #pragma once
 
 #include "../Enumerations.h"
+#include "../OrthancException.h"
+#include "../Toolbox.h"
 
+#include <string>
+#include <stdint.h>
 #include <boost/noncopyable.hpp>
 
 namespace Orthanc
@@ -50,11 +54,58 @@ namespace Orthanc
                         size_t size,
                         FileContentType type) = 0;
 
+    /**
+     * Creates a file whose content is that of a file of the local
+     * filesystem, which is left untouched. This default
+     * implementation reads the source file into memory: The storage
+     * areas that are backed by the filesystem should override it, in
+     * order to avoid this copy.
+     **/
+    virtual void CreateFromFile(const std::string& uuid,
+                                const std::string& path,
+                                FileContentType type)
+    {
+      std::string content;
+      Toolbox::ReadFile(content, path);
+
+      if (content.empty())
+      {
+        Create(uuid, NULL, 0, type);
+      }
+      else
+      {
+        Create(uuid, content.c_str(), content.size(), type);
+      }
+    }
+
     virtual void Read(std::string& content,
                       const std::string& uuid,
                       FileContentType type) = 0;
 
     virtual void Remove(const std::string& uuid,
                         FileContentType type) = 0;
+
+    /**
+     * Reads the bytes in the range [start, end) of a file. This
+     * default implementation reads the whole file: The storage areas
+     * that provide random access should override it.
+     **/
+    virtual void ReadRange(std::string& content,
+                           const std::string& uuid,
+                           FileContentType type,
+                           uint64_t start,
+                           uint64_t end)
+    {
+      std::string whole;
+      Read(whole, uuid, type);
+
+      if (start > end ||
+          end > whole.size())
+      {
+        throw OrthancException(ErrorCode_ParameterOutOfRange);
+      }
+
+      content.assign(whole, static_cast<size_t>(start), static_cast<size_t>(end - start));
+    }
   };
 }
@@ -142,6 +142,32 @@ namespace Orthanc
   }
 
 
+  void HttpClient::SetContentType(const std::string& contentType)
+  {
+    struct curl_slist *headers = curl_slist_append(NULL, "Expect:");
+    if (headers == NULL)
+    {
+      throw OrthancException(ErrorCode_NotEnoughMemory);
+    }
+
+    if (!contentType.empty())
+    {
+      struct curl_slist *tmp = curl_slist_append(headers, ("Content-Type: " + contentType).c_str());
+      if (tmp == NULL)
+      {
+        curl_slist_free_all(headers);
+        throw OrthancException(ErrorCode_NotEnoughMemory);
+      }
+
+      headers = tmp;
+    }
+
+    curl_slist_free_all(pimpl_->postHeaders_);
+    pimpl_->postHeaders_ = headers;
+    contentType_ = contentType;
+  }
+
+
   void HttpClient::SetVerbose(bool isVerbose)
   {
     isVerbose_ = isVerbose;
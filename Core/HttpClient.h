@@ -54,6 +54,7 @@ namespace Orthanc
     bool isVerbose_;
     long timeout_;
     std::string proxy_;
+    std::string contentType_;
 
     void Setup();
 
@@ -116,6 +117,17 @@ namespace Orthanc
       return postData_;
     }
 
+    /**
+     * Sets the "Content-Type" HTTP header of the body of the POST and
+     * PUT requests. If empty, libcurl uses its default content type.
+     **/
+    void SetContentType(const std::string& contentType);
+
+    const std::string& GetContentType() const
+    {
+      return contentType_;
+    }
+
     void SetVerbose(bool isVerbose);
 
     bool IsVerbose() const
@@ -56,6 +56,28 @@ namespace Orthanc
       return true;
     }
 
+    virtual bool IsRangeSupported()
+    {
+      return true;
+    }
+
+    virtual bool SendRange(HttpOutput& output,
+                           uint64_t start,
+                           uint64_t length)
+    {
+      if (start + length > buffer_.size())
+      {
+        return false;
+      }
+
+      if (length > 0)
+      {
+        output.SendBody(&buffer_[start], length);
+      }
+
+      return true;
+    }
+
   public:
     std::string& GetBuffer() 
     {
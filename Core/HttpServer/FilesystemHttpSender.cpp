@@ -35,6 +35,7 @@
 #include "../Toolbox.h"
 
 #include <stdio.h>
+#include <boost/filesystem/fstream.hpp>
 
 namespace Orthanc
 {
@@ -56,17 +57,22 @@ namespace Orthanc
 
   bool FilesystemHttpSender::SendData(HttpOutput& output)
   {
-    FILE* fp = fopen(path_.string().c_str(), "rb");
-    if (!fp)
+    // The stream is closed by its destructor, even if the client
+    // disconnects while the file is being sent
+    boost::filesystem::ifstream f;
+    f.open(path_, std::ifstream::in | std::ifstream::binary);
+    if (!f.good())
     {
       return false;
     }
 
-    std::vector<uint8_t> buffer(1024 * 1024);  // Chunks of 1MB
+    std::vector<char> buffer(1024 * 1024);  // Chunks of 1MB
 
     for (;;)
     {
-      size_t nbytes = fread(&buffer[0], 1, buffer.size(), fp);
+      f.read(&buffer[0], buffer.size());
+
+      size_t nbytes = static_cast<size_t>(f.gcount());
       if (nbytes == 0)
       {
         break;
@@ -77,11 +83,49 @@ namespace Orthanc
       }
     }
 
-    fclose(fp);
+    return true;
+  }
+
+  bool FilesystemHttpSender::SendRange(HttpOutput& output,
+                                       uint64_t start,
+                                       uint64_t length)
+  {
+    boost::filesystem::ifstream f;
+    f.open(path_, std::ifstream::in | std::ifstream::binary);
+    if (!f.good())
+    {
+      return false;
+    }
+
+    f.seekg(static_cast<std::streamoff>(start), std::ios::beg);
+    if (!f.good())
+    {
+      return false;
+    }
+
+    // The file is streamed by chunks of 1MB, so that it is never
+    // entirely loaded in RAM
+    std::vector<char> buffer(1024 * 1024);
+
+    while (length > 0)
+    {
+      size_t chunk = (length < buffer.size() ? 
+                      static_cast<size_t>(length) : buffer.size());
+
+      f.read(&buffer[0], chunk);
+      if (static_cast<size_t>(f.gcount()) != chunk)
+      {
+        return false;
+      }
+
+      output.SendBody(&buffer[0], chunk);
+      length -= chunk;
+    }
 
     return true;
   }
 
+
   FilesystemHttpSender::FilesystemHttpSender(const char* path)
   {
     path_ = std::string(path);
@@ -48,6 +48,15 @@ namespace Orthanc
 
     virtual bool SendData(HttpOutput& output);
 
+    virtual bool IsRangeSupported()
+    {
+      return true;
+    }
+
+    virtual bool SendRange(HttpOutput& output,
+                           uint64_t start,
+                           uint64_t length);
+
   public:
     FilesystemHttpSender(const char* path);
 
@@ -34,11 +34,102 @@
 #include "HttpFileSender.h"
 
 #include "../OrthancException.h"
+#include "../Toolbox.h"
 
+#include <string.h>
 #include <boost/lexical_cast.hpp>
 
 namespace Orthanc
 {
+  namespace
+  {
+    enum RangeStatus
+    {
+      RangeStatus_Satisfiable,
+      RangeStatus_Unsatisfiable,
+      RangeStatus_Ignored   // Invalid or unsupported range
+    };
+  }
+
+
+  static RangeStatus ParseRange(uint64_t& start,
+                                uint64_t& end,
+                                const std::string& range,
+                                uint64_t size)
+  {
+    // Only single byte ranges are supported: "bytes=first-last",
+    // "bytes=first-" and "bytes=-suffixLength". A range that is
+    // invalid or not supported is ignored (RFC 7233, Section 3.1).
+
+    static const char* PREFIX = "bytes=";
+    if (range.compare(0, strlen(PREFIX), PREFIX) != 0 ||
+        range.find(',') != std::string::npos)
+    {
+      return RangeStatus_Ignored;
+    }
+
+    std::string spec = Toolbox::StripSpaces(range.substr(strlen(PREFIX)));
+    size_t separator = spec.find('-');
+    if (separator == std::string::npos)
+    {
+      return RangeStatus_Ignored;
+    }
+
+    std::string first = Toolbox::StripSpaces(spec.substr(0, separator));
+    std::string last = Toolbox::StripSpaces(spec.substr(separator + 1));
+
+    try
+    {
+      if (first.empty())
+      {
+        // Suffix range
+        uint64_t suffix = boost::lexical_cast<uint64_t>(last);
+        if (suffix == 0 || size == 0)
+        {
+          return RangeStatus_Unsatisfiable;
+        }
+
+        start = (suffix >= size ? 0 : size - suffix);
+        end = size - 1;
+      }
+      else
+      {
+        start = boost::lexical_cast<uint64_t>(first);
+
+        if (last.empty())
+        {
+          end = size - 1;
+        }
+        else
+        {
+          end = boost::lexical_cast<uint64_t>(last);
+          if (start > end)
+          {
+            // Syntactically invalid (RFC 7233, Section 2.1)
+            return RangeStatus_Ignored;
+          }
+        }
+
+        if (start >= size)
+        {
+          return RangeStatus_Unsatisfiable;
+        }
+
+        if (end >= size)
+        {
+          end = size - 1;
+        }
+      }
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+      return RangeStatus_Ignored;
+    }
+
+    return RangeStatus_Satisfiable;
+  }
+
+
   void HttpFileSender::SendHeader(HttpOutput& output)
   {
     if (contentType_.size() > 0)
@@ -51,12 +142,16 @@ namespace Orthanc
       output.SetContentFilename(downloadFilename_.c_str());
     }
 
-    output.SetContentLength(GetFileSize());
+    if (IsRangeSupported())
+    {
+      output.AddHeader("Accept-Ranges", "bytes");
+    }
   }
 
   void HttpFileSender::Send(HttpOutput& output)
   {
     SendHeader(output);
+    output.SetContentLength(GetFileSize());
 
     if (!SendData(output))
     {
@@ -64,4 +159,46 @@ namespace Orthanc
       //output.SendHeader(HttpStatus_500_InternalServerError);
     }
   }
+
+
+  void HttpFileSender::Send(HttpOutput& output,
+                            const std::string& range)
+  {
+    if (range.empty() ||
+        !IsRangeSupported())
+    {
+      Send(output);
+      return;
+    }
+
+    uint64_t size = GetFileSize();
+    uint64_t start, end;
+
+    switch (ParseRange(start, end, range, size))
+    {
+      case RangeStatus_Satisfiable:
+        break;
+
+      case RangeStatus_Unsatisfiable:
+        output.SendRangeNotSatisfiable(size);
+        return;
+
+      case RangeStatus_Ignored:
+        // Multiple ranges, unknown units or invalid range: Send the
+        // full content, as allowed by the HTTP specification
+        Send(output);
+        return;
+
+      default:
+        throw OrthancException(ErrorCode_InternalError);
+    }
+
+    SendHeader(output);
+    output.SetPartialContent(start, end, size);
+
+    if (!SendRange(output, start, end - start + 1))
+    {
+      throw OrthancException(ErrorCode_InternalError);
+    }
+  }
 }
@@ -49,6 +49,20 @@ namespace Orthanc
 
     virtual bool SendData(HttpOutput& output) = 0;
 
+    // Senders that can efficiently send a part of their content
+    // override these methods to support HTTP range requests
+    virtual bool IsRangeSupported()
+    {
+      return false;
+    }
+
+    virtual bool SendRange(HttpOutput& output,
+                           uint64_t start,
+                           uint64_t length)
+    {
+      return false;
+    }
+
   public:
     virtual ~HttpFileSender()
     {
@@ -85,5 +99,10 @@ namespace Orthanc
     }
 
     void Send(HttpOutput& output);
+
+    // "range" is the value of the "Range" HTTP header of the request
+    // (an empty string if absent)
+    void Send(HttpOutput& output,
+              const std::string& range);
   };
 }
@@ -35,6 +35,8 @@
 
 #include <string.h>
 #include <iostream>
+#include <algorithm>
+#include <boost/lexical_cast.hpp>
 
 
 namespace Orthanc
@@ -64,6 +66,17 @@ namespace Orthanc
   }
 
 
+  bool HttpHandler::HandleUploadedFile(HttpOutput& output,
+                                       HttpMethod method,
+                                       const UriComponents& uri,
+                                       const Arguments& headers,
+                                       const Arguments& getArguments,
+                                       const HttpUploadedFile& body)
+  {
+    return false;
+  }
+
+
   void HttpHandler::ParseGetArguments(HttpHandler::Arguments& result, const char* query)
   {
     const char* pos = query;
@@ -159,4 +172,86 @@ namespace Orthanc
       }
     }
   }
+
+
+  bool HttpHandler::LookupAcceptedQuality(float& quality,
+                                          const std::string& accept,
+                                          const std::string& mimeType)
+  {
+    if (Toolbox::StripSpaces(accept).empty())
+    {
+      quality = 1.0f;
+      return false;
+    }
+
+    std::string mime;
+    Toolbox::ToLowerCase(mime, mimeType);
+    std::string wildcard = mime.substr(0, mime.find('/')) + "/*";
+
+    // The most specific media range applies: 2 for an exact match, 1
+    // for "type/*", 0 for "*/*", and -1 if no range has matched
+    int specificity = -1;
+    quality = 0.0f;
+
+    std::vector<std::string> ranges;
+    Toolbox::TokenizeString(ranges, accept, ',');
+
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+      std::vector<std::string> tokens;
+      Toolbox::TokenizeString(tokens, ranges[i], ';');
+
+      std::string range;
+      Toolbox::ToLowerCase(range, Toolbox::StripSpaces(tokens[0]));
+
+      int s;
+      if (range == mime)
+      {
+        s = 2;
+      }
+      else if (range == wildcard)
+      {
+        s = 1;
+      }
+      else if (range == "*/*")
+      {
+        s = 0;
+      }
+      else
+      {
+        continue;
+      }
+
+      if (s <= specificity)
+      {
+        continue;
+      }
+
+      float q = 1.0f;
+      for (size_t j = 1; j < tokens.size(); j++)
+      {
+        std::string parameter = Toolbox::StripSpaces(tokens[j]);
+        if (parameter.size() > 2 &&
+            (parameter[0] == 'q' || parameter[0] == 'Q') &&
+            parameter[1] == '=')
+        {
+          try
+          {
+            q = boost::lexical_cast<float>(Toolbox::StripSpaces(parameter.substr(2)));
+          }
+          catch (boost::bad_lexical_cast&)
+          {
+            q = 0.0f;  // Malformed quality factor
+          }
+
+          q = std::max(0.0f, std::min(1.0f, q));
+        }
+      }
+
+      specificity = s;
+      quality = q;
+    }
+
+    return (specificity == 2);
+  }
 }
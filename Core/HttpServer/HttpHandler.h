@@ -40,6 +40,7 @@
 namespace Orthanc
 {
   class HttpOutput;
+  class HttpUploadedFile;
 
   class HttpHandler
   {
@@ -57,6 +58,21 @@ namespace Orthanc
                         const Arguments& getArguments,
                         const std::string& postData) = 0;
 
+    /**
+     * Handles a request whose body has been streamed to a temporary
+     * file by the HTTP server. As the body can be very large, this
+     * default implementation does not read it into memory, and
+     * declines the request: The handlers that accept such bodies
+     * override this method, and should only read the file once they
+     * know that they serve the URI.
+     **/
+    virtual bool HandleUploadedFile(HttpOutput& output,
+                                    HttpMethod method,
+                                    const UriComponents& uri,
+                                    const Arguments& headers,
+                                    const Arguments& getArguments,
+                                    const HttpUploadedFile& body);
+
     static void ParseGetArguments(HttpHandler::Arguments& result, 
                                   const char* query);
 
@@ -70,5 +86,17 @@ namespace Orthanc
 
     static void ParseCookies(HttpHandler::Arguments& result, 
                              const HttpHandler::Arguments& httpHeaders);
+
+    /**
+     * Gets the quality factor (the "q" parameter, between 0 and 1)
+     * that the value of an "Accept" HTTP header gives to some MIME
+     * type, taking the wildcards (any subtype of a type, or any
+     * type) into account. An empty header accepts any MIME type.
+     * Returns "true" iff the MIME type is explicitly listed in the
+     * header.
+     **/
+    static bool LookupAcceptedQuality(float& quality,
+                                      const std::string& accept,
+                                      const std::string& mimeType);
   };
 }
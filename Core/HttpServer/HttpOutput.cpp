@@ -34,6 +34,7 @@
 #include "HttpOutput.h"
 
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <stdio.h>
 #include <glog/logging.h>
@@ -44,13 +45,16 @@
 namespace Orthanc
 {
   HttpOutput::StateMachine::StateMachine(IHttpOutputStream& stream,
-                                         bool isKeepAlive) : 
+                                         bool isKeepAlive,
+                                         bool isChunkedAllowed) : 
     stream_(stream),
     state_(State_WritingHeader),
     status_(HttpStatus_200_Ok),
     hasContentLength_(false),
     contentPosition_(0),
-    keepAlive_(isKeepAlive)
+    keepAlive_(isKeepAlive),
+    isChunkedAllowed_(isChunkedAllowed),
+    isCloseDelimited_(false)
   {
   }
 
@@ -66,6 +70,11 @@ namespace Orthanc
     {
       LOG(ERROR) << "This HTTP answer has not sent the proper number of bytes in its body";
     }
+
+    if (state_ == State_WritingStream)
+    {
+      LOG(ERROR) << "This streamed HTTP answer was not properly closed";
+    }
   }
 
 
@@ -136,8 +145,43 @@ namespace Orthanc
     headers_.clear();
   }
 
+  void HttpOutput::StateMachine::SendHeader(const std::string& bodyHeader)
+  {
+    stream_.OnHttpStatusReceived(status_);
+
+    std::string s = "HTTP/1.1 " + 
+      boost::lexical_cast<std::string>(status_) +
+      " " + std::string(EnumerationToString(status_)) +
+      "\r\n";
+
+    if (isCloseDelimited_)
+    {
+      s += "Connection: close\r\n";
+    }
+    else if (keepAlive_)
+    {
+      s += "Connection: keep-alive\r\n";
+    }
+
+    for (std::list<std::string>::const_iterator
+           it = headers_.begin(); it != headers_.end(); ++it)
+    {
+      s += *it;
+    }
+
+    s += bodyHeader + "\r\n";
+
+    stream_.Send(true, s.c_str(), s.size());
+  }
+
+
   void HttpOutput::StateMachine::SendBody(const void* buffer, size_t length)
   {
+    if (state_ == State_WritingStream)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
     if (state_ == State_Done)
     {
       if (length == 0)
@@ -155,33 +199,14 @@ namespace Orthanc
     {
       // Send the HTTP header before writing the body
 
-      stream_.OnHttpStatusReceived(status_);
-
-      std::string s = "HTTP/1.1 " + 
-        boost::lexical_cast<std::string>(status_) +
-        " " + std::string(EnumerationToString(status_)) +
-        "\r\n";
-
-      if (keepAlive_)
-      {
-        s += "Connection: keep-alive\r\n";
-      }
-
-      for (std::list<std::string>::const_iterator
-             it = headers_.begin(); it != headers_.end(); ++it)
-      {
-        s += *it;
-      }
-
-      if (status_ != HttpStatus_200_Ok)
+      if (status_ != HttpStatus_200_Ok &&
+          status_ != HttpStatus_206_PartialContent)
       {
         hasContentLength_ = false;
       }
 
       uint64_t contentLength = (hasContentLength_ ? contentLength_ : length);
-      s += "Content-Length: " + boost::lexical_cast<std::string>(contentLength) + "\r\n\r\n";
-
-      stream_.Send(true, s.c_str(), s.size());
+      SendHeader("Content-Length: " + boost::lexical_cast<std::string>(contentLength) + "\r\n");
       state_ = State_WritingBody;
     }
 
@@ -206,6 +231,79 @@ namespace Orthanc
   }
 
 
+  void HttpOutput::StateMachine::StartStream(const char* contentType)
+  {
+    if (state_ != State_WritingHeader ||
+        status_ != HttpStatus_200_Ok ||
+        hasContentLength_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    SetContentType(contentType);
+
+    if (isChunkedAllowed_)
+    {
+      SendHeader("Transfer-Encoding: chunked\r\n");
+    }
+    else
+    {
+      // HTTP/1.0 client: The body is neither chunked nor preceded by
+      // its length, its end is signaled by closing the connection
+      isCloseDelimited_ = true;
+      SendHeader("");
+    }
+
+    state_ = State_WritingStream;
+  }
+
+
+  void HttpOutput::StateMachine::SendStreamItem(const void* data, size_t size)
+  {
+    if (state_ != State_WritingStream)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (size == 0)
+    {
+      return;  // An empty chunk would end the answer
+    }
+
+    if (isCloseDelimited_)
+    {
+      stream_.Send(false, data, size);
+      contentPosition_ += size;
+      return;
+    }
+
+    std::ostringstream chunkHeader;
+    chunkHeader << std::hex << size << "\r\n";
+    std::string s = chunkHeader.str();
+
+    stream_.Send(false, s.c_str(), s.size());
+    stream_.Send(false, data, size);
+    stream_.Send(false, "\r\n", 2);
+    contentPosition_ += size;
+  }
+
+
+  void HttpOutput::StateMachine::CloseStream()
+  {
+    if (state_ != State_WritingStream)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (!isCloseDelimited_)
+    {
+      stream_.Send(false, "0\r\n\r\n", 5);
+    }
+
+    state_ = State_Done;
+  }
+
+
   void HttpOutput::SendMethodNotAllowed(const std::string& allowed)
   {
     stateMachine_.ClearHeaders();
@@ -232,6 +330,34 @@ namespace Orthanc
   }
 
 
+  void HttpOutput::SetPartialContent(uint64_t start,
+                                     uint64_t end,
+                                     uint64_t fullSize)
+  {
+    if (start > end ||
+        end >= fullSize)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    stateMachine_.SetHttpStatus(HttpStatus_206_PartialContent);
+    stateMachine_.AddHeader("Content-Range", "bytes " + 
+                            boost::lexical_cast<std::string>(start) + "-" +
+                            boost::lexical_cast<std::string>(end) + "/" +
+                            boost::lexical_cast<std::string>(fullSize));
+    stateMachine_.SetContentLength(end - start + 1);
+  }
+
+
+  void HttpOutput::SendRangeNotSatisfiable(uint64_t fullSize)
+  {
+    stateMachine_.ClearHeaders();
+    stateMachine_.SetHttpStatus(HttpStatus_416_RequestedRangeNotSatisfiable);
+    stateMachine_.AddHeader("Content-Range", "bytes */" + boost::lexical_cast<std::string>(fullSize));
+    stateMachine_.SendBody(NULL, 0);
+  }
+
+
   void HttpOutput::Redirect(const std::string& path)
   {
     stateMachine_.ClearHeaders();
@@ -266,6 +392,14 @@ namespace Orthanc
     }
   }
 
+  void HttpOutput::SendStreamItem(const std::string& item)
+  {
+    if (item.size() > 0)
+    {
+      stateMachine_.SendStreamItem(item.c_str(), item.size());
+    }
+  }
+
   void HttpOutput::SendBody()
   {
     stateMachine_.SendBody(NULL, 0);
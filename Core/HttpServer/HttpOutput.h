@@ -53,6 +53,7 @@ namespace Orthanc
       {
         State_WritingHeader,      
         State_WritingBody,
+        State_WritingStream,
         State_Done
       };
 
@@ -64,11 +65,16 @@ namespace Orthanc
       uint64_t contentLength_;
       uint64_t contentPosition_;
       bool keepAlive_;
+      bool isChunkedAllowed_;
+      bool isCloseDelimited_;
       std::list<std::string> headers_;
 
+      void SendHeader(const std::string& bodyHeader);
+
     public:
       StateMachine(IHttpOutputStream& stream,
-                   bool isKeepAlive);
+                   bool isKeepAlive,
+                   bool isChunkedAllowed);
 
       ~StateMachine();
 
@@ -89,14 +95,38 @@ namespace Orthanc
       void ClearHeaders();
 
       void SendBody(const void* buffer, size_t length);
+
+      void StartStream(const char* contentType);
+
+      void SendStreamItem(const void* data, size_t size);
+
+      void CloseStream();
+
+      bool IsHeaderSent() const
+      {
+        return state_ != State_WritingHeader;
+      }
+
+      bool IsChunkedAllowed() const
+      {
+        return isChunkedAllowed_;
+      }
+
+      bool IsCloseDelimited() const
+      {
+        return isCloseDelimited_;
+      }
     };
 
     StateMachine stateMachine_;
 
   public:
+    // The chunked transfer encoding must not be used if the client
+    // speaks HTTP/1.0 (RFC 7230, section 3.3.1)
     HttpOutput(IHttpOutputStream& stream,
-               bool isKeepAlive) : 
-      stateMachine_(stream, isKeepAlive)
+               bool isKeepAlive,
+               bool isChunkedAllowed = true) : 
+      stateMachine_(stream, isKeepAlive, isChunkedAllowed)
     {
     }
 
@@ -117,6 +147,12 @@ namespace Orthanc
       stateMachine_.SetContentLength(length);
     }
 
+    // Prepares a "206 Partial Content" answer that contains the bytes
+    // [start, end] (inclusive) of a resource whose size is "fullSize"
+    void SetPartialContent(uint64_t start,
+                           uint64_t end,
+                           uint64_t fullSize);
+
     void SetCookie(const std::string& cookie,
                    const std::string& value)
     {
@@ -135,8 +171,53 @@ namespace Orthanc
 
     void SendBody();
 
+    /**
+     * Streamed answers, whose size is not known in advance, are sent
+     * using the chunked transfer encoding of HTTP/1.1. If the client
+     * does not support it, the end of the answer is signaled by
+     * closing the connection (cf. "IsCloseDelimited()"). The HTTP
+     * header is immediately sent by StartStream().
+     **/
+    void StartStream(const char* contentType)
+    {
+      stateMachine_.StartStream(contentType);
+    }
+
+    void SendStreamItem(const void* data, size_t size)
+    {
+      stateMachine_.SendStreamItem(data, size);
+    }
+
+    void SendStreamItem(const std::string& item);
+
+    void CloseStream()
+    {
+      stateMachine_.CloseStream();
+    }
+
+    bool IsHeaderSent() const
+    {
+      return stateMachine_.IsHeaderSent();
+    }
+
+    bool IsChunkedAllowed() const
+    {
+      return stateMachine_.IsChunkedAllowed();
+    }
+
+    // Whether the HTTP server must close the connection once the
+    // answer is sent, as its end is not otherwise delimited
+    bool IsCloseDelimited() const
+    {
+      return stateMachine_.IsCloseDelimited();
+    }
+
     void SendMethodNotAllowed(const std::string& allowed);
 
+    // Answers "416 Requested Range Not Satisfiable" for a resource
+    // whose size is "fullSize"
+    void SendRangeNotSatisfiable(uint64_t fullSize);
+
     void Redirect(const std::string& path);
 
     void SendUnauthorized(const std::string& realm);
@@ -0,0 +1,172 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "../PrecompiledHeaders.h"
+#include "HttpUploadedFile.h"
+
+#include "../OrthancException.h"
+
+#include <glog/logging.h>
+#include <boost/filesystem.hpp>
+
+namespace Orthanc
+{
+  HttpUploadedFile::HttpUploadedFile(const std::string& directory) : 
+    file_(directory, NULL),
+    size_(0),
+    done_(false)
+  {
+    stream_.open(file_.GetPath(), std::ofstream::out | std::ios::binary);
+    if (!stream_.good())
+    {
+      LOG(ERROR) << "Cannot create a temporary file in directory: " << directory;
+      throw OrthancException(ErrorCode_CannotWriteFile);
+    }
+  }
+
+
+  void HttpUploadedFile::CheckDone() const
+  {
+    if (!done_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+  }
+
+
+  void HttpUploadedFile::Append(const void* data,
+                                size_t size)
+  {
+    if (done_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (size == 0)
+    {
+      return;
+    }
+
+    stream_.write(reinterpret_cast<const char*>(data), size);
+    if (!stream_.good())
+    {
+      throw OrthancException(ErrorCode_CannotWriteFile);
+    }
+
+    md5Context_.Append(data, size);
+    size_ += size;
+  }
+
+
+  void HttpUploadedFile::Close()
+  {
+    if (done_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    stream_.close();
+    if (stream_.fail())
+    {
+      throw OrthancException(ErrorCode_CannotWriteFile);
+    }
+
+    md5Context_.Finish(md5_);
+    done_ = true;
+  }
+
+
+  uint64_t HttpUploadedFile::GetSize() const
+  {
+    CheckDone();
+    return size_;
+  }
+
+
+  const std::string& HttpUploadedFile::GetMD5() const
+  {
+    CheckDone();
+    return md5_;
+  }
+
+
+  void HttpUploadedFile::Read(std::string& content) const
+  {
+    CheckDone();
+    Toolbox::ReadFile(content, file_.GetPath());
+  }
+
+
+  void HttpUploadedFile::RemoveStaleFiles(const std::string& directory)
+  {
+    namespace fs = boost::filesystem;
+
+    if (!fs::is_directory(directory))
+    {
+      return;
+    }
+
+    // Only remove the files that are named like the temporary files
+    // (cf. "Toolbox::TemporaryFile"), in case the directory is shared
+    unsigned int count = 0;
+
+    fs::directory_iterator end;
+    for (fs::directory_iterator it(directory); it != end; ++it)
+    {
+#if BOOST_HAS_FILESYSTEM_V3 == 1
+      const std::string name = it->path().filename().string();
+#else
+      const std::string name = it->path().filename();
+#endif
+
+      if (fs::is_regular_file(it->status()) &&
+          name.compare(0, 8, "Orthanc-") == 0)
+      {
+        try
+        {
+          fs::remove(it->path());
+          count++;
+        }
+        catch (fs::filesystem_error&)
+        {
+          LOG(WARNING) << "Cannot remove the stale temporary file: " << it->path().string();
+        }
+      }
+    }
+
+    if (count > 0)
+    {
+      LOG(WARNING) << "Removed " << count << " stale temporary file(s) from directory: " << directory;
+    }
+  }
+}
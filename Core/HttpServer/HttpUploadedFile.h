@@ -0,0 +1,87 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include "../Uuid.h"
+
+#include <stdint.h>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace Orthanc
+{
+  /**
+   * Body of an HTTP request that is streamed by the HTTP server to a
+   * temporary file, instead of being read into memory. The MD5 hash
+   * of the body is computed while it is received. The temporary file
+   * is removed by the destructor.
+   **/
+  class HttpUploadedFile : public boost::noncopyable
+  {
+  private:
+    Toolbox::TemporaryFile       file_;
+    boost::filesystem::ofstream  stream_;
+    Toolbox::MD5Context          md5Context_;
+    uint64_t                     size_;
+    std::string                  md5_;
+    bool                         done_;
+
+    void CheckDone() const;
+
+  public:
+    HttpUploadedFile(const std::string& directory);
+
+    void Append(const void* data,
+                size_t size);
+
+    // Must be called once the whole body has been received
+    void Close();
+
+    const std::string& GetPath() const
+    {
+      return file_.GetPath();
+    }
+
+    uint64_t GetSize() const;
+
+    const std::string& GetMD5() const;
+
+    void Read(std::string& content) const;
+
+    // Removes the temporary files that were left in this directory,
+    // e.g. by a crash during an upload. Must only be called while no
+    // upload is running.
+    static void RemoveStaleFiles(const std::string& directory);
+  };
+}
@@ -36,6 +36,7 @@
 #include "MongooseServer.h"
 
 #include <algorithm>
+#include <limits>
 #include <string.h>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
@@ -48,6 +49,7 @@
 #include "../OrthancException.h"
 #include "../ChunkedBuffer.h"
 #include "HttpOutput.h"
+#include "HttpUploadedFile.h"
 #include "mongoose.h"
 
 #if ORTHANC_SSL_ENABLED == 1
@@ -58,6 +60,10 @@
 
 static const long LOCALHOST = (127ll << 24) + 1ll;
 
+// Size of the chunks that are read from the network when streaming a
+// body to a temporary file
+static const size_t UPLOAD_CHUNK_SIZE = 1024 * 1024;
+
 
 namespace Orthanc
 {
@@ -93,6 +99,62 @@ namespace Orthanc
     };
 
 
+    void ForceCloseConnection(const struct mg_request_info* request)
+    {
+      /**
+       * Mongoose provides no primitive to drop a connection, but it
+       * only keeps a connection alive if the "Connection" header of
+       * the request allows it, which is checked once the callback
+       * returns. This header is thus overwritten with "close", or
+       * appended if the request has no such header.
+       **/
+      static char connection[] = "Connection";
+      static char close[] = "close";
+
+      struct mg_request_info* info = const_cast<struct mg_request_info*>(request);
+
+      for (int i = 0; i < info->num_headers; i++)
+      {
+        if (boost::iequals(info->http_headers[i].name, connection))
+        {
+          info->http_headers[i].value = close;
+          return;
+        }
+      }
+
+      const int maxHeaders = static_cast<int>(sizeof(info->http_headers) / sizeof(info->http_headers[0]));
+      if (info->num_headers < maxHeaders)
+      {
+        info->http_headers[info->num_headers].name = connection;
+        info->http_headers[info->num_headers].value = close;
+        info->num_headers++;
+      }
+    }
+
+
+    void SignalError(HttpOutput& output,
+                     const struct mg_request_info* request,
+                     HttpStatus status)
+    {
+      if (output.IsHeaderSent())
+      {
+        // The answer was being streamed: It is too late to send an
+        // HTTP status. The connection is closed, so that the client
+        // notices that the answer is incomplete (a chunked answer
+        // lacks its terminating chunk, and a fixed-length answer is
+        // truncated), instead of reading the next answer of a
+        // keep-alive connection as the remainder of this body.
+        LOG(ERROR) << "Cannot send HTTP status " << status << ", as the HTTP header has already been sent: "
+                   << "Closing the connection";
+        ForceCloseConnection(request);
+      }
+      else
+      {
+        output.SendStatus(status);
+      }
+    }
+
+
     enum PostDataStatus
     {
       PostDataStatus_Success,
@@ -260,43 +322,60 @@ namespace Orthanc
 
 
 
-  static PostDataStatus ReadBody(std::string& postData,
-                                 struct mg_connection *connection,
-                                 const HttpHandler::Arguments& headers)
+  static bool GetContentLength(uint64_t& length,
+                               const HttpHandler::Arguments& headers)
   {
     HttpHandler::Arguments::const_iterator cs = headers.find("content-length");
     if (cs == headers.end())
     {
-      return PostDataStatus_NoLength;
+      return false;
     }
 
-    int length;      
+    // 64-bit integers, as the bodies that are streamed to a file can
+    // be larger than 2GB
+    int64_t value;
     try
     {
-      length = boost::lexical_cast<int>(cs->second);
+      value = boost::lexical_cast<int64_t>(cs->second);
     }
     catch (boost::bad_lexical_cast)
+    {
+      return false;
+    }
+
+    length = (value < 0 ? 0 : static_cast<uint64_t>(value));
+    return true;
+  }
+
+
+  static PostDataStatus ReadBody(std::string& postData,
+                                 struct mg_connection *connection,
+                                 const HttpHandler::Arguments& headers)
+  {
+    uint64_t length;
+    if (!GetContentLength(length, headers))
     {
       return PostDataStatus_NoLength;
     }
 
-    if (length < 0)
+    if (length > static_cast<uint64_t>(std::numeric_limits<int>::max()))
     {
-      length = 0;
+      LOG(ERROR) << "Too large HTTP body to be read into memory: " << length << " bytes";
+      return PostDataStatus_Failure;
     }
 
-    postData.resize(length);
+    postData.resize(static_cast<size_t>(length));
 
     size_t pos = 0;
     while (length > 0)
     {
-      int r = mg_read(connection, &postData[pos], length);
+      int r = mg_read(connection, &postData[pos], static_cast<size_t>(length));
       if (r <= 0)
       {
         return PostDataStatus_Failure;
       }
 
-      assert(r <= length);
+      assert(static_cast<uint64_t>(r) <= length);
       length -= r;
       pos += r;
     }
@@ -305,6 +384,70 @@ namespace Orthanc
   }
 
 
+  static PostDataStatus ReadBodyToFile(HttpUploadedFile& target,
+                                       struct mg_connection *connection,
+                                       uint64_t length)
+  {
+    // The body is received by chunks, so that the memory consumption
+    // does not depend on its size
+    std::string chunk(UPLOAD_CHUNK_SIZE, '\0');
+
+    while (length > 0)
+    {
+      size_t count = static_cast<size_t>(std::min(length, static_cast<uint64_t>(chunk.size())));
+
+      int r = mg_read(connection, &chunk[0], count);
+      if (r <= 0)
+      {
+        return PostDataStatus_Failure;
+      }
+
+      assert(static_cast<size_t>(r) <= count);
+      target.Append(&chunk[0], r);
+      length -= r;
+    }
+
+    target.Close();
+
+    return PostDataStatus_Success;
+  }
+
+
+  // Reads a body that is not multipart. If it is large enough, it is
+  // streamed to a temporary file, and "postFile" is set.
+  static PostDataStatus ReadSinglePartBody(std::string& postData,
+                                           std::auto_ptr<HttpUploadedFile>& postFile,
+                                           struct mg_connection *connection,
+                                           const HttpHandler::Arguments& headers,
+                                           const MongooseServer& server)
+  {
+    uint64_t length;
+    if (!GetContentLength(length, headers))
+    {
+      return PostDataStatus_NoLength;
+    }
+
+    if (server.GetUploadDirectory().empty() ||
+        server.GetUploadThreshold() == 0 ||
+        length < server.GetUploadThreshold())
+    {
+      return ReadBody(postData, connection, headers);
+    }
+
+    try
+    {
+      postFile.reset(new HttpUploadedFile(server.GetUploadDirectory()));
+      return ReadBodyToFile(*postFile, connection, length);
+    }
+    catch (OrthancException& e)
+    {
+      LOG(ERROR) << "Cannot stream an HTTP body of " << length << " bytes to the disk: " << e.What();
+      postFile.reset(NULL);
+      return PostDataStatus_Failure;
+    }
+  }
+
+
 
   static PostDataStatus ParseMultipartPost(std::string &completedFile,
                                            struct mg_connection *connection,
@@ -540,12 +683,20 @@ namespace Orthanc
   }
 
 
+  static bool IsChunkedAllowed(const struct mg_request_info *request)
+  {
+    // The chunked transfer encoding is only known to HTTP/1.1 clients
+    return (request->http_version != NULL &&
+            !strcmp(request->http_version, "1.1"));
+  }
+
+
   static void InternalCallback(struct mg_connection *connection,
                                const struct mg_request_info *request)
   {
     MongooseServer* that = reinterpret_cast<MongooseServer*>(request->user_data);
     MongooseOutputStream stream(connection);
-    HttpOutput output(stream, that->IsKeepAliveEnabled());
+    HttpOutput output(stream, that->IsKeepAliveEnabled(), IsChunkedAllowed(request));
 
     // Check remote calls
     if (!that->IsRemoteAccessAllowed() &&
@@ -614,6 +765,7 @@ namespace Orthanc
 
     // Extract the body of the request for PUT and POST
     std::string body;
+    std::auto_ptr<HttpUploadedFile> bodyFile;
     if (method == HttpMethod_Post ||
         method == HttpMethod_Put)
     {
@@ -623,7 +775,7 @@ namespace Orthanc
       if (ct == headers.end())
       {
         // No content-type specified. Assume no multi-part content occurs at this point.
-        status = ReadBody(body, connection, headers);          
+        status = ReadSinglePartBody(body, bodyFile, connection, headers, *that);
       }
       else
       {
@@ -635,7 +787,7 @@ namespace Orthanc
         }
         else
         {
-          status = ReadBody(body, connection, headers);
+          status = ReadSinglePartBody(body, bodyFile, connection, headers, *that);
         }
       }
 
@@ -681,7 +833,14 @@ namespace Orthanc
     {
       try
       {
-        found = (*it)->Handle(output, method, uri, headers, argumentsGET, body);
+        if (bodyFile.get() != NULL)
+        {
+          found = (*it)->HandleUploadedFile(output, method, uri, headers, argumentsGET, *bodyFile);
+        }
+        else
+        {
+          found = (*it)->Handle(output, method, uri, headers, argumentsGET, body);
+        }
       }
       catch (OrthancException& e)
       {
@@ -693,16 +852,16 @@ namespace Orthanc
           case ErrorCode_InexistentFile:
           case ErrorCode_InexistentItem:
           case ErrorCode_UnknownResource:
-            output.SendStatus(HttpStatus_404_NotFound);
+            SignalError(output, request, HttpStatus_404_NotFound);
             break;
 
           case ErrorCode_BadRequest:
           case ErrorCode_UriSyntax:
-            output.SendStatus(HttpStatus_400_BadRequest);
+            SignalError(output, request, HttpStatus_400_BadRequest);
             break;
 
           default:
-            output.SendStatus(HttpStatus_500_InternalServerError);
+            SignalError(output, request, HttpStatus_500_InternalServerError);
         }
 
         return;
@@ -710,13 +869,13 @@ namespace Orthanc
       catch (boost::bad_lexical_cast&)
       {
         LOG(ERROR) << "Exception in the HTTP handler: Bad lexical cast";
-        output.SendStatus(HttpStatus_400_BadRequest);
+        SignalError(output, request, HttpStatus_400_BadRequest);
         return;
       }
       catch (std::runtime_error&)
       {
         LOG(ERROR) << "Exception in the HTTP handler: Presumably a bad JSON request";
-        output.SendStatus(HttpStatus_400_BadRequest);
+        SignalError(output, request, HttpStatus_400_BadRequest);
         return;
       }
     }
@@ -725,6 +884,13 @@ namespace Orthanc
     {
       output.SendStatus(HttpStatus_404_NotFound);
     }
+
+    if (output.IsCloseDelimited())
+    {
+      // The end of this streamed answer is only signaled by closing
+      // the connection, even if the client asked to keep it alive
+      ForceCloseConnection(request);
+    }
   }
 
 
@@ -779,6 +945,7 @@ namespace Orthanc
     port_ = 8000;
     filter_ = NULL;
     keepAlive_ = false;
+    uploadThreshold_ = 0;
 
 #if ORTHANC_SSL_ENABLED == 1
     // Check for the Heartbleed exploit
@@ -937,6 +1104,27 @@ namespace Orthanc
     remoteAllowed_ = allowed;
   }
 
+  void MongooseServer::SetUploadDirectory(const std::string& directory)
+  {
+    Stop();
+
+    if (!directory.empty())
+    {
+      Toolbox::CreateDirectory(directory);
+
+      // The uploads of a previous execution cannot be resumed
+      HttpUploadedFile::RemoveStaleFiles(directory);
+    }
+
+    uploadDirectory_ = directory;
+  }
+
+  void MongooseServer::SetUploadThreshold(uint64_t threshold)
+  {
+    Stop();
+    uploadThreshold_ = threshold;
+  }
+
   void MongooseServer::SetIncomingHttpRequestFilter(IIncomingHttpRequestFilter& filter)
   {
     Stop();
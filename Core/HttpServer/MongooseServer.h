@@ -79,6 +79,8 @@ namespace Orthanc
     uint16_t port_;
     IIncomingHttpRequestFilter* filter_;
     bool keepAlive_;
+    std::string uploadDirectory_;
+    uint64_t uploadThreshold_;
   
     bool IsRunning() const;
 
@@ -147,6 +149,29 @@ namespace Orthanc
 
     void SetIncomingHttpRequestFilter(IIncomingHttpRequestFilter& filter);
 
+    const std::string& GetUploadDirectory() const
+    {
+      return uploadDirectory_;
+    }
+
+    /**
+     * The bodies of the POST and PUT requests that are not multipart
+     * and whose size is above the threshold (in bytes) are streamed
+     * to a temporary file in this directory, instead of being read
+     * into memory. The directory should lie on the same filesystem as
+     * the storage area, so that the files can be adopted by the
+     * storage area without being copied. An empty directory or a
+     * zero threshold disables the streaming.
+     **/
+    void SetUploadDirectory(const std::string& directory);
+
+    uint64_t GetUploadThreshold() const
+    {
+      return uploadThreshold_;
+    }
+
+    void SetUploadThreshold(uint64_t threshold);
+
     void ClearHandlers();
 
     ChunkStore& GetChunkStore();
@@ -36,80 +36,688 @@
 #include "../OrthancException.h"
 
 #include <boost/math/special_functions/round.hpp>
+#include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/thread.hpp>
 
 #include <cassert>
+#include <cmath>
 #include <string.h>
 #include <limits>
+#include <vector>
 #include <stdint.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+// SSE2 is part of the x86-64 instruction set: It is always available
+// and the scalar floating-point arithmetic uses the same SSE units,
+// which guarantees that both implementations give the same results
+#  define ORTHANC_IMAGE_PROCESSING_SSE2 1
+#  include <emmintrin.h>
+#else
+#  define ORTHANC_IMAGE_PROCESSING_SSE2 0
+#endif
+
+
 namespace Orthanc
 {
-  template <typename TargetType, typename SourceType>
-  static void ConvertInternal(ImageAccessor& target,
-                              const ImageAccessor& source)
+  static bool simdEnabled_ = true;
+  static unsigned int threadsCount_ = 1;
+
+  // Images with fewer pixels than this are never split between threads
+  static const unsigned int MIN_PIXELS_PER_THREAD = 256 * 1024;
+
+
+  template <typename Functor>
+  static void ApplyToBand(Functor* functor,
+                          unsigned int firstRow,
+                          unsigned int endRow)
   {
-    const TargetType minValue = std::numeric_limits<TargetType>::min();
-    const TargetType maxValue = std::numeric_limits<TargetType>::max();
+    functor->Apply(firstRow, endRow);
+  }
 
-    for (unsigned int y = 0; y < source.GetHeight(); y++)
+
+  /**
+   * Applies "functor.Apply(firstRow, endRow)" to horizontal bands of
+   * "height" rows. The work is split between the threads if it
+   * involves enough "pixels"; the copies of the functor are then
+   * merged with "functor.Merge()".
+   **/
+  template <typename Functor>
+  static void ProcessRows(Functor& functor,
+                          unsigned int height,
+                          uint64_t pixels)
+  {
+
+    unsigned int bands = threadsCount_;
+    if (pixels / MIN_PIXELS_PER_THREAD < bands)
+    {
+      bands = static_cast<unsigned int>(pixels / MIN_PIXELS_PER_THREAD);
+    }
+
+    if (bands > height)
+    {
+      bands = height;
+    }
+
+    if (bands <= 1)
     {
-      TargetType* t = reinterpret_cast<TargetType*>(target.GetRow(y));
-      const SourceType* s = reinterpret_cast<const SourceType*>(source.GetConstRow(y));
+      functor.Apply(0, height);
+      return;
+    }
 
-      for (unsigned int x = 0; x < source.GetWidth(); x++, t++, s++)
+    std::vector<Functor> functors(bands, functor);
+    boost::thread_group threads;
+
+    try
+    {
+      for (unsigned int i = 0; i < bands; i++)
       {
-        if (static_cast<int32_t>(*s) < static_cast<int32_t>(minValue))
-        {
-          *t = minValue;
-        }
-        else if (static_cast<int32_t>(*s) > static_cast<int32_t>(maxValue))
+        unsigned int first = static_cast<unsigned int>(static_cast<uint64_t>(height) * i / bands);
+        unsigned int end = static_cast<unsigned int>(static_cast<uint64_t>(height) * (i + 1) / bands);
+
+        if (i + 1 == bands)
         {
-          *t = maxValue;
+          // The last band is processed by the calling thread
+          functors[i].Apply(first, end);
         }
         else
         {
-          *t = static_cast<TargetType>(*s);
+          threads.add_thread(new boost::thread(ApplyToBand<Functor>, &functors[i], first, end));
         }
       }
     }
+    catch (...)
+    {
+      // The threads that were started write through "functors", which
+      // must not be destroyed before they are over
+      threads.join_all();
+      throw;
+    }
+
+    threads.join_all();
+
+    for (unsigned int i = 0; i < bands; i++)
+    {
+      functor.Merge(functors[i]);
+    }
   }
 
 
-  template <typename TargetType>
-  static void ConvertColorToGrayscale(ImageAccessor& target,
-                              const ImageAccessor& source)
+  template <typename Functor>
+  static void ProcessRows(Functor& functor,
+                          const ImageAccessor& image)
   {
-    assert(source.GetFormat() == PixelFormat_RGB24);
+    ProcessRows(functor, image.GetHeight(), 
+                static_cast<uint64_t>(image.GetWidth()) * static_cast<uint64_t>(image.GetHeight()));
+  }
 
-    const TargetType minValue = std::numeric_limits<TargetType>::min();
-    const TargetType maxValue = std::numeric_limits<TargetType>::max();
 
-    for (unsigned int y = 0; y < source.GetHeight(); y++)
+  /**
+   * SSE2 kernels. Each of them processes the beginning of one row,
+   * and returns the number of pixels it has processed: The scalar
+   * code, which is the reference implementation, processes the
+   * remaining pixels. The default templates process no pixel.
+   **/
+
+  template <typename TargetType, typename SourceType>
+  static unsigned int ConvertRowSimd(TargetType* /*target*/,
+                                     const SourceType* /*source*/,
+                                     unsigned int /*width*/)
+  {
+    return 0;
+  }
+
+  template <typename PixelType>
+  static unsigned int GetMinMaxRowSimd(PixelType& /*minValue*/,
+                                       PixelType& /*maxValue*/,
+                                       const PixelType* /*p*/,
+                                       unsigned int /*width*/)
+  {
+    return 0;
+  }
+
+  template <typename PixelType>
+  static unsigned int AddConstantRowSimd(PixelType* /*p*/,
+                                         unsigned int /*width*/,
+                                         int64_t /*constant*/)
+  {
+    return 0;
+  }
+
+  template <typename PixelType>
+  static unsigned int ShiftScaleRowSimd(PixelType* /*p*/,
+                                        unsigned int /*width*/,
+                                        float /*offset*/,
+                                        float /*scaling*/)
+  {
+    return 0;
+  }
+
+
+#if ORTHANC_IMAGE_PROCESSING_SSE2 == 1
+  template <>
+  unsigned int ConvertRowSimd<uint16_t, uint8_t>(uint16_t* target,
+                                                 const uint8_t* source,
+                                                 unsigned int width)
+  {
+    const __m128i zero = _mm_setzero_si128();
+
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_unpacklo_epi8(v, zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x + 8), _mm_unpackhi_epi8(v, zero));
+    }
+
+    return x;
+  }
+
+  template <>
+  unsigned int ConvertRowSimd<int16_t, uint8_t>(int16_t* target,
+                                                const uint8_t* source,
+                                                unsigned int width)
+  {
+    return ConvertRowSimd<uint16_t, uint8_t>(reinterpret_cast<uint16_t*>(target), source, width);
+  }
+
+  template <>
+  unsigned int ConvertRowSimd<uint8_t, uint16_t>(uint8_t* target,
+                                                 const uint16_t* source,
+                                                 unsigned int width)
+  {
+    // "a - max(a - 255, 0)" is "min(a, 255)" for unsigned values
+    const __m128i limit = _mm_set1_epi16(255);
+
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x + 8));
+      a = _mm_sub_epi16(a, _mm_subs_epu16(a, limit));
+      b = _mm_sub_epi16(b, _mm_subs_epu16(b, limit));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_packus_epi16(a, b));
+    }
+
+    return x;
+  }
+
+  template <>
+  unsigned int ConvertRowSimd<int16_t, uint16_t>(int16_t* target,
+                                                 const uint16_t* source,
+                                                 unsigned int width)
+  {
+    const __m128i limit = _mm_set1_epi16(0x7fff);
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+      a = _mm_sub_epi16(a, _mm_subs_epu16(a, limit));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), a);
+    }
+
+    return x;
+  }
+
+  template <>
+  unsigned int ConvertRowSimd<uint8_t, int16_t>(uint8_t* target,
+                                                const int16_t* source,
+                                                unsigned int width)
+  {
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x + 8));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_packus_epi16(a, b));
+    }
+
+    return x;
+  }
+
+  template <>
+  unsigned int ConvertRowSimd<uint16_t, int16_t>(uint16_t* target,
+                                                 const int16_t* source,
+                                                 unsigned int width)
+  {
+    const __m128i zero = _mm_setzero_si128();
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(target + x), _mm_max_epi16(a, zero));
+    }
+
+    return x;
+  }
+
+
+  template <>
+  unsigned int GetMinMaxRowSimd<uint8_t>(uint8_t& minValue,
+                                         uint8_t& maxValue,
+                                         const uint8_t* p,
+                                         unsigned int width)
+  {
+    if (width < 16)
+    {
+      return 0;
+    }
+
+    __m128i a = _mm_set1_epi8(static_cast<char>(minValue));
+    __m128i b = _mm_set1_epi8(static_cast<char>(maxValue));
+
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
+      a = _mm_min_epu8(a, v);
+      b = _mm_max_epu8(b, v);
+    }
+
+    uint8_t mins[16], maxs[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), a);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), b);
+
+    for (unsigned int i = 0; i < 16; i++)
+    {
+      minValue = std::min(minValue, mins[i]);
+      maxValue = std::max(maxValue, maxs[i]);
+    }
+
+    return x;
+  }
+
+  template <>
+  unsigned int GetMinMaxRowSimd<int16_t>(int16_t& minValue,
+                                         int16_t& maxValue,
+                                         const int16_t* p,
+                                         unsigned int width)
+  {
+    if (width < 8)
+    {
+      return 0;
+    }
+
+    __m128i a = _mm_set1_epi16(minValue);
+    __m128i b = _mm_set1_epi16(maxValue);
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
+      a = _mm_min_epi16(a, v);
+      b = _mm_max_epi16(b, v);
+    }
+
+    int16_t mins[8], maxs[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), a);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), b);
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      minValue = std::min(minValue, mins[i]);
+      maxValue = std::max(maxValue, maxs[i]);
+    }
+
+    return x;
+  }
+
+  template <>
+  unsigned int GetMinMaxRowSimd<uint16_t>(uint16_t& minValue,
+                                          uint16_t& maxValue,
+                                          const uint16_t* p,
+                                          unsigned int width)
+  {
+    if (width < 8)
+    {
+      return 0;
+    }
+
+    // SSE2 only compares signed 16bpp values: Flipping the most
+    // significant bit maps the unsigned order onto the signed order
+    const __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+
+    __m128i a = _mm_xor_si128(_mm_set1_epi16(static_cast<short>(minValue)), flip);
+    __m128i b = _mm_xor_si128(_mm_set1_epi16(static_cast<short>(maxValue)), flip);
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x)), flip);
+      a = _mm_min_epi16(a, v);
+      b = _mm_max_epi16(b, v);
+    }
+
+    uint16_t mins[8], maxs[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), _mm_xor_si128(a, flip));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxs), _mm_xor_si128(b, flip));
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      minValue = std::min(minValue, mins[i]);
+      maxValue = std::max(maxValue, maxs[i]);
+    }
+
+    return x;
+  }
+
+
+  template <>
+  unsigned int AddConstantRowSimd<uint8_t>(uint8_t* p,
+                                           unsigned int width,
+                                           int64_t constant)
+  {
+    // Saturated arithmetic: Any constant beyond 255 saturates all the pixels
+    const __m128i c = _mm_set1_epi8(static_cast<char>(std::min<int64_t>(constant < 0 ? -constant : constant, 255)));
+
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
+      v = (constant < 0 ? _mm_subs_epu8(v, c) : _mm_adds_epu8(v, c));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p + x), v);
+    }
+
+    return x;
+  }
+
+  template <>
+  unsigned int AddConstantRowSimd<uint16_t>(uint16_t* p,
+                                            unsigned int width,
+                                            int64_t constant)
+  {
+    const __m128i c = _mm_set1_epi16(static_cast<short>(std::min<int64_t>(constant < 0 ? -constant : constant, 65535)));
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
+      v = (constant < 0 ? _mm_subs_epu16(v, c) : _mm_adds_epu16(v, c));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p + x), v);
+    }
+
+    return x;
+  }
+
+  template <>
+  unsigned int AddConstantRowSimd<int16_t>(int16_t* p,
+                                           unsigned int width,
+                                           int64_t constant)
+  {
+    // The sum is computed on 32bit, then saturated by "packs". Any
+    // constant beyond 65535 saturates all the pixels.
+    const __m128i c = _mm_set1_epi32(static_cast<int>(std::max<int64_t>(-65535, std::min<int64_t>(constant, 65535))));
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      v = _mm_packs_epi32(_mm_add_epi32(lo, c), _mm_add_epi32(hi, c));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p + x), v);
+    }
+
+    return x;
+  }
+
+
+  /**
+   * Computes "round((v + offset) * scaling)" on 4 integer values,
+   * clamped to [minValue, maxValue], with the rounding of halfway
+   * cases away from zero, as "boost::math::iround()". Clamping
+   * before rounding gives the same result as clamping after, as the
+   * bounds are integers.
+   **/
+  static inline __m128i ShiftScaleSimd(__m128i v,
+                                       __m128 offset,
+                                       __m128 scaling,
+                                       __m128 minValue,
+                                       __m128 maxValue)
+  {
+    __m128 f = _mm_mul_ps(_mm_add_ps(_mm_cvtepi32_ps(v), offset), scaling);
+    f = _mm_min_ps(_mm_max_ps(f, minValue), maxValue);
+
+    __m128i r = _mm_cvttps_epi32(f);  // Truncation towards zero
+    __m128 fraction = _mm_sub_ps(f, _mm_cvtepi32_ps(r));  // Exact
+
+    // The comparison masks are "-1" where true
+    r = _mm_sub_epi32(r, _mm_castps_si128(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f))));
+    r = _mm_add_epi32(r, _mm_castps_si128(_mm_cmple_ps(fraction, _mm_set1_ps(-0.5f))));
+
+    return r;
+  }
+
+  template <typename PixelType>
+  static unsigned int ShiftScaleRowSimd16(PixelType* p,
+                                          unsigned int width,
+                                          float offset,
+                                          float scaling)
+  {
+    const bool isSigned = std::numeric_limits<PixelType>::is_signed;
+
+    const __m128 o = _mm_set1_ps(offset);
+    const __m128 s = _mm_set1_ps(scaling);
+    const __m128 minValue = _mm_set1_ps(static_cast<float>(std::numeric_limits<PixelType>::min()));
+    const __m128 maxValue = _mm_set1_ps(static_cast<float>(std::numeric_limits<PixelType>::max()));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+
+    unsigned int x = 0;
+    for (; x + 8 <= width; x += 8)
     {
-      TargetType* t = reinterpret_cast<TargetType*>(target.GetRow(y));
-      const uint8_t* s = reinterpret_cast<const uint8_t*>(source.GetConstRow(y));
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
 
-      for (unsigned int x = 0; x < source.GetWidth(); x++, t++, s += 3)
+      __m128i lo, hi;
+      if (isSigned)
       {
-        // Y = 0.2126 R + 0.7152 G + 0.0722 B
-        int32_t v = (2126 * static_cast<int32_t>(s[0]) +
-                     7152 * static_cast<int32_t>(s[1]) +
-                     0722 * static_cast<int32_t>(s[2])) / 1000;
-        
-        if (static_cast<int32_t>(v) < static_cast<int32_t>(minValue))
-        {
-          *t = minValue;
-        }
-        else if (static_cast<int32_t>(v) > static_cast<int32_t>(maxValue))
+        lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      }
+      else
+      {
+        lo = _mm_unpacklo_epi16(v, zero);
+        hi = _mm_unpackhi_epi16(v, zero);
+      }
+
+      lo = ShiftScaleSimd(lo, o, s, minValue, maxValue);
+      hi = ShiftScaleSimd(hi, o, s, minValue, maxValue);
+
+      if (isSigned)
+      {
+        v = _mm_packs_epi32(lo, hi);
+      }
+      else
+      {
+        // No "packus_epi32" in SSE2: Shift to the signed range, then back
+        v = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(lo, bias), _mm_sub_epi32(hi, bias)), flip);
+      }
+
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p + x), v);
+    }
+
+    return x;
+  }
+
+  template <>
+  unsigned int ShiftScaleRowSimd<uint16_t>(uint16_t* p,
+                                           unsigned int width,
+                                           float offset,
+                                           float scaling)
+  {
+    return ShiftScaleRowSimd16<uint16_t>(p, width, offset, scaling);
+  }
+
+  template <>
+  unsigned int ShiftScaleRowSimd<int16_t>(int16_t* p,
+                                          unsigned int width,
+                                          float offset,
+                                          float scaling)
+  {
+    return ShiftScaleRowSimd16<int16_t>(p, width, offset, scaling);
+  }
+
+  template <>
+  unsigned int ShiftScaleRowSimd<uint8_t>(uint8_t* p,
+                                          unsigned int width,
+                                          float offset,
+                                          float scaling)
+  {
+    const __m128 o = _mm_set1_ps(offset);
+    const __m128 s = _mm_set1_ps(scaling);
+    const __m128 minValue = _mm_set1_ps(0.0f);
+    const __m128 maxValue = _mm_set1_ps(255.0f);
+    const __m128i zero = _mm_setzero_si128();
+
+    unsigned int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x));
+      __m128i lo = _mm_unpacklo_epi8(v, zero);
+      __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+      __m128i a = ShiftScaleSimd(_mm_unpacklo_epi16(lo, zero), o, s, minValue, maxValue);
+      __m128i b = ShiftScaleSimd(_mm_unpackhi_epi16(lo, zero), o, s, minValue, maxValue);
+      __m128i c = ShiftScaleSimd(_mm_unpacklo_epi16(hi, zero), o, s, minValue, maxValue);
+      __m128i d = ShiftScaleSimd(_mm_unpackhi_epi16(hi, zero), o, s, minValue, maxValue);
+
+      v = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p + x), v);
+    }
+
+    return x;
+  }
+#endif
+
+
+  template <typename TargetType, typename SourceType>
+  class ConvertFunctor
+  {
+  private:
+    ImageAccessor*        target_;
+    const ImageAccessor*  source_;
+
+  public:
+    ConvertFunctor(ImageAccessor& target,
+                   const ImageAccessor& source) :
+      target_(&target),
+      source_(&source)
+    {
+    }
+
+    void Apply(unsigned int firstRow,
+               unsigned int endRow)
+    {
+      const TargetType minValue = std::numeric_limits<TargetType>::min();
+      const TargetType maxValue = std::numeric_limits<TargetType>::max();
+      const unsigned int width = source_->GetWidth();
+
+      for (unsigned int y = firstRow; y < endRow; y++)
+      {
+        TargetType* t = reinterpret_cast<TargetType*>(target_->GetRow(y));
+        const SourceType* s = reinterpret_cast<const SourceType*>(source_->GetConstRow(y));
+
+        unsigned int x = (simdEnabled_ ? ConvertRowSimd<TargetType, SourceType>(t, s, width) : 0);
+        t += x;
+        s += x;
+
+        for (; x < width; x++, t++, s++)
         {
-          *t = maxValue;
+          if (static_cast<int32_t>(*s) < static_cast<int32_t>(minValue))
+          {
+            *t = minValue;
+          }
+          else if (static_cast<int32_t>(*s) > static_cast<int32_t>(maxValue))
+          {
+            *t = maxValue;
+          }
+          else
+          {
+            *t = static_cast<TargetType>(*s);
+          }
         }
-        else
+      }
+    }
+
+    void Merge(const ConvertFunctor& /*other*/)
+    {
+    }
+  };
+
+
+  template <typename TargetType, typename SourceType>
+  static void ConvertInternal(ImageAccessor& target,
+                              const ImageAccessor& source)
+  {
+    ConvertFunctor<TargetType, SourceType> functor(target, source);
+    ProcessRows(functor, source);
+  }
+
+
+  template <typename TargetType>
+  class ConvertColorToGrayscaleFunctor
+  {
+  private:
+    ImageAccessor*        target_;
+    const ImageAccessor*  source_;
+
+  public:
+    ConvertColorToGrayscaleFunctor(ImageAccessor& target,
+                                   const ImageAccessor& source) :
+      target_(&target),
+      source_(&source)
+    {
+      assert(source.GetFormat() == PixelFormat_RGB24);
+    }
+
+    void Apply(unsigned int firstRow,
+               unsigned int endRow)
+    {
+      const TargetType minValue = std::numeric_limits<TargetType>::min();
+      const TargetType maxValue = std::numeric_limits<TargetType>::max();
+
+      for (unsigned int y = firstRow; y < endRow; y++)
+      {
+        TargetType* t = reinterpret_cast<TargetType*>(target_->GetRow(y));
+        const uint8_t* s = reinterpret_cast<const uint8_t*>(source_->GetConstRow(y));
+
+        for (unsigned int x = 0; x < source_->GetWidth(); x++, t++, s += 3)
         {
-          *t = static_cast<TargetType>(v);
+          // Y = 0.2126 R + 0.7152 G + 0.0722 B
+          int32_t v = (2126 * static_cast<int32_t>(s[0]) +
+                       7152 * static_cast<int32_t>(s[1]) +
+                       0722 * static_cast<int32_t>(s[2])) / 1000;
+        
+          if (static_cast<int32_t>(v) < static_cast<int32_t>(minValue))
+          {
+            *t = minValue;
+          }
+          else if (static_cast<int32_t>(v) > static_cast<int32_t>(maxValue))
+          {
+            *t = maxValue;
+          }
+          else
+          {
+            *t = static_cast<TargetType>(v);
+          }
         }
       }
     }
+
+    void Merge(const ConvertColorToGrayscaleFunctor& /*other*/)
+    {
+    }
+  };
+
+
+  template <typename TargetType>
+  static void ConvertColorToGrayscale(ImageAccessor& target,
+                                      const ImageAccessor& source)
+  {
+    ConvertColorToGrayscaleFunctor<TargetType> functor(target, source);
+    ProcessRows(functor, source);
   }
 
 
@@ -129,6 +737,67 @@ namespace Orthanc
   }
 
 
+  template <typename PixelType>
+  class GetMinMaxValueFunctor
+  {
+  private:
+    const ImageAccessor*  source_;
+    PixelType             minValue_;
+    PixelType             maxValue_;
+
+  public:
+    GetMinMaxValueFunctor(const ImageAccessor& source) :
+      source_(&source),
+      minValue_(std::numeric_limits<PixelType>::max()),
+      maxValue_(std::numeric_limits<PixelType>::min())
+    {
+    }
+
+    void Apply(unsigned int firstRow,
+               unsigned int endRow)
+    {
+      const unsigned int width = source_->GetWidth();
+
+      for (unsigned int y = firstRow; y < endRow; y++)
+      {
+        const PixelType* p = reinterpret_cast<const PixelType*>(source_->GetConstRow(y));
+
+        unsigned int x = (simdEnabled_ ? GetMinMaxRowSimd<PixelType>(minValue_, maxValue_, p, width) : 0);
+        p += x;
+
+        for (; x < width; x++, p++)
+        {
+          if (*p < minValue_)
+          {
+            minValue_ = *p;
+          }
+
+          if (*p > maxValue_)
+          {
+            maxValue_ = *p;
+          }
+        }
+      }
+    }
+
+    void Merge(const GetMinMaxValueFunctor& other)
+    {
+      minValue_ = std::min(minValue_, other.minValue_);
+      maxValue_ = std::max(maxValue_, other.maxValue_);
+    }
+
+    PixelType GetMinValue() const
+    {
+      return minValue_;
+    }
+
+    PixelType GetMaxValue() const
+    {
+      return maxValue_;
+    }
+  };
+
+
   template <typename PixelType>
   static void GetMinMaxValueInternal(PixelType& minValue,
                                      PixelType& maxValue,
@@ -143,28 +812,67 @@ namespace Orthanc
       return;
     }
 
-    minValue = std::numeric_limits<PixelType>::max();
-    maxValue = std::numeric_limits<PixelType>::min();
+    GetMinMaxValueFunctor<PixelType> functor(source);
+    ProcessRows(functor, source);
 
-    for (unsigned int y = 0; y < source.GetHeight(); y++)
+    minValue = functor.GetMinValue();
+    maxValue = functor.GetMaxValue();
+  }
+
+
+  template <typename PixelType>
+  class AddConstantFunctor
+  {
+  private:
+    ImageAccessor*  image_;
+    int64_t         constant_;
+
+  public:
+    AddConstantFunctor(ImageAccessor& image,
+                       int64_t constant) :
+      image_(&image),
+      constant_(constant)
+    {
+    }
+
+    void Apply(unsigned int firstRow,
+               unsigned int endRow)
     {
-      const PixelType* p = reinterpret_cast<const PixelType*>(source.GetConstRow(y));
+      const int64_t minValue = std::numeric_limits<PixelType>::min();
+      const int64_t maxValue = std::numeric_limits<PixelType>::max();
+      const unsigned int width = image_->GetWidth();
 
-      for (unsigned int x = 0; x < source.GetWidth(); x++, p++)
+      for (unsigned int y = firstRow; y < endRow; y++)
       {
-        if (*p < minValue)
-        {
-          minValue = *p;
-        }
+        PixelType* p = reinterpret_cast<PixelType*>(image_->GetRow(y));
 
-        if (*p > maxValue)
+        unsigned int x = (simdEnabled_ ? AddConstantRowSimd<PixelType>(p, width, constant_) : 0);
+        p += x;
+
+        for (; x < width; x++, p++)
         {
-          maxValue = *p;
+          int64_t v = static_cast<int64_t>(*p) + constant_;
+
+          if (v > maxValue)
+          {
+            *p = std::numeric_limits<PixelType>::max();
+          }
+          else if (v < minValue)
+          {
+            *p = std::numeric_limits<PixelType>::min();
+          }
+          else
+          {
+            *p = static_cast<PixelType>(v);
+          }
         }
       }
     }
-  }
 
+    void Merge(const AddConstantFunctor& /*other*/)
+    {
+    }
+  };
 
 
   template <typename PixelType>
@@ -176,16 +884,34 @@ namespace Orthanc
       return;
     }
 
-    const int64_t minValue = std::numeric_limits<PixelType>::min();
-    const int64_t maxValue = std::numeric_limits<PixelType>::max();
+    AddConstantFunctor<PixelType> functor(image, constant);
+    ProcessRows(functor, image);
+  }
+
 
-    for (unsigned int y = 0; y < image.GetHeight(); y++)
+  /**
+   * Shared by "MultiplyConstant()" (with "offset == 0" and
+   * "isMultiply == true") and "ShiftScale()": Their scalar versions
+   * only differ in the function that rounds the result.
+   **/
+  template <typename PixelType>
+  class ShiftScaleFunctor
+  {
+  private:
+    ImageAccessor*  image_;
+    float           offset_;
+    float           scaling_;
+    bool            isMultiply_;
+
+    void ApplyShiftScale(PixelType* p,
+                         unsigned int count) const
     {
-      PixelType* p = reinterpret_cast<PixelType*>(image.GetRow(y));
+      const float minValue = static_cast<float>(std::numeric_limits<PixelType>::min());
+      const float maxValue = static_cast<float>(std::numeric_limits<PixelType>::max());
 
-      for (unsigned int x = 0; x < image.GetWidth(); x++, p++)
+      for (unsigned int x = 0; x < count; x++, p++)
       {
-        int64_t v = static_cast<int64_t>(*p) + constant;
+        float v = (static_cast<float>(*p) + offset_) * scaling_;
 
         if (v > maxValue)
         {
@@ -197,33 +923,20 @@ namespace Orthanc
         }
         else
         {
-          *p = static_cast<PixelType>(v);
+          *p = static_cast<PixelType>(boost::math::iround(v));
         }
       }
     }
-  }
-
 
-
-  template <typename PixelType>
-  void MultiplyConstantInternal(ImageAccessor& image,
-                                float factor)
-  {
-    if (abs(factor - 1.0f) <= std::numeric_limits<float>::epsilon())
-    {
-      return;
-    }
-
-    const int64_t minValue = std::numeric_limits<PixelType>::min();
-    const int64_t maxValue = std::numeric_limits<PixelType>::max();
-
-    for (unsigned int y = 0; y < image.GetHeight(); y++)
+    void ApplyMultiply(PixelType* p,
+                       unsigned int count) const
     {
-      PixelType* p = reinterpret_cast<PixelType*>(image.GetRow(y));
+      const int64_t minValue = std::numeric_limits<PixelType>::min();
+      const int64_t maxValue = std::numeric_limits<PixelType>::max();
 
-      for (unsigned int x = 0; x < image.GetWidth(); x++, p++)
+      for (unsigned int x = 0; x < count; x++, p++)
       {
-        int64_t v = boost::math::llround(static_cast<float>(*p) * factor);
+        int64_t v = boost::math::llround(static_cast<float>(*p) * scaling_);
 
         if (v > maxValue)
         {
@@ -239,6 +952,67 @@ namespace Orthanc
         }
       }
     }
+
+  public:
+    ShiftScaleFunctor(ImageAccessor& image,
+                      float offset,
+                      float scaling,
+                      bool isMultiply) :
+      image_(&image),
+      offset_(offset),
+      scaling_(scaling),
+      isMultiply_(isMultiply)
+    {
+    }
+
+    void Apply(unsigned int firstRow,
+               unsigned int endRow)
+    {
+      const unsigned int width = image_->GetWidth();
+
+      // The SIMD version is only used if the scalar version cannot
+      // meet a NaN or an infinite product, which makes the latter
+      // throw an exception when rounding
+      const bool simd = (simdEnabled_ &&
+                         boost::math::isfinite(offset_) &&
+                         boost::math::isfinite(scaling_) &&
+                         (!isMultiply_ ||
+                          std::abs(scaling_) < std::numeric_limits<float>::max() / 65536.0f));
+
+      for (unsigned int y = firstRow; y < endRow; y++)
+      {
+        PixelType* p = reinterpret_cast<PixelType*>(image_->GetRow(y));
+
+        unsigned int x = (simd ? ShiftScaleRowSimd<PixelType>(p, width, offset_, scaling_) : 0);
+
+        if (isMultiply_)
+        {
+          ApplyMultiply(p + x, width - x);
+        }
+        else
+        {
+          ApplyShiftScale(p + x, width - x);
+        }
+      }
+    }
+
+    void Merge(const ShiftScaleFunctor& /*other*/)
+    {
+    }
+  };
+
+
+  template <typename PixelType>
+  void MultiplyConstantInternal(ImageAccessor& image,
+                                float factor)
+  {
+    if (abs(factor - 1.0f) <= std::numeric_limits<float>::epsilon())
+    {
+      return;
+    }
+
+    ShiftScaleFunctor<PixelType> functor(image, 0.0f, factor, true);
+    ProcessRows(functor, image);
   }
 
 
@@ -247,31 +1021,218 @@ namespace Orthanc
                           float offset,
                           float scaling)
   {
-    const float minValue = static_cast<float>(std::numeric_limits<PixelType>::min());
-    const float maxValue = static_cast<float>(std::numeric_limits<PixelType>::max());
+    ShiftScaleFunctor<PixelType> functor(image, offset, scaling, false);
+    ProcessRows(functor, image);
+  }
 
-    for (unsigned int y = 0; y < image.GetHeight(); y++)
+
+  template <typename PixelType,
+            unsigned int ChannelsCount>
+  class DownscaleFunctor
+  {
+  private:
+    ImageAccessor*        target_;
+    const ImageAccessor*  source_;
+
+  public:
+    DownscaleFunctor(ImageAccessor& target,
+                     const ImageAccessor& source) :
+      target_(&target),
+      source_(&source)
     {
-      PixelType* p = reinterpret_cast<PixelType*>(image.GetRow(y));
+    }
 
-      for (unsigned int x = 0; x < image.GetWidth(); x++, p++)
+    // The rows are those of the target image
+    void Apply(unsigned int firstRow,
+               unsigned int endRow)
+    {
+      const unsigned int sourceWidth = source_->GetWidth();
+      const unsigned int sourceHeight = source_->GetHeight();
+      const unsigned int targetWidth = target_->GetWidth();
+      const unsigned int targetHeight = target_->GetHeight();
+
+      for (unsigned int ty = firstRow; ty < endRow; ty++)
       {
-        float v = (static_cast<float>(*p) + offset) * scaling;
+        // Range of the source rows that are covered by this target row
+        const unsigned int y0 = static_cast<unsigned int>(static_cast<uint64_t>(ty) * sourceHeight / targetHeight);
+        const unsigned int y1 = static_cast<unsigned int>(static_cast<uint64_t>(ty + 1) * sourceHeight / targetHeight);
+        assert(y0 < y1);
 
-        if (v > maxValue)
-        {
-          *p = std::numeric_limits<PixelType>::max();
-        }
-        else if (v < minValue)
+        PixelType* t = reinterpret_cast<PixelType*>(target_->GetRow(ty));
+
+        for (unsigned int tx = 0; tx < targetWidth; tx++)
         {
-          *p = std::numeric_limits<PixelType>::min();
+          const unsigned int x0 = static_cast<unsigned int>(static_cast<uint64_t>(tx) * sourceWidth / targetWidth);
+          const unsigned int x1 = static_cast<unsigned int>(static_cast<uint64_t>(tx + 1) * sourceWidth / targetWidth);
+          assert(x0 < x1);
+
+          int64_t sums[ChannelsCount];
+          for (unsigned int c = 0; c < ChannelsCount; c++)
+          {
+            sums[c] = 0;
+          }
+
+          for (unsigned int y = y0; y < y1; y++)
+          {
+            const PixelType* s = reinterpret_cast<const PixelType*>(source_->GetConstRow(y)) + x0 * ChannelsCount;
+
+            for (unsigned int x = x0; x < x1; x++)
+            {
+              for (unsigned int c = 0; c < ChannelsCount; c++, s++)
+              {
+                sums[c] += *s;
+              }
+            }
+          }
+
+          // Round the mean to the nearest integer, halfway cases away from zero
+          const int64_t count = static_cast<int64_t>(x1 - x0) * static_cast<int64_t>(y1 - y0);
+          for (unsigned int c = 0; c < ChannelsCount; c++, t++)
+          {
+            if (sums[c] >= 0)
+            {
+              *t = static_cast<PixelType>((sums[c] + count / 2) / count);
+            }
+            else
+            {
+              *t = static_cast<PixelType>(-((-sums[c] + count / 2) / count));
+            }
+          }
         }
-        else
+      }
+    }
+
+    void Merge(const DownscaleFunctor& /*other*/)
+    {
+    }
+  };
+
+
+  template <typename PixelType,
+            unsigned int ChannelsCount>
+  static void DownscaleInternal(ImageAccessor& target,
+                                const ImageAccessor& source)
+  {
+    // The amount of work is proportional to the size of the source
+    DownscaleFunctor<PixelType, ChannelsCount> functor(target, source);
+    ProcessRows(functor, target.GetHeight(),
+                static_cast<uint64_t>(source.GetWidth()) * static_cast<uint64_t>(source.GetHeight()));
+  }
+
+
+  template <typename SourceType>
+  class WindowingFunctor
+  {
+  private:
+    ImageAccessor*        target_;
+    const ImageAccessor*  source_;
+    const uint8_t*        lut_;
+
+  public:
+    // "lut" is indexed by the source values, shifted so that the
+    // minimum value of "SourceType" is at index 0
+    WindowingFunctor(ImageAccessor& target,
+                     const ImageAccessor& source,
+                     const uint8_t* lut) :
+      target_(&target),
+      source_(&source),
+      lut_(lut)
+    {
+    }
+
+    void Apply(unsigned int firstRow,
+               unsigned int endRow)
+    {
+      const int32_t offset = -static_cast<int32_t>(std::numeric_limits<SourceType>::min());
+      const unsigned int width = source_->GetWidth();
+
+      for (unsigned int y = firstRow; y < endRow; y++)
+      {
+        uint8_t* t = reinterpret_cast<uint8_t*>(target_->GetRow(y));
+        const SourceType* s = reinterpret_cast<const SourceType*>(source_->GetConstRow(y));
+
+        for (unsigned int x = 0; x < width; x++)
         {
-          *p = static_cast<PixelType>(boost::math::iround(v));
+          t[x] = lut_[static_cast<int32_t>(s[x]) + offset];
         }
       }
     }
+
+    void Merge(const WindowingFunctor& /*other*/)
+    {
+    }
+  };
+
+
+  template <typename SourceType>
+  static void ApplyWindowingInternal(ImageAccessor& target,
+                                     const ImageAccessor& source,
+                                     float windowCenter,
+                                     float windowWidth,
+                                     float rescaleSlope,
+                                     float rescaleIntercept,
+                                     bool invert)
+  {
+    // Linear VOI LUT function of the DICOM standard (PS 3.3, C.11.2.1.2),
+    // evaluated once for each possible value of the source pixels
+    const int32_t minValue = static_cast<int32_t>(std::numeric_limits<SourceType>::min());
+    const int32_t maxValue = static_cast<int32_t>(std::numeric_limits<SourceType>::max());
+
+    const double center = static_cast<double>(windowCenter) - 0.5;
+    const double width = static_cast<double>(windowWidth) - 1.0;
+    const double low = center - width / 2.0;
+    const double high = center + width / 2.0;
+
+    std::vector<uint8_t> lut(maxValue - minValue + 1);
+
+    for (int32_t v = minValue; v <= maxValue; v++)
+    {
+      double x = static_cast<double>(v) * rescaleSlope + rescaleIntercept;
+
+      uint8_t y;
+      if (x <= low)
+      {
+        y = 0;
+      }
+      else if (x > high)
+      {
+        y = 255;
+      }
+      else
+      {
+        // The argument is in [0, 255.5]: Round to the nearest integer
+        y = static_cast<uint8_t>(static_cast<int>(((x - center) / width + 0.5) * 255.0 + 0.5));
+      }
+
+      lut[v - minValue] = (invert ? 255 - y : y);
+    }
+
+    WindowingFunctor<SourceType> functor(target, source, &lut[0]);
+    ProcessRows(functor, source);
+  }
+
+
+  void ImageProcessing::SetSimdEnabled(bool enabled)
+  {
+    simdEnabled_ = enabled;
+  }
+
+
+  bool ImageProcessing::IsSimdEnabled()
+  {
+    return (ORTHANC_IMAGE_PROCESSING_SSE2 == 1 && simdEnabled_);
+  }
+
+
+  void ImageProcessing::SetThreadsCount(unsigned int count)
+  {
+    threadsCount_ = (count == 0 ? 1 : count);
+  }
+
+
+  unsigned int ImageProcessing::GetThreadsCount()
+  {
+    return threadsCount_;
   }
 
 
@@ -529,4 +1490,106 @@ namespace Orthanc
         throw OrthancException(ErrorCode_NotImplemented);
     }
   }
+
+
+  void ImageProcessing::Downscale(ImageAccessor& target,
+                                  const ImageAccessor& source)
+  {
+    if (target.GetFormat() != source.GetFormat())
+    {
+      throw OrthancException(ErrorCode_IncompatibleImageFormat);
+    }
+
+    if (target.GetWidth() > source.GetWidth() ||
+        target.GetHeight() > source.GetHeight() ||
+        (target.GetWidth() == 0 && source.GetWidth() != 0) ||
+        (target.GetHeight() == 0 && source.GetHeight() != 0))
+    {
+      throw OrthancException(ErrorCode_IncompatibleImageSize);
+    }
+
+    if (target.GetWidth() == source.GetWidth() &&
+        target.GetHeight() == source.GetHeight())
+    {
+      Copy(target, source);
+      return;
+    }
+
+    switch (source.GetFormat())
+    {
+      case PixelFormat_Grayscale8:
+        DownscaleInternal<uint8_t, 1>(target, source);
+        return;
+
+      case PixelFormat_RGB24:
+        DownscaleInternal<uint8_t, 3>(target, source);
+        return;
+
+      case PixelFormat_RGBA32:
+        DownscaleInternal<uint8_t, 4>(target, source);
+        return;
+
+      case PixelFormat_Grayscale16:
+        DownscaleInternal<uint16_t, 1>(target, source);
+        return;
+
+      case PixelFormat_SignedGrayscale16:
+        DownscaleInternal<int16_t, 1>(target, source);
+        return;
+
+      default:
+        throw OrthancException(ErrorCode_NotImplemented);
+    }
+  }
+
+
+  void ImageProcessing::ApplyWindowing(ImageAccessor& target,
+                                       const ImageAccessor& source,
+                                       float windowCenter,
+                                       float windowWidth,
+                                       float rescaleSlope,
+                                       float rescaleIntercept,
+                                       bool invert)
+  {
+    if (target.GetWidth() != source.GetWidth() ||
+        target.GetHeight() != source.GetHeight())
+    {
+      throw OrthancException(ErrorCode_IncompatibleImageSize);
+    }
+
+    if (target.GetFormat() != PixelFormat_Grayscale8)
+    {
+      throw OrthancException(ErrorCode_IncompatibleImageFormat);
+    }
+
+    if (!boost::math::isfinite(windowCenter) ||
+        !boost::math::isfinite(windowWidth) ||
+        !boost::math::isfinite(rescaleSlope) ||
+        !boost::math::isfinite(rescaleIntercept) ||
+        windowWidth < 1.0f)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    switch (source.GetFormat())
+    {
+      case PixelFormat_Grayscale8:
+        ApplyWindowingInternal<uint8_t>(target, source, windowCenter, windowWidth, 
+                                        rescaleSlope, rescaleIntercept, invert);
+        return;
+
+      case PixelFormat_Grayscale16:
+        ApplyWindowingInternal<uint16_t>(target, source, windowCenter, windowWidth, 
+                                         rescaleSlope, rescaleIntercept, invert);
+        return;
+
+      case PixelFormat_SignedGrayscale16:
+        ApplyWindowingInternal<int16_t>(target, source, windowCenter, windowWidth, 
+                                        rescaleSlope, rescaleIntercept, invert);
+        return;
+
+      default:
+        throw OrthancException(ErrorCode_NotImplemented);
+    }
+  }
 }
@@ -41,6 +41,25 @@ namespace Orthanc
   class ImageProcessing
   {
   public:
+    /**
+     * The SIMD implementations of the operations are used by default
+     * if available on this platform (SSE2 on x86-64). They give the
+     * same results as the scalar implementations, that are the
+     * reference, and that are used if SIMD is disabled.
+     **/
+    static void SetSimdEnabled(bool enabled);
+
+    static bool IsSimdEnabled();
+
+    /**
+     * Large images are split into horizontal bands that are processed
+     * by at most "count" threads. The default value "1" processes all
+     * the images in the calling thread.
+     **/
+    static void SetThreadsCount(unsigned int count);
+
+    static unsigned int GetThreadsCount();
+
     static void Copy(ImageAccessor& target,
                      const ImageAccessor& source);
 
@@ -66,5 +85,29 @@ namespace Orthanc
     static void ShiftScale(ImageAccessor& image,
                            float offset,
                            float scaling);
+
+    /**
+     * Reduces the size of the source image to the size of the target
+     * image, by averaging the source pixels that are covered by each
+     * target pixel (box filter). Both images must have the same pixel
+     * format, and the target cannot be larger than the source.
+     **/
+    static void Downscale(ImageAccessor& target,
+                          const ImageAccessor& source);
+
+    /**
+     * Maps a grayscale image to an 8bpp image, by applying the
+     * modality LUT ("rescaleSlope" and "rescaleIntercept"), then the
+     * linear VOI LUT of the DICOM standard (window center and width),
+     * through a lookup table of all the possible source values. If
+     * "invert" is "true", the result is inverted (MONOCHROME1).
+     **/
+    static void ApplyWindowing(ImageAccessor& target,
+                               const ImageAccessor& source,
+                               float windowCenter,
+                               float windowWidth,
+                               float rescaleSlope,
+                               float rescaleIntercept,
+                               bool invert);
   };
 }
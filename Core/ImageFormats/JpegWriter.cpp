@@ -0,0 +1,232 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "../PrecompiledHeaders.h"
+#include "JpegWriter.h"
+
+#include "../OrthancException.h"
+#include "../ChunkedBuffer.h"
+#include "../Toolbox.h"
+
+#include <vector>
+#include <setjmp.h>
+#include <stdio.h>
+
+#if ORTHANC_JPEG_ENABLED == 1
+// Use the 8bpp version of the IJG library that is embedded in DCMTK
+extern "C"
+{
+#define boolean ijg_boolean
+#include <jpeglib8.h>
+#undef boolean
+}
+#endif
+
+
+namespace Orthanc
+{
+#if ORTHANC_JPEG_ENABLED == 1
+  // http://www.ijg.org/files/ (file "libjpeg.doc" of release 6b)
+  namespace
+  {
+    // Anonymous namespace to avoid clashes between compilation modules
+
+    static const size_t BLOCK_SIZE = 16384;
+
+    struct ErrorManager
+    {
+      struct jpeg_error_mgr  pub_;  // Must be the first member
+      jmp_buf                jump_;
+    };
+
+    struct DestinationManager
+    {
+      struct jpeg_destination_mgr  pub_;  // Must be the first member
+      ChunkedBuffer*               target_;
+      std::vector<JOCTET>          block_;
+    };
+  }
+
+
+  static void ErrorExit(j_common_ptr cinfo)
+  {
+    // Give the control back to "WriteToMemory()"
+    ErrorManager* errors = reinterpret_cast<ErrorManager*>(cinfo->err);
+    longjmp(errors->jump_, 1);
+  }
+
+
+  static void OutputMessage(j_common_ptr /*cinfo*/)
+  {
+    // Ignore the warnings
+  }
+
+
+  static void InitDestination(j_compress_ptr cinfo)
+  {
+    DestinationManager* dest = reinterpret_cast<DestinationManager*>(cinfo->dest);
+    dest->pub_.next_output_byte = &dest->block_[0];
+    dest->pub_.free_in_buffer = dest->block_.size();
+  }
+
+
+  static ijg_boolean EmptyOutputBuffer(j_compress_ptr cinfo)
+  {
+    // The whole block must be emptied, whatever "free_in_buffer" is
+    DestinationManager* dest = reinterpret_cast<DestinationManager*>(cinfo->dest);
+    dest->target_->AddChunk(reinterpret_cast<const char*>(&dest->block_[0]), dest->block_.size());
+    InitDestination(cinfo);
+    return TRUE;
+  }
+
+
+  static void TermDestination(j_compress_ptr cinfo)
+  {
+    DestinationManager* dest = reinterpret_cast<DestinationManager*>(cinfo->dest);
+    dest->target_->AddChunk(reinterpret_cast<const char*>(&dest->block_[0]),
+                            dest->block_.size() - dest->pub_.free_in_buffer);
+  }
+#endif
+
+
+  void JpegWriter::SetQuality(uint8_t quality)
+  {
+    if (quality == 0 || quality > 100)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    quality_ = quality;
+  }
+
+
+  void JpegWriter::WriteToFile(const char* filename,
+                               unsigned int width,
+                               unsigned int height,
+                               unsigned int pitch,
+                               PixelFormat format,
+                               const void* buffer)
+  {
+    std::string jpeg;
+    WriteToMemory(jpeg, width, height, pitch, format, buffer);
+    Toolbox::WriteFile(jpeg, filename);
+  }
+
+
+  void JpegWriter::WriteToMemory(std::string& jpeg,
+                                 unsigned int width,
+                                 unsigned int height,
+                                 unsigned int pitch,
+                                 PixelFormat format,
+                                 const void* buffer)
+  {
+#if ORTHANC_JPEG_ENABLED == 1
+    int components;
+    J_COLOR_SPACE colorSpace;
+
+    switch (format)
+    {
+      case PixelFormat_Grayscale8:
+        components = 1;
+        colorSpace = JCS_GRAYSCALE;
+        break;
+
+      case PixelFormat_RGB24:
+        components = 3;
+        colorSpace = JCS_RGB;
+        break;
+
+      default:
+        throw OrthancException(ErrorCode_NotImplemented);
+    }
+
+    if (width == 0 ||
+        height == 0 ||
+        width > JPEG_MAX_DIMENSION ||
+        height > JPEG_MAX_DIMENSION)
+    {
+      throw OrthancException(ErrorCode_IncompatibleImageSize);
+    }
+
+    // All the objects with a destructor are created before "setjmp()"
+    ChunkedBuffer chunks;
+
+    struct jpeg_compress_struct cinfo;
+    ErrorManager errors;
+    DestinationManager dest;
+    dest.target_ = &chunks;
+    dest.block_.resize(BLOCK_SIZE);
+
+    cinfo.err = jpeg_std_error(&errors.pub_);
+    errors.pub_.error_exit = ErrorExit;
+    errors.pub_.output_message = OutputMessage;
+
+    if (setjmp(errors.jump_))
+    {
+      // Error during the compression
+      jpeg_destroy_compress(&cinfo);
+      throw OrthancException(ErrorCode_InternalError);
+    }
+
+    jpeg_create_compress(&cinfo);
+
+    dest.pub_.init_destination = InitDestination;
+    dest.pub_.empty_output_buffer = EmptyOutputBuffer;
+    dest.pub_.term_destination = TermDestination;
+    cinfo.dest = &dest.pub_;
+
+    cinfo.image_width = width;
+    cinfo.image_height = height;
+    cinfo.input_components = components;
+    cinfo.in_color_space = colorSpace;
+
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality_, TRUE /* limit to baseline-JPEG values */);
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while (cinfo.next_scanline < cinfo.image_height)
+    {
+      JSAMPROW row = const_cast<JSAMPROW>(reinterpret_cast<const JSAMPLE*>(buffer) + 
+                                          cinfo.next_scanline * pitch);
+      jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+
+    chunks.Flatten(jpeg);
+
+#else
+    throw OrthancException(ErrorCode_NotImplemented);
+#endif
+  }
+}
@@ -0,0 +1,143 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "../PrecompiledHeaders.h"
+#include "RawFramesHeader.h"
+
+#include "../OrthancException.h"
+
+namespace Orthanc
+{
+  static const uint32_t MAGIC = 0x5741524f;  // "ORAW" in little endian
+  static const uint32_t VERSION = 1;
+
+  const size_t RawFramesHeader::HEADER_SIZE;
+
+
+  static void WriteUInt32(std::string& target,
+                          size_t position,
+                          uint32_t value)
+  {
+    target[position] = static_cast<char>(value & 0xff);
+    target[position + 1] = static_cast<char>((value >> 8) & 0xff);
+    target[position + 2] = static_cast<char>((value >> 16) & 0xff);
+    target[position + 3] = static_cast<char>((value >> 24) & 0xff);
+  }
+
+
+  static uint32_t ReadUInt32(const uint8_t* p)
+  {
+    return (static_cast<uint32_t>(p[0]) |
+            (static_cast<uint32_t>(p[1]) << 8) |
+            (static_cast<uint32_t>(p[2]) << 16) |
+            (static_cast<uint32_t>(p[3]) << 24));
+  }
+
+
+  RawFramesHeader::RawFramesHeader() :
+    format_(PixelFormat_Grayscale8),
+    width_(0),
+    height_(0),
+    depth_(0)
+  {
+  }
+
+
+  RawFramesHeader::RawFramesHeader(PixelFormat format,
+                                   unsigned int width,
+                                   unsigned int height,
+                                   unsigned int depth) :
+    format_(format),
+    width_(width),
+    height_(height),
+    depth_(depth)
+  {
+  }
+
+
+  size_t RawFramesHeader::GetFrameSize() const
+  {
+    return GetBytesPerPixel(format_) * width_ * height_;
+  }
+
+
+  uint64_t RawFramesHeader::GetTotalSize() const
+  {
+    return HEADER_SIZE + static_cast<uint64_t>(GetFrameSize()) * depth_;
+  }
+
+
+  void RawFramesHeader::Write(std::string& target) const
+  {
+    target.resize(HEADER_SIZE);
+    WriteUInt32(target, 0, MAGIC);
+    WriteUInt32(target, 4, VERSION);
+    WriteUInt32(target, 8, static_cast<uint32_t>(format_));
+    WriteUInt32(target, 12, width_);
+    WriteUInt32(target, 16, height_);
+    WriteUInt32(target, 20, depth_);
+  }
+
+
+  void RawFramesHeader::Read(const void* data,
+                             size_t size)
+  {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+
+    if (size < HEADER_SIZE ||
+        ReadUInt32(p) != MAGIC ||
+        ReadUInt32(p + 4) != VERSION)
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    uint32_t format = ReadUInt32(p + 8);
+    switch (format)
+    {
+      case PixelFormat_RGB24:
+      case PixelFormat_RGBA32:
+      case PixelFormat_Grayscale8:
+      case PixelFormat_Grayscale16:
+      case PixelFormat_SignedGrayscale16:
+        format_ = static_cast<PixelFormat>(format);
+        break;
+
+      default:
+        throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    width_ = ReadUInt32(p + 12);
+    height_ = ReadUInt32(p + 16);
+    depth_ = ReadUInt32(p + 20);
+  }
+}
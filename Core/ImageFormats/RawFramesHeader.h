@@ -0,0 +1,101 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include "../Enumerations.h"
+
+#include <string>
+#include <stdint.h>
+
+namespace Orthanc
+{
+  /**
+   * Header of the volumes that are returned by the
+   * "/series/{id}/raw-frames" URI. It is made of 6 unsigned 32-bit
+   * little-endian integers: The magic number "ORAW", the version of
+   * the format, the pixel format, the width, the height, and the
+   * number of frames (depth). The header is directly followed by the
+   * frames, without any padding between the lines. The 16bpp pixels
+   * are stored in little endian.
+   **/
+  class RawFramesHeader
+  {
+  private:
+    PixelFormat   format_;
+    unsigned int  width_;
+    unsigned int  height_;
+    unsigned int  depth_;
+
+  public:
+    static const size_t HEADER_SIZE = 24;
+
+    RawFramesHeader();
+
+    RawFramesHeader(PixelFormat format,
+                    unsigned int width,
+                    unsigned int height,
+                    unsigned int depth);
+
+    PixelFormat GetFormat() const
+    {
+      return format_;
+    }
+
+    unsigned int GetWidth() const
+    {
+      return width_;
+    }
+
+    unsigned int GetHeight() const
+    {
+      return height_;
+    }
+
+    unsigned int GetDepth() const
+    {
+      return depth_;
+    }
+
+    size_t GetFrameSize() const;
+
+    // Size of the header and of all the frames
+    uint64_t GetTotalSize() const;
+
+    void Write(std::string& target) const;
+
+    // Throws "ErrorCode_BadFileFormat" if the header is invalid
+    void Read(const void* data,
+              size_t size);
+  };
+}
@@ -62,6 +62,6 @@ namespace Orthanc
       condition_.wait(lock);
     }
 
-    count_++;
+    count_--;
   }
 }
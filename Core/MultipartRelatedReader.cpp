@@ -0,0 +1,205 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "PrecompiledHeaders.h"
+#include "MultipartRelatedReader.h"
+
+#include "OrthancException.h"
+#include "Toolbox.h"
+
+namespace Orthanc
+{
+  static const char* CRLF = "\r\n";
+
+
+  static std::string GetParameter(const std::string& contentType,
+                                  const std::string& name)
+  {
+    std::vector<std::string> tokens;
+    Toolbox::TokenizeString(tokens, contentType, ';');
+
+    for (size_t i = 1; i < tokens.size(); i++)
+    {
+      size_t equal = tokens[i].find('=');
+      if (equal == std::string::npos)
+      {
+        continue;
+      }
+
+      std::string key;
+      Toolbox::ToLowerCase(key, Toolbox::StripSpaces(tokens[i].substr(0, equal)));
+
+      if (key == name)
+      {
+        std::string value = Toolbox::StripSpaces(tokens[i].substr(equal + 1));
+        if (value.size() >= 2 &&
+            value[0] == '"' &&
+            value[value.size() - 1] == '"')
+        {
+          value = value.substr(1, value.size() - 2);
+        }
+
+        return value;
+      }
+    }
+
+    return "";
+  }
+
+
+  bool MultipartRelatedReader::ParseContentType(std::string& boundary,
+                                                const std::string& contentType)
+  {
+    std::string mime;
+    Toolbox::ToLowerCase(mime, Toolbox::StripSpaces(contentType.substr(0, contentType.find(';'))));
+
+    if (mime != "multipart/related")
+    {
+      return false;
+    }
+
+    boundary = GetParameter(contentType, "boundary");
+    if (boundary.empty())
+    {
+      throw OrthancException(ErrorCode_BadRequest);
+    }
+
+    return true;
+  }
+
+
+  MultipartRelatedReader::MultipartRelatedReader(const std::string& body,
+                                                 const std::string& boundary) :
+    body_(body)
+  {
+    if (boundary.empty())
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    const std::string delimiter = "--" + boundary;
+
+    // Skip the preamble
+    size_t pos = body_.find(delimiter);
+    if (pos == std::string::npos ||
+        (pos != 0 && (pos < 2 || body_.compare(pos - 2, 2, CRLF) != 0)))
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    for (;;)
+    {
+      pos += delimiter.size();
+
+      if (body_.compare(pos, 2, "--") == 0)
+      {
+        // Closing delimiter, the epilogue is ignored
+        return;
+      }
+
+      // Skip the transport padding, up to the end of the line
+      pos = body_.find(CRLF, pos);
+      if (pos == std::string::npos)
+      {
+        throw OrthancException(ErrorCode_BadFileFormat);
+      }
+
+      pos += 2;
+
+      // Parse the headers of the part, that end with an empty line
+      Part part;
+      while (body_.compare(pos, 2, CRLF) != 0)
+      {
+        size_t eol = body_.find(CRLF, pos);
+        if (eol == std::string::npos)
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+
+        std::string header = body_.substr(pos, eol - pos);
+        size_t colon = header.find(':');
+        if (colon != std::string::npos)
+        {
+          std::string key;
+          Toolbox::ToLowerCase(key, Toolbox::StripSpaces(header.substr(0, colon)));
+          if (key == "content-type")
+          {
+            part.contentType_ = Toolbox::StripSpaces(header.substr(colon + 1));
+          }
+        }
+
+        pos = eol + 2;
+      }
+
+      pos += 2;
+
+      size_t end = body_.find(CRLF + delimiter, pos);
+      if (end == std::string::npos)
+      {
+        throw OrthancException(ErrorCode_BadFileFormat);
+      }
+
+      part.offset_ = pos;
+      part.size_ = end - pos;
+      parts_.push_back(part);
+
+      pos = end + 2;
+    }
+  }
+
+
+  const MultipartRelatedReader::Part& MultipartRelatedReader::GetPart(size_t index) const
+  {
+    if (index >= parts_.size())
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    return parts_[index];
+  }
+
+
+  const char* MultipartRelatedReader::GetData(size_t index) const
+  {
+    const Part& part = GetPart(index);
+    return part.size_ == 0 ? NULL : body_.c_str() + part.offset_;
+  }
+
+
+  void MultipartRelatedReader::GetPart(std::string& content,
+                                       size_t index) const
+  {
+    const Part& part = GetPart(index);
+    content.assign(body_, part.offset_, part.size_);
+  }
+}
@@ -0,0 +1,93 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+
+namespace Orthanc
+{
+  /**
+   * Splits a "multipart/related" body (RFC 2387) into its parts. The
+   * parts are not copied: They are described by their location inside
+   * the body, that must be kept alive as long as this reader is used.
+   **/
+  class MultipartRelatedReader : public boost::noncopyable
+  {
+  private:
+    struct Part
+    {
+      size_t       offset_;
+      size_t       size_;
+      std::string  contentType_;
+    };
+
+    const std::string& body_;
+    std::vector<Part> parts_;
+
+    const Part& GetPart(size_t index) const;
+
+  public:
+    MultipartRelatedReader(const std::string& body,
+                           const std::string& boundary);
+
+    /**
+     * Returns "false" if the "Content-Type" HTTP header does not
+     * correspond to a "multipart/related" body.
+     **/
+    static bool ParseContentType(std::string& boundary,
+                                 const std::string& contentType);
+
+    size_t GetPartsCount() const
+    {
+      return parts_.size();
+    }
+
+    const std::string& GetContentType(size_t index) const
+    {
+      return GetPart(index).contentType_;
+    }
+
+    size_t GetSize(size_t index) const
+    {
+      return GetPart(index).size_;
+    }
+
+    const char* GetData(size_t index) const;
+
+    void GetPart(std::string& content,
+                 size_t index) const;
+  };
+}
@@ -0,0 +1,128 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "PrecompiledHeaders.h"
+#include "MultipartRelatedWriter.h"
+
+#include "OrthancException.h"
+#include "Toolbox.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+namespace Orthanc
+{
+  static std::string GenerateBoundary(const void* writer)
+  {
+    // The boundary must not appear inside the parts: Hash enough
+    // varying information to make collisions unlikely
+    static unsigned int counter = 0;
+
+    char buf[128];
+    sprintf(buf, "%p-%u-%lu-%d", writer, counter++,
+            static_cast<unsigned long>(time(NULL)), rand());
+
+    std::string md5;
+    Toolbox::ComputeMD5(md5, buf);
+    return "orthanc-" + md5;
+  }
+
+
+  MultipartRelatedWriter::MultipartRelatedWriter(const std::string& mime) :
+    mime_(mime),
+    count_(0)
+  {
+    boundary_ = GenerateBoundary(this);
+  }
+
+
+  std::string MultipartRelatedWriter::GetContentType() const
+  {
+    return "multipart/related; type=\"" + mime_ + "\"; boundary=" + boundary_;
+  }
+
+
+  void MultipartRelatedWriter::AddPart(const void* data,
+                                       size_t size)
+  {
+    const char* p = static_cast<const char*>(data);
+    if (std::search(p, p + size, boundary_.begin(), boundary_.end()) != p + size)
+    {
+      throw OrthancException(ErrorCode_InternalError);
+    }
+
+    char length[32];
+    sprintf(length, "%lu", static_cast<unsigned long>(size));
+
+    body_.reserve(body_.size() + size + boundary_.size() + mime_.size() + 64);
+    body_ += "--" + boundary_ + "\r\n";
+    body_ += "Content-Type: " + mime_ + "\r\n";
+    body_ += "Content-Length: " + std::string(length) + "\r\n\r\n";
+    body_.append(p, size);
+    body_ += "\r\n";
+
+    count_++;
+  }
+
+
+  void MultipartRelatedWriter::AddPart(const std::string& data)
+  {
+    if (data.empty())
+    {
+      AddPart(NULL, 0);
+    }
+    else
+    {
+      AddPart(&data[0], data.size());
+    }
+  }
+
+
+  void MultipartRelatedWriter::Finish(std::string& target)
+  {
+    body_ += "--" + boundary_ + "--\r\n";
+
+    target.clear();
+    target.swap(body_);
+    count_ = 0;
+  }
+
+
+  void MultipartRelatedWriter::Clear()
+  {
+    body_.clear();
+    count_ = 0;
+  }
+}
@@ -0,0 +1,87 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include <string>
+#include <boost/noncopyable.hpp>
+
+namespace Orthanc
+{
+  /**
+   * Formats a "multipart/related" body (RFC 2387), that packs several
+   * files of the same MIME type into one HTTP request. The boundary
+   * is generated by the writer, and is part of "GetContentType()".
+   **/
+  class MultipartRelatedWriter : public boost::noncopyable
+  {
+  private:
+    std::string mime_;
+    std::string boundary_;
+    std::string body_;
+    size_t count_;
+
+  public:
+    MultipartRelatedWriter(const std::string& mime);
+
+    const std::string& GetBoundary() const
+    {
+      return boundary_;
+    }
+
+    std::string GetContentType() const;
+
+    void AddPart(const void* data,
+                 size_t size);
+
+    void AddPart(const std::string& data);
+
+    size_t GetPartsCount() const
+    {
+      return count_;
+    }
+
+    size_t GetSize() const
+    {
+      return body_.size();
+    }
+
+    /**
+     * Closes the body, then moves it to "target". The writer is
+     * emptied, and can be used to format another body.
+     **/
+    void Finish(std::string& target);
+
+    void Clear();
+  };
+}
@@ -0,0 +1,310 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "../PrecompiledHeaders.h"
+#include "JsonStreamWriter.h"
+
+#include "../OrthancException.h"
+
+#include <json/writer.h>
+
+namespace Orthanc
+{
+  static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+
+  JsonStreamWriter::JsonStreamWriter(IOutputStream& output,
+                                     bool pretty) :
+    output_(output),
+    pretty_(pretty),
+    chunkSize_(DEFAULT_CHUNK_SIZE),
+    hasRoot_(false),
+    afterKey_(false),
+    closed_(false)
+  {
+  }
+
+
+  void JsonStreamWriter::SetChunkSize(size_t size)
+  {
+    if (size == 0)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    chunkSize_ = size;
+  }
+
+
+  void JsonStreamWriter::Append(const std::string& s)
+  {
+    buffer_.append(s);
+
+    if (buffer_.size() >= chunkSize_)
+    {
+      output_.Write(buffer_);
+      buffer_.clear();
+    }
+  }
+
+
+  void JsonStreamWriter::NewLine(size_t depth)
+  {
+    if (pretty_)
+    {
+      buffer_.push_back('\n');
+      buffer_.append(3 * depth, ' ');
+    }
+  }
+
+
+  void JsonStreamWriter::BeforeValue()
+  {
+    if (closed_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (levels_.empty())
+    {
+      if (hasRoot_)
+      {
+        // Only one root value is allowed
+        throw OrthancException(ErrorCode_BadSequenceOfCalls);
+      }
+
+      hasRoot_ = true;
+    }
+    else if (levels_.back().isArray_)
+    {
+      if (levels_.back().count_ > 0)
+      {
+        buffer_.push_back(',');
+      }
+
+      NewLine(levels_.size());
+      levels_.back().count_++;
+    }
+    else if (afterKey_)
+    {
+      afterKey_ = false;
+    }
+    else
+    {
+      // Values of an object must be preceded by a key
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+  }
+
+
+  void JsonStreamWriter::Start(bool isArray)
+  {
+    BeforeValue();
+
+    Level level;
+    level.isArray_ = isArray;
+    level.count_ = 0;
+    levels_.push_back(level);
+
+    Append(isArray ? "[" : "{");
+  }
+
+
+  void JsonStreamWriter::End(bool isArray)
+  {
+    if (levels_.empty() ||
+        levels_.back().isArray_ != isArray ||
+        afterKey_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    const bool isEmpty = (levels_.back().count_ == 0);
+    levels_.pop_back();
+
+    if (!isEmpty)
+    {
+      NewLine(levels_.size());
+    }
+
+    Append(isArray ? "]" : "}");
+  }
+
+
+  void JsonStreamWriter::WriteKey(const std::string& key)
+  {
+    if (levels_.empty() ||
+        levels_.back().isArray_ ||
+        afterKey_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (levels_.back().count_ > 0)
+    {
+      buffer_.push_back(',');
+    }
+
+    NewLine(levels_.size());
+    levels_.back().count_++;
+
+    buffer_.append(Json::valueToQuotedString(key.c_str()));
+    Append(pretty_ ? " : " : ":");
+    afterKey_ = true;
+  }
+
+
+  void JsonStreamWriter::WriteString(const std::string& value)
+  {
+    BeforeValue();
+    Append(Json::valueToQuotedString(value.c_str()));
+  }
+
+
+  void JsonStreamWriter::WriteInteger(int64_t value)
+  {
+    BeforeValue();
+    Append(Json::valueToString(static_cast<Json::LargestInt>(value)));
+  }
+
+
+  void JsonStreamWriter::WriteUnsignedInteger(uint64_t value)
+  {
+    BeforeValue();
+    Append(Json::valueToString(static_cast<Json::LargestUInt>(value)));
+  }
+
+
+  void JsonStreamWriter::WriteDouble(double value)
+  {
+    BeforeValue();
+    Append(Json::valueToString(value));
+  }
+
+
+  void JsonStreamWriter::WriteBool(bool value)
+  {
+    BeforeValue();
+    Append(value ? "true" : "false");
+  }
+
+
+  void JsonStreamWriter::WriteNull()
+  {
+    BeforeValue();
+    Append("null");
+  }
+
+
+  void JsonStreamWriter::WriteValue(const Json::Value& value)
+  {
+    switch (value.type())
+    {
+      case Json::nullValue:
+        WriteNull();
+        break;
+
+      case Json::intValue:
+        WriteInteger(value.asLargestInt());
+        break;
+
+      case Json::uintValue:
+        WriteUnsignedInteger(value.asLargestUInt());
+        break;
+
+      case Json::realValue:
+        WriteDouble(value.asDouble());
+        break;
+
+      case Json::stringValue:
+        WriteString(value.asString());
+        break;
+
+      case Json::booleanValue:
+        WriteBool(value.asBool());
+        break;
+
+      case Json::arrayValue:
+        StartArray();
+        for (Json::Value::ArrayIndex i = 0; i < value.size(); i++)
+        {
+          WriteValue(value[i]);
+        }
+        EndArray();
+        break;
+
+      case Json::objectValue:
+      {
+        StartObject();
+
+        Json::Value::Members members = value.getMemberNames();
+        for (size_t i = 0; i < members.size(); i++)
+        {
+          WriteKey(members[i]);
+          WriteValue(value[members[i]]);
+        }
+
+        EndObject();
+        break;
+      }
+
+      default:
+        throw OrthancException(ErrorCode_InternalError);
+    }
+  }
+
+
+  void JsonStreamWriter::Close()
+  {
+    if (closed_ ||
+        !hasRoot_ ||
+        !levels_.empty())
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (pretty_)
+    {
+      buffer_.push_back('\n');
+    }
+
+    if (!buffer_.empty())
+    {
+      output_.Write(buffer_);
+      buffer_.clear();
+    }
+
+    output_.Close();
+    closed_ = true;
+  }
+}
@@ -0,0 +1,147 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include <json/value.h>
+
+namespace Orthanc
+{
+  /**
+   * Incremental JSON serializer. The document is written as a
+   * sequence of calls (arrays, objects, keys and values), and the
+   * serialized text is given by chunks to an output stream as soon as
+   * enough bytes are available, so that the whole document never has
+   * to be stored in memory. The output is compact, except if pretty
+   * printing is requested (3-space indentation, as by
+   * "Json::StyledWriter").
+   **/
+  class JsonStreamWriter : public boost::noncopyable
+  {
+  public:
+    class IOutputStream
+    {
+    public:
+      virtual ~IOutputStream()
+      {
+      }
+
+      virtual void Write(const std::string& chunk) = 0;
+
+      virtual void Close() = 0;
+    };
+
+  private:
+    struct Level
+    {
+      bool    isArray_;
+      size_t  count_;
+    };
+
+    IOutputStream&      output_;
+    bool                pretty_;
+    size_t              chunkSize_;
+    std::string         buffer_;
+    std::vector<Level>  levels_;
+    bool                hasRoot_;
+    bool                afterKey_;
+    bool                closed_;
+
+    void Append(const std::string& s);
+
+    void NewLine(size_t depth);
+
+    void BeforeValue();
+
+    void Start(bool isArray);
+
+    void End(bool isArray);
+
+  public:
+    JsonStreamWriter(IOutputStream& output,
+                     bool pretty);
+
+    // Size of the chunks that are given to the output stream
+    void SetChunkSize(size_t size);
+
+    size_t GetChunkSize() const
+    {
+      return chunkSize_;
+    }
+
+    void StartArray()
+    {
+      Start(true);
+    }
+
+    void EndArray()
+    {
+      End(true);
+    }
+
+    void StartObject()
+    {
+      Start(false);
+    }
+
+    void EndObject()
+    {
+      End(false);
+    }
+
+    void WriteKey(const std::string& key);
+
+    void WriteString(const std::string& value);
+
+    void WriteInteger(int64_t value);
+
+    void WriteUnsignedInteger(uint64_t value);
+
+    void WriteDouble(double value);
+
+    void WriteBool(bool value);
+
+    void WriteNull();
+
+    // Writes a whole JSON subtree
+    void WriteValue(const Json::Value& value);
+
+    // Sends the pending bytes, then closes the output stream. The
+    // document must be complete.
+    void Close();
+  };
+}
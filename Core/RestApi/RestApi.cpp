@@ -33,6 +33,8 @@
 #include "../PrecompiledHeaders.h"
 #include "RestApi.h"
 
+#include "../HttpServer/HttpUploadedFile.h"
+
 #include <stdlib.h>   // To define "_exit()" under Windows
 #include <glog/logging.h>
 
@@ -52,6 +54,7 @@ namespace Orthanc
       const HttpHandler::Arguments& headers_;
       const HttpHandler::Arguments& getArguments_;
       const std::string& postData_;
+      const HttpUploadedFile* postFile_;
 
     public:
       HttpHandlerVisitor(RestApi& api,
@@ -59,13 +62,15 @@ namespace Orthanc
                          HttpMethod method,
                          const HttpHandler::Arguments& headers,
                          const HttpHandler::Arguments& getArguments,
-                         const std::string& postData) :
+                         const std::string& postData,
+                         const HttpUploadedFile* postFile) :
         api_(api),
         output_(output),
         method_(method),
         headers_(headers),
         getArguments_(getArguments),
-        postData_(postData)
+        postData_(postData),
+        postFile_(postFile)
       {
       }
 
@@ -87,7 +92,7 @@ namespace Orthanc
 
             case HttpMethod_Post:
             {
-              RestApiPostCall call(output_, api_, headers_, components, trailing, uri, postData_);
+              RestApiPostCall call(output_, api_, headers_, components, trailing, uri, postData_, postFile_);
               resource.Handle(call);
               return true;
             }
@@ -101,8 +106,21 @@ namespace Orthanc
 
             case HttpMethod_Put:
             {
-              RestApiPutCall call(output_, api_, headers_, components, trailing, uri, postData_);
-              resource.Handle(call);
+              if (postFile_ != NULL)
+              {
+                // Only the POST handlers can process a streamed body
+                std::string putData;
+                postFile_->Read(putData);
+
+                RestApiPutCall call(output_, api_, headers_, components, trailing, uri, putData);
+                resource.Handle(call);
+              }
+              else
+              {
+                RestApiPutCall call(output_, api_, headers_, components, trailing, uri, postData_);
+                resource.Handle(call);
+              }
+
               return true;
             }
 
@@ -162,9 +180,42 @@ namespace Orthanc
                        const Arguments& headers,
                        const Arguments& getArguments,
                        const std::string& postData)
+  {
+    return HandleInternal(output, method, uri, headers, getArguments, postData, NULL);
+  }
+
+
+  bool RestApi::HandleUploadedFile(HttpOutput& output,
+                                   HttpMethod method,
+                                   const UriComponents& uri,
+                                   const Arguments& headers,
+                                   const Arguments& getArguments,
+                                   const HttpUploadedFile& body)
+  {
+    // The body is given to the POST handlers as a file, that is only
+    // read into memory if they call "GetPostBody()"
+    std::string empty;
+    return HandleInternal(output, method, uri, headers, getArguments, empty, &body);
+  }
+
+
+  bool RestApi::HandleInternal(HttpOutput& output,
+                               HttpMethod method,
+                               const UriComponents& uri,
+                               const Arguments& headers,
+                               const Arguments& getArguments,
+                               const std::string& postData,
+                               const HttpUploadedFile* postFile)
   {
     RestApiOutput wrappedOutput(output);
 
+    // The JSON answers are compact, except if the "pretty" GET
+    // argument is present
+    if (getArguments.find("pretty") != getArguments.end())
+    {
+      wrappedOutput.SetPrettyJson(true);
+    }
+
 #if ORTHANC_PUGIXML_ENABLED == 1
     // Look if the user wishes XML answers instead of JSON
     // http://www.w3.org/Protocols/HTTP/HTRQ_Headers.html#z3
@@ -188,7 +239,7 @@ namespace Orthanc
     }
 #endif
 
-    HttpHandlerVisitor visitor(*this, wrappedOutput, method, headers, getArguments, postData);
+    HttpHandlerVisitor visitor(*this, wrappedOutput, method, headers, getArguments, postData, postFile);
 
     if (root_.LookupResource(uri, visitor))
     {
@@ -43,6 +43,14 @@ namespace Orthanc
   private:
     RestApiHierarchy root_;
 
+    bool HandleInternal(HttpOutput& output,
+                        HttpMethod method,
+                        const UriComponents& uri,
+                        const Arguments& headers,
+                        const Arguments& getArguments,
+                        const std::string& postData,
+                        const HttpUploadedFile* postFile);
+
   public:
     static void AutoListChildren(RestApiGetCall& call);
 
@@ -53,6 +61,13 @@ namespace Orthanc
                         const Arguments& getArguments,
                         const std::string& postData);
 
+    virtual bool HandleUploadedFile(HttpOutput& output,
+                                    HttpMethod method,
+                                    const UriComponents& uri,
+                                    const Arguments& headers,
+                                    const Arguments& getArguments,
+                                    const HttpUploadedFile& body);
+
     void Register(const std::string& path,
                   RestApiGetCall::Handler handler);
 
@@ -37,12 +37,118 @@
 #include <glog/logging.h>
 
 #include "../OrthancException.h"
+#include "../Toolbox.h"
+
+#include <json/reader.h>
 
 namespace Orthanc
 {
+  namespace
+  {
+    /**
+     * Sends a JSON document to the HTTP connection. The last chunk is
+     * retained until the next one is available: A document that fits
+     * in one chunk is sent with a "Content-Length", the others with
+     * the chunked transfer encoding. As HTTP/1.0 clients do not
+     * support this encoding, their answers are entirely buffered and
+     * sent with a "Content-Length", which keeps their connection
+     * reusable.
+     **/
+    class HttpJsonStream : public JsonStreamWriter::IOutputStream
+    {
+    private:
+      HttpOutput&  output_;
+      std::string  pending_;
+      bool         isStreaming_;
+
+    public:
+      HttpJsonStream(HttpOutput& output) :
+        output_(output),
+        isStreaming_(false)
+      {
+      }
+
+      virtual void Write(const std::string& chunk)
+      {
+        if (!output_.IsChunkedAllowed())
+        {
+          pending_.append(chunk);
+          return;
+        }
+
+        if (!pending_.empty())
+        {
+          if (!isStreaming_)
+          {
+            output_.StartStream("application/json");
+            isStreaming_ = true;
+          }
+
+          output_.SendStreamItem(pending_);
+        }
+
+        pending_ = chunk;
+      }
+
+      virtual void Close()
+      {
+        if (isStreaming_)
+        {
+          output_.SendStreamItem(pending_);
+          output_.CloseStream();
+        }
+        else
+        {
+          output_.SetContentType("application/json");
+          output_.SendBody(pending_);
+        }
+      }
+    };
+
+
+#if ORTHANC_PUGIXML_ENABLED == 1
+    // XML answers cannot be streamed: The JSON document is converted
+    // once complete
+    class XmlJsonStream : public JsonStreamWriter::IOutputStream
+    {
+    private:
+      HttpOutput&  output_;
+      std::string  json_;
+
+    public:
+      XmlJsonStream(HttpOutput& output) :
+        output_(output)
+      {
+      }
+
+      virtual void Write(const std::string& chunk)
+      {
+        json_.append(chunk);
+      }
+
+      virtual void Close()
+      {
+        Json::Value value;
+        Json::Reader reader;
+        if (!reader.parse(json_, value))
+        {
+          throw OrthancException(ErrorCode_InternalError);
+        }
+
+        std::string s;
+        Toolbox::JsonToXml(s, value);
+        output_.SetContentType("application/xml");
+        output_.SendBody(s);
+      }
+    };
+#endif
+  }
+
+
   RestApiOutput::RestApiOutput(HttpOutput& output) : 
     output_(output),
-    convertJsonToXml_(false)
+    convertJsonToXml_(false),
+    prettyJson_(false)
   {
     alreadySent_ = false;
   }
@@ -74,6 +180,14 @@ namespace Orthanc
     alreadySent_ = true;
   }
 
+  void RestApiOutput::AnswerFile(HttpFileSender& sender,
+                                 const std::string& range)
+  {
+    CheckStatus();
+    sender.Send(output_, range);
+    alreadySent_ = true;
+  }
+
   void RestApiOutput::AnswerJson(const Json::Value& value)
   {
     CheckStatus();
@@ -92,11 +206,55 @@ namespace Orthanc
     }
     else
     {
-      Json::StyledWriter writer;
-      output_.SetContentType("application/json");
-      output_.SendBody(writer.write(value));
+      HttpJsonStream stream(output_);
+      JsonStreamWriter writer(stream, prettyJson_);
+      writer.WriteValue(value);
+      writer.Close();
+    }
+
+    alreadySent_ = true;
+  }
+
+
+  JsonStreamWriter& RestApiOutput::StartJsonStream()
+  {
+    CheckStatus();
+
+    if (jsonWriter_.get() != NULL)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (convertJsonToXml_)
+    {
+#if ORTHANC_PUGIXML_ENABLED == 1
+      jsonStream_.reset(new XmlJsonStream(output_));
+#else
+      LOG(ERROR) << "Orthanc was compiled without XML support";
+      throw OrthancException(ErrorCode_InternalError);
+#endif
+    }
+    else
+    {
+      jsonStream_.reset(new HttpJsonStream(output_));
+    }
+
+    jsonWriter_.reset(new JsonStreamWriter(*jsonStream_, prettyJson_));
+
+    return *jsonWriter_;
+  }
+
+
+  void RestApiOutput::CloseJsonStream()
+  {
+    if (jsonWriter_.get() == NULL)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
     }
 
+    jsonWriter_->Close();
+    jsonWriter_.reset(NULL);
+    jsonStream_.reset(NULL);
     alreadySent_ = true;
   }
 
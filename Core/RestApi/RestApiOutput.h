@@ -34,7 +34,9 @@
 
 #include "../HttpServer/HttpOutput.h"
 #include "../HttpServer/HttpFileSender.h"
+#include "JsonStreamWriter.h"
 
+#include <memory>
 #include <json/json.h>
 
 namespace Orthanc
@@ -45,6 +47,10 @@ namespace Orthanc
     HttpOutput& output_;
     bool alreadySent_;
     bool convertJsonToXml_;
+    bool prettyJson_;
+
+    std::auto_ptr<JsonStreamWriter::IOutputStream>  jsonStream_;
+    std::auto_ptr<JsonStreamWriter>  jsonWriter_;
 
     void CheckStatus();
 
@@ -73,10 +79,36 @@ namespace Orthanc
       return convertJsonToXml_;
     }
 
+    // The JSON answers are compact, except if pretty printing is
+    // requested (e.g. by the "pretty" GET argument)
+    void SetPrettyJson(bool pretty)
+    {
+      prettyJson_ = pretty;
+    }
+
+    bool IsPrettyJson() const
+    {
+      return prettyJson_;
+    }
+
     void AnswerFile(HttpFileSender& sender);
 
+    void AnswerFile(HttpFileSender& sender,
+                    const std::string& range);
+
     void AnswerJson(const Json::Value& value);
 
+    /**
+     * Starts a JSON answer that is written incrementally, which avoids
+     * building a large Json::Value tree in memory. The answer is sent
+     * by chunks, using the chunked transfer encoding if it does not
+     * fit in one chunk. "CloseJsonStream()" must be called once the
+     * document is complete.
+     **/
+    JsonStreamWriter& StartJsonStream();
+
+    void CloseJsonStream();
+
     void AnswerBuffer(const std::string& buffer,
                       const std::string& contentType);
 
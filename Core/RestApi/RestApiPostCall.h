@@ -33,6 +33,8 @@
 #pragma once
 
 #include "RestApiCall.h"
+#include "../HttpServer/HttpUploadedFile.h"
+#include "../OrthancException.h"
 
 namespace Orthanc
 {
@@ -40,6 +42,9 @@ namespace Orthanc
   {
   private:
     const std::string& data_;
+    const HttpUploadedFile* file_;
+    mutable std::string fileContent_;
+    mutable bool isFileRead_;
 
   public:
     typedef void (*Handler) (RestApiPostCall& call);
@@ -50,15 +55,51 @@ namespace Orthanc
                     const HttpHandler::Arguments& uriComponents,
                     const UriComponents& trailing,
                     const UriComponents& fullUri,
-                    const std::string& data) :
+                    const std::string& data,
+                    const HttpUploadedFile* file = NULL) :
       RestApiCall(output, context, httpHeaders, uriComponents, trailing, fullUri),
-      data_(data)
+      data_(data),
+      file_(file),
+      isFileRead_(false)
     {
     }
 
     const std::string& GetPostBody() const
     {
-      return data_;
+      if (file_ == NULL)
+      {
+        return data_;
+      }
+
+      // The body was streamed to a file: Read it on the first access
+      if (!isFileRead_)
+      {
+        file_->Read(fileContent_);
+        isFileRead_ = true;
+      }
+
+      return fileContent_;
+    }
+
+    /**
+     * Returns "true" iff the body has been streamed to a temporary
+     * file by the HTTP server, because it is large. The handlers that
+     * expect large bodies should process this file, rather than
+     * calling "GetPostBody()" that reads it into memory.
+     **/
+    bool HasPostBodyFile() const
+    {
+      return file_ != NULL;
+    }
+
+    const HttpUploadedFile& GetPostBodyFile() const
+    {
+      if (file_ == NULL)
+      {
+        throw OrthancException(ErrorCode_BadSequenceOfCalls);
+      }
+
+      return *file_;
     }
 
     virtual bool ParseJsonRequest(Json::Value& result) const
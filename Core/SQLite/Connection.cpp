@@ -389,5 +389,16 @@ namespace Orthanc
         throw OrthancSQLiteException("SQLite: Unable to flush the database");
       }
     }
+
+
+    void Connection::SetBusyTimeout(int milliseconds)
+    {
+      CheckIsOpen();
+
+      if (sqlite3_busy_timeout(db_, milliseconds) != SQLITE_OK)
+      {
+        throw OrthancSQLiteException("SQLite: Unable to set the busy timeout");
+      }
+    }
   }
 }
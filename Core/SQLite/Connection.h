@@ -113,6 +113,10 @@ namespace Orthanc
 
       void FlushToDisk();
 
+      // Time during which a statement waits for a lock held by
+      // another connection to the same file, before failing
+      void SetBusyTimeout(int milliseconds);
+
       IScalarFunction* Register(IScalarFunction* func);  // Takes the ownership of the function
 
       // Info querying -------------------------------------------------------------
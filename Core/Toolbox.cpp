@@ -454,6 +454,21 @@ namespace Orthanc
   }
 
 
+  static void FormatMD5(std::string& result,
+                        md5_state_s& state)
+  {
+    md5_byte_t actualHash[16];
+    md5_finish(&state, actualHash);
+
+    result.resize(32);
+    for (unsigned int i = 0; i < 16; i++)
+    {
+      result[2 * i] = GetHexadecimalCharacter(actualHash[i] / 16);
+      result[2 * i + 1] = GetHexadecimalCharacter(actualHash[i] % 16);
+    }
+  }
+
+
   void Toolbox::ComputeMD5(std::string& result,
                            const void* data,
                            size_t length)
@@ -468,15 +483,60 @@ namespace Orthanc
                  static_cast<int>(length));
     }
 
-    md5_byte_t actualHash[16];
-    md5_finish(&state, actualHash);
+    FormatMD5(result, state);
+  }
 
-    result.resize(32);
-    for (unsigned int i = 0; i < 16; i++)
+
+  struct Toolbox::MD5Context::PImpl
+  {
+    md5_state_s  state_;
+    bool         done_;
+  };
+
+
+  Toolbox::MD5Context::MD5Context() : pimpl_(new PImpl)
+  {
+    md5_init(&pimpl_->state_);
+    pimpl_->done_ = false;
+  }
+
+
+  Toolbox::MD5Context::~MD5Context()
+  {
+    delete pimpl_;
+  }
+
+
+  void Toolbox::MD5Context::Append(const void* data,
+                                   size_t length)
+  {
+    if (pimpl_->done_)
     {
-      result[2 * i] = GetHexadecimalCharacter(actualHash[i] / 16);
-      result[2 * i + 1] = GetHexadecimalCharacter(actualHash[i] % 16);
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
     }
+
+    const md5_byte_t* p = reinterpret_cast<const md5_byte_t*>(data);
+
+    // "md5_append()" takes a signed length: Split the huge chunks
+    while (length > 0)
+    {
+      size_t chunk = std::min(length, static_cast<size_t>(1024 * 1024 * 1024));
+      md5_append(&pimpl_->state_, p, static_cast<int>(chunk));
+      p += chunk;
+      length -= chunk;
+    }
+  }
+
+
+  void Toolbox::MD5Context::Finish(std::string& result)
+  {
+    if (pimpl_->done_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    pimpl_->done_ = true;
+    FormatMD5(result, pimpl_->state_);
   }
 
 
@@ -38,6 +38,7 @@
 #include <vector>
 #include <string>
 #include <json/json.h>
+#include <boost/noncopyable.hpp>
 
 namespace Orthanc
 {
@@ -97,6 +98,28 @@ namespace Orthanc
                     const void* data,
                     size_t length);
 
+    /**
+     * Computes the MD5 hash of some data that is received chunk by
+     * chunk, without keeping the data in memory. The result is
+     * formatted as by "ComputeMD5()".
+     **/
+    class MD5Context : public boost::noncopyable
+    {
+    private:
+      struct PImpl;
+      PImpl* pimpl_;
+
+    public:
+      MD5Context();
+
+      ~MD5Context();
+
+      void Append(const void* data,
+                  size_t length);
+
+      void Finish(std::string& result);
+    };
+
     void ComputeSHA1(std::string& result,
                      const std::string& data);
 
@@ -119,16 +119,9 @@ namespace Orthanc
     }
 
 
-    static std::string CreateTemporaryPath(const char* extension)
+    static std::string CreateTemporaryPath(boost::filesystem::path tmpDir,
+                                           const char* extension)
     {
-#if BOOST_HAS_FILESYSTEM_V3 == 1
-      boost::filesystem::path tmpDir = boost::filesystem::temp_directory_path();
-#elif defined(__linux__)
-      boost::filesystem::path tmpDir("/tmp");
-#else
-#error Support your platform here
-#endif
-
       // We use UUID to create unique path to temporary files
       std::string filename = "Orthanc-" + Orthanc::Toolbox::GenerateUuid();
 
@@ -142,14 +135,33 @@ namespace Orthanc
     }
 
 
+    static boost::filesystem::path GetSystemTemporaryDirectory()
+    {
+#if BOOST_HAS_FILESYSTEM_V3 == 1
+      return boost::filesystem::temp_directory_path();
+#elif defined(__linux__)
+      return boost::filesystem::path("/tmp");
+#else
+#error Support your platform here
+#endif
+    }
+
+
     TemporaryFile::TemporaryFile() : 
-      path_(CreateTemporaryPath(NULL))
+      path_(CreateTemporaryPath(GetSystemTemporaryDirectory(), NULL))
     {
     }
 
 
     TemporaryFile::TemporaryFile(const char* extension) :
-      path_(CreateTemporaryPath(extension))
+      path_(CreateTemporaryPath(GetSystemTemporaryDirectory(), extension))
+    {
+    }
+
+
+    TemporaryFile::TemporaryFile(const std::string& directory,
+                                 const char* extension) :
+      path_(CreateTemporaryPath(directory, extension))
     {
     }
 
@@ -65,6 +65,11 @@ namespace Orthanc
 
       TemporaryFile(const char* extension);
 
+      // Creates the temporary file in the given directory, instead of
+      // the temporary directory of the system
+      TemporaryFile(const std::string& directory,
+                    const char* extension);
+
       ~TemporaryFile();
 
       const std::string& GetPath() const
@@ -33,8 +33,11 @@
 #include "../Core/PrecompiledHeaders.h"
 #include "OrthancConnection.h"
 
+#include "../Core/MultipartRelatedWriter.h"
 #include "../Core/Toolbox.h"
 
+#include <iostream>
+
 namespace OrthancClient
 {
   void OrthancConnection::ReadPatients()
@@ -61,8 +64,12 @@ namespace OrthancClient
     return dynamic_cast<Patient&>(patients_.GetItem(index));
   }
 
+  // Batches of DICOM files are also flushed once they reach this size
+  static const uint64_t MAX_STORE_BATCH_SIZE = 64 * 1024 * 1024;
+
+
   OrthancConnection::OrthancConnection(const char* orthancUrl) : 
-    orthancUrl_(orthancUrl), patients_(*this)
+    orthancUrl_(orthancUrl), patients_(*this), storeBatchSize_(1), pendingStoresSize_(0)
   {
     ReadPatients();
   }
@@ -70,22 +77,53 @@ namespace OrthancClient
   OrthancConnection::OrthancConnection(const char* orthancUrl,
                                        const char* username, 
                                        const char* password) : 
-    orthancUrl_(orthancUrl), patients_(*this)
+    orthancUrl_(orthancUrl), patients_(*this), storeBatchSize_(1), pendingStoresSize_(0)
   {
     client_.SetCredentials(username, password);
     ReadPatients();
   }
 
 
-  void OrthancConnection::Store(const void* dicom, uint64_t size)
+  OrthancConnection::~OrthancConnection()
   {
-    if (size == 0)
+    if (pendingStores_.empty())
     {
       return;
     }
 
+    // The exceptions cannot be propagated from a destructor: The
+    // errors are written to the standard error, as there is no
+    // logging in this library. Call FlushStore() to catch them.
+    const size_t count = pendingStores_.size();
+
+    try
+    {
+      FlushStore();
+    }
+    catch (Laaw::LaawException& e)
+    {
+      std::cerr << "Unable to send " << count << " pending DICOM file(s) to " 
+                << orthancUrl_ << ": " << e.What() << std::endl;
+    }
+    catch (Orthanc::OrthancException& e)
+    {
+      std::cerr << "Unable to send " << count << " pending DICOM file(s) to " 
+                << orthancUrl_ << ": " << e.What() << std::endl;
+    }
+    catch (...)
+    {
+      std::cerr << "Unable to send " << count << " pending DICOM file(s) to " 
+                << orthancUrl_ << std::endl;
+    }
+  }
+
+
+  void OrthancConnection::StoreInternal(const void* dicom, uint64_t size)
+  {
     client_.SetMethod(Orthanc::HttpMethod_Post);
     client_.SetUrl(orthancUrl_ + "/instances");
+    client_.SetContentType("application/dicom");
+    client_.SetTimeout(0);
 
     // Copy the DICOM file in the POST body. TODO - Avoid memory copy
     client_.AccessPostData().resize(static_cast<size_t>(size));
@@ -96,7 +134,114 @@ namespace OrthancClient
     {
       throw OrthancClientException(Orthanc::ErrorCode_NetworkProtocol);
     }
-    
+  }
+
+
+  void OrthancConnection::Store(const void* dicom, uint64_t size)
+  {
+    if (size == 0)
+    {
+      return;
+    }
+
+    if (storeBatchSize_ <= 1)
+    {
+      StoreInternal(dicom, size);
+      Reload();
+      return;
+    }
+
+    pendingStores_.push_back(std::string(static_cast<const char*>(dicom), static_cast<size_t>(size)));
+    pendingStoresSize_ += size;
+
+    if (pendingStores_.size() >= storeBatchSize_ ||
+        pendingStoresSize_ >= MAX_STORE_BATCH_SIZE)
+    {
+      FlushStore();
+    }
+  }
+
+
+  void OrthancConnection::SetStoreBatchSize(uint32_t batchSize)
+  {
+    FlushStore();
+    storeBatchSize_ = batchSize;
+  }
+
+
+  void OrthancConnection::FlushStore()
+  {
+    if (pendingStores_.empty())
+    {
+      return;
+    }
+
+    std::vector<std::string> pending;
+    pending.swap(pendingStores_);
+    pendingStoresSize_ = 0;
+
+    // Pack the pending DICOM files into a single "multipart/related"
+    // request, that Orthanc answers with the status of each file
+    Orthanc::MultipartRelatedWriter batch("application/dicom");
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+      batch.AddPart(pending[i]);
+    }
+
+    client_.SetMethod(Orthanc::HttpMethod_Post);
+    client_.SetUrl(orthancUrl_ + "/instances");
+    client_.SetContentType(batch.GetContentType());
+    client_.SetTimeout(0);
+    batch.Finish(client_.AccessPostData());
+
+    std::string answer;
+    bool success;
+
+    try
+    {
+      success = client_.Apply(answer);
+    }
+    catch (...)
+    {
+      // Network error or timeout
+      client_.AccessPostData().clear();
+      throw OrthancClientException(Orthanc::ErrorCode_NetworkProtocol);
+    }
+
+    client_.AccessPostData().clear();
+
+    Json::Value v;
+    Json::Reader reader;
+    if (!reader.parse(answer, v) ||
+        v.type() != Json::arrayValue)
+    {
+      // This version of Orthanc does not accept batches: Send the
+      // DICOM files one by one
+      for (size_t i = 0; i < pending.size(); i++)
+      {
+        StoreInternal(pending[i].c_str(), pending[i].size());
+      }
+    }
+    else if (!success ||
+             v.size() != pending.size())
+    {
+      Reload();
+      throw OrthancClientException(Orthanc::ErrorCode_NetworkProtocol);
+    }
+    else
+    {
+      for (Json::Value::ArrayIndex i = 0; i < v.size(); i++)
+      {
+        if (v[i].type() != Json::objectValue ||
+            !v[i].isMember("Status") ||
+            v[i]["Status"].asString() == "Failure")
+        {
+          Reload();
+          throw OrthancClientException(Orthanc::ErrorCode_NetworkProtocol);
+        }
+      }
+    }
+
     Reload();
   }
 
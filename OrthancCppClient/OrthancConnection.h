@@ -52,9 +52,14 @@ namespace OrthancClient
     std::string orthancUrl_;
     Orthanc::ArrayFilledByThreads  patients_;
     Json::Value content_;
+    uint32_t storeBatchSize_;
+    std::vector<std::string> pendingStores_;
+    uint64_t pendingStoresSize_;
 
     void ReadPatients();
 
+    void StoreInternal(const void* dicom, uint64_t size);
+
     virtual size_t GetFillerSize()
     {
       return content_.size();
@@ -79,9 +84,7 @@ namespace OrthancClient
                       const char* username, 
                       const char* password);
 
-    virtual ~OrthancConnection()
-    {
-    }
+    virtual ~OrthancConnection();
 
     /**
      * {summary}{Returns the number of threads for this connection.}
@@ -176,5 +179,28 @@ namespace OrthancClient
      * {param}{size The size of the DICOM file.}
      **/    
     void Store(const void* dicom, uint64_t size);
+
+    /**
+     * {summary}{Returns the number of DICOM files per batch.}
+     * {description}{Returns the maximum number of DICOM files that are sent together to the remote instance of %Orthanc, in a single HTTP request.}
+     * {returns}{The number of DICOM files per batch.}
+     **/
+    uint32_t GetStoreBatchSize() const
+    {
+      return storeBatchSize_;
+    }
+
+    /**
+     * {summary}{Sets the number of DICOM files per batch.}
+     * {description}{If this number is greater than 1, the DICOM files that are sent by Store() and StoreFile() are accumulated, then sent together to the remote instance of %Orthanc in a single HTTP request, which is much faster for small files. The pending files are sent once the batch is full, or by FlushStore(). By default, the DICOM files are sent one by one.}
+     * {param}{batchSize The number of DICOM files per batch.}
+     **/
+    void SetStoreBatchSize(uint32_t batchSize);
+
+    /**
+     * {summary}{Send the pending DICOM files.}
+     * {description}{This method will send the DICOM files that have been accumulated by Store() and StoreFile() since the last batch was sent. It must be called once all the DICOM files have been stored, in order to detect the errors. The destructor of this object also sends the pending DICOM files, but it can only write its errors to the standard error.}
+     **/
+    void FlushStore();
   };
 }
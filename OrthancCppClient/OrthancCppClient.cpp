@@ -41,7 +41,9 @@
 #include "../Core/ImageFormats/ImageAccessor.cpp"
 #include "../Core/ImageFormats/ImageBuffer.cpp"
 #include "../Core/ImageFormats/PngReader.cpp"
+#include "../Core/ImageFormats/RawFramesHeader.cpp"
 #include "../Core/MultiThreading/ArrayFilledByThreads.cpp"
+#include "../Core/MultipartRelatedWriter.cpp"
 #include "../Core/MultiThreading/SharedMessageQueue.cpp"
 #include "../Core/MultiThreading/ThreadedCommandProcessor.cpp"
 #include "../Core/OrthancException.cpp"
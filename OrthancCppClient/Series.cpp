@@ -34,6 +34,8 @@
 #include "Series.h"
 
 #include "OrthancConnection.h"
+#include "../Core/ImageFormats/RawFramesHeader.h"
+#include "../Core/Toolbox.h"
 
 #include <set>
 #include <boost/lexical_cast.hpp>
@@ -384,6 +386,112 @@ namespace OrthancClient
 
 
   
+  bool Series::Load3DImageBulk(void* target,
+                               Orthanc::PixelFormat format,
+                               Orthanc::ImageExtractionMode mode,
+                               size_t lineStride,
+                               size_t stackStride)
+  {
+    using namespace Orthanc;
+
+    std::string uri;
+    switch (mode)
+    {
+      case ImageExtractionMode_Preview:
+        uri = "/raw-frames?mode=preview";
+        break;
+
+      case ImageExtractionMode_UInt8:
+        uri = "/raw-frames?mode=uint8";
+        break;
+
+      case ImageExtractionMode_UInt16:
+        uri = "/raw-frames?mode=uint16";
+        break;
+
+      default:
+        return false;
+    }
+
+    HttpClient client(connection_.GetHttpClient());
+    client.SetUrl(url_ + uri);
+
+    std::string volume;
+    RawFramesHeader header;
+
+    try
+    {
+      if (!client.Apply(volume))
+      {
+        // This version of Orthanc does not support bulk downloads,
+        // or the slices cannot be stacked by the server
+        return false;
+      }
+
+      header.Read(volume.c_str(), volume.size());
+    }
+    catch (OrthancException&)
+    {
+      // Truncated or invalid answer
+      return false;
+    }
+
+    if (header.GetWidth() != GetWidth() ||
+        header.GetHeight() != GetHeight() ||
+        header.GetDepth() != GetInstanceCount() ||
+        header.GetTotalSize() != volume.size())
+    {
+      return false;
+    }
+
+    const bool expand = (header.GetFormat() == PixelFormat_Grayscale8 &&
+                         format == PixelFormat_RGB24);
+
+    if (header.GetFormat() != format && !expand)
+    {
+      return false;
+    }
+
+    const bool swap = (GetBytesPerPixel(format) == 2 &&
+                       Toolbox::DetectEndianness() == Endianness_Big);
+
+    const size_t sourceLineSize = GetBytesPerPixel(header.GetFormat()) * header.GetWidth();
+    const uint8_t* source = reinterpret_cast<const uint8_t*>(volume.c_str()) + RawFramesHeader::HEADER_SIZE;
+
+    for (unsigned int z = 0; z < header.GetDepth(); z++)
+    {
+      for (unsigned int y = 0; y < header.GetHeight(); y++, source += sourceLineSize)
+      {
+        uint8_t* p = reinterpret_cast<uint8_t*>(target) + z * stackStride + y * lineStride;
+
+        if (expand)
+        {
+          for (unsigned int x = 0; x < header.GetWidth(); x++, p += 3)
+          {
+            p[0] = source[x];
+            p[1] = source[x];
+            p[2] = source[x];
+          }
+        }
+        else if (swap)
+        {
+          for (size_t x = 0; x < sourceLineSize; x += 2)
+          {
+            p[x] = source[x + 1];
+            p[x + 1] = source[x];
+          }
+        }
+        else
+        {
+          memcpy(p, source, sourceLineSize);
+        }
+      }
+    }
+
+    return true;
+  }
+
+
   void Series::Load3DImageInternal(void* target,
                                    Orthanc::PixelFormat format,
                                    size_t lineStride,
@@ -467,6 +575,17 @@ namespace OrthancClient
     }
 
 
+    // Download the whole volume at once if the remote Orthanc
+    // supports it, which avoids one HTTP request and one PNG image
+    // per slice. The server orders the slices the same way.
+    if (Load3DImageBulk(target, format, mode, lineStride, stackStride))
+    {
+      if (listener)
+        listener->SignalSuccess(GetInstanceCount());
+      return;
+    }
+
+
     // Submit the download of each stack as a set of commands
     ThreadedCommandProcessor processor(connection_.GetThreadCount());
 
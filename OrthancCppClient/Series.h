@@ -80,6 +80,12 @@ namespace OrthancClient
 
     virtual Orthanc::IDynamicObject* GetFillerItem(size_t index);
 
+    bool Load3DImageBulk(void* target,
+                         Orthanc::PixelFormat format,
+                         Orthanc::ImageExtractionMode mode,
+                         size_t lineStride,
+                         size_t stackStride);
+
     void Load3DImageInternal(void* target,
                              Orthanc::PixelFormat format,
                              size_t lineStride,
@@ -43,6 +43,9 @@
 
 namespace Orthanc
 {
+  // In milliseconds: Time during which the connections wait for the
+  // locks that are held by the other connections to the index
+  static const int BUSY_TIMEOUT = 5000;
 
   namespace Internals
   {
@@ -223,6 +226,14 @@ namespace Orthanc
     s.Run();
     int64_t id = db_.GetLastInsertRowId();
 
+    // A new resource only counts itself
+    SQLite::Statement t(db_, SQLITE_FROM_HERE, "INSERT INTO ResourceStatistics VALUES(?, ?, ?, ?, 0, 0)");
+    t.BindInt64(0, id);
+    t.BindInt(1, type == ResourceType_Study ? 1 : 0);
+    t.BindInt(2, type == ResourceType_Series ? 1 : 0);
+    t.BindInt(3, type == ResourceType_Instance ? 1 : 0);
+    t.Run();
+
     ChangeType changeType;
     switch (type)
     {
@@ -335,6 +346,16 @@ namespace Orthanc
     s.BindInt64(0, parent);
     s.BindInt64(1, child);
     s.Run();
+
+    // The content of the child is now part of the new parent and of
+    // its ancestors
+    ResourceStatistics statistics;
+    if (!ReadStatistics(statistics, child))
+    {
+      throw OrthancException(ErrorCode_InternalError);
+    }
+
+    UpdateStatistics(parent, statistics, 1);
   }
 
 
@@ -354,6 +375,35 @@ namespace Orthanc
 
   void DatabaseWrapper::DeleteResource(int64_t id)
   {
+    // The "ResourceDeletedParentCleaning" trigger also deletes the
+    // ancestors that are left without any child: Look for the highest
+    // of these ancestors, whose content has to be removed from the
+    // statistics of the remaining ancestors. The statistics of the
+    // deleted resources are removed by the "ON DELETE CASCADE"
+    // constraint.
+    int64_t deleted = id;
+    int64_t parent;
+    while (LookupParent(parent, deleted))
+    {
+      SQLite::Statement c(db_, SQLITE_FROM_HERE, "SELECT COUNT(*) FROM Resources WHERE parentId=?");
+      c.BindInt64(0, parent);
+      c.Step();
+
+      if (c.ColumnInt64(0) > 1)
+      {
+        ResourceStatistics statistics;
+        if (!ReadStatistics(statistics, deleted))
+        {
+          throw OrthancException(ErrorCode_InternalError);
+        }
+
+        UpdateStatistics(parent, statistics, -1);
+        break;
+      }
+
+      deleted = parent;
+    }
+
     signalRemainingAncestor_->Reset();
 
     SQLite::Statement s(db_, SQLITE_FROM_HERE, "DELETE FROM Resources WHERE internalId=?");
@@ -436,16 +486,110 @@ namespace Orthanc
     s.BindString(6, attachment.GetUncompressedMD5());
     s.BindString(7, attachment.GetCompressedMD5());
     s.Run();
+
+    ResourceStatistics statistics;
+    statistics.compressedSize_ = attachment.GetCompressedSize();
+    statistics.uncompressedSize_ = attachment.GetUncompressedSize();
+    UpdateStatistics(id, statistics, 1);
   }
 
 
   void DatabaseWrapper::DeleteAttachment(int64_t id,
                                          FileContentType attachment)
   {
+    FileInfo info;
+    if (!LookupAttachment(info, id, attachment))
+    {
+      return;
+    }
+
     SQLite::Statement s(db_, SQLITE_FROM_HERE, "DELETE FROM AttachedFiles WHERE id=? AND fileType=?");
     s.BindInt64(0, id);
     s.BindInt(1, attachment);
     s.Run();
+
+    ResourceStatistics statistics;
+    statistics.compressedSize_ = info.GetCompressedSize();
+    statistics.uncompressedSize_ = info.GetUncompressedSize();
+    UpdateStatistics(id, statistics, -1);
+  }
+
+
+  bool DatabaseWrapper::ReadStatistics(ResourceStatistics& target,
+                                       int64_t id)
+  {
+    SQLite::Statement s(db_, SQLITE_FROM_HERE, 
+                        "SELECT countStudies, countSeries, countInstances, compressedSize, uncompressedSize "
+                        "FROM ResourceStatistics WHERE id=?");
+    s.BindInt64(0, id);
+
+    if (!s.Step())
+    {
+      return false;
+    }
+    else
+    {
+      target.countStudies_ = static_cast<unsigned int>(s.ColumnInt64(0));
+      target.countSeries_ = static_cast<unsigned int>(s.ColumnInt64(1));
+      target.countInstances_ = static_cast<unsigned int>(s.ColumnInt64(2));
+      target.compressedSize_ = static_cast<uint64_t>(s.ColumnInt64(3));
+      target.uncompressedSize_ = static_cast<uint64_t>(s.ColumnInt64(4));
+      return true;
+    }
+  }
+
+
+  bool DatabaseWrapper::LookupStatistics(/* out */ uint64_t& compressedSize, 
+                                         /* out */ uint64_t& uncompressedSize, 
+                                         /* out */ unsigned int& countStudies, 
+                                         /* out */ unsigned int& countSeries, 
+                                         /* out */ unsigned int& countInstances, 
+                                         /* in  */ int64_t id)
+  {
+    ResourceStatistics statistics;
+    if (ReadStatistics(statistics, id))
+    {
+      compressedSize = statistics.compressedSize_;
+      uncompressedSize = statistics.uncompressedSize_;
+      countStudies = statistics.countStudies_;
+      countSeries = statistics.countSeries_;
+      countInstances = statistics.countInstances_;
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+
+  void DatabaseWrapper::UpdateStatistics(int64_t id,
+                                         const ResourceStatistics& statistics,
+                                         int sign)
+  {
+    assert(sign == 1 || sign == -1);
+
+    // Apply the change to the resource, then to all of its ancestors
+    for (;;)
+    {
+      SQLite::Statement s(db_, SQLITE_FROM_HERE, 
+                          "UPDATE ResourceStatistics SET countStudies = countStudies + ?, "
+                          "countSeries = countSeries + ?, countInstances = countInstances + ?, "
+                          "compressedSize = compressedSize + ?, uncompressedSize = uncompressedSize + ? "
+                          "WHERE id=?");
+      s.BindInt64(0, sign * static_cast<int64_t>(statistics.countStudies_));
+      s.BindInt64(1, sign * static_cast<int64_t>(statistics.countSeries_));
+      s.BindInt64(2, sign * static_cast<int64_t>(statistics.countInstances_));
+      s.BindInt64(3, sign * static_cast<int64_t>(statistics.compressedSize_));
+      s.BindInt64(4, sign * static_cast<int64_t>(statistics.uncompressedSize_));
+      s.BindInt64(5, id);
+      s.Run();
+
+      if (!LookupParent(id, id))
+      {
+        return;
+      }
+    }
   }
 
 
@@ -514,6 +658,11 @@ namespace Orthanc
       SQLite::Statement s(db_, SQLITE_FROM_HERE, "INSERT INTO DicomIdentifiers VALUES(?, ?, ?, ?)");
       SetMainDicomTagsInternal(s, id, tag, value);
     }
+    else if (tag.IsSearchable())
+    {
+      SQLite::Statement s(db_, SQLITE_FROM_HERE, "INSERT INTO SearchableTags VALUES(?, ?, ?, ?)");
+      SetMainDicomTagsInternal(s, id, tag, value);
+    }
     else
     {
       SQLite::Statement s(db_, SQLITE_FROM_HERE, "INSERT INTO MainDicomTags VALUES(?, ?, ?, ?)");
@@ -543,6 +692,15 @@ namespace Orthanc
                    s2.ColumnInt(2),
                    s2.ColumnString(3));
     }
+
+    SQLite::Statement s3(db_, SQLITE_FROM_HERE, "SELECT * FROM SearchableTags WHERE id=?");
+    s3.BindInt64(0, id);
+    while (s3.Step())
+    {
+      map.SetValue(s3.ColumnInt(1),
+                   s3.ColumnInt(2),
+                   s3.ColumnString(3));
+    }
   }
 
 
@@ -775,6 +933,109 @@ namespace Orthanc
     }
   }
 
+
+  void DatabaseWrapper::GetAllPublicIds(std::list<std::string>& target,
+                                        int64_t& last,
+                                        ResourceType resourceType,
+                                        int64_t since,
+                                        unsigned int maxResults)
+  {
+    // The rows are read from "ResourceTypeIndex", whose entries are
+    // sorted by internal identifier for a given resource type
+    SQLite::Statement s(db_, SQLITE_FROM_HERE, 
+                        "SELECT internalId, publicId FROM Resources WHERE resourceType=? "
+                        "AND internalId>? ORDER BY internalId LIMIT ?");
+    s.BindInt(0, resourceType);
+    s.BindInt64(1, since);
+    s.BindInt(2, maxResults);
+
+    target.clear();
+    last = since;
+
+    while (s.Step())
+    {
+      last = s.ColumnInt64(0);
+      target.push_back(s.ColumnString(1));
+    }
+  }
+
+
+  void DatabaseWrapper::GetResourcesSummary(std::list<ResourceSummary>& target,
+                                            int64_t& last,
+                                            ResourceType resourceType,
+                                            int64_t since,
+                                            unsigned int maxResults)
+  {
+    target.clear();
+    last = since;
+
+    // First, read the resources of the batch together with their
+    // parent and their statistics
+    {
+      SQLite::Statement s(db_, SQLITE_FROM_HERE, 
+                          "SELECT r.internalId, r.publicId, p.publicId, "
+                          "st.countStudies, st.countSeries, st.countInstances "
+                          "FROM Resources AS r "
+                          "LEFT JOIN Resources AS p ON p.internalId = r.parentId "
+                          "LEFT JOIN ResourceStatistics AS st ON st.id = r.internalId "
+                          "WHERE r.resourceType=? AND r.internalId>? "
+                          "ORDER BY r.internalId LIMIT ?");
+      s.BindInt(0, resourceType);
+      s.BindInt64(1, since);
+      s.BindInt(2, maxResults);
+
+      while (s.Step())
+      {
+        last = s.ColumnInt64(0);
+        target.push_back(ResourceSummary(last, resourceType, s.ColumnString(1),
+                                         s.ColumnIsNull(2) ? "" : s.ColumnString(2),
+                                         s.ColumnIsNull(3) ? 0 : s.ColumnInt(3),
+                                         s.ColumnIsNull(4) ? 0 : s.ColumnInt(4),
+                                         s.ColumnIsNull(5) ? 0 : s.ColumnInt(5)));
+      }
+    }
+
+    if (target.empty())
+    {
+      return;
+    }
+
+    std::map<int64_t, ResourceSummary*> summaries;
+    for (std::list<ResourceSummary>::iterator 
+           it = target.begin(); it != target.end(); ++it)
+    {
+      summaries[it->GetInternalId()] = &(*it);
+    }
+
+    // Then, read the main DICOM tags of the whole batch at once, from
+    // the 3 tables that store them (cf. "GetMainDicomTags()")
+    SQLite::Statement s(db_, SQLITE_FROM_HERE, 
+                        "SELECT t.id, t.tagGroup, t.tagElement, t.value FROM MainDicomTags AS t "
+                        "INNER JOIN Resources AS r ON r.internalId = t.id "
+                        "WHERE r.resourceType=?1 AND r.internalId>?2 AND r.internalId<=?3 "
+                        "UNION ALL "
+                        "SELECT t.id, t.tagGroup, t.tagElement, t.value FROM DicomIdentifiers AS t "
+                        "INNER JOIN Resources AS r ON r.internalId = t.id "
+                        "WHERE r.resourceType=?1 AND r.internalId>?2 AND r.internalId<=?3 "
+                        "UNION ALL "
+                        "SELECT t.id, t.tagGroup, t.tagElement, t.value FROM SearchableTags AS t "
+                        "INNER JOIN Resources AS r ON r.internalId = t.id "
+                        "WHERE r.resourceType=?1 AND r.internalId>?2 AND r.internalId<=?3");
+    s.BindInt(0, resourceType);
+    s.BindInt64(1, since);
+    s.BindInt64(2, last);
+
+    while (s.Step())
+    {
+      std::map<int64_t, ResourceSummary*>::iterator found = summaries.find(s.ColumnInt64(0));
+      if (found != summaries.end())
+      {
+        found->second->SetMainDicomTag(DicomTag(s.ColumnInt(1), s.ColumnInt(2)),
+                                       s.ColumnString(3));
+      }
+    }
+  }
+
   static void UpgradeDatabase(SQLite::Connection& db,
                               EmbeddedResources::FileResourceId script)
   {
@@ -786,25 +1047,90 @@ namespace Orthanc
   }
 
 
-  DatabaseWrapper::DatabaseWrapper(const std::string& path) : listener_(NULL)
+  DatabaseWrapper::DatabaseWrapper(const std::string& path) : 
+    listener_(NULL),
+    path_(path),
+    allowReadOnlyConnections_(false),
+    version_(0)
+  {
+    db_.Open(path);
+    Open();
+  }
+
+  DatabaseWrapper::DatabaseWrapper(const std::string& path,
+                                   bool allowReadOnlyConnections) : 
+    listener_(NULL),
+    path_(path),
+    allowReadOnlyConnections_(allowReadOnlyConnections),
+    version_(0)
   {
     db_.Open(path);
     Open();
   }
 
-  DatabaseWrapper::DatabaseWrapper() : listener_(NULL)
+  DatabaseWrapper::DatabaseWrapper() : 
+    listener_(NULL),
+    allowReadOnlyConnections_(false),
+    version_(0)
   {
     db_.OpenInMemory();
     Open();
   }
 
+  DatabaseWrapper::DatabaseWrapper(const std::string& path,
+                                   const DatabaseWrapper& parent) : 
+    listener_(NULL),
+    signalRemainingAncestor_(NULL),
+    path_(path),
+    allowReadOnlyConnections_(false),
+    version_(parent.version_)
+  {
+    // The schema of the database has already been created or
+    // upgraded by the parent (read-write) connection. The WAL journal
+    // mode is persistent, so it is inherited from the parent.
+    db_.Open(path);
+    db_.SetBusyTimeout(BUSY_TIMEOUT);
+
+    std::string version;
+    if (!LookupGlobalProperty(version, GlobalProperty_DatabaseSchemaVersion) ||
+        version != boost::lexical_cast<std::string>(version_))
+    {
+      LOG(ERROR) << "The read-only connection does not see the version " << version_ 
+                 << " of the database schema, but: " << version;
+      throw OrthancException(ErrorCode_IncompatibleDatabaseVersion);
+    }
+  }
+
+  IDatabaseWrapper* DatabaseWrapper::OpenReadOnlyConnection()
+  {
+    if (!allowReadOnlyConnections_)
+    {
+      return NULL;
+    }
+    else
+    {
+      return new DatabaseWrapper(path_, *this);
+    }
+  }
+
   void DatabaseWrapper::Open()
   {
     // Performance tuning of SQLite with PRAGMAs
     // http://www.sqlite.org/pragma.html
     db_.Execute("PRAGMA SYNCHRONOUS=NORMAL;");
     db_.Execute("PRAGMA JOURNAL_MODE=WAL;");
-    db_.Execute("PRAGMA LOCKING_MODE=EXCLUSIVE;");
+
+    if (allowReadOnlyConnections_)
+    {
+      db_.SetBusyTimeout(BUSY_TIMEOUT);
+    }
+    else
+    {
+      // The exclusive locking mode prevents other connections from
+      // reading the database, but avoids the use of shared memory
+      db_.Execute("PRAGMA LOCKING_MODE=EXCLUSIVE;");
+    }
+
     db_.Execute("PRAGMA WAL_AUTOCHECKPOINT=1000;");
     //db_.Execute("PRAGMA TEMP_STORE=memory");
 
@@ -835,11 +1161,12 @@ namespace Orthanc
        *  - Version 2: only Orthanc 0.3.1
        *  - Version 3: from Orthanc 0.3.2 to Orthanc 0.7.2 (inclusive)
        *  - Version 4: from Orthanc 0.7.3 to Orthanc 0.8.4 (inclusive)
-       *  - Version 5: from Orthanc 0.8.5 (inclusive)
+       *  - Version 5: only Orthanc 0.8.5
+       *  - Version 6: from Orthanc 0.8.6 (inclusive)
        **/
 
-      // This version of Orthanc is only compatible with versions 3, 4 and 5 of the DB schema
-      ok = (v == 3 || v == 4 || v == 5);
+      // This version of Orthanc is only compatible with versions 3, 4, 5 and 6 of the DB schema
+      ok = (v == 3 || v == 4 || v == 5 || v == 6);
 
       if (v == 3)
       {
@@ -854,6 +1181,15 @@ namespace Orthanc
         UpgradeDatabase(db_, EmbeddedResources::UPGRADE_DATABASE_4_TO_5);
         v = 5;
       }
+
+      if (v == 5)
+      {
+        LOG(WARNING) << "Upgrading database version from 5 to 6";
+        UpgradeDatabase(db_, EmbeddedResources::UPGRADE_DATABASE_5_TO_6);
+        v = 6;
+      }
+
+      version_ = v;
     }
     catch (boost::bad_lexical_cast&)
     {
@@ -1002,6 +1338,112 @@ namespace Orthanc
   }
 
 
+  void  DatabaseWrapper::LookupSearchableTag(std::list<int64_t>& result,
+                                             const DicomTag& tag,
+                                             const std::string& lower,
+                                             const std::string& upper)
+  {
+    if (!tag.IsSearchable())
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    // The "COLLATE NOCASE" clauses are needed for the index
+    // "SearchableTagsIndexValues" to be used
+    std::auto_ptr<SQLite::Statement> s;
+
+    if (lower.size() > 0 && upper.size() > 0)
+    {
+      s.reset(new SQLite::Statement(db_, SQLITE_FROM_HERE, 
+                                    "SELECT id FROM SearchableTags WHERE tagGroup=? AND tagElement=? "
+                                    "AND value >= ? COLLATE NOCASE AND value <= ? COLLATE NOCASE"));
+      s->BindString(2, lower);
+      s->BindString(3, upper);
+    }
+    else if (lower.size() > 0)
+    {
+      s.reset(new SQLite::Statement(db_, SQLITE_FROM_HERE, 
+                                    "SELECT id FROM SearchableTags WHERE tagGroup=? AND tagElement=? "
+                                    "AND value >= ? COLLATE NOCASE"));
+      s->BindString(2, lower);
+    }
+    else if (upper.size() > 0)
+    {
+      s.reset(new SQLite::Statement(db_, SQLITE_FROM_HERE, 
+                                    "SELECT id FROM SearchableTags WHERE tagGroup=? AND tagElement=? "
+                                    "AND value <= ? COLLATE NOCASE"));
+      s->BindString(2, upper);
+    }
+    else
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    s->BindInt(0, tag.GetGroup());
+    s->BindInt(1, tag.GetElement());
+
+    result.clear();
+
+    while (s->Step())
+    {
+      result.push_back(s->ColumnInt64(0));
+    }
+  }
+
+
+  void  DatabaseWrapper::LookupIdentifierRange(std::list<int64_t>& result,
+                                               const DicomTag& tag,
+                                               const std::string& lower,
+                                               const std::string& upper)
+  {
+    if (!tag.IsIdentifier())
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    // The identifiers are case-sensitive: These requests use the
+    // index "DicomIdentifiersIndexTagValues"
+    std::auto_ptr<SQLite::Statement> s;
+
+    if (lower.size() > 0 && upper.size() > 0)
+    {
+      s.reset(new SQLite::Statement(db_, SQLITE_FROM_HERE, 
+                                    "SELECT id FROM DicomIdentifiers WHERE tagGroup=? AND tagElement=? "
+                                    "AND value >= ? AND value <= ?"));
+      s->BindString(2, lower);
+      s->BindString(3, upper);
+    }
+    else if (lower.size() > 0)
+    {
+      s.reset(new SQLite::Statement(db_, SQLITE_FROM_HERE, 
+                                    "SELECT id FROM DicomIdentifiers WHERE tagGroup=? AND tagElement=? "
+                                    "AND value >= ?"));
+      s->BindString(2, lower);
+    }
+    else if (upper.size() > 0)
+    {
+      s.reset(new SQLite::Statement(db_, SQLITE_FROM_HERE, 
+                                    "SELECT id FROM DicomIdentifiers WHERE tagGroup=? AND tagElement=? "
+                                    "AND value <= ?"));
+      s->BindString(2, upper);
+    }
+    else
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    s->BindInt(0, tag.GetGroup());
+    s->BindInt(1, tag.GetElement());
+
+    result.clear();
+
+    while (s->Step())
+    {
+      result.push_back(s->ColumnInt64(0));
+    }
+  }
+
+
   void  DatabaseWrapper::LookupIdentifier(std::list<int64_t>& result,
                                           const std::string& value)
   {
@@ -55,9 +55,44 @@ namespace Orthanc
     IServerIndexListener* listener_;
     SQLite::Connection db_;
     Internals::SignalRemainingAncestor* signalRemainingAncestor_;
+    std::string path_;
+    bool allowReadOnlyConnections_;
+    unsigned int version_;   // Version of the schema, once upgraded
+
+    struct ResourceStatistics
+    {
+      unsigned int countStudies_;
+      unsigned int countSeries_;
+      unsigned int countInstances_;
+      uint64_t compressedSize_;
+      uint64_t uncompressedSize_;
+
+      ResourceStatistics() :
+        countStudies_(0),
+        countSeries_(0),
+        countInstances_(0),
+        compressedSize_(0),
+        uncompressedSize_(0)
+      {
+      }
+    };
 
     void Open();
 
+    bool ReadStatistics(ResourceStatistics& target,
+                        int64_t id);
+
+    // Adds ("sign == 1") or removes ("sign == -1") the given
+    // statistics to the resource and to all of its ancestors
+    void UpdateStatistics(int64_t id,
+                          const ResourceStatistics& statistics,
+                          int sign);
+
+    // Constructor for the read-only connections, that must see the
+    // same version of the schema as their parent
+    DatabaseWrapper(const std::string& path,
+                    const DatabaseWrapper& parent);
+
     void GetChangesInternal(std::list<ServerIndexChange>& target,
                             bool& done,
                             SQLite::Statement& s,
@@ -73,6 +108,14 @@ namespace Orthanc
   public:
     DatabaseWrapper(const std::string& path);
 
+    /**
+     * If "allowReadOnlyConnections" is true, the SQLite file is not
+     * locked in exclusive mode, so that read-only connections can be
+     * created by "OpenReadOnlyConnection()".
+     **/
+    DatabaseWrapper(const std::string& path,
+                    bool allowReadOnlyConnections);
+
     DatabaseWrapper();
 
     virtual void SetListener(IServerIndexListener& listener);
@@ -170,6 +213,18 @@ namespace Orthanc
     virtual void GetAllPublicIds(std::list<std::string>& target,
                                  ResourceType resourceType);
 
+    virtual void GetAllPublicIds(std::list<std::string>& target,
+                                 int64_t& last,
+                                 ResourceType resourceType,
+                                 int64_t since,
+                                 unsigned int maxResults);
+
+    virtual void GetResourcesSummary(std::list<ResourceSummary>& target,
+                                     int64_t& last,
+                                     ResourceType resourceType,
+                                     int64_t since,
+                                     unsigned int maxResults);
+
     virtual bool SelectPatientToRecycle(int64_t& internalId);
 
     virtual bool SelectPatientToRecycle(int64_t& internalId,
@@ -209,9 +264,28 @@ namespace Orthanc
     virtual void LookupIdentifier(std::list<int64_t>& result,
                                   const std::string& value);
 
+    virtual void LookupSearchableTag(std::list<int64_t>& result,
+                                     const DicomTag& tag,
+                                     const std::string& lower,
+                                     const std::string& upper);
+
+    virtual void LookupIdentifierRange(std::list<int64_t>& result,
+                                       const DicomTag& tag,
+                                       const std::string& lower,
+                                       const std::string& upper);
+
     virtual void GetAllMetadata(std::map<MetadataType, std::string>& result,
                                 int64_t id);
 
+    virtual bool LookupStatistics(/* out */ uint64_t& compressedSize, 
+                                  /* out */ uint64_t& uncompressedSize, 
+                                  /* out */ unsigned int& countStudies, 
+                                  /* out */ unsigned int& countSeries, 
+                                  /* out */ unsigned int& countInstances, 
+                                  /* in  */ int64_t id);
+
+    virtual IDatabaseWrapper* OpenReadOnlyConnection();
+
 
 
 
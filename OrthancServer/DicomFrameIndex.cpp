@@ -0,0 +1,943 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "PrecompiledHeadersServer.h"
+#include "DicomFrameIndex.h"
+
+#include "../Core/OrthancException.h"
+#include "../Core/Toolbox.h"
+
+#include <string.h>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <json/reader.h>
+#include <json/writer.h>
+
+namespace Orthanc
+{
+  // http://dicom.nema.org/medical/dicom/current/output/html/part05.html
+
+  static const char* const IMPLICIT_VR_LITTLE_ENDIAN = "1.2.840.10008.1.2";
+  static const char* const EXPLICIT_VR_LITTLE_ENDIAN = "1.2.840.10008.1.2.1";
+  static const char* const DEFLATED_EXPLICIT_VR_LITTLE_ENDIAN = "1.2.840.10008.1.2.1.99";
+  static const char* const EXPLICIT_VR_BIG_ENDIAN = "1.2.840.10008.1.2.2";
+
+  static const uint32_t UNDEFINED_LENGTH = 0xffffffffu;
+
+  // Sequences cannot be nested deeper than this in the scanned files
+  static const unsigned int MAX_DEPTH = 32;
+
+
+  namespace
+  {
+    // Anonymous namespace to avoid clashes between compilation modules
+
+    class LittleEndianReader
+    {
+    private:
+      const uint8_t*  data_;      // NULL if reading from a file
+      std::istream*   file_;
+      uint64_t        filePosition_;
+      std::string     buffer_;    // Last bytes that were read from the file
+      uint64_t        size_;
+      uint64_t        position_;
+
+    public:
+      LittleEndianReader(const void* data,
+                         uint64_t size) :
+        data_(reinterpret_cast<const uint8_t*>(data)),
+        file_(NULL),
+        filePosition_(0),
+        size_(size),
+        position_(0)
+      {
+      }
+
+      LittleEndianReader(std::istream& file,
+                         uint64_t size) :
+        data_(NULL),
+        file_(&file),
+        filePosition_(0),
+        size_(size),
+        position_(0)
+      {
+      }
+
+      uint64_t GetSize() const
+      {
+        return size_;
+      }
+
+      uint64_t GetPosition() const
+      {
+        return position_;
+      }
+
+      void SetPosition(uint64_t position)
+      {
+        if (position > size_)
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+
+        position_ = position;
+      }
+
+      bool IsDone() const
+      {
+        return position_ == size_;
+      }
+
+      void Skip(uint64_t count)
+      {
+        if (count > size_ - position_)
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+
+        position_ += count;
+      }
+
+      const uint8_t* Read(uint64_t count)
+      {
+        uint64_t start = position_;
+        Skip(count);  // Checks the bounds before accessing the data
+
+        if (data_ != NULL)
+        {
+          return data_ + start;
+        }
+
+        buffer_.resize(static_cast<size_t>(count));
+
+        if (count > 0)
+        {
+          // Only seek if some bytes were skipped since the last read
+          if (filePosition_ != start)
+          {
+            file_->seekg(static_cast<std::streamoff>(start), std::ios::beg);
+          }
+
+          file_->read(&buffer_[0], static_cast<std::streamsize>(count));
+          if (!file_->good())
+          {
+            throw OrthancException(ErrorCode_BadFileFormat);
+          }
+
+          filePosition_ = position_;
+        }
+
+        return reinterpret_cast<const uint8_t*>(buffer_.c_str());
+      }
+
+      uint16_t ReadUInt16()
+      {
+        const uint8_t* p = Read(2);
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+      }
+
+      uint32_t ReadUInt32()
+      {
+        const uint8_t* p = Read(4);
+        return (static_cast<uint32_t>(p[0]) |
+                (static_cast<uint32_t>(p[1]) << 8) |
+                (static_cast<uint32_t>(p[2]) << 16) |
+                (static_cast<uint32_t>(p[3]) << 24));
+      }
+
+      std::string ReadString(uint32_t length)
+      {
+        const char* p = reinterpret_cast<const char*>(Read(length));
+
+        // Remove the padding (space or NUL)
+        while (length > 0 &&
+               (p[length - 1] == ' ' || p[length - 1] == '\0'))
+        {
+          length--;
+        }
+
+        return std::string(p, length);
+      }
+    };
+
+
+    struct ElementHeader
+    {
+      uint16_t  group_;
+      uint16_t  element_;
+      char      vr_[2];
+      uint32_t  length_;
+
+      bool Is(uint16_t group,
+              uint16_t element) const
+      {
+        return group_ == group && element_ == element;
+      }
+
+      bool IsVR(const char* vr) const
+      {
+        return vr_[0] == vr[0] && vr_[1] == vr[1];
+      }
+    };
+
+
+    struct ImageTags
+    {
+      unsigned int  rows_;
+      unsigned int  columns_;
+      unsigned int  samplesPerPixel_;
+      unsigned int  bitsAllocated_;
+      unsigned int  numberOfFrames_;
+
+      ImageTags() :
+        rows_(0),
+        columns_(0),
+        samplesPerPixel_(1),
+        bitsAllocated_(0),
+        numberOfFrames_(1)
+      {
+      }
+    };
+  }
+
+
+  static bool HasLongLength(const char vr[2])
+  {
+    // Value representations with 2 reserved bytes and a 32-bit length
+    static const char* const LONG[] = { 
+      "OB", "OD", "OF", "OL", "OV", "OW", "SQ", "SV", "UC", "UN", "UR", "UT", "UV"
+    };
+
+    for (size_t i = 0; i < sizeof(LONG) / sizeof(const char*); i++)
+    {
+      if (vr[0] == LONG[i][0] && vr[1] == LONG[i][1])
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+
+  static void ReadElementHeader(ElementHeader& header,
+                                LittleEndianReader& reader,
+                                bool explicitVR)
+  {
+    header.group_ = reader.ReadUInt16();
+    header.element_ = reader.ReadUInt16();
+
+    if (header.group_ == 0xfffe)
+    {
+      // Item, item delimitation and sequence delimitation have no VR
+      header.vr_[0] = header.vr_[1] = ' ';
+      header.length_ = reader.ReadUInt32();
+    }
+    else if (explicitVR)
+    {
+      const uint8_t* vr = reader.Read(2);
+      header.vr_[0] = static_cast<char>(vr[0]);
+      header.vr_[1] = static_cast<char>(vr[1]);
+
+      if (HasLongLength(header.vr_))
+      {
+        reader.Skip(2);
+        header.length_ = reader.ReadUInt32();
+      }
+      else
+      {
+        header.length_ = reader.ReadUInt16();
+      }
+    }
+    else
+    {
+      header.vr_[0] = header.vr_[1] = ' ';
+      header.length_ = reader.ReadUInt32();
+    }
+  }
+
+
+  static void SkipItems(LittleEndianReader& reader,
+                        bool explicitVR,
+                        unsigned int depth);
+
+
+  // Skips the elements until the item delimitation (if "untilDelimiter"
+  // is "true") or until the end of the reader
+  static void SkipElements(LittleEndianReader& reader,
+                           bool explicitVR,
+                           bool untilDelimiter,
+                           unsigned int depth)
+  {
+    if (depth > MAX_DEPTH)
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    while (!reader.IsDone())
+    {
+      ElementHeader header;
+      ReadElementHeader(header, reader, explicitVR);
+
+      if (header.Is(0xfffe, 0xe00d))
+      {
+        // Item delimitation
+        if (untilDelimiter)
+        {
+          return;
+        }
+        else
+        {
+          throw OrthancException(ErrorCode_BadFileFormat);
+        }
+      }
+
+      if (header.length_ == UNDEFINED_LENGTH)
+      {
+        // Sequence of undefined length. The items of a "UN" element
+        // are always encoded in implicit VR (PS 3.5, Section 6.2.2).
+        SkipItems(reader, explicitVR && !header.IsVR("UN"), depth + 1);
+      }
+      else
+      {
+        reader.Skip(header.length_);
+      }
+    }
+
+    if (untilDelimiter)
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+  }
+
+
+  // Skips the items of a sequence of undefined length, including the
+  // sequence delimitation
+  static void SkipItems(LittleEndianReader& reader,
+                        bool explicitVR,
+                        unsigned int depth)
+  {
+    for (;;)
+    {
+      ElementHeader header;
+      ReadElementHeader(header, reader, explicitVR);
+
+      if (header.Is(0xfffe, 0xe0dd))
+      {
+        return;  // Sequence delimitation
+      }
+      else if (!header.Is(0xfffe, 0xe000))
+      {
+        throw OrthancException(ErrorCode_BadFileFormat);
+      }
+      else if (header.length_ == UNDEFINED_LENGTH)
+      {
+        SkipElements(reader, explicitVR, true, depth + 1);
+      }
+      else
+      {
+        reader.Skip(header.length_);
+      }
+    }
+  }
+
+
+  static unsigned int ReadUnsignedShort(LittleEndianReader& reader,
+                                        const ElementHeader& header)
+  {
+    if (header.length_ != 2)
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    return reader.ReadUInt16();
+  }
+
+
+  class DicomFrameIndex::Reader : public LittleEndianReader
+  {
+  public:
+    Reader(const void* data,
+           uint64_t size) :
+      LittleEndianReader(data, size)
+    {
+    }
+
+    Reader(std::istream& file,
+           uint64_t size) :
+      LittleEndianReader(file, size)
+    {
+    }
+  };
+
+
+  bool DicomFrameIndex::Parse(const void* dicom,
+                              size_t size)
+  {
+    Reader reader(dicom, size);
+    return ParseInternal(reader);
+  }
+
+
+  bool DicomFrameIndex::ParseFile(const std::string& path)
+  {
+    boost::filesystem::ifstream f;
+    f.open(path, std::ifstream::in | std::ios::binary);
+    if (!f.good())
+    {
+      throw OrthancException(ErrorCode_InexistentFile);
+    }
+
+    Reader reader(f, static_cast<uint64_t>(boost::filesystem::file_size(path)));
+    return ParseInternal(reader);
+  }
+
+
+  bool DicomFrameIndex::ParseInternal(Reader& reader)
+  {
+    transferSyntax_.clear();
+    headerSize_ = 0;
+    encapsulated_ = false;
+    frames_.clear();
+
+    try
+    {
+      // Preamble and prefix
+      reader.Skip(128);
+      if (memcmp(reader.Read(4), "DICM", 4) != 0)
+      {
+        return false;
+      }
+
+      // The meta-information is always encoded in explicit VR little endian
+      for (;;)
+      {
+        uint64_t position = reader.GetPosition();
+        if (reader.IsDone() ||
+            reader.ReadUInt16() != 0x0002)
+        {
+          reader.SetPosition(position);
+          break;
+        }
+
+        reader.SetPosition(position);
+
+        ElementHeader header;
+        ReadElementHeader(header, reader, true);
+
+        if (header.length_ == UNDEFINED_LENGTH)
+        {
+          return false;
+        }
+        else if (header.Is(0x0002, 0x0010))
+        {
+          transferSyntax_ = reader.ReadString(header.length_);
+        }
+        else
+        {
+          reader.Skip(header.length_);
+        }
+      }
+
+      if (transferSyntax_ == IMPLICIT_VR_LITTLE_ENDIAN)
+      {
+        explicitVR_ = false;
+      }
+      else if (transferSyntax_.empty() ||
+               transferSyntax_ == DEFLATED_EXPLICIT_VR_LITTLE_ENDIAN ||
+               transferSyntax_ == EXPLICIT_VR_BIG_ENDIAN)
+      {
+        return false;
+      }
+      else
+      {
+        explicitVR_ = true;
+      }
+
+      // Main dataset, until the pixel data
+      ImageTags tags;
+
+      for (;;)
+      {
+        if (reader.IsDone())
+        {
+          return false;  // No pixel data
+        }
+
+        uint64_t position = reader.GetPosition();
+
+        ElementHeader header;
+        ReadElementHeader(header, reader, explicitVR_);
+
+        if (header.Is(0x7fe0, 0x0010))
+        {
+          headerSize_ = position;
+          break;
+        }
+        else if (header.length_ == UNDEFINED_LENGTH)
+        {
+          SkipItems(reader, explicitVR_ && !header.IsVR("UN"), 1);
+        }
+        else if (header.Is(0x0028, 0x0010))
+        {
+          tags.rows_ = ReadUnsignedShort(reader, header);
+        }
+        else if (header.Is(0x0028, 0x0011))
+        {
+          tags.columns_ = ReadUnsignedShort(reader, header);
+        }
+        else if (header.Is(0x0028, 0x0002))
+        {
+          tags.samplesPerPixel_ = ReadUnsignedShort(reader, header);
+        }
+        else if (header.Is(0x0028, 0x0100))
+        {
+          tags.bitsAllocated_ = ReadUnsignedShort(reader, header);
+        }
+        else if (header.Is(0x0028, 0x0008))
+        {
+          std::string s = Toolbox::StripSpaces(reader.ReadString(header.length_));
+          if (!s.empty())
+          {
+            tags.numberOfFrames_ = boost::lexical_cast<unsigned int>(s);
+          }
+        }
+        else
+        {
+          reader.Skip(header.length_);
+        }
+      }
+
+      if (tags.numberOfFrames_ == 0)
+      {
+        return false;
+      }
+
+      ElementHeader pixelData;
+      reader.SetPosition(headerSize_);
+      ReadElementHeader(pixelData, reader, explicitVR_);
+
+      if (pixelData.length_ != UNDEFINED_LENGTH)
+      {
+        // Native pixel data: The frames are contiguous
+        if (tags.bitsAllocated_ == 0 ||
+            tags.bitsAllocated_ % 8 != 0)
+        {
+          return false;  // Notably, 1bpp images are not supported
+        }
+
+        const uint64_t frameSize = (static_cast<uint64_t>(tags.rows_) * tags.columns_ * 
+                                    tags.samplesPerPixel_ * (tags.bitsAllocated_ / 8));
+        const uint64_t offset = reader.GetPosition();
+
+        if (frameSize == 0 ||
+            frameSize * tags.numberOfFrames_ > pixelData.length_ ||
+            offset + frameSize * tags.numberOfFrames_ > reader.GetSize())
+        {
+          return false;
+        }
+
+        frames_.resize(tags.numberOfFrames_);
+        for (unsigned int i = 0; i < tags.numberOfFrames_; i++)
+        {
+          frames_[i].push_back(Fragment(offset + frameSize * i, frameSize));
+        }
+
+        return true;
+      }
+
+      // Encapsulated pixel data: Basic offset table, then the fragments
+      encapsulated_ = true;
+
+      std::vector<uint32_t> offsets;
+      Fragments fragments;
+      std::vector<uint64_t> itemPositions;
+      uint64_t firstItem = 0;
+
+      for (bool first = true; ; first = false)
+      {
+        uint64_t position = reader.GetPosition();
+
+        ElementHeader item;
+        ReadElementHeader(item, reader, explicitVR_);
+
+        if (item.Is(0xfffe, 0xe0dd))
+        {
+          break;
+        }
+        else if (!item.Is(0xfffe, 0xe000) ||
+                 item.length_ == UNDEFINED_LENGTH)
+        {
+          return false;
+        }
+        else if (first)
+        {
+          if (item.length_ % 4 != 0)
+          {
+            return false;
+          }
+
+          for (uint32_t i = 0; i < item.length_ / 4; i++)
+          {
+            offsets.push_back(reader.ReadUInt32());
+          }
+
+          firstItem = reader.GetPosition();
+        }
+        else
+        {
+          // The offsets of the basic offset table are relative to the
+          // first byte of the item tag of the first fragment
+          itemPositions.push_back(position - firstItem);
+          fragments.push_back(Fragment(reader.GetPosition(), item.length_));
+          reader.Skip(item.length_);
+        }
+      }
+
+      if (fragments.empty())
+      {
+        return false;
+      }
+
+      frames_.resize(tags.numberOfFrames_);
+
+      if (tags.numberOfFrames_ == 1)
+      {
+        frames_[0] = fragments;
+      }
+      else if (offsets.size() == tags.numberOfFrames_)
+      {
+        // Use the basic offset table
+        size_t f = 0;
+        for (unsigned int i = 0; i < tags.numberOfFrames_; i++)
+        {
+          if (f == fragments.size() ||
+              itemPositions[f] != offsets[i])
+          {
+            return false;
+          }
+
+          uint64_t end = (i + 1 < tags.numberOfFrames_ ? offsets[i + 1] : itemPositions.back() + 1);
+
+          while (f < fragments.size() &&
+                 itemPositions[f] < end)
+          {
+            frames_[i].push_back(fragments[f]);
+            f++;
+          }
+        }
+
+        if (f != fragments.size())
+        {
+          return false;
+        }
+      }
+      else if (fragments.size() == tags.numberOfFrames_)
+      {
+        // No basic offset table: One fragment per frame
+        for (unsigned int i = 0; i < tags.numberOfFrames_; i++)
+        {
+          frames_[i].push_back(fragments[i]);
+        }
+      }
+      else
+      {
+        return false;
+      }
+
+      return true;
+    }
+    catch (OrthancException&)
+    {
+      frames_.clear();
+      return false;
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+      frames_.clear();
+      return false;
+    }
+  }
+
+
+  bool DicomFrameIndex::Parse(const std::string& dicom)
+  {
+    if (dicom.empty())
+    {
+      return false;
+    }
+    else
+    {
+      return Parse(dicom.c_str(), dicom.size());
+    }
+  }
+
+
+  const DicomFrameIndex::Fragments& DicomFrameIndex::GetFragments(unsigned int frame) const
+  {
+    if (frame >= frames_.size())
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    return frames_[frame];
+  }
+
+
+  void DicomFrameIndex::GetFrameRange(uint64_t& start,
+                                      uint64_t& end,
+                                      unsigned int frame) const
+  {
+    const Fragments& fragments = GetFragments(frame);
+    start = fragments.front().offset_;
+    end = fragments.back().offset_ + fragments.back().size_;
+  }
+
+
+  static void WriteUInt16(std::string& target,
+                          uint16_t value)
+  {
+    target.push_back(static_cast<char>(value & 0xff));
+    target.push_back(static_cast<char>(value >> 8));
+  }
+
+
+  static void WriteUInt32(std::string& target,
+                          uint32_t value)
+  {
+    WriteUInt16(target, static_cast<uint16_t>(value & 0xffff));
+    WriteUInt16(target, static_cast<uint16_t>(value >> 16));
+  }
+
+
+  static void WriteTag(std::string& target,
+                       uint16_t group,
+                       uint16_t element,
+                       uint32_t length)
+  {
+    WriteUInt16(target, group);
+    WriteUInt16(target, element);
+    WriteUInt32(target, length);
+  }
+
+
+  void DicomFrameIndex::CreateSingleFrameFile(std::string& target,
+                                              const std::string& header,
+                                              const std::string& range,
+                                              unsigned int frame) const
+  {
+    uint64_t start, end;
+    GetFrameRange(start, end, frame);
+
+    if (header.size() != headerSize_ ||
+        range.size() != end - start)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    const Fragments& fragments = GetFragments(frame);
+
+    target.reserve(header.size() + range.size() + 32 + 8 * fragments.size());
+    target = header;
+
+    // Pixel data element: (7fe0,0010), VR "OB"
+    WriteUInt16(target, 0x7fe0);
+    WriteUInt16(target, 0x0010);
+
+    if (explicitVR_)
+    {
+      target.append("OB");
+      WriteUInt16(target, 0);
+    }
+
+    if (encapsulated_)
+    {
+      WriteUInt32(target, UNDEFINED_LENGTH);
+      WriteTag(target, 0xfffe, 0xe000, 0);  // Empty basic offset table
+
+      for (size_t i = 0; i < fragments.size(); i++)
+      {
+        WriteTag(target, 0xfffe, 0xe000, static_cast<uint32_t>(fragments[i].size_));
+        target.append(range, static_cast<size_t>(fragments[i].offset_ - start),
+                      static_cast<size_t>(fragments[i].size_));
+      }
+
+      WriteTag(target, 0xfffe, 0xe0dd, 0);  // Sequence delimitation
+    }
+    else
+    {
+      WriteUInt32(target, static_cast<uint32_t>(range.size()));
+      target.append(range);
+    }
+  }
+
+
+  // The offsets and sizes are serialized as decimal strings, as
+  // JsonCpp integers are 32 bits, which would truncate the positions
+  // in the files that are larger than 4GB
+  static std::string FormatPosition(uint64_t value)
+  {
+    return boost::lexical_cast<std::string>(value);
+  }
+
+
+  static uint64_t ParsePosition(const Json::Value& value)
+  {
+    if (value.type() != Json::stringValue)
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    return boost::lexical_cast<uint64_t>(value.asString());
+  }
+
+
+  void DicomFrameIndex::Serialize(std::string& target) const
+  {
+    Json::Value index = Json::objectValue;
+    index["Version"] = 2;
+    index["TransferSyntax"] = transferSyntax_;
+    index["ExplicitVR"] = explicitVR_;
+    index["HeaderSize"] = FormatPosition(headerSize_);
+    index["Encapsulated"] = encapsulated_;
+
+    if (encapsulated_)
+    {
+      // One array "[offset1, size1, offset2, size2...]" per frame
+      Json::Value frames = Json::arrayValue;
+
+      for (size_t i = 0; i < frames_.size(); i++)
+      {
+        Json::Value fragments = Json::arrayValue;
+
+        for (size_t j = 0; j < frames_[i].size(); j++)
+        {
+          fragments.append(FormatPosition(frames_[i][j].offset_));
+          fragments.append(FormatPosition(frames_[i][j].size_));
+        }
+
+        frames.append(fragments);
+      }
+
+      index["Frames"] = frames;
+    }
+    else
+    {
+      // The frames are contiguous and of the same size
+      index["FramesCount"] = static_cast<Json::UInt>(frames_.size());
+      index["Offset"] = FormatPosition(frames_.empty() ? 0 : frames_[0][0].offset_);
+      index["FrameSize"] = FormatPosition(frames_.empty() ? 0 : frames_[0][0].size_);
+    }
+
+    target = Json::FastWriter().write(index);
+  }
+
+
+  bool DicomFrameIndex::Unserialize(const std::string& source)
+  {
+    transferSyntax_.clear();
+    headerSize_ = 0;
+    encapsulated_ = false;
+    frames_.clear();
+
+    // The version 1 of this format stored the positions as 32-bit
+    // integers, and is not accepted anymore
+    Json::Value index;
+    Json::Reader reader;
+    if (!reader.parse(source, index) ||
+        index.type() != Json::objectValue ||
+        !index.isMember("Version") ||
+        index["Version"].asInt() != 2)
+    {
+      return false;
+    }
+
+    try
+    {
+      transferSyntax_ = index["TransferSyntax"].asString();
+      explicitVR_ = index["ExplicitVR"].asBool();
+      headerSize_ = ParsePosition(index["HeaderSize"]);
+      encapsulated_ = index["Encapsulated"].asBool();
+
+      if (encapsulated_)
+      {
+        const Json::Value& frames = index["Frames"];
+        frames_.resize(frames.size());
+
+        for (Json::Value::ArrayIndex i = 0; i < frames.size(); i++)
+        {
+          for (Json::Value::ArrayIndex j = 0; j + 1 < frames[i].size(); j += 2)
+          {
+            frames_[i].push_back(Fragment(ParsePosition(frames[i][j]), ParsePosition(frames[i][j + 1])));
+          }
+
+          if (frames_[i].empty())
+          {
+            frames_.clear();
+            return false;
+          }
+        }
+      }
+      else
+      {
+        const uint64_t offset = ParsePosition(index["Offset"]);
+        const uint64_t frameSize = ParsePosition(index["FrameSize"]);
+
+        frames_.resize(index["FramesCount"].asUInt());
+        for (size_t i = 0; i < frames_.size(); i++)
+        {
+          frames_[i].push_back(Fragment(offset + frameSize * i, frameSize));
+        }
+      }
+    }
+    catch (OrthancException&)
+    {
+      frames_.clear();
+      return false;
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+      frames_.clear();
+      return false;
+    }
+    catch (std::runtime_error&)
+    {
+      // Type error in JsonCpp
+      frames_.clear();
+      return false;
+    }
+
+    return !frames_.empty();
+  }
+}
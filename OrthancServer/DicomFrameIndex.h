@@ -0,0 +1,151 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <json/value.h>
+
+namespace Orthanc
+{
+  /**
+   * Index of the frames of a DICOM file: Location of the pixel data
+   * of each frame (native transfer syntaxes) or of the fragments of
+   * each frame (encapsulated transfer syntaxes). This index is
+   * computed by scanning the DICOM file once, without decoding it.
+   * It is then used to read one frame from the storage area, without
+   * reading nor parsing the other frames.
+   **/
+  class DicomFrameIndex
+  {
+  public:
+    struct Fragment
+    {
+      uint64_t  offset_;
+      uint64_t  size_;
+
+      Fragment(uint64_t offset,
+               uint64_t size) :
+        offset_(offset),
+        size_(size)
+      {
+      }
+    };
+
+    typedef std::vector<Fragment>  Fragments;
+
+  private:
+    std::string             transferSyntax_;
+    bool                    explicitVR_;
+    uint64_t                headerSize_;
+    bool                    encapsulated_;
+    std::vector<Fragments>  frames_;
+
+    class Reader;
+
+    bool ParseInternal(Reader& reader);
+
+  public:
+    DicomFrameIndex() :
+      explicitVR_(true),
+      headerSize_(0),
+      encapsulated_(false)
+    {
+    }
+
+    /**
+     * Scans a DICOM file (with its preamble). Returns "false" if the
+     * frames cannot be located: Unsupported transfer syntax (big
+     * endian or deflated), no pixel data, or encapsulated pixel data
+     * whose fragments cannot be associated with the frames.
+     **/
+    bool Parse(const void* dicom,
+               size_t size);
+
+    bool Parse(const std::string& dicom);
+
+    /**
+     * Scans a DICOM file of the local filesystem. Only the headers of
+     * the elements are read, the values of the large elements (such
+     * as the pixel data) are skipped on the disk.
+     **/
+    bool ParseFile(const std::string& path);
+
+    const std::string& GetTransferSyntax() const
+    {
+      return transferSyntax_;
+    }
+
+    bool IsEncapsulated() const
+    {
+      return encapsulated_;
+    }
+
+    // Number of bytes before the "Pixel Data" element
+    uint64_t GetHeaderSize() const
+    {
+      return headerSize_;
+    }
+
+    unsigned int GetFramesCount() const
+    {
+      return static_cast<unsigned int>(frames_.size());
+    }
+
+    const Fragments& GetFragments(unsigned int frame) const;
+
+    // Range [start, end) of the file that contains all the
+    // fragments of the given frame
+    void GetFrameRange(uint64_t& start,
+                       uint64_t& end,
+                       unsigned int frame) const;
+
+    /**
+     * Creates a DICOM file that contains only one frame. "header"
+     * must contain the first "GetHeaderSize()" bytes of the original
+     * file, and "range" the bytes given by "GetFrameRange(frame)". The
+     * "Number of Frames" tag is not updated: The caller must set it
+     * to 1 after parsing the resulting file.
+     **/
+    void CreateSingleFrameFile(std::string& target,
+                               const std::string& header,
+                               const std::string& range,
+                               unsigned int frame) const;
+
+    void Serialize(std::string& target) const;
+
+    bool Unserialize(const std::string& source);
+  };
+}
@@ -36,6 +36,7 @@
 
 #include <dcmtk/dcmdata/dcfilefo.h>
 #include <glog/logging.h>
+#include <limits>
 
 
 namespace Orthanc
@@ -56,7 +57,7 @@ namespace Orthanc
 
   void DicomInstanceToStore::ComputeMissingInformation()
   {
-    if (buffer_.HasContent() &&
+    if ((buffer_.HasContent() || HasFile()) &&
         summary_.HasContent() &&
         json_.HasContent())
     {
@@ -64,7 +65,8 @@ namespace Orthanc
       return; 
     }
     
-    if (!buffer_.HasContent())
+    if (!buffer_.HasContent() &&
+        !HasFile())
     {
       if (!parsed_.HasContent())
       {
@@ -89,12 +91,20 @@ namespace Orthanc
     }
 
     // At this point, we know that the DICOM file is available as a
-    // memory buffer, but that its summary or its JSON version is
-    // missing
+    // memory buffer or as a file, but that its summary or its JSON
+    // version is missing
 
     if (!parsed_.HasContent())
     {
-      parsed_.TakeOwnership(new ParsedDicomFile(buffer_.GetConstContent()));
+      if (buffer_.HasContent())
+      {
+        parsed_.TakeOwnership(new ParsedDicomFile(buffer_.GetConstContent()));
+      }
+      else
+      {
+        // Parse the file without loading its large elements
+        parsed_.TakeOwnership(ParsedDicomFile::OpenFile(file_));
+      }
     }
 
     // At this point, we have parsed the DICOM file
@@ -114,9 +124,21 @@ namespace Orthanc
 
 
 
+  void DicomInstanceToStore::ReadFileIfNeeded()
+  {
+    if (!buffer_.HasContent() &&
+        HasFile())
+    {
+      buffer_.Allocate();
+      Toolbox::ReadFile(buffer_.GetContent(), file_);
+    }
+  }
+
+
   const char* DicomInstanceToStore::GetBufferData()
   {
     ComputeMissingInformation();
+    ReadFileIfNeeded();
     
     if (!buffer_.HasContent())
     {
@@ -137,6 +159,20 @@ namespace Orthanc
   size_t DicomInstanceToStore::GetBufferSize()
   {
     ComputeMissingInformation();
+
+    if (!buffer_.HasContent() &&
+        HasFile())
+    {
+      // The size of a streamed file might not fit in memory on
+      // 32-bit platforms
+      if (fileSize_ > static_cast<uint64_t>(std::numeric_limits<size_t>::max()))
+      {
+        LOG(ERROR) << "Too large DICOM file to be handled in memory: " << fileSize_ << " bytes";
+        throw OrthancException(ErrorCode_NotEnoughMemory);
+      }
+
+      return static_cast<size_t>(fileSize_);
+    }
     
     if (!buffer_.HasContent())
     {
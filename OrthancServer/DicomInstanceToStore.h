@@ -143,18 +143,66 @@ namespace Orthanc
     SmartContainer<DicomMap>  summary_;
     SmartContainer<Json::Value>  json_;
 
+    // Path to a file that contains the DICOM instance, if the
+    // instance is not available as a memory buffer
+    std::string  file_;
+    uint64_t     fileSize_;
+    std::string  fileMD5_;
+
     std::string remoteAet_;
     std::string calledAet_;
     ServerIndex::MetadataMap metadata_;
 
     void ComputeMissingInformation();
 
+    void ReadFileIfNeeded();
+
   public:
+    DicomInstanceToStore() : fileSize_(0)
+    {
+    }
+
     void SetBuffer(const std::string& dicom)
     {
       buffer_.SetConstReference(dicom);
     }
 
+    /**
+     * The DICOM instance is stored in a file of the local filesystem,
+     * whose size and MD5 hash are already known. The file is only
+     * read into memory if "GetBufferData()" is called: Otherwise, it
+     * is parsed from the disk and adopted by the storage area. It
+     * must not be modified nor removed before the instance is stored.
+     **/
+    void SetFile(const std::string& path,
+                 uint64_t size,
+                 const std::string& md5)
+    {
+      file_ = path;
+      fileSize_ = size;
+      fileMD5_ = md5;
+    }
+
+    bool HasFile() const
+    {
+      return !file_.empty();
+    }
+
+    const std::string& GetFilePath() const
+    {
+      return file_;
+    }
+
+    uint64_t GetFileSize() const
+    {
+      return fileSize_;
+    }
+
+    const std::string& GetFileMD5() const
+    {
+      return fileMD5_;
+    }
+
     void SetParsedDicomFile(ParsedDicomFile& parsed)
     {
       parsed_.SetReference(parsed);
@@ -36,6 +36,7 @@
 #include "../../Core/OrthancException.h"
 
 #include <glog/logging.h>
+#include <boost/lexical_cast.hpp>
 
 namespace Orthanc
 {
@@ -44,42 +45,232 @@ namespace Orthanc
     return boost::posix_time::microsec_clock::local_time();
   }
 
-  void ReusableDicomUserConnection::Open(const std::string& remoteAet,
-                                         const std::string& address,
-                                         int port,
-                                         ModalityManufacturer manufacturer)
+
+  static std::string GetKey(const std::string& remoteAet,
+                            const std::string& address,
+                            int port,
+                            ModalityManufacturer manufacturer)
+  {
+    return (remoteAet + "|" + address + "|" + 
+            boost::lexical_cast<std::string>(port) + "|" +
+            boost::lexical_cast<std::string>(static_cast<int>(manufacturer)));
+  }
+
+
+  // The delay before retrying to open an association doubles with
+  // each consecutive failure, up to this factor
+  static const unsigned int MAX_RETRY_FACTOR = 64;
+
+
+  static void DeleteConnections(std::vector<DicomUserConnection*>& connections)
+  {
+    for (size_t i = 0; i < connections.size(); i++)
+    {
+      delete connections[i];
+    }
+
+    connections.clear();
+  }
+
+
+  DicomUserConnection* ReusableDicomUserConnection::Acquire(const std::string& remoteAet,
+                                                            const std::string& address,
+                                                            int port,
+                                                            ModalityManufacturer manufacturer)
   {
-    if (connection_ != NULL &&
-        connection_->GetRemoteApplicationEntityTitle() == remoteAet &&
-        connection_->GetRemoteHost() == address &&
-        connection_->GetRemotePort() == port &&
-        connection_->GetRemoteManufacturer() == manufacturer)
+    const std::string key = GetKey(remoteAet, address, port, manufacturer);
+    std::string localAet;
+    std::vector<DicomUserConnection*> closed;
+
     {
-      // The current connection can be reused
-      LOG(INFO) << "Reusing the previous SCU connection";
-      return;
+      boost::mutex::scoped_lock lock(mutex_);
+
+      // Wait for a slot to be available for this modality
+      Modality& modality = modalities_[key];
+      while (modality.active_ >= maxConnectionsPerModality_)
+      {
+        available_.wait(lock);
+      }
+
+      if (modality.idle_.empty() &&
+          !modality.retryAfter_.is_not_a_date_time() &&
+          Now() < modality.retryAfter_)
+      {
+        LOG(WARNING) << "Not opening an SCU connection to \"" << remoteAet << "\" before "
+                     << boost::posix_time::to_simple_string(modality.retryAfter_) << " ("
+                     << modality.failures_ << " consecutive failure(s))";
+        throw OrthancException(ErrorCode_NetworkProtocol);
+      }
+
+      modality.active_++;
+
+      // Reuse the most recently used association, if any
+      while (!modality.idle_.empty())
+      {
+        DicomUserConnection* connection = modality.idle_.back().connection_;
+        modality.idle_.pop_back();
+
+        if (connection->IsOpen() &&
+            connection->GetLocalApplicationEntityTitle() == localAet_)
+        {
+          LOG(INFO) << "Reusing a previous SCU connection to \"" << remoteAet << "\"";
+          lock.unlock();
+          DeleteConnections(closed);
+          return connection;
+        }
+
+        closed.push_back(connection);
+      }
+
+      localAet = localAet_;
+    }
+
+    DeleteConnections(closed);
+
+    // Open a new association, outside of the mutex as this implies
+    // network operations
+    std::auto_ptr<DicomUserConnection> connection(new DicomUserConnection);
+
+    try
+    {
+      connection->SetLocalApplicationEntityTitle(localAet);
+      connection->SetRemoteApplicationEntityTitle(remoteAet);
+      connection->SetRemoteHost(address);
+      connection->SetRemotePort(port);
+      connection->SetRemoteManufacturer(manufacturer);
+      OpenConnection(*connection);
+    }
+    catch (OrthancException&)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      Modality& modality = modalities_[key];
+      assert(modality.active_ > 0);
+      modality.active_--;
+      modality.failures_++;
+
+      // Back off before the next attempt
+      unsigned int factor = 1;
+      for (unsigned int i = 1; i < modality.failures_ && factor < MAX_RETRY_FACTOR; i++)
+      {
+        factor *= 2;
+      }
+
+      modality.retryAfter_ = Now() + timeBeforeRetry_ * static_cast<int>(factor);
+
+      LOG(WARNING) << "Cannot open an SCU connection to \"" << remoteAet << "\" ("
+                   << modality.failures_ << " consecutive failure(s))";
+
+      available_.notify_all();
+      throw;
+    }
+
+    return connection.release();
+  }
+
+
+  void ReusableDicomUserConnection::Release(DicomUserConnection* connection,
+                                            bool success)
+  {
+    const std::string key = GetKey(connection->GetRemoteApplicationEntityTitle(),
+                                   connection->GetRemoteHost(),
+                                   connection->GetRemotePort(),
+                                   connection->GetRemoteManufacturer());
+
+    // The association might be in an inconsistent state after an
+    // error: Never reuse it
+    bool close = (!success || 
+                  !connection->IsOpen() ||
+                  // "storescp" from DCMTK has problems when reusing a
+                  // connection. Always close.
+                  connection->GetRemoteManufacturer() == ModalityManufacturer_StoreScp);
+
+    std::vector<DicomUserConnection*> closed;
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      Modality& modality = modalities_[key];
+      assert(modality.active_ > 0);
+      modality.active_--;
+
+      if (success)
+      {
+        modality.failures_ = 0;
+        modality.retryAfter_ = boost::posix_time::ptime();
+      }
+      else
+      {
+        // The other idle associations to this modality are likely to
+        // be broken as well. The next association will be opened
+        // right away: The back off only starts if it cannot be opened.
+        modality.failures_++;
+
+        for (std::list<IdleConnection>::const_iterator
+               it = modality.idle_.begin(); it != modality.idle_.end(); ++it)
+        {
+          closed.push_back(it->connection_);
+        }
+
+        modality.idle_.clear();
+      }
+
+      if (connection->GetLocalApplicationEntityTitle() != localAet_)
+      {
+        close = true;
+      }
+
+      if (!close)
+      {
+        IdleConnection idle;
+        idle.connection_ = connection;
+        idle.lastUse_ = Now();
+        modality.idle_.push_back(idle);
+      }
+
+      available_.notify_all();
     }
 
-    Close();
+    if (close)
+    {
+      delete connection;
+    }
 
-    connection_ = new DicomUserConnection();
-    connection_->SetLocalApplicationEntityTitle(localAet_);
-    connection_->SetRemoteApplicationEntityTitle(remoteAet);
-    connection_->SetRemoteHost(address);
-    connection_->SetRemotePort(port);
-    connection_->SetRemoteManufacturer(manufacturer);
-    connection_->Open();
+    DeleteConnections(closed);
   }
-    
-  void ReusableDicomUserConnection::Close()
+
+
+  void ReusableDicomUserConnection::CloseIdleConnections(bool all)
   {
-    if (connection_ != NULL)
+    std::vector<DicomUserConnection*> closed;
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      const boost::posix_time::ptime now = Now();
+
+      for (Modalities::iterator it = modalities_.begin(); it != modalities_.end(); ++it)
+      {
+        std::list<IdleConnection>& idle = it->second.idle_;
+
+        // The least recently used connections are at the front of the list
+        while (!idle.empty() &&
+               (all || now >= idle.front().lastUse_ + timeBeforeClose_))
+        {
+          closed.push_back(idle.front().connection_);
+          idle.pop_front();
+        }
+      }
+    }
+
+    if (!closed.empty())
     {
-      delete connection_;
-      connection_ = NULL;
+      LOG(INFO) << "Closing " << closed.size() << " idle SCU connection(s)";
+      DeleteConnections(closed);
     }
   }
 
+
   void ReusableDicomUserConnection::CloseThread(ReusableDicomUserConnection* that)
   {
     for (;;)
@@ -87,41 +278,40 @@ namespace Orthanc
       boost::this_thread::sleep(boost::posix_time::milliseconds(100));
       if (!that->continue_)
       {
-        //LOG(INFO) << "Finishing the thread watching the global SCU connection";
+        //LOG(INFO) << "Finishing the thread watching the SCU connections";
         return;
       }
 
-      {
-        boost::mutex::scoped_lock lock(that->mutex_);
-        if (that->connection_ != NULL &&
-            Now() >= that->lastUse_ + that->timeBeforeClose_)
-        {
-          LOG(INFO) << "Closing the global SCU connection after timeout";
-          that->Close();
-        }
-      }
+      that->CloseIdleConnections(false);
     }
   }
-    
+
+
   ReusableDicomUserConnection::Locker::Locker(ReusableDicomUserConnection& that,
                                               const std::string& aet,
                                               const std::string& address,
                                               int port,
                                               ModalityManufacturer manufacturer) :
-    ::Orthanc::Locker(that)
+    that_(that)
   {
-    that.Open(aet, address, port, manufacturer);
-    connection_ = that.connection_;
+    connection_ = that.Acquire(aet, address, port, manufacturer);
   }
 
 
   ReusableDicomUserConnection::Locker::Locker(ReusableDicomUserConnection& that,
                                               const RemoteModalityParameters& remote) :
-    ::Orthanc::Locker(that)
+    that_(that)
   {
-    that.Open(remote.GetApplicationEntityTitle(), remote.GetHost(), 
-              remote.GetPort(), remote.GetManufacturer());
-    connection_ = that.connection_;    
+    connection_ = that.Acquire(remote.GetApplicationEntityTitle(), remote.GetHost(), 
+                               remote.GetPort(), remote.GetManufacturer());
+  }
+
+
+  ReusableDicomUserConnection::Locker::~Locker()
+  {
+    // If the locker is destroyed because of an exception, the
+    // association is considered as unhealthy
+    that_.Release(connection_, !std::uncaught_exception());
   }
 
 
@@ -135,23 +325,26 @@ namespace Orthanc
     return *connection_;
   }      
 
+
   ReusableDicomUserConnection::ReusableDicomUserConnection() : 
-    connection_(NULL), 
     timeBeforeClose_(boost::posix_time::seconds(5)),  // By default, close connection after 5 seconds
+    timeBeforeRetry_(boost::posix_time::seconds(1)),
+    maxConnectionsPerModality_(1),
     localAet_("ORTHANC")
   {
-    lastUse_ = Now();
     continue_ = true;
     closeThread_ = boost::thread(CloseThread, this);
   }
 
+
   ReusableDicomUserConnection::~ReusableDicomUserConnection()
   {
     continue_ = false;
     closeThread_.join();
-    Close();
+    CloseIdleConnections(true);
   }
 
+
   void ReusableDicomUserConnection::SetMillisecondsBeforeClose(uint64_t ms)
   {
     boost::mutex::scoped_lock lock(mutex_);
@@ -164,30 +357,63 @@ namespace Orthanc
     timeBeforeClose_ = boost::posix_time::milliseconds(ms);
   }
 
-  void ReusableDicomUserConnection::SetLocalApplicationEntityTitle(const std::string& aet)
+
+  void ReusableDicomUserConnection::SetMaxConnectionsPerModality(unsigned int count)
   {
     boost::mutex::scoped_lock lock(mutex_);
-    Close();
-    localAet_ = aet;
+
+    if (count == 0)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    maxConnectionsPerModality_ = count;
+    available_.notify_all();
   }
 
-  void ReusableDicomUserConnection::Lock()
+
+  void ReusableDicomUserConnection::SetMillisecondsBeforeRetry(uint64_t ms)
   {
-    mutex_.lock();
+    boost::mutex::scoped_lock lock(mutex_);
+    timeBeforeRetry_ = boost::posix_time::milliseconds(ms);
   }
 
-  void ReusableDicomUserConnection::Unlock()
+
+  std::string ReusableDicomUserConnection::GetLocalApplicationEntityTitle() const
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return localAet_;
+  }
+
+
+  void ReusableDicomUserConnection::SetLocalApplicationEntityTitle(const std::string& aet)
   {
-    if (connection_ != NULL &&
-        connection_->GetRemoteManufacturer() == ModalityManufacturer_StoreScp)
     {
-      // "storescp" from DCMTK has problems when reusing a
-      // connection. Always close.
-      Close();
+      boost::mutex::scoped_lock lock(mutex_);
+      localAet_ = aet;
     }
 
-    lastUse_ = Now();
-    mutex_.unlock();
+    // The associations that are currently in use will be closed once
+    // released, as their local AET does not match anymore
+    CloseIdleConnections(true);
   }
-}
 
+
+  unsigned int ReusableDicomUserConnection::GetConsecutiveFailures(const std::string& remoteAet,
+                                                                   const std::string& address,
+                                                                   int port,
+                                                                   ModalityManufacturer manufacturer) const
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    Modalities::const_iterator it = modalities_.find(GetKey(remoteAet, address, port, manufacturer));
+    if (it == modalities_.end())
+    {
+      return 0;
+    }
+    else
+    {
+      return it->second.failures_;
+    }
+  }
+}
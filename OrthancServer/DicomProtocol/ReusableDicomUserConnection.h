@@ -33,42 +33,86 @@
 #pragma once
 
 #include "DicomUserConnection.h"
-#include "../../Core/MultiThreading/Locker.h"
 
+#include <map>
+#include <list>
 #include <boost/thread.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 namespace Orthanc
 {
-  class ReusableDicomUserConnection : public ILockable
+  /**
+   * Pool of outgoing DICOM associations (SCU). The associations are
+   * grouped by remote modality, as identified by its AET, host, port
+   * and manufacturer. Up to "GetMaxConnectionsPerModality()"
+   * associations can be simultaneously used for each modality, and
+   * the idle associations are closed after a timeout.
+   *
+   * The pool also tracks the health of each modality, as its number
+   * of consecutive failures. Once an association cannot be opened,
+   * no new association is opened to this modality before a delay
+   * that doubles with each consecutive failure: Meanwhile, the
+   * requests fail immediately instead of waiting for the network.
+   **/
+  class ReusableDicomUserConnection : public boost::noncopyable
   {
   private:
-    boost::mutex mutex_;
-    DicomUserConnection* connection_;
+    struct IdleConnection
+    {
+      DicomUserConnection*      connection_;
+      boost::posix_time::ptime  lastUse_;
+    };
+
+    struct Modality
+    {
+      std::list<IdleConnection>  idle_;
+      unsigned int               active_;
+      unsigned int               failures_;     // Number of consecutive failures
+      boost::posix_time::ptime   retryAfter_;   // No new association before this time
+
+      Modality() : active_(0), failures_(0)
+      {
+      }
+    };
+
+    typedef std::map<std::string, Modality>  Modalities;
+
+    mutable boost::mutex mutex_;
+    boost::condition_variable available_;
+    Modalities modalities_;
     bool continue_;
     boost::posix_time::time_duration timeBeforeClose_;
-    boost::posix_time::ptime lastUse_;
+    boost::posix_time::time_duration timeBeforeRetry_;
+    unsigned int maxConnectionsPerModality_;
     boost::thread closeThread_;
     std::string localAet_;
 
-    void Open(const std::string& remoteAet,
-              const std::string& address,
-              int port,
-              ModalityManufacturer manufacturer);
-    
-    void Close();
+    DicomUserConnection* Acquire(const std::string& remoteAet,
+                                 const std::string& address,
+                                 int port,
+                                 ModalityManufacturer manufacturer);
+
+    void Release(DicomUserConnection* connection,
+                 bool success);
+
+    void CloseIdleConnections(bool all);
 
     static void CloseThread(ReusableDicomUserConnection* that);
 
   protected:
-    virtual void Lock();
+    // Opens a new association. Can be overridden by the unit tests,
+    // so as not to rely on a remote modality.
+    virtual void OpenConnection(DicomUserConnection& connection)
+    {
+      connection.Open();
+    }
 
-    virtual void Unlock();
-    
   public:
-    class Locker : public ::Orthanc::Locker
+    class Locker : public boost::noncopyable
     {
     private:
+      ReusableDicomUserConnection& that_;
       DicomUserConnection* connection_;
 
     public:
@@ -81,6 +125,8 @@ namespace Orthanc
              int port,
              ModalityManufacturer manufacturer);
 
+      ~Locker();
+
       DicomUserConnection& GetConnection();
     };
 
@@ -95,9 +141,23 @@ namespace Orthanc
 
     void SetMillisecondsBeforeClose(uint64_t ms);
 
-    const std::string& GetLocalApplicationEntityTitle() const;
+    unsigned int GetMaxConnectionsPerModality() const
+    {
+      return maxConnectionsPerModality_;
+    }
+
+    void SetMaxConnectionsPerModality(unsigned int count);
+
+    // Delay before opening a new association after a first failure
+    void SetMillisecondsBeforeRetry(uint64_t ms);
+
+    std::string GetLocalApplicationEntityTitle() const;
 
     void SetLocalApplicationEntityTitle(const std::string& aet);
+
+    unsigned int GetConsecutiveFailures(const std::string& remoteAet,
+                                        const std::string& address,
+                                        int port,
+                                        ModalityManufacturer manufacturer) const;
   };
 }
-
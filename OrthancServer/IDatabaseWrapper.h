@@ -37,6 +37,7 @@
 #include "../Core/FileStorage/FileInfo.h"
 #include "IServerIndexListener.h"
 #include "ExportedResource.h"
+#include "ResourceSummary.h"
 
 #include <list>
 #include <boost/noncopyable.hpp>
@@ -79,6 +80,23 @@ namespace Orthanc
     virtual void GetAllPublicIds(std::list<std::string>& target,
                                  ResourceType resourceType) = 0;
 
+    // Lists at most "maxResults" resources, by increasing internal
+    // identifier, starting after the internal identifier "since".
+    // "last" is set to the internal identifier of the last resource.
+    virtual void GetAllPublicIds(std::list<std::string>& target /*out*/,
+                                 int64_t& last /*out*/,
+                                 ResourceType resourceType,
+                                 int64_t since,
+                                 unsigned int maxResults) = 0;
+
+    // Same as the previous method, but returns the summary of each
+    // resource (main DICOM tags, parent and number of descendants)
+    virtual void GetResourcesSummary(std::list<ResourceSummary>& target /*out*/,
+                                     int64_t& last /*out*/,
+                                     ResourceType resourceType,
+                                     int64_t since,
+                                     unsigned int maxResults) = 0;
+
 
     virtual void GetChanges(std::list<ServerIndexChange>& target /*out*/,
                             bool& done /*out*/,
@@ -142,6 +160,18 @@ namespace Orthanc
     virtual void LookupIdentifier(std::list<int64_t>& result,
                                   const std::string& value) = 0;
 
+    virtual void LookupSearchableTag(std::list<int64_t>& result,
+                                     const DicomTag& tag,
+                                     const std::string& lower,
+                                     const std::string& upper) = 0;
+
+    // Case-sensitive range lookup over the values of one identifier
+    // tag. An empty bound means that the range is open on this side.
+    virtual void LookupIdentifierRange(std::list<int64_t>& result,
+                                       const DicomTag& tag,
+                                       const std::string& lower,
+                                       const std::string& upper) = 0;
+
     virtual bool LookupMetadata(std::string& target,
                                 int64_t id,
                                 MetadataType type) = 0;
@@ -175,5 +205,27 @@ namespace Orthanc
     virtual SQLite::ITransaction* StartTransaction() = 0;
 
     virtual void SetListener(IServerIndexListener& listener) = 0;
+
+    /**
+     * Get the number of child studies/series/instances of a resource
+     * (including the resource itself), and the total size of the
+     * files that are attached to this resource and to its
+     * descendants. These statistics are incrementally maintained, so
+     * this is a constant-time operation.
+     **/
+    virtual bool LookupStatistics(/* out */ uint64_t& compressedSize, 
+                                  /* out */ uint64_t& uncompressedSize, 
+                                  /* out */ unsigned int& countStudies, 
+                                  /* out */ unsigned int& countSeries, 
+                                  /* out */ unsigned int& countInstances, 
+                                  /* in  */ int64_t id) = 0;
+
+    /**
+     * Open a new connection to the same database, that will only be
+     * used to run read-only requests, possibly in parallel with other
+     * read-only connections. Returns NULL if the database does not
+     * support concurrent readers (e.g. if it is stored in memory).
+     **/
+    virtual IDatabaseWrapper* OpenReadOnlyConnection() = 0;
   };
 }
@@ -0,0 +1,246 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "PrecompiledHeadersServer.h"
+#include "InstancesIngester.h"
+
+#include <glog/logging.h>
+
+namespace Orthanc
+{
+  void InstancesIngester::Store(StoreStatus& status,
+                                std::string& publicId,
+                                std::string& error,
+                                const std::string& dicom)
+  {
+    try
+    {
+      DicomInstanceToStore toStore;
+      toStore.SetBuffer(dicom);
+      status = context_.Store(publicId, toStore);
+    }
+    catch (OrthancException& e)
+    {
+      status = StoreStatus_Failure;
+      error = e.What();
+    }
+    catch (std::bad_alloc&)
+    {
+      status = StoreStatus_Failure;
+      error = OrthancException(ErrorCode_NotEnoughMemory).What();
+    }
+    catch (std::exception& e)
+    {
+      // E.g. "boost::bad_lexical_cast", or "std::runtime_error"
+      // thrown by jsoncpp or by Lua
+      status = StoreStatus_Failure;
+      error = e.what();
+    }
+    catch (...)
+    {
+      // No exception must escape from the thread, which would
+      // terminate the process: This item is reported as failed
+      status = StoreStatus_Failure;
+      error = OrthancException(ErrorCode_InternalError).What();
+    }
+  }
+
+
+  void InstancesIngester::Worker(InstancesIngester* that)
+  {
+    for (;;)
+    {
+      size_t index;
+      std::string dicom;
+
+      {
+        boost::mutex::scoped_lock lock(that->mutex_);
+
+        while (!that->stopped_ &&
+               that->queue_.empty())
+        {
+          that->itemPosted_.wait(lock);
+        }
+
+        if (that->stopped_)
+        {
+          return;
+        }
+
+        index = that->queue_.front();
+        that->queue_.pop_front();
+        that->running_++;
+        dicom.swap(that->items_[index].dicom_);
+      }
+
+      StoreStatus status;
+      std::string publicId, error;
+      that->Store(status, publicId, error, dicom);
+
+      {
+        boost::mutex::scoped_lock lock(that->mutex_);
+
+        Item& item = that->items_[index];
+        item.status_ = status;
+        item.publicId_.swap(publicId);
+        item.error_.swap(error);
+        that->running_--;
+
+        that->itemStored_.notify_all();
+      }
+    }
+  }
+
+
+  InstancesIngester::InstancesIngester(ServerContext& context,
+                                       unsigned int threadsCount,
+                                       unsigned int maxPending) :
+    context_(context),
+    maxPending_(maxPending > 0 ? maxPending : 1),
+    running_(0),
+    stopped_(false),
+    joined_(false)
+  {
+    workers_.reserve(threadsCount);
+    for (unsigned int i = 0; i < threadsCount; i++)
+    {
+      workers_.push_back(new boost::thread(Worker, this));
+    }
+  }
+
+
+  InstancesIngester::~InstancesIngester()
+  {
+    {
+      // The instances that are still queued are dropped
+      boost::mutex::scoped_lock lock(mutex_);
+      stopped_ = true;
+      itemPosted_.notify_all();
+    }
+
+    for (size_t i = 0; i < workers_.size(); i++)
+    {
+      workers_[i]->join();
+      delete workers_[i];
+    }
+  }
+
+
+  void InstancesIngester::Post(const std::string& name,
+                               std::string& dicom)
+  {
+    if (joined_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (workers_.empty())
+    {
+      // No worker thread: Synchronous store
+      items_.push_back(Item());
+      Item& item = items_.back();
+      item.name_ = name;
+      Store(item.status_, item.publicId_, item.error_, dicom);
+      dicom.clear();
+      return;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    // Do not run too far ahead of the worker threads
+    while (queue_.size() + running_ >= maxPending_)
+    {
+      itemStored_.wait(lock);
+    }
+
+    items_.push_back(Item());
+    items_.back().name_ = name;
+    items_.back().status_ = StoreStatus_Failure;
+    items_.back().dicom_.swap(dicom);
+    dicom.clear();
+
+    queue_.push_back(items_.size() - 1);
+    itemPosted_.notify_one();
+  }
+
+
+  void InstancesIngester::PostFailure(const std::string& name,
+                                      const std::string& error)
+  {
+    if (joined_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    // The items are concurrently accessed by the worker threads
+    boost::mutex::scoped_lock lock(mutex_);
+
+    items_.push_back(Item());
+    items_.back().name_ = name;
+    items_.back().status_ = StoreStatus_Failure;
+    items_.back().error_ = error;
+  }
+
+
+  void InstancesIngester::Join()
+  {
+    if (!workers_.empty())
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      while (!queue_.empty() ||
+             running_ > 0)
+      {
+        itemStored_.wait(lock);
+      }
+    }
+
+    joined_ = true;
+  }
+
+
+  const InstancesIngester::Item& InstancesIngester::GetItem(size_t index) const
+  {
+    if (!joined_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    if (index >= items_.size())
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    return items_[index];
+  }
+}
@@ -0,0 +1,141 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include "ServerContext.h"
+
+#include <deque>
+#include <vector>
+#include <boost/thread.hpp>
+
+namespace Orthanc
+{
+  /**
+   * Stores a batch of DICOM instances that are received together
+   * (e.g. inside a ZIP archive), by running a pool of threads. The
+   * concurrent stores are grouped into the same database transactions
+   * by the index (cf. "IndexGroupCommitSize"). At most "maxPending"
+   * instances that have been posted but not stored yet are kept in
+   * memory: "Post()" blocks while this limit is reached. If no thread
+   * is requested, the instances are synchronously stored by "Post()".
+   **/
+  class InstancesIngester : public boost::noncopyable
+  {
+  private:
+    struct Item
+    {
+      std::string  name_;
+      std::string  dicom_;
+      StoreStatus  status_;
+      std::string  publicId_;
+      std::string  error_;
+    };
+
+    ServerContext& context_;
+    std::vector<Item> items_;
+    std::deque<size_t> queue_;
+    size_t maxPending_;
+    size_t running_;
+    bool stopped_;
+    bool joined_;
+
+    boost::mutex mutex_;
+    boost::condition_variable itemPosted_;
+    boost::condition_variable itemStored_;
+    std::vector<boost::thread*> workers_;
+
+    static void Worker(InstancesIngester* that);
+
+    void Store(StoreStatus& status,
+               std::string& publicId,
+               std::string& error,
+               const std::string& dicom);
+
+    const Item& GetItem(size_t index) const;
+
+  public:
+    InstancesIngester(ServerContext& context,
+                      unsigned int threadsCount,
+                      unsigned int maxPending);
+
+    ~InstancesIngester();
+
+    /**
+     * The content of "dicom" is moved into the ingester (the string
+     * is left empty).
+     **/
+    void Post(const std::string& name,
+              std::string& dicom);
+
+    /**
+     * Records an instance that could not even be extracted from the
+     * request (e.g. a corrupted entry of a ZIP archive), so that it
+     * is reported as a failure together with the stored instances.
+     **/
+    void PostFailure(const std::string& name,
+                     const std::string& error);
+
+    /**
+     * Waits for all the posted instances to be stored. The results
+     * can only be accessed once this method has returned, and no
+     * instance can be posted afterwards.
+     **/
+    void Join();
+
+    size_t GetSize() const
+    {
+      return items_.size();
+    }
+
+    const std::string& GetName(size_t index) const
+    {
+      return GetItem(index).name_;
+    }
+
+    StoreStatus GetStatus(size_t index) const
+    {
+      return GetItem(index).status_;
+    }
+
+    const std::string& GetPublicId(size_t index) const
+    {
+      return GetItem(index).publicId_;
+    }
+
+    const std::string& GetError(size_t index) const
+    {
+      return GetItem(index).error_;
+    }
+  };
+}
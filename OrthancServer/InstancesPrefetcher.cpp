@@ -0,0 +1,209 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "PrecompiledHeadersServer.h"
+#include "InstancesPrefetcher.h"
+
+#include <glog/logging.h>
+
+namespace Orthanc
+{
+  void InstancesPrefetcher::Worker(InstancesPrefetcher* that)
+  {
+    for (;;)
+    {
+      size_t index;
+
+      {
+        boost::mutex::scoped_lock lock(that->mutex_);
+
+        // Do not run too far ahead of the consumer
+        while (!that->stopped_ &&
+               that->nextToRead_ < that->instances_.size() &&
+               that->nextToRead_ >= that->nextToReturn_ + that->maxPending_)
+        {
+          that->slotConsumed_.wait(lock);
+        }
+
+        if (that->stopped_ ||
+            that->nextToRead_ >= that->instances_.size())
+        {
+          return;
+        }
+
+        index = that->nextToRead_++;
+      }
+
+      std::string content;
+      ErrorCode error = ErrorCode_Success;
+      std::string what;
+
+      try
+      {
+        that->context_.ReadFile(content, that->instances_[index], FileContentType_Dicom);
+      }
+      catch (OrthancException& e)
+      {
+        error = e.GetErrorCode();
+        what = e.What();
+      }
+      catch (std::bad_alloc&)
+      {
+        error = ErrorCode_NotEnoughMemory;
+      }
+      catch (std::exception& e)
+      {
+        // E.g. "boost::filesystem_error" or "std::runtime_error"
+        error = ErrorCode_Custom;
+        what = e.what();
+      }
+      catch (...)
+      {
+        // No exception must escape from the thread, which would
+        // terminate the process: The consumer is notified instead
+        error = ErrorCode_InternalError;
+      }
+
+      {
+        boost::mutex::scoped_lock lock(that->mutex_);
+
+        Slot& slot = that->slots_[index];
+        if (error == ErrorCode_Success)
+        {
+          slot.content_.swap(content);
+          slot.status_ = SlotStatus_Ready;
+        }
+        else
+        {
+          slot.error_ = error;
+          slot.what_ = what;
+          slot.status_ = SlotStatus_Failure;
+        }
+
+        that->slotReady_.notify_all();
+      }
+    }
+  }
+
+
+  InstancesPrefetcher::InstancesPrefetcher(ServerContext& context,
+                                           const std::vector<std::string>& instances,
+                                           unsigned int threadsCount,
+                                           unsigned int maxPending) :
+    context_(context),
+    instances_(instances),
+    slots_(instances.size()),
+    maxPending_(maxPending > 0 ? maxPending : 1),
+    nextToRead_(0),
+    nextToReturn_(0),
+    stopped_(false)
+  {
+    if (threadsCount > instances.size())
+    {
+      threadsCount = instances.size();
+    }
+
+    workers_.reserve(threadsCount);
+    for (unsigned int i = 0; i < threadsCount; i++)
+    {
+      workers_.push_back(new boost::thread(Worker, this));
+    }
+  }
+
+
+  InstancesPrefetcher::~InstancesPrefetcher()
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      stopped_ = true;
+      slotConsumed_.notify_all();
+    }
+
+    for (size_t i = 0; i < workers_.size(); i++)
+    {
+      workers_[i]->join();
+      delete workers_[i];
+    }
+  }
+
+
+  bool InstancesPrefetcher::ReadNext(std::string& dicom)
+  {
+    if (workers_.empty())
+    {
+      // No worker thread: Synchronous read
+      if (nextToReturn_ >= instances_.size())
+      {
+        return false;
+      }
+
+      context_.ReadFile(dicom, instances_[nextToReturn_], FileContentType_Dicom);
+      nextToReturn_++;
+      return true;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (nextToReturn_ >= instances_.size())
+    {
+      return false;
+    }
+
+    Slot& slot = slots_[nextToReturn_];
+    while (slot.status_ == SlotStatus_Pending)
+    {
+      slotReady_.wait(lock);
+    }
+
+    nextToReturn_++;
+    slotConsumed_.notify_all();
+
+    if (slot.status_ == SlotStatus_Failure)
+    {
+      LOG(ERROR) << "Cannot read instance " << instances_[nextToReturn_ - 1];
+
+      if (slot.error_ == ErrorCode_Custom)
+      {
+        throw OrthancException(slot.what_);
+      }
+      else
+      {
+        throw OrthancException(slot.error_);
+      }
+    }
+
+    dicom.clear();
+    dicom.swap(slot.content_);
+    return true;
+  }
+}
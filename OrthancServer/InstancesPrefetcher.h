@@ -0,0 +1,108 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include "ServerContext.h"
+
+#include <vector>
+#include <boost/thread.hpp>
+
+namespace Orthanc
+{
+  /**
+   * Reads (and uncompresses) an ordered list of DICOM instances from
+   * the storage area, by running a pool of threads ahead of the
+   * consumer. The instances are returned in the order of the list,
+   * and at most "maxPending" instances that have been read but not
+   * consumed yet are kept in memory. If no thread is requested, the
+   * instances are synchronously read by "ReadNext()".
+   **/
+  class InstancesPrefetcher : public boost::noncopyable
+  {
+  private:
+    enum SlotStatus
+    {
+      SlotStatus_Pending,
+      SlotStatus_Ready,
+      SlotStatus_Failure
+    };
+
+    struct Slot
+    {
+      SlotStatus  status_;
+      std::string content_;
+      ErrorCode   error_;
+      std::string what_;
+
+      Slot() : status_(SlotStatus_Pending), error_(ErrorCode_Success)
+      {
+      }
+    };
+
+    ServerContext& context_;
+    std::vector<std::string> instances_;
+    std::vector<Slot> slots_;
+    size_t maxPending_;
+    size_t nextToRead_;
+    size_t nextToReturn_;
+    bool stopped_;
+
+    boost::mutex mutex_;
+    boost::condition_variable slotReady_;
+    boost::condition_variable slotConsumed_;
+    std::vector<boost::thread*> workers_;
+
+    static void Worker(InstancesPrefetcher* that);
+
+  public:
+    InstancesPrefetcher(ServerContext& context,
+                        const std::vector<std::string>& instances,
+                        unsigned int threadsCount,
+                        unsigned int maxPending);
+
+    ~InstancesPrefetcher();
+
+    size_t GetSize() const
+    {
+      return instances_.size();
+    }
+
+    /**
+     * Returns "false" once all the instances have been read. Throws
+     * the exception that was raised while reading the instance, if
+     * any.
+     **/
+    bool ReadNext(std::string& dicom);
+  };
+}
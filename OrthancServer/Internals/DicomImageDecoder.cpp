@@ -84,6 +84,7 @@
 #include "../../Core/ImageFormats/ImageProcessing.h"
 #include "../../Core/ImageFormats/PngWriter.h"  // TODO REMOVE THIS
 #include "../../Core/DicomFormat/DicomIntegerPixelAccessor.h"
+#include "../../Core/Toolbox.h"
 #include "../ToDcmtkBridge.h"
 #include "../FromDcmtkBridge.h"
 
@@ -104,6 +105,38 @@ namespace Orthanc
   static const DicomTag DICOM_TAG_COMPRESSION_TYPE(0x07a1, 0x1011);
 
 
+  static bool ReadFirstFloat(float& result,
+                             const DicomMap& values,
+                             const DicomTag& tag)
+  {
+    // Multi-valued tags (such as "Window Center") are separated by backslashes
+    const DicomValue* value = values.TestAndGetValue(tag);
+    if (value == NULL ||
+        value->IsNull())
+    {
+      return false;
+    }
+
+    std::vector<std::string> tokens;
+    Toolbox::TokenizeString(tokens, value->AsString(), '\\');
+
+    if (tokens.empty())
+    {
+      return false;
+    }
+
+    try
+    {
+      result = boost::lexical_cast<float>(Toolbox::StripSpaces(tokens[0]));
+      return true;
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+      return false;
+    }
+  }
+
+
   static bool IsJpegLossless(const DcmDataset& dataset)
   {
     // http://support.dcmtk.org/docs/dcxfer_8h-source.html
@@ -341,39 +374,6 @@ namespace Orthanc
   }
 
 
-  template <typename PixelType>
-  static void CopyPixels(ImageAccessor& target,
-                         const DicomIntegerPixelAccessor& source)
-  {
-    const PixelType minValue = std::numeric_limits<PixelType>::min();
-    const PixelType maxValue = std::numeric_limits<PixelType>::max();
-
-    for (unsigned int y = 0; y < source.GetInformation().GetHeight(); y++)
-    {
-      PixelType* pixel = reinterpret_cast<PixelType*>(target.GetRow(y));
-      for (unsigned int x = 0; x < source.GetInformation().GetWidth(); x++)
-      {
-        for (unsigned int c = 0; c < source.GetInformation().GetChannelCount(); c++, pixel++)
-        {
-          int32_t v = source.GetValue(x, y, c);
-          if (v < static_cast<int32_t>(minValue))
-          {
-            *pixel = minValue;
-          }
-          else if (v > static_cast<int32_t>(maxValue))
-          {
-            *pixel = maxValue;
-          }
-          else
-          {
-            *pixel = static_cast<PixelType>(v);
-          }
-        }
-      }
-    }
-  }
-
-
   void DicomImageDecoder::DecodeUncompressedImage(ImageBuffer& target,
                                                   DcmDataset& dataset,
                                                   unsigned int frame)
@@ -447,31 +447,15 @@ namespace Orthanc
     }
 
     /**
-     * Slow version : loop over the DICOM buffer, storing its value
-     * into the target image.
+     * Slow version (e.g. planar images): Decode the DICOM buffer into
+     * the target image, using the inner loops that are specialized
+     * for the layout of the pixel data. This gives the same result as
+     * a loop over "DicomIntegerPixelAccessor::GetValue()".
      **/
 
     if (!fastVersionSuccess)
     {
-      switch (target.GetFormat())
-      {
-        case PixelFormat_RGB24:
-        case PixelFormat_RGBA32:
-        case PixelFormat_Grayscale8:
-          CopyPixels<uint8_t>(targetAccessor, source.GetAccessor());
-          break;
-        
-        case PixelFormat_Grayscale16:
-          CopyPixels<uint16_t>(targetAccessor, source.GetAccessor());
-          break;
-
-        case PixelFormat_SignedGrayscale16:
-          CopyPixels<int16_t>(targetAccessor, source.GetAccessor());
-          break;
-
-        default:
-          throw OrthancException(ErrorCode_InternalError);
-      }
+      source.GetAccessor().ExtractFrame(targetAccessor);
     }
   }
 
@@ -696,4 +680,113 @@ namespace Orthanc
         throw OrthancException(ErrorCode_NotImplemented);
     }
   }
+
+
+  bool DicomImageDecoder::DecodeRendered(ImageBuffer& target,
+                                         DcmDataset& dataset,
+                                         unsigned int frame,
+                                         const RenderingParameters& parameters)
+  {
+    ImageBuffer source;
+    if (!Decode(source, dataset, frame))
+    {
+      return false;
+    }
+
+    unsigned int width, height;
+    parameters.ComputeTargetSize(width, height, source.GetWidth(), source.GetHeight());
+
+    // Downscale before windowing, so that the cost of the windowing
+    // is proportional to the size of the rendered image
+    ImageBuffer resized;
+    ImageAccessor resizedAccessor;
+
+    if (width == source.GetWidth() &&
+        height == source.GetHeight())
+    {
+      resizedAccessor = source.GetConstAccessor();
+    }
+    else
+    {
+      resized.SetFormat(source.GetFormat());
+      resized.SetWidth(width);
+      resized.SetHeight(height);
+      resizedAccessor = resized.GetAccessor();
+      ImageProcessing::Downscale(resizedAccessor, source.GetConstAccessor());
+    }
+
+    switch (source.GetFormat())
+    {
+      case PixelFormat_RGB24:
+      {
+        // No windowing for color images
+        if (width == source.GetWidth() &&
+            height == source.GetHeight())
+        {
+          target.AcquireOwnership(source);
+        }
+        else
+        {
+          target.AcquireOwnership(resized);
+        }
+
+        return true;
+      }
+
+      case PixelFormat_Grayscale8:
+      case PixelFormat_Grayscale16:
+      case PixelFormat_SignedGrayscale16:
+      {
+        DicomMap m;
+        FromDcmtkBridge::Convert(m, dataset);
+
+        float slope, intercept;
+        if (!ReadFirstFloat(slope, m, DICOM_TAG_RESCALE_SLOPE) ||
+            !ReadFirstFloat(intercept, m, DICOM_TAG_RESCALE_INTERCEPT))
+        {
+          slope = 1.0f;
+          intercept = 0.0f;
+        }
+
+        float center, windowWidth;
+        if (parameters.HasWindowing())
+        {
+          center = parameters.GetWindowCenter();
+          windowWidth = parameters.GetWindowWidth();
+        }
+        else if (!ReadFirstFloat(center, m, DICOM_TAG_WINDOW_CENTER) ||
+                 !ReadFirstFloat(windowWidth, m, DICOM_TAG_WINDOW_WIDTH) ||
+                 windowWidth < 1.0f)
+        {
+          // No valid window in the DICOM instance: Stretch the full
+          // dynamics of the rescaled values to the [0,255] range
+          int64_t a, b;
+          ImageProcessing::GetMinMaxValue(a, b, resizedAccessor);
+
+          float x = static_cast<float>(a) * slope + intercept;
+          float y = static_cast<float>(b) * slope + intercept;
+          float low = std::min(x, y);
+          float high = std::max(x, y);
+
+          center = (low + high + 1.0f) / 2.0f;
+          windowWidth = high - low + 1.0f;
+        }
+
+        DicomImageInformation info(m);
+
+        target.SetFormat(PixelFormat_Grayscale8);
+        target.SetWidth(width);
+        target.SetHeight(height);
+
+        ImageAccessor targetAccessor(target.GetAccessor());
+        ImageProcessing::ApplyWindowing(targetAccessor, resizedAccessor, center, windowWidth, slope, intercept,
+                                        info.GetPhotometricInterpretation() == PhotometricInterpretation_Monochrome1);
+
+        return true;
+      }
+
+      default:
+        throw OrthancException(ErrorCode_NotImplemented);
+    }
+  }
 }
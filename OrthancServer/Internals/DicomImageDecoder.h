@@ -35,6 +35,7 @@
 #include <dcmtk/dcmdata/dcfilefo.h>
 
 #include "../../Core/ImageFormats/ImageBuffer.h"
+#include "../RenderingParameters.h"
 
 namespace Orthanc
 {
@@ -78,5 +79,17 @@ namespace Orthanc
     static bool DecodePreview(ImageBuffer& target,
                               DcmDataset& dataset,
                               unsigned int frame);
+
+    /**
+     * Renders a frame as an 8bpp image for display: The image is
+     * first downscaled according to "parameters", then the rescale
+     * slope/intercept and the window of "parameters" (or, by default,
+     * those of the DICOM instance) are applied. Color images are only
+     * downscaled.
+     **/
+    static bool DecodeRendered(ImageBuffer& target,
+                               DcmDataset& dataset,
+                               unsigned int frame,
+                               const RenderingParameters& parameters);
   };
 }
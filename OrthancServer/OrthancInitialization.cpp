@@ -723,7 +723,11 @@ namespace Orthanc
     {
     }
 
-    return new DatabaseWrapper(indexDirectory.string() + "/index");
+    // The exclusive locking of the SQLite file is only relaxed if
+    // concurrent readers are enabled
+    bool allowReadOnlyConnections = (Configuration::GetGlobalIntegerParameter("IndexReadConnections", 4) > 0);
+
+    return new DatabaseWrapper(indexDirectory.string() + "/index", allowReadOnlyConnections);
   }
 
 
@@ -752,6 +756,16 @@ namespace Orthanc
         }
       }
 
+      virtual void CreateFromFile(const std::string& uuid,
+                                  const std::string& path,
+                                  FileContentType type)
+      {
+        if (type != FileContentType_Dicom)
+        {
+          storage_.CreateFromFile(uuid, path, type);
+        }
+      }
+
       virtual void Read(std::string& content,
                         const std::string& uuid,
                         FileContentType type)
@@ -807,4 +821,21 @@ namespace Orthanc
   {
     return CreateFilesystemStorage();
   }  
+
+
+  PreviewCache* Configuration::CreatePreviewCache()
+  {
+    int size = Configuration::GetGlobalIntegerParameter("PreviewCacheSize", 128);
+    if (size <= 0)
+    {
+      LOG(WARNING) << "The preview cache is disabled";
+      return NULL;
+    }
+
+    std::string storageDirectoryStr = Configuration::GetGlobalStringParameter("StorageDirectory", "OrthancStorage");
+    boost::filesystem::path previewsDirectory = Configuration::InterpretStringParameterAsPath(
+      Configuration::GetGlobalStringParameter("PreviewCacheDirectory", storageDirectoryStr + "/previews"));
+
+    return new PreviewCache(previewsDirectory.string(), static_cast<uint64_t>(size) * 1024 * 1024);
+  }
 }
@@ -42,6 +42,7 @@
 #include "OrthancPeerParameters.h"
 #include "IDatabaseWrapper.h"
 #include "../Core/FileStorage/IStorageArea.h"
+#include "PreviewCache.h"
 
 namespace Orthanc
 {
@@ -108,5 +109,8 @@ namespace Orthanc
     static IDatabaseWrapper* CreateDatabaseWrapper();
 
     static IStorageArea* CreateStorageArea();
+
+    // Returns NULL if the preview cache is disabled
+    static PreviewCache* CreatePreviewCache();
   };
 }
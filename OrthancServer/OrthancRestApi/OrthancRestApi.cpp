@@ -34,6 +34,10 @@
 #include "OrthancRestApi.h"
 
 #include "../DicomModification.h"
+#include "../InstancesIngester.h"
+#include "../OrthancInitialization.h"
+#include "../../Core/Compression/ZipReader.h"
+#include "../../Core/MultipartRelatedReader.h"
 
 #include <glog/logging.h>
 
@@ -68,20 +72,188 @@ namespace Orthanc
 
   // Upload of DICOM files through HTTP ---------------------------------------
 
+  static bool IsDicomDir(const std::string& path)
+  {
+    // The DICOMDIR of a DICOM media is not an instance to be stored
+    std::string name = path.substr(path.find_last_of("/\\") + 1);
+    Toolbox::ToUpperCase(name);
+    return name == "DICOMDIR";
+  }
+
+
+  static void ReadZipArchive(InstancesIngester& ingester,
+                             ZipReader& archive)
+  {
+    for (size_t i = 0; i < archive.GetFilesCount(); i++)
+    {
+      if (!archive.IsDirectory(i) &&
+          archive.GetUncompressedSize(i) != 0 &&
+          !IsDicomDir(archive.GetFileName(i)))
+      {
+        // A corrupted entry is reported as a failure, like the
+        // entries that cannot be stored, without aborting the upload
+        std::string dicom;
+
+        try
+        {
+          archive.ReadFile(dicom, i);
+        }
+        catch (OrthancException& e)
+        {
+          LOG(ERROR) << "Cannot extract \"" << archive.GetFileName(i)
+                     << "\" from the ZIP archive: " << e.What();
+          ingester.PostFailure(archive.GetFileName(i), e.What());
+          continue;
+        }
+
+        ingester.Post(archive.GetFileName(i), dicom);
+      }
+    }
+  }
+
+
+  static unsigned int GetBulkIngestThreads()
+  {
+    // Each upload uses its own threads: Bound their number, as
+    // several uploads might be running concurrently
+    static const int MAX_BULK_INGEST_THREADS = 16;
+
+    int count = Configuration::GetGlobalIntegerParameter("BulkIngestThreads", 4);
+    if (count < 0 ||
+        count > MAX_BULK_INGEST_THREADS)
+    {
+      int clamped = (count < 0 ? 0 : MAX_BULK_INGEST_THREADS);
+      LOG(WARNING) << "Invalid value for \"BulkIngestThreads\" (" << count
+                   << "), using " << clamped << " thread(s)";
+      count = clamped;
+    }
+
+    return static_cast<unsigned int>(count);
+  }
+
+
+  static void UploadBulk(RestApiPostCall& call,
+                         const std::string& boundary)  // Empty for ZIP archives
+  {
+    ServerContext& context = OrthancRestApi::GetContext(call);
+
+    // The instances are extracted from the body in this thread, while
+    // they are concurrently stored by the ingester
+    unsigned int threadsCount = GetBulkIngestThreads();
+    InstancesIngester ingester(context, threadsCount, 2 * threadsCount);
+
+    if (boundary.empty())
+    {
+      ZipReader archive;
+
+      if (call.HasPostBodyFile())
+      {
+        // Only the entry being extracted is loaded into memory
+        archive.OpenFile(call.GetPostBodyFile().GetPath());
+      }
+      else
+      {
+        archive.OpenMemory(call.GetPostBody());
+      }
+
+      LOG(INFO) << "Receiving a ZIP archive with " << archive.GetFilesCount() << " entries through HTTP";
+      ReadZipArchive(ingester, archive);
+    }
+    else
+    {
+      MultipartRelatedReader reader(call.GetPostBody(), boundary);
+
+      LOG(INFO) << "Receiving " << reader.GetPartsCount() << " DICOM files through HTTP (multipart/related)";
+
+      for (size_t i = 0; i < reader.GetPartsCount(); i++)
+      {
+        if (reader.GetSize(i) != 0)
+        {
+          std::string dicom;
+          reader.GetPart(dicom, i);
+          ingester.Post("", dicom);
+        }
+      }
+    }
+
+    ingester.Join();
+
+    Json::Value result = Json::arrayValue;
+    for (size_t i = 0; i < ingester.GetSize(); i++)
+    {
+      Json::Value item = Json::objectValue;
+
+      if (!ingester.GetName(i).empty())
+      {
+        item["Name"] = ingester.GetName(i);
+      }
+
+      StoreStatus status = ingester.GetStatus(i);
+      if (status == StoreStatus_Failure)
+      {
+        item["Error"] = ingester.GetError(i);
+      }
+      else
+      {
+        item["ID"] = ingester.GetPublicId(i);
+        item["Path"] = GetBasePath(ResourceType_Instance, ingester.GetPublicId(i));
+      }
+
+      item["Status"] = EnumerationToString(status);
+      result.append(item);
+    }
+
+    call.GetOutput().AnswerJson(result);
+  }
+
+
   static void UploadDicomFile(RestApiPostCall& call)
   {
     ServerContext& context = OrthancRestApi::GetContext(call);
 
-    const std::string& postData = call.GetPostBody();
-    if (postData.size() == 0)
+    // Bulk uploads are recognized by their content type
+    std::string contentType = call.GetHttpHeader("content-type", "");
+    std::string mime;
+    Toolbox::ToLowerCase(mime, Toolbox::StripSpaces(contentType.substr(0, contentType.find(';'))));
+
+    std::string boundary;
+    if (mime == "application/zip")
     {
+      UploadBulk(call, "");
+      return;
+    }
+    else if (MultipartRelatedReader::ParseContentType(boundary, contentType))
+    {
+      UploadBulk(call, boundary);
       return;
     }
-
-    LOG(INFO) << "Receiving a DICOM file of " << postData.size() << " bytes through HTTP";
 
     DicomInstanceToStore toStore;
-    toStore.SetBuffer(postData);
+
+    if (call.HasPostBodyFile())
+    {
+      // Large upload that was streamed to a temporary file by the
+      // HTTP server: Store it without reading it into memory
+      const HttpUploadedFile& file = call.GetPostBodyFile();
+      if (file.GetSize() == 0)
+      {
+        return;
+      }
+
+      LOG(INFO) << "Receiving a DICOM file of " << file.GetSize() << " bytes through HTTP (streamed to the disk)";
+      toStore.SetFile(file.GetPath(), file.GetSize(), file.GetMD5());
+    }
+    else
+    {
+      const std::string& postData = call.GetPostBody();
+      if (postData.size() == 0)
+      {
+        return;
+      }
+
+      LOG(INFO) << "Receiving a DICOM file of " << postData.size() << " bytes through HTTP";
+      toStore.SetBuffer(postData);
+    }
 
     std::string publicId;
     StoreStatus status = context.Store(publicId, toStore);
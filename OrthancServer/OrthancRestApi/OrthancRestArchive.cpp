@@ -34,8 +34,9 @@
 #include "OrthancRestApi.h"
 
 #include "../DicomDirWriter.h"
+#include "../InstancesPrefetcher.h"
+#include "../OrthancInitialization.h"
 #include "../../Core/Compression/HierarchicalZipWriter.h"
-#include "../../Core/HttpServer/FilesystemHttpSender.h"
 #include "../../Core/Uuid.h"
 
 #include <glog/logging.h>
@@ -89,7 +90,111 @@ namespace Orthanc
     return Toolbox::ConvertToAscii(s);
   }
 
-  static bool CreateRootDirectoryInArchive(HierarchicalZipWriter& writer,
+  namespace
+  {
+    /**
+     * Records the operations on the ZIP writer while the hierarchy of
+     * resources is walked, so that the full list of instances is known
+     * (and can be prefetched) before the archive is created.
+     **/
+    class ArchiveCommands : public boost::noncopyable
+    {
+    private:
+      enum Type
+      {
+        Type_OpenDirectory,
+        Type_CloseDirectory,
+        Type_WriteInstance
+      };
+
+      struct Command
+      {
+        Type         type_;
+        std::string  name_;
+
+        Command(Type type,
+                const std::string& name) :
+          type_(type),
+          name_(name)
+        {
+        }
+      };
+
+      std::vector<Command>      commands_;
+      std::vector<std::string>  instances_;
+
+    public:
+      void OpenDirectory(const char* name)
+      {
+        commands_.push_back(Command(Type_OpenDirectory, name));
+      }
+
+      void CloseDirectory()
+      {
+        commands_.push_back(Command(Type_CloseDirectory, ""));
+      }
+
+      void WriteInstance(const char* filename,
+                         const std::string& instancePublicId)
+      {
+        commands_.push_back(Command(Type_WriteInstance, filename));
+        instances_.push_back(instancePublicId);
+      }
+
+      const std::vector<std::string>& GetInstances() const
+      {
+        return instances_;
+      }
+
+      void Apply(HierarchicalZipWriter& writer,
+                 InstancesPrefetcher& prefetcher) const
+      {
+        for (size_t i = 0; i < commands_.size(); i++)
+        {
+          switch (commands_[i].type_)
+          {
+            case Type_OpenDirectory:
+              writer.OpenDirectory(commands_[i].name_.c_str());
+              break;
+
+            case Type_CloseDirectory:
+              writer.CloseDirectory();
+              break;
+
+            case Type_WriteInstance:
+            {
+              std::string dicom;
+              if (!prefetcher.ReadNext(dicom))
+              {
+                throw OrthancException(ErrorCode_InternalError);
+              }
+
+              writer.OpenFile(commands_[i].name_.c_str());
+              writer.Write(dicom);
+              break;
+            }
+
+            default:
+              throw OrthancException(ErrorCode_InternalError);
+          }
+        }
+      }
+    };
+  }
+
+
+  static void GetArchiveThreads(unsigned int& threadsCount,
+                                unsigned int& maxPending)
+  {
+    int threads = Configuration::GetGlobalIntegerParameter("ArchiveThreads", 4);
+    threadsCount = (threads > 0 ? static_cast<unsigned int>(threads) : 0);
+
+    // Bound the memory used by the instances that are read in advance
+    maxPending = 2 * threadsCount;
+  }
+
+
+  static bool CreateRootDirectoryInArchive(ArchiveCommands& commands,
                                            ServerContext& context,
                                            const Json::Value& resource,
                                            ResourceType resourceType)
@@ -116,7 +221,7 @@ namespace Orthanc
         
       case ResourceType_Series:
         if (!context.GetIndex().LookupResource(parent, resource["ParentStudy"].asString(), parentType) ||
-            !CreateRootDirectoryInArchive(writer, context, parent, parentType))
+            !CreateRootDirectoryInArchive(commands, context, parent, parentType))
         {
           return false;
         }
@@ -126,25 +231,11 @@ namespace Orthanc
         throw OrthancException(ErrorCode_NotImplemented);
     }
 
-    writer.OpenDirectory(GetDirectoryNameInArchive(parent, parentType).c_str());
+    commands.OpenDirectory(GetDirectoryNameInArchive(parent, parentType).c_str());
     return true;
   }
 
-  static bool ArchiveInstance(HierarchicalZipWriter& writer,
-                              ServerContext& context,
-                              const std::string& instancePublicId,
-                              const char* filename)
-  {
-    writer.OpenFile(filename);
-
-    std::string dicom;
-    context.ReadFile(dicom, instancePublicId, FileContentType_Dicom);
-    writer.Write(dicom);
-
-    return true;
-  }
-
-  static bool ArchiveInternal(HierarchicalZipWriter& writer,
+  static bool ArchiveInternal(ArchiveCommands& commands,
                               ServerContext& context,
                               const std::string& publicId,
                               ResourceType resourceType,
@@ -157,12 +248,12 @@ namespace Orthanc
     }    
 
     if (isFirstLevel && 
-        !CreateRootDirectoryInArchive(writer, context, resource, resourceType))
+        !CreateRootDirectoryInArchive(commands, context, resource, resourceType))
     {
       return false;
     }
 
-    writer.OpenDirectory(GetDirectoryNameInArchive(resource, resourceType).c_str());
+    commands.OpenDirectory(GetDirectoryNameInArchive(resource, resourceType).c_str());
 
     switch (resourceType)
     {
@@ -170,7 +261,7 @@ namespace Orthanc
         for (Json::Value::ArrayIndex i = 0; i < resource["Studies"].size(); i++)
         {
           std::string studyId = resource["Studies"][i].asString();
-          if (!ArchiveInternal(writer, context, studyId, ResourceType_Study, false))
+          if (!ArchiveInternal(commands, context, studyId, ResourceType_Study, false))
           {
             return false;
           }
@@ -181,7 +272,7 @@ namespace Orthanc
         for (Json::Value::ArrayIndex i = 0; i < resource["Series"].size(); i++)
         {
           std::string seriesId = resource["Series"][i].asString();
-          if (!ArchiveInternal(writer, context, seriesId, ResourceType_Series, false))
+          if (!ArchiveInternal(commands, context, seriesId, ResourceType_Series, false))
           {
             return false;
           }
@@ -218,10 +309,7 @@ namespace Orthanc
           // This was the implementation up to Orthanc 0.7.0:
           // std::string filename = instance["MainDicomTags"]["SOPInstanceUID"].asString() + ".dcm";
 
-          if (!ArchiveInstance(writer, context, publicId, filename))
-          {
-            return false;
-          }
+          commands.WriteInstance(filename, publicId);
         }
 
         break;
@@ -231,7 +319,7 @@ namespace Orthanc
         throw OrthancException(ErrorCode_InternalError);
     }
 
-    writer.CloseDirectory();
+    commands.CloseDirectory();
     return true;
   }                                 
 
@@ -264,38 +352,69 @@ namespace Orthanc
   }
                               
 
+  namespace
+  {
+    // Sends the ZIP archive as the body of the HTTP answer, while it
+    // is being created
+    class HttpZipStream : public ZipWriter::IOutputStream
+    {
+    private:
+      HttpOutput& output_;
+
+    public:
+      HttpZipStream(RestApiOutput& output,
+                    const std::string& filename) :
+        output_(output.GetLowLevelOutput())
+      {
+        output_.SetContentFilename(filename.c_str());
+        output_.StartStream("application/zip");
+        output.MarkLowLevelOutputDone();
+      }
+
+      virtual void Write(const std::string& chunk)
+      {
+        output_.SendStreamItem(chunk);
+      }
+
+      virtual void Close()
+      {
+        output_.CloseStream();
+      }
+    };
+  }
+
+
   template <enum ResourceType resourceType>
   static void GetArchive(RestApiGetCall& call)
   {
     ServerContext& context = OrthancRestApi::GetContext(call);
 
     std::string id = call.GetUriComponent("id", "");
-    bool isZip64 = IsZip64Required(context.GetIndex(), id);
-
-    // Create a RAII for the temporary file to manage the ZIP file
-    Toolbox::TemporaryFile tmp;
 
+    // Walk the hierarchy of the requested resource, before the HTTP
+    // header is sent
+    ArchiveCommands commands;
+    if (!ArchiveInternal(commands, context, id, resourceType, true))
     {
-      // Create a ZIP writer
-      HierarchicalZipWriter writer(tmp.GetPath().c_str());
-      writer.SetZip64(isZip64);
-
-      // Store the requested resource into the ZIP
-      if (!ArchiveInternal(writer, context, id, resourceType, true))
-      {
-        return;
-      }
+      return;
     }
 
-    // Prepare the sending of the ZIP file
-    FilesystemHttpSender sender(tmp.GetPath().c_str());
-    sender.SetContentType("application/zip");
-    sender.SetDownloadFilename(id + ".zip");
+    bool isZip64 = IsZip64Required(context.GetIndex(), id);
+
+    // Start reading the instances in the background
+    unsigned int threadsCount, maxPending;
+    GetArchiveThreads(threadsCount, maxPending);
+    InstancesPrefetcher prefetcher(context, commands.GetInstances(), threadsCount, maxPending);
 
-    // Send the ZIP
-    call.GetOutput().AnswerFile(sender);
+    // Stream the ZIP writer to the HTTP connection
+    HttpZipStream stream(call.GetOutput(), id + ".zip");
+    HierarchicalZipWriter writer(stream);
+    writer.SetZip64(isZip64);
 
-    // The temporary file is automatically removed thanks to the RAII
+    // Store the requested resource into the ZIP
+    commands.Apply(writer, prefetcher);
+
+    writer.Close();
   }
 
 
@@ -306,57 +425,49 @@ namespace Orthanc
     std::string id = call.GetUriComponent("id", "");
     bool isZip64 = IsZip64Required(context.GetIndex(), id);
 
-    // Create a RAII for the temporary file to manage the ZIP file
-    Toolbox::TemporaryFile tmp;
-
-    {
-      // Create a ZIP writer
-      HierarchicalZipWriter writer(tmp.GetPath().c_str());
-      writer.SetZip64(isZip64);
-      writer.OpenDirectory("IMAGES");
+    // Retrieve the list of the instances, and start reading them in
+    // the background
+    std::list<std::string> instances;
+    context.GetIndex().GetChildInstances(instances, id);
 
-      // Create the DICOMDIR writer
-      DicomDirWriter dicomDir;
+    unsigned int threadsCount, maxPending;
+    GetArchiveThreads(threadsCount, maxPending);
+    InstancesPrefetcher prefetcher(context, std::vector<std::string>(instances.begin(), instances.end()),
+                                   threadsCount, maxPending);
 
-      // Retrieve the list of the instances
-      std::list<std::string> instances;
-      context.GetIndex().GetChildInstances(instances, id);
+    // Stream the ZIP writer to the HTTP connection
+    HttpZipStream stream(call.GetOutput(), id + ".zip");
+    HierarchicalZipWriter writer(stream);
+    writer.SetZip64(isZip64);
+    writer.OpenDirectory("IMAGES");
 
-      size_t pos = 0;
-      for (std::list<std::string>::const_iterator
-             it = instances.begin(); it != instances.end(); it++, pos++)
-      {
-        // "DICOM restricts the filenames on DICOM media to 8
-        // characters (some systems wrongly use 8.3, but this does not
-        // conform to the standard)."
-        std::string filename = "IM" + boost::lexical_cast<std::string>(pos);
-        writer.OpenFile(filename.c_str());
-
-        std::string dicom;
-        context.ReadFile(dicom, *it, FileContentType_Dicom);
-        writer.Write(dicom);
-
-        ParsedDicomFile parsed(dicom);
-        dicomDir.Add("IMAGES", filename, parsed);
-      }
+    // Create the DICOMDIR writer
+    DicomDirWriter dicomDir;
 
-      // Add the DICOMDIR
-      writer.CloseDirectory();
-      writer.OpenFile("DICOMDIR");
-      std::string s;
-      dicomDir.Encode(s);
-      writer.Write(s);
+    size_t pos = 0;
+    std::string dicom;
+    while (prefetcher.ReadNext(dicom))
+    {
+      // "DICOM restricts the filenames on DICOM media to 8
+      // characters (some systems wrongly use 8.3, but this does not
+      // conform to the standard)."
+      std::string filename = "IM" + boost::lexical_cast<std::string>(pos);
+      writer.OpenFile(filename.c_str());
+      writer.Write(dicom);
+
+      ParsedDicomFile parsed(dicom);
+      dicomDir.Add("IMAGES", filename, parsed);
+      pos++;
     }
 
-    // Prepare the sending of the ZIP file
-    FilesystemHttpSender sender(tmp.GetPath().c_str());
-    sender.SetContentType("application/zip");
-    sender.SetDownloadFilename(id + ".zip");
-
-    // Send the ZIP
-    call.GetOutput().AnswerFile(sender);
+    // Add the DICOMDIR
+    writer.CloseDirectory();
+    writer.OpenFile("DICOMDIR");
+    std::string s;
+    dicomDir.Encode(s);
+    writer.Write(s);
 
-    // The temporary file is automatically removed thanks to the RAII
+    writer.Close();
   }
 
 
@@ -429,11 +429,17 @@ namespace Orthanc
     OrthancPeerParameters peer;
     Configuration::GetOrthancPeer(peer, remote);
 
+    // A single command receives all the instances, so that they can
+    // be sent by batches (cf. "OrthancPeersBatchSize")
     ServerJob job;
-    for (std::list<std::string>::const_iterator 
-           it = instances.begin(); it != instances.end(); ++it)
+    if (!instances.empty())
     {
-      job.AddCommand(new StorePeerCommand(context, peer, false)).AddInput(*it);
+      ServerCommandInstance& command = job.AddCommand(new StorePeerCommand(context, peer, false));
+      for (std::list<std::string>::const_iterator 
+             it = instances.begin(); it != instances.end(); ++it)
+      {
+        command.AddInput(*it);
+      }
     }
 
     job.SetDescription("HTTP request: POST to peer \"" + remote + "\"");
@@ -33,21 +33,122 @@
 #include "../PrecompiledHeadersServer.h"
 #include "OrthancRestApi.h"
 
+#include "../InstancesPrefetcher.h"
+#include "../OrthancInitialization.h"
+#include "../ResourceFinder.h"
 #include "../ServerToolbox.h"
+#include "../SliceOrdering.h"
 #include "../FromDcmtkBridge.h"
+#include "../../Core/ImageFormats/JpegWriter.h"
+#include "../../Core/ImageFormats/PngWriter.h"
+#include "../../Core/ImageFormats/RawFramesHeader.h"
 
 #include <glog/logging.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 namespace Orthanc
 {
   // List all the patients, studies, series or instances ----------------------
  
+  // Number of resources that are read from the index at once when
+  // listing all the resources, which is also the maximum size of one
+  // page of a paginated listing
+  static const unsigned int LIST_BATCH_SIZE = 1000;
+
   template <enum ResourceType resourceType>
   static void ListResources(RestApiGetCall& call)
   {
-    Json::Value result;
-    OrthancRestApi::GetIndex(call).GetAllUuids(result, resourceType);
-    call.GetOutput().AnswerJson(result);
+    ServerIndex& index = OrthancRestApi::GetIndex(call);
+
+    // With "expand", the summary of each resource is returned instead
+    // of its identifier
+    bool expand = call.HasArgument("expand");
+
+    // With "limit" and/or "since", only one page of the resources is
+    // returned. "since" is the cursor ("Last") returned by the
+    // previous page, which remains valid even if resources are
+    // concurrently added to or removed from the index.
+    bool paginated = (call.HasArgument("limit") || call.HasArgument("since"));
+
+    int64_t since = 0;
+    unsigned int limit = LIST_BATCH_SIZE;
+
+    if (paginated)
+    {
+      try
+      {
+        since = boost::lexical_cast<int64_t>(call.GetArgument("since", "0"));
+        limit = boost::lexical_cast<unsigned int>(call.GetArgument("limit", "0"));
+      }
+      catch (boost::bad_lexical_cast&)
+      {
+        call.GetOutput().SignalError(HttpStatus_400_BadRequest);
+        return;
+      }
+
+      if (since < 0)
+      {
+        call.GetOutput().SignalError(HttpStatus_400_BadRequest);
+        return;
+      }
+
+      if (limit == 0 || limit > LIST_BATCH_SIZE)
+      {
+        limit = LIST_BATCH_SIZE;
+      }
+    }
+
+    // The resources are streamed to the HTTP client while the index
+    // is read, batch by batch
+    JsonStreamWriter& writer = call.GetOutput().StartJsonStream();
+
+    if (paginated)
+    {
+      writer.StartObject();
+      writer.WriteKey("Resources");
+    }
+
+    writer.StartArray();
+
+    bool done = false;
+    do
+    {
+      if (expand)
+      {
+        Json::Value batch = Json::arrayValue;
+        done = index.ExpandAllResources(batch, since, resourceType, limit);
+
+        for (Json::Value::ArrayIndex i = 0; i < batch.size(); i++)
+        {
+          writer.WriteValue(batch[i]);
+        }
+      }
+      else
+      {
+        std::list<std::string> batch;
+        done = index.GetAllUuids(batch, since, resourceType, limit);
+
+        for (std::list<std::string>::const_iterator 
+               it = batch.begin(); it != batch.end(); ++it)
+        {
+          writer.WriteString(*it);
+        }
+      }
+    }
+    while (!paginated && !done);
+
+    writer.EndArray();
+
+    if (paginated)
+    {
+      writer.WriteKey("Done");
+      writer.WriteBool(done);
+      writer.WriteKey("Last");
+      writer.WriteInteger(since);
+      writer.EndObject();
+    }
+
+    call.GetOutput().CloseJsonStream();
   }
 
   template <enum ResourceType resourceType>
@@ -112,7 +213,7 @@ namespace Orthanc
     ServerContext& context = OrthancRestApi::GetContext(call);
 
     std::string publicId = call.GetUriComponent("id", "");
-    context.AnswerAttachment(call.GetOutput(), publicId, FileContentType_Dicom);
+    context.AnswerAttachment(call.GetOutput(), publicId, FileContentType_Dicom, call.GetHttpHeader("range", ""));
   }
 
 
@@ -149,7 +250,7 @@ namespace Orthanc
     }
     else
     {
-      context.AnswerAttachment(call.GetOutput(), publicId, FileContentType_DicomAsJson);
+      context.AnswerAttachment(call.GetOutput(), publicId, FileContentType_DicomAsJson, call.GetHttpHeader("range", ""));
     }
   }
 
@@ -196,8 +297,102 @@ namespace Orthanc
   }
 
 
-  template <enum ImageExtractionMode mode>
-  static void GetImage(RestApiGetCall& call)
+  /**
+   * Chooses between PNG (lossless, the default) and JPEG (lossy, only
+   * for the 8bpp extraction modes). The "format" GET argument has
+   * priority over the "Accept" HTTP header. Returns "false" if the
+   * arguments are invalid, otherwise sets "jpegQuality" to zero for
+   * PNG. If the "Accept" header is used, the answer gets a "Vary:
+   * Accept" header.
+   **/
+  static bool NegotiateImageFormat(unsigned int& jpegQuality,
+                                   RestApiGetCall& call,
+                                   ImageExtractionMode mode)
+  {
+    jpegQuality = 0;
+
+    bool jpeg;
+    if (call.HasArgument("format"))
+    {
+      std::string format = call.GetArgument("format", "");
+      Toolbox::ToLowerCase(format);
+
+      if (format == "png")
+      {
+        jpeg = false;
+      }
+      else if (format == "jpeg" || format == "jpg")
+      {
+        jpeg = true;
+      }
+      else
+      {
+        return false;
+      }
+    }
+    else
+    {
+      // Content negotiation: JPEG is only sent if the client prefers
+      // it over PNG
+      const std::string accept = call.GetHttpHeader("accept", "");
+
+      float png, jpg;
+      bool hasPng = HttpHandler::LookupAcceptedQuality(png, accept, "image/png");
+      bool hasJpeg = HttpHandler::LookupAcceptedQuality(jpg, accept, "image/jpeg");
+
+      jpeg = (jpg > png ||
+              (jpg == png && jpg > 0 && hasJpeg && !hasPng));
+
+      // The answer depends on the "Accept" header: The HTTP caches
+      // must not serve it to clients that accept other formats
+      call.GetOutput().GetLowLevelOutput().AddHeader("Vary", "Accept");
+    }
+
+    if (!jpeg)
+    {
+      return true;
+    }
+
+#if ORTHANC_JPEG_ENABLED == 1
+    if (mode != ImageExtractionMode_Preview &&
+        mode != ImageExtractionMode_UInt8)
+    {
+      // JPEG cannot encode the 16bpp images
+      return !call.HasArgument("format");
+    }
+
+    int quality = Configuration::GetGlobalIntegerParameter("JpegQuality", 90);
+
+    if (call.HasArgument("quality"))
+    {
+      try
+      {
+        quality = boost::lexical_cast<int>(call.GetArgument("quality", ""));
+      }
+      catch (boost::bad_lexical_cast)
+      {
+        return false;
+      }
+    }
+
+    if (quality < 1 || quality > 100)
+    {
+      return false;
+    }
+
+    jpegQuality = static_cast<unsigned int>(quality);
+    return true;
+#else
+    // JPEG support is disabled: Fallback to PNG, unless JPEG was
+    // explicitly requested
+    return !call.HasArgument("format");
+#endif
+  }
+
+
+  static void AnswerImage(RestApiGetCall& call,
+                          ImageExtractionMode mode,
+                          unsigned int thumbnailSize)
   {
     ServerContext& context = OrthancRestApi::GetContext(call);
 
@@ -213,16 +408,28 @@ namespace Orthanc
       return;
     }
 
-    std::string publicId = call.GetUriComponent("id", "");
-    std::string dicomContent, png;
-    context.ReadFile(dicomContent, publicId, FileContentType_Dicom);
+    unsigned int jpegQuality;
+    if (!NegotiateImageFormat(jpegQuality, call, mode))
+    {
+      return;
+    }
 
-    ParsedDicomFile dicom(dicomContent);
+    std::string publicId = call.GetUriComponent("id", "");
+    std::string image;
 
     try
     {
-      dicom.ExtractPngImage(png, frame, mode);
-      call.GetOutput().AnswerBuffer(png, "image/png");
+      if (jpegQuality == 0)
+      {
+        context.ExtractPngImage(image, publicId, frame, mode, thumbnailSize);
+        call.GetOutput().AnswerBuffer(image, "image/png");
+      }
+      else
+      {
+        context.ExtractJpegImage(image, publicId, frame, mode, thumbnailSize,
+                                 static_cast<uint8_t>(jpegQuality));
+        call.GetOutput().AnswerBuffer(image, "image/jpeg");
+      }
     }
     catch (OrthancException& e)
     {
@@ -245,6 +452,143 @@ namespace Orthanc
   }
 
 
+  template <enum ImageExtractionMode mode>
+  static void GetImage(RestApiGetCall& call)
+  {
+    AnswerImage(call, mode, 0);
+  }
+
+
+  static void GetThumbnail(RestApiGetCall& call)
+  {
+    unsigned int size = OrthancRestApi::GetContext(call).GetThumbnailSize();
+
+    if (call.HasArgument("size"))
+    {
+      try
+      {
+        size = boost::lexical_cast<unsigned int>(call.GetArgument("size", ""));
+      }
+      catch (boost::bad_lexical_cast)
+      {
+        return;
+      }
+
+      if (size == 0)
+      {
+        return;
+      }
+    }
+
+    AnswerImage(call, ImageExtractionMode_Preview, size);
+  }
+
+
+  static bool ParseRenderingParameters(RenderingParameters& parameters,
+                                       RestApiGetCall& call)
+  {
+    try
+    {
+      if (call.HasArgument("window-center") ||
+          call.HasArgument("window-width"))
+      {
+        // Both arguments must be present
+        float center = boost::lexical_cast<float>(call.GetArgument("window-center", ""));
+        float width = boost::lexical_cast<float>(call.GetArgument("window-width", ""));
+        parameters.SetWindowing(center, width);
+      }
+
+      unsigned int width = 0, height = 0;
+
+      if (call.HasArgument("width"))
+      {
+        width = boost::lexical_cast<unsigned int>(call.GetArgument("width", ""));
+      }
+
+      if (call.HasArgument("height"))
+      {
+        height = boost::lexical_cast<unsigned int>(call.GetArgument("height", ""));
+      }
+
+      parameters.SetMaximumSize(width, height);
+      return true;
+    }
+    catch (boost::bad_lexical_cast)
+    {
+      return false;
+    }
+    catch (OrthancException&)
+    {
+      // Bad window
+      return false;
+    }
+  }
+
+
+  static void GetRenderedImage(RestApiGetCall& call)
+  {
+    ServerContext& context = OrthancRestApi::GetContext(call);
+
+    unsigned int frame;
+    try
+    {
+      frame = boost::lexical_cast<unsigned int>(call.GetUriComponent("frame", "0"));
+    }
+    catch (boost::bad_lexical_cast)
+    {
+      return;
+    }
+
+    RenderingParameters parameters;
+    unsigned int jpegQuality;
+    if (!ParseRenderingParameters(parameters, call) ||
+        !NegotiateImageFormat(jpegQuality, call, ImageExtractionMode_Preview))
+    {
+      return;
+    }
+
+    std::string publicId = call.GetUriComponent("id", "");
+
+    ImageBuffer buffer;
+
+    try
+    {
+      ServerContext::FrameLocker locker(context, publicId, frame);
+      locker.GetDicom().ExtractRenderedImage(buffer, locker.GetFrame(), parameters);
+    }
+    catch (OrthancException& e)
+    {
+      if (e.GetErrorCode() == ErrorCode_ParameterOutOfRange)
+      {
+        // The frame number is out of the range for this DICOM
+        // instance, the resource is not existent
+        return;
+      }
+      else
+      {
+        throw;
+      }
+    }
+
+    ImageAccessor accessor(buffer.GetConstAccessor());
+    std::string image;
+
+    if (jpegQuality == 0)
+    {
+      PngWriter writer;
+      writer.WriteToMemory(image, accessor);
+      call.GetOutput().AnswerBuffer(image, "image/png");
+    }
+    else
+    {
+      JpegWriter writer;
+      writer.SetQuality(static_cast<uint8_t>(jpegQuality));
+      writer.WriteToMemory(image, accessor);
+      call.GetOutput().AnswerBuffer(image, "image/jpeg");
+    }
+  }
+
+
   static void GetMatlabImage(RestApiGetCall& call)
   {
     ServerContext& context = OrthancRestApi::GetContext(call);
@@ -262,12 +606,13 @@ namespace Orthanc
     }
 
     std::string publicId = call.GetUriComponent("id", "");
-    std::string dicomContent;
-    context.ReadFile(dicomContent, publicId, FileContentType_Dicom);
 
-    ParsedDicomFile dicom(dicomContent);
     ImageBuffer buffer;
-    dicom.ExtractImage(buffer, frame);
+
+    {
+      ServerContext::FrameLocker locker(context, publicId, frame);
+      locker.GetDicom().ExtractImage(buffer, locker.GetFrame());
+    }
 
     ImageAccessor accessor(buffer.GetConstAccessor());
 
@@ -278,6 +623,201 @@ namespace Orthanc
   }
 
 
+  static std::string GetTagValue(const Json::Value& dicomAsJson,
+                                 const DicomTag& tag,
+                                 const std::string& defaultValue)
+  {
+    const std::string key = tag.Format();
+
+    if (dicomAsJson.isMember(key) &&
+        dicomAsJson[key]["Type"] == "String")
+    {
+      return Toolbox::StripSpaces(dicomAsJson[key]["Value"].asString());
+    }
+    else
+    {
+      return defaultValue;
+    }
+  }
+
+
+  static void SendRawFrame(HttpOutput& output,
+                           ImageBuffer& frame)
+  {
+    ImageAccessor accessor(frame.GetConstAccessor());
+
+    const size_t lineSize = accessor.GetBytesPerPixel() * accessor.GetWidth();
+    const bool swap = (accessor.GetBytesPerPixel() == 2 &&
+                       Toolbox::DetectEndianness() == Endianness_Big);
+
+    std::string buffer;
+    buffer.resize(lineSize * accessor.GetHeight());
+
+    for (unsigned int y = 0; y < accessor.GetHeight(); y++)
+    {
+      const uint8_t* source = reinterpret_cast<const uint8_t*>(accessor.GetConstRow(y));
+      uint8_t* target = reinterpret_cast<uint8_t*>(&buffer[0]) + y * lineSize;
+
+      if (swap)
+      {
+        for (size_t x = 0; x < lineSize; x += 2)
+        {
+          target[x] = source[x + 1];
+          target[x + 1] = source[x];
+        }
+      }
+      else
+      {
+        memcpy(target, source, lineSize);
+      }
+    }
+
+    output.SendBody(buffer);
+  }
+
+
+  static void GetRawFrames(RestApiGetCall& call)
+  {
+    ServerContext& context = OrthancRestApi::GetContext(call);
+
+    ImageExtractionMode mode;
+    std::string s = call.GetArgument("mode", "uint16");
+    if (s == "preview")
+    {
+      mode = ImageExtractionMode_Preview;
+    }
+    else if (s == "uint8")
+    {
+      mode = ImageExtractionMode_UInt8;
+    }
+    else if (s == "uint16")
+    {
+      mode = ImageExtractionMode_UInt16;
+    }
+    else if (s == "int16")
+    {
+      mode = ImageExtractionMode_Int16;
+    }
+    else
+    {
+      return;
+    }
+
+    std::string publicId = call.GetUriComponent("id", "");
+
+    std::list<std::string> instances;
+    context.GetIndex().GetChildInstances(instances, publicId);
+
+    // Sort the slices using the summary of the instances, and check
+    // that they share the same size, before sending the HTTP header
+    SliceOrdering ordering;
+    std::map<std::string, unsigned int> framesCount;
+    std::string rows, columns;
+    unsigned int depth = 0;
+
+    for (std::list<std::string>::const_iterator 
+           it = instances.begin(); it != instances.end(); ++it)
+    {
+      Json::Value dicom;
+      context.ReadJson(dicom, *it);
+      ordering.AddInstance(*it, dicom);
+
+      if (it == instances.begin())
+      {
+        rows = GetTagValue(dicom, DICOM_TAG_ROWS, "");
+        columns = GetTagValue(dicom, DICOM_TAG_COLUMNS, "");
+      }
+      else if (rows != GetTagValue(dicom, DICOM_TAG_ROWS, "") ||
+               columns != GetTagValue(dicom, DICOM_TAG_COLUMNS, ""))
+      {
+        call.GetOutput().SignalError(HttpStatus_400_BadRequest);
+        return;
+      }
+
+      unsigned int frames;
+      try
+      {
+        frames = boost::lexical_cast<unsigned int>(GetTagValue(dicom, DICOM_TAG_NUMBER_OF_FRAMES, "1"));
+      }
+      catch (boost::bad_lexical_cast&)
+      {
+        frames = 1;
+      }
+
+      framesCount[*it] = frames;
+      depth += frames;
+    }
+
+    std::vector<std::string> sorted;
+    if (!ordering.Sort(sorted))
+    {
+      // The slices cannot be ordered
+      call.GetOutput().SignalError(HttpStatus_400_BadRequest);
+      return;
+    }
+
+    if (sorted.empty())
+    {
+      std::string header;
+      RawFramesHeader(PixelFormat_Grayscale8, 0, 0, 0).Write(header);
+      call.GetOutput().AnswerBuffer(header, "application/octet-stream");
+      return;
+    }
+
+    HttpOutput& output = call.GetOutput().GetLowLevelOutput();
+    output.SetContentType("application/octet-stream");
+
+    // The instances are read and uncompressed in the background, in
+    // the order of the slices, bypassing the cache of parsed DICOM
+    int threads = Configuration::GetGlobalIntegerParameter("ArchiveThreads", 4);
+    unsigned int threadsCount = (threads > 0 ? static_cast<unsigned int>(threads) : 0);
+    InstancesPrefetcher prefetcher(context, sorted, threadsCount, 2 * threadsCount);
+
+    std::auto_ptr<RawFramesHeader> header;
+
+    for (size_t i = 0; i < sorted.size(); i++)
+    {
+      std::string content;
+      if (!prefetcher.ReadNext(content))
+      {
+        throw OrthancException(ErrorCode_InternalError);
+      }
+
+      ParsedDicomFile dicom(content);
+
+      for (unsigned int frame = 0; frame < framesCount[sorted[i]]; frame++)
+      {
+        ImageBuffer buffer;
+        dicom.ExtractImage(buffer, frame, mode);
+
+        if (header.get() == NULL)
+        {
+          // The pixel format of the volume is that of the first frame
+          header.reset(new RawFramesHeader(buffer.GetFormat(), buffer.GetWidth(), buffer.GetHeight(), depth));
+
+          std::string serialized;
+          header->Write(serialized);
+          output.SetContentLength(header->GetTotalSize());
+          output.SendBody(serialized);
+          call.GetOutput().MarkLowLevelOutputDone();
+        }
+        else if (buffer.GetFormat() != header->GetFormat() ||
+                 buffer.GetWidth() != header->GetWidth() ||
+                 buffer.GetHeight() != header->GetHeight())
+        {
+          // The HTTP header has already been sent: The connection
+          // will be closed before the announced content length
+          LOG(ERROR) << "Instance " << sorted[i] << " does not have the same pixel format "
+                     << "or size as the other slices of series " << publicId;
+          throw OrthancException(ErrorCode_IncompatibleImageFormat);
+        }
+
+        SendRawFrame(output, buffer);
+      }
+    }
+  }
+
+
 
   static void GetResourceStatistics(RestApiGetCall& call)
   {
@@ -453,7 +993,7 @@ namespace Orthanc
 
     if (uncompress)
     {
-      context.AnswerAttachment(call.GetOutput(), publicId, type);
+      context.AnswerAttachment(call.GetOutput(), publicId, type, call.GetHttpHeader("range", ""));
     }
     else
     {
@@ -589,10 +1129,14 @@ namespace Orthanc
     std::string name = call.GetUriComponent("name", "");
     FileContentType contentType = StringToContentType(name);
 
-    if (contentType >= FileContentType_StartUser &&
-        contentType <= FileContentType_EndUser)
+    // It is forbidden to delete internal attachments, except the
+    // DICOM-as-JSON summary of an instance, that is regenerated
+    // (in the compact format) on its next access
+    if ((contentType >= FileContentType_StartUser &&
+         contentType <= FileContentType_EndUser) ||
+        (contentType == FileContentType_DicomAsJson &&
+         StringToResourceType(call.GetUriComponent("resourceType", "").c_str()) == ResourceType_Instance))
     {
-      // It is forbidden to delete internal attachments
       OrthancRestApi::GetIndex(call).DeleteAttachment(publicId, contentType);
       call.GetOutput().AnswerBuffer("{}", "application/json");
     }
@@ -815,6 +1359,208 @@ namespace Orthanc
   }
 
 
+  static double GetElapsedMilliseconds(const boost::posix_time::ptime& start)
+  {
+    boost::posix_time::time_duration elapsed = 
+      boost::posix_time::microsec_clock::universal_time() - start;
+    return static_cast<double>(elapsed.total_microseconds()) / 1000.0;
+  }
+
+
+  static void Find(RestApiPostCall& call)
+  {
+    /**
+     * The body of the request is a JSON object such as:
+     *   { "Level" : "Study", 
+     *     "Query" : { "PatientName" : "DOE*", "StudyDate" : "20140101-" } }
+     * The constraints follow the C-FIND syntax (wildcards, ranges and
+     * lists). The optional fields are "Expand" (return the resources
+     * as "/{resource}/{id}" does), "Limit" and "Since" (pagination,
+     * "Since" being the "Last" identifier of the previous page), and
+     * "Debug" (report the lookups in the index and their timing).
+     *
+     * NB: Pagination only bounds the matching of the candidates
+     * against the full query (which might read the storage area). The
+     * lookup of the candidates in the index is not paginated: Each
+     * page looks up, then sorts, all the candidates after "Since".
+     **/
+
+    ServerContext& context = OrthancRestApi::GetContext(call);
+
+    Json::Value request;
+    if (!call.ParseJsonRequest(request) ||
+        request.type() != Json::objectValue ||
+        !request.isMember("Level") ||
+        !request.isMember("Query") ||
+        request["Level"].type() != Json::stringValue ||
+        request["Query"].type() != Json::objectValue ||
+        (request.isMember("Expand") && request["Expand"].type() != Json::booleanValue) ||
+        (request.isMember("Debug") && request["Debug"].type() != Json::booleanValue) ||
+        (request.isMember("Since") && request["Since"].type() != Json::stringValue) ||
+        (request.isMember("Limit") && !request["Limit"].isUInt()))
+    {
+      // Bad JSON request
+      call.GetOutput().SignalError(HttpStatus_400_BadRequest);
+      return;
+    }
+
+    ResourceType level;
+
+    try
+    {
+      level = StringToResourceType(request["Level"].asCString());
+    }
+    catch (OrthancException&)
+    {
+      // Unknown level
+      call.GetOutput().SignalError(HttpStatus_400_BadRequest);
+      return;
+    }
+
+    bool expand = request.get("Expand", false).asBool();
+    bool debug = request.get("Debug", false).asBool();
+    bool paginated = (request.isMember("Limit") || request.isMember("Since"));
+    unsigned int limit = request.get("Limit", 0).asUInt();   // "0" means no limit
+    std::string since = request.get("Since", "").asString();
+
+    DicomMap query;
+
+    Json::Value::Members members = request["Query"].getMemberNames();
+    for (size_t i = 0; i < members.size(); i++)
+    {
+      const Json::Value& constraint = request["Query"][members[i]];
+      if (constraint.type() != Json::stringValue)
+      {
+        call.GetOutput().SignalError(HttpStatus_400_BadRequest);
+        return;
+      }
+
+      DicomTag tag(0, 0);
+
+      try
+      {
+        tag = FromDcmtkBridge::ParseTag(members[i]);
+      }
+      catch (OrthancException&)
+      {
+        // Unknown DICOM tag
+        call.GetOutput().SignalError(HttpStatus_400_BadRequest);
+        return;
+      }
+
+      // The empty constraints are universal matches
+      if (!constraint.asString().empty())
+      {
+        query.SetValue(tag, constraint.asString());
+      }
+    }
+
+    ResourceFinder finder(context, level, query);
+
+    // Lookup of the candidates in the index
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    Json::Value plan;
+    std::list<std::string> candidates;
+    finder.FindCandidates(candidates, debug ? &plan : NULL);
+
+    double candidatesTime = GetElapsedMilliseconds(start);
+
+    // Sorting the candidates by identifier makes the pagination
+    // stable, even if resources are concurrently added or removed.
+    // The candidates from the previous pages are dropped first.
+    if (!since.empty())
+    {
+      for (std::list<std::string>::iterator it = candidates.begin(); it != candidates.end(); )
+      {
+        if (*it <= since)
+        {
+          it = candidates.erase(it);
+        }
+        else
+        {
+          ++it;
+        }
+      }
+    }
+
+    candidates.sort();
+
+    // Matching of the candidates against the full query
+    start = boost::posix_time::microsec_clock::universal_time();
+
+    std::list<std::string> matches;
+    bool done = true;
+
+    for (std::list<std::string>::const_iterator
+           it = candidates.begin(); it != candidates.end(); ++it)
+    {
+      if (limit != 0 && matches.size() == limit)
+      {
+        done = false;
+        break;
+      }
+
+      try
+      {
+        DicomMap tags;
+        if (finder.GetTags(tags, *it) &&
+            finder.Matches(tags))
+        {
+          matches.push_back(*it);
+        }
+      }
+      catch (OrthancException&)
+      {
+        // This resource has probably been deleted during the lookup
+      }
+    }
+
+    double matchingTime = GetElapsedMilliseconds(start);
+
+    Json::Value resources = Json::arrayValue;
+
+    for (std::list<std::string>::const_iterator
+           it = matches.begin(); it != matches.end(); ++it)
+    {
+      if (expand)
+      {
+        Json::Value item;
+        if (context.GetIndex().LookupResource(item, *it, level))
+        {
+          resources.append(item);
+        }
+      }
+      else
+      {
+        resources.append(*it);
+      }
+    }
+
+    if (!paginated && !debug)
+    {
+      call.GetOutput().AnswerJson(resources);
+      return;
+    }
+
+    Json::Value result = Json::objectValue;
+    result["Resources"] = resources;
+    result["Done"] = done;
+    result["Last"] = matches.empty() ? since : matches.back();
+
+    if (debug)
+    {
+      result["Plan"] = plan;
+      result["Indexed"] = finder.IsIndexed();
+      result["Timing"] = Json::objectValue;
+      result["Timing"]["Candidates"] = candidatesTime;
+      result["Timing"]["Matching"] = matchingTime;
+    }
+
+    call.GetOutput().AnswerJson(result);
+  }
+
+
   template <enum ResourceType start, 
             enum ResourceType end>
   static void GetChildResources(RestApiGetCall& call)
@@ -887,7 +1633,9 @@ namespace Orthanc
 
     context.GetIndex().GetChildInstances(instances, publicId);  // (*)
 
-    Json::Value result = Json::objectValue;
+    // The tags of each instance are streamed as soon as they are read
+    JsonStreamWriter& writer = call.GetOutput().StartJsonStream();
+    writer.StartObject();
 
     for (Instances::const_iterator it = instances.begin();
          it != instances.end(); it++)
@@ -895,19 +1643,22 @@ namespace Orthanc
       Json::Value full;
       context.ReadJson(full, *it);
 
+      writer.WriteKey(*it);
+
       if (simplify)
       {
         Json::Value simplified;
         SimplifyTags(simplified, full);
-        result[*it] = simplified;
+        writer.WriteValue(simplified);
       }
       else
       {
-        result[*it] = full;
+        writer.WriteValue(full);
       }
     }
-    
-    call.GetOutput().AnswerJson(result);
+
+    writer.EndObject();
+    call.GetOutput().CloseJsonStream();
   }
 
 
@@ -994,11 +1745,15 @@ namespace Orthanc
     Register("/instances/{id}/frames/{frame}/image-uint8", GetImage<ImageExtractionMode_UInt8>);
     Register("/instances/{id}/frames/{frame}/image-uint16", GetImage<ImageExtractionMode_UInt16>);
     Register("/instances/{id}/frames/{frame}/image-int16", GetImage<ImageExtractionMode_Int16>);
+    Register("/instances/{id}/frames/{frame}/thumbnail", GetThumbnail);
+    Register("/instances/{id}/frames/{frame}/rendered", GetRenderedImage);
     Register("/instances/{id}/frames/{frame}/matlab", GetMatlabImage);
     Register("/instances/{id}/preview", GetImage<ImageExtractionMode_Preview>);
     Register("/instances/{id}/image-uint8", GetImage<ImageExtractionMode_UInt8>);
     Register("/instances/{id}/image-uint16", GetImage<ImageExtractionMode_UInt16>);
     Register("/instances/{id}/image-int16", GetImage<ImageExtractionMode_Int16>);
+    Register("/instances/{id}/thumbnail", GetThumbnail);
+    Register("/instances/{id}/rendered", GetRenderedImage);
     Register("/instances/{id}/matlab", GetMatlabImage);
 
     Register("/patients/{id}/protected", IsProtectedPatient);
@@ -1022,6 +1777,7 @@ namespace Orthanc
     Register("/{resourceType}/{id}/attachments/{name}", UploadAttachment);
 
     Register("/tools/lookup", Lookup);
+    Register("/tools/find", Find);
 
     Register("/patients/{id}/studies", GetChildResources<ResourceType_Patient, ResourceType_Study>);
     Register("/patients/{id}/series", GetChildResources<ResourceType_Patient, ResourceType_Series>);
@@ -1040,6 +1796,7 @@ namespace Orthanc
     Register("/patients/{id}/instances-tags", GetChildInstancesTags);
     Register("/studies/{id}/instances-tags", GetChildInstancesTags);
     Register("/series/{id}/instances-tags", GetChildInstancesTags);
+    Register("/series/{id}/raw-frames", GetRawFrames);
 
     Register("/instances/{id}/content/*", GetRawContent);
   }
@@ -65,6 +65,14 @@ namespace Orthanc
   {
     Json::Value result = Json::objectValue;
     OrthancRestApi::GetIndex(call).ComputeStatistics(result);
+    OrthancRestApi::GetContext(call).GetDicomCacheStatistics(result["DicomCache"]);
+    call.GetOutput().AnswerJson(result);
+  }
+
+  static void GetJobs(RestApiGetCall& call)
+  {
+    Json::Value result;
+    OrthancRestApi::GetContext(call).GetScheduler().GetStatus(result);
     call.GetOutput().AnswerJson(result);
   }
 
@@ -210,6 +218,7 @@ namespace Orthanc
     Register("/", ServeRoot);
     Register("/system", GetSystemInformation);
     Register("/statistics", GetStatistics);
+    Register("/jobs", GetJobs);
     Register("/tools/generate-uid", GenerateUid);
     Register("/tools/execute-script", ExecuteScript);
     Register("/tools/now", GetNowIsoString);
@@ -87,6 +87,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "../Core/Toolbox.h"
 #include "../Core/OrthancException.h"
 #include "../Core/ImageFormats/ImageBuffer.h"
+#include "../Core/ImageFormats/JpegWriter.h"
 #include "../Core/ImageFormats/PngWriter.h"
 #include "../Core/Uuid.h"
 #include "../Core/DicomFormat/DicomString.h"
@@ -1009,12 +1010,36 @@ namespace Orthanc
   }
 
 
+  ParsedDicomFile::ParsedDicomFile(PImpl* pimpl) : pimpl_(pimpl)
+  {
+  }
+
+
   ParsedDicomFile::~ParsedDicomFile()
   {
     delete pimpl_;
   }
 
 
+  ParsedDicomFile* ParsedDicomFile::OpenFile(const std::string& path)
+  {
+    std::auto_ptr<DcmFileFormat> file(new DcmFileFormat);
+
+    // The elements that are longer than "DCM_MaxReadLength" bytes are
+    // only loaded on demand
+    if (!file->loadFile(path.c_str(), EXS_Unknown, EGL_noChange, DCM_MaxReadLength).good())
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+
+    PImpl* pimpl = new PImpl;
+    pimpl->encoding_ = FromDcmtkBridge::DetectEncoding(*file->getDataset());
+    pimpl->file_ = file;
+
+    return new ParsedDicomFile(pimpl);
+  }
+
+
   void* ParsedDicomFile::GetDcmtkObject()
   {
     return pimpl_->file_.get();
@@ -1200,6 +1225,19 @@ namespace Orthanc
   }
 
 
+  void ParsedDicomFile::ExtractRenderedImage(ImageBuffer& result,
+                                             unsigned int frame,
+                                             const RenderingParameters& parameters)
+  {
+    DcmDataset& dataset = *pimpl_->file_->getDataset();
+
+    if (!DicomImageDecoder::DecodeRendered(result, dataset, frame, parameters))
+    {
+      throw OrthancException(ErrorCode_BadFileFormat);
+    }
+  }
+
+
   void ParsedDicomFile::ExtractPngImage(std::string& result,
                                         unsigned int frame,
                                         ImageExtractionMode mode)
@@ -1213,6 +1251,27 @@ namespace Orthanc
   }
 
 
+  void ParsedDicomFile::ExtractJpegImage(std::string& result,
+                                         unsigned int frame,
+                                         ImageExtractionMode mode,
+                                         uint8_t quality)
+  {
+    if (mode != ImageExtractionMode_UInt8 &&
+        mode != ImageExtractionMode_Preview)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    ImageBuffer buffer;
+    ExtractImage(buffer, frame, mode);
+
+    ImageAccessor accessor(buffer.GetConstAccessor());
+    JpegWriter writer;
+    writer.SetQuality(quality);
+    writer.WriteToMemory(result, accessor);
+  }
+
+
   Encoding ParsedDicomFile::GetEncoding() const
   {
     return pimpl_->encoding_;
@@ -35,6 +35,7 @@
 #include "../Core/DicomFormat/DicomInstanceHasher.h"
 #include "../Core/RestApi/RestApiOutput.h"
 #include "ServerEnumerations.h"
+#include "RenderingParameters.h"
 #include "../Core/ImageFormats/ImageAccessor.h"
 #include "../Core/ImageFormats/ImageBuffer.h"
 
@@ -48,6 +49,8 @@ namespace Orthanc
 
     ParsedDicomFile(ParsedDicomFile& other);
 
+    explicit ParsedDicomFile(PImpl* pimpl);
+
     void Setup(const char* content,
                size_t size);
 
@@ -63,6 +66,14 @@ namespace Orthanc
 
     ~ParsedDicomFile();
 
+    /**
+     * Parses a DICOM file of the local filesystem. The large elements
+     * (such as the pixel data) are not loaded into memory: DCMTK reads
+     * them from the file on their first access, which implies that
+     * the file must remain available as long as this object exists.
+     **/
+    static ParsedDicomFile* OpenFile(const std::string& path);
+
     void* GetDcmtkObject();
 
     ParsedDicomFile* Clone();
@@ -115,6 +126,16 @@ namespace Orthanc
                          unsigned int frame,
                          ImageExtractionMode mode);
 
+    void ExtractRenderedImage(ImageBuffer& result,
+                              unsigned int frame,
+                              const RenderingParameters& parameters);
+
+    // Only available for the 8bpp extraction modes
+    void ExtractJpegImage(std::string& result,
+                          unsigned int frame,
+                          ImageExtractionMode mode,
+                          uint8_t quality);
+
     Encoding GetEncoding() const;
 
     void SetEncoding(Encoding encoding);
@@ -27,6 +27,18 @@ CREATE TABLE DicomIdentifiers(
        PRIMARY KEY(id, tagGroup, tagElement)
        );
 
+-- The following table was added in Orthanc 0.8.6 (database v6). It
+-- contains the main DICOM tags that are used as C-FIND matching keys
+-- (cf. "DicomTag::IsSearchable()"), that are thus not stored in
+-- "MainDicomTags".
+CREATE TABLE SearchableTags(
+       id INTEGER REFERENCES Resources(internalId) ON DELETE CASCADE,
+       tagGroup INTEGER,
+       tagElement INTEGER,
+       value TEXT,
+       PRIMARY KEY(id, tagGroup, tagElement)
+       );
+
 CREATE TABLE Metadata(
        id INTEGER REFERENCES Resources(internalId) ON DELETE CASCADE,
        type INTEGER,
@@ -66,6 +78,20 @@ CREATE TABLE ExportedResources(
        date TEXT
        ); 
 
+-- The following table was added in Orthanc 0.8.6 (database v6). It
+-- contains, for each resource, the number of child
+-- studies/series/instances (including the resource itself) and the
+-- size of all the files that are attached to the resource and to its
+-- descendants. It is incrementally maintained by "DatabaseWrapper".
+CREATE TABLE ResourceStatistics(
+       id INTEGER PRIMARY KEY REFERENCES Resources(internalId) ON DELETE CASCADE,
+       countStudies INTEGER,
+       countSeries INTEGER,
+       countInstances INTEGER,
+       compressedSize INTEGER,
+       uncompressedSize INTEGER
+       );
+
 CREATE TABLE PatientRecyclingOrder(
        seq INTEGER PRIMARY KEY AUTOINCREMENT,
        patientId INTEGER REFERENCES Resources(internalId) ON DELETE CASCADE
@@ -81,11 +107,20 @@ CREATE INDEX MainDicomTagsIndex1 ON MainDicomTags(id);
 -- CREATE INDEX MainDicomTagsIndex2 ON MainDicomTags(tagGroup, tagElement);
 -- CREATE INDEX MainDicomTagsIndexValues ON MainDicomTags(value COLLATE BINARY);
 
--- The 3 following indexes were added in Orthanc 0.8.5 (database v5)
+-- The 2 following indexes were added in Orthanc 0.8.5 (database v5)
 CREATE INDEX DicomIdentifiersIndex1 ON DicomIdentifiers(id);
-CREATE INDEX DicomIdentifiersIndex2 ON DicomIdentifiers(tagGroup, tagElement);
 CREATE INDEX DicomIdentifiersIndexValues ON DicomIdentifiers(value COLLATE BINARY);
 
+-- The following index was added in Orthanc 0.8.6 (database v6),
+-- replacing "DicomIdentifiersIndex2" on (tagGroup, tagElement) that
+-- was added in Orthanc 0.8.5 (database v5). It is used by the exact, range
+-- and prefix lookups of the identifiers.
+CREATE INDEX DicomIdentifiersIndexTagValues ON DicomIdentifiers(tagGroup, tagElement, value);
+
+-- The following index was added in Orthanc 0.8.6 (database v6). The
+-- values are case-insensitive, as the C-FIND matching.
+CREATE INDEX SearchableTagsIndexValues ON SearchableTags(tagGroup, tagElement, value COLLATE NOCASE);
+
 CREATE INDEX ChangesIndex ON Changes(internalId);
 
 CREATE TRIGGER AttachedFileDeleted
@@ -123,4 +158,4 @@ END;
 
 -- Set the version of the database schema
 -- The "1" corresponds to the "GlobalProperty_DatabaseSchemaVersion" enumeration
-INSERT INTO GlobalProperties VALUES (1, "5");
+INSERT INTO GlobalProperties VALUES (1, "6");
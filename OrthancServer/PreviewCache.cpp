@@ -0,0 +1,415 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "PrecompiledHeadersServer.h"
+#include "PreviewCache.h"
+
+#include "../Core/OrthancException.h"
+#include "../Core/Toolbox.h"
+#include "../Core/Uuid.h"
+
+#include <algorithm>
+#include <ctime>
+#include <string.h>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <glog/logging.h>
+
+static const char* const TEMPORARY_EXTENSION = ".tmp";
+
+
+namespace Orthanc
+{
+  namespace
+  {
+    // Anonymous namespace to avoid clashes between compilation modules
+
+    struct ExistingEntry
+    {
+      std::time_t  time_;
+      std::string  key_;
+      uint64_t     size_;
+
+      bool operator< (const ExistingEntry& other) const
+      {
+        return time_ < other.time_;
+      }
+    };
+  }
+
+
+  static std::string GetFilename(const boost::filesystem::path& p)
+  {
+#if BOOST_HAS_FILESYSTEM_V3 == 1
+    return p.filename().string();
+#else
+    return p.filename();
+#endif
+  }
+
+
+  std::string PreviewCache::GetInstanceDirectory(const std::string& instancePublicId) const
+  {
+    if (!Toolbox::IsSHA1(instancePublicId))
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    boost::filesystem::path p(root_);
+    p /= instancePublicId.substr(0, 2);
+    p /= instancePublicId;
+    return p.string();
+  }
+
+
+  std::string PreviewCache::GetKey(const std::string& instancePublicId,
+                                   unsigned int frame,
+                                   ImageExtractionMode mode,
+                                   unsigned int thumbnailSize,
+                                   unsigned int jpegQuality)
+  {
+    std::string key = (instancePublicId + "/" + 
+                       boost::lexical_cast<std::string>(frame) + "-" +
+                       boost::lexical_cast<std::string>(static_cast<int>(mode)) + "-" +
+                       boost::lexical_cast<std::string>(thumbnailSize));
+
+    if (jpegQuality == 0)
+    {
+      return key + ".png";
+    }
+    else
+    {
+      return key + "-q" + boost::lexical_cast<std::string>(jpegQuality) + ".jpg";
+    }
+  }
+
+
+  std::string PreviewCache::GetPath(const std::string& key) const
+  {
+    // The key starts with the public ID of the instance
+    boost::filesystem::path p(root_);
+    p /= key.substr(0, 2);
+    p /= key;
+    return p.string();
+  }
+
+
+  void PreviewCache::RemoveEntry(const std::string& key)
+  {
+    // The mutex must be locked by the caller
+    currentSize_ -= index_.Invalidate(key);
+
+    boost::system::error_code err;
+    boost::filesystem::remove(GetPath(key), err);
+  }
+
+
+  void PreviewCache::RemoveOldestEntry()
+  {
+    // The mutex must be locked by the caller
+    uint64_t size;
+    std::string key = index_.RemoveOldest(size);
+    currentSize_ -= size;
+
+    boost::system::error_code err;
+    boost::filesystem::remove(GetPath(key), err);
+  }
+
+
+  void PreviewCache::MakeRoom(uint64_t size)
+  {
+    // The mutex must be locked by the caller
+    while (!index_.IsEmpty() &&
+           currentSize_ + size > maximumSize_)
+    {
+      RemoveOldestEntry();
+    }
+  }
+
+
+  void PreviewCache::LoadExistingEntries()
+  {
+    namespace fs = boost::filesystem;
+
+    std::vector<ExistingEntry> entries;
+
+    for (fs::recursive_directory_iterator current(root_), end; current != end; ++current)
+    {
+      try
+      {
+        if (fs::is_regular_file(current->status()))
+        {
+          fs::path p = current->path();
+          std::string filename = GetFilename(p);
+          std::string instance = GetFilename(p.parent_path());
+
+          if (filename.size() > strlen(TEMPORARY_EXTENSION) &&
+              filename.substr(filename.size() - strlen(TEMPORARY_EXTENSION)) == TEMPORARY_EXTENSION)
+          {
+            // Leftover of an interrupted write
+            fs::remove(p);
+          }
+          else if (Toolbox::IsSHA1(instance) &&
+                   GetFilename(p.parent_path().parent_path()) == instance.substr(0, 2))
+          {
+            ExistingEntry entry;
+            entry.time_ = fs::last_write_time(p);
+            entry.key_ = instance + "/" + filename;
+            entry.size_ = fs::file_size(p);
+            entries.push_back(entry);
+          }
+        }
+      }
+      catch (fs::filesystem_error&)
+      {
+      }
+    }
+
+    // The oldest files are the first to be removed
+    std::sort(entries.begin(), entries.end());
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+      index_.Add(entries[i].key_, entries[i].size_);
+      currentSize_ += entries[i].size_;
+    }
+
+    MakeRoom(0);
+  }
+
+
+  PreviewCache::PreviewCache(const std::string& root,
+                             uint64_t maximumSize) :
+    root_(root),
+    maximumSize_(maximumSize),
+    currentSize_(0)
+  {
+    Toolbox::CreateDirectory(root);
+    LoadExistingEntries();
+
+    LOG(WARNING) << "Preview cache in directory " << root_ << ": " 
+                 << index_.GetSize() << " images, " << (currentSize_ / (1024 * 1024)) << "MB";
+  }
+
+
+  uint64_t PreviewCache::GetCurrentSize()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return currentSize_;
+  }
+
+
+  size_t PreviewCache::GetEntriesCount()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    return index_.GetSize();
+  }
+
+
+  bool PreviewCache::Lookup(std::string& image,
+                            const std::string& instancePublicId,
+                            unsigned int frame,
+                            ImageExtractionMode mode,
+                            unsigned int thumbnailSize,
+                            unsigned int jpegQuality)
+  {
+    GetInstanceDirectory(instancePublicId);  // Validate the public ID
+
+    const std::string key = GetKey(instancePublicId, frame, mode, thumbnailSize, jpegQuality);
+    std::string path;
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      if (!index_.Contains(key))
+      {
+        return false;
+      }
+
+      index_.MakeMostRecent(key);
+      path = GetPath(key);
+    }
+
+    try
+    {
+      // The file is read without holding the mutex: It might have
+      // been concurrently removed
+      Toolbox::ReadFile(image, path);
+      return true;
+    }
+    catch (OrthancException&)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+
+      if (index_.Contains(key))
+      {
+        LOG(ERROR) << "Unable to read from the preview cache: " << path;
+        RemoveEntry(key);
+      }
+
+      return false;
+    }
+  }
+
+
+  bool PreviewCache::Contains(const std::string& instancePublicId,
+                              unsigned int frame,
+                              ImageExtractionMode mode,
+                              unsigned int thumbnailSize,
+                              unsigned int jpegQuality)
+  {
+    GetInstanceDirectory(instancePublicId);  // Validate the public ID
+
+    boost::mutex::scoped_lock lock(mutex_);
+    return index_.Contains(GetKey(instancePublicId, frame, mode, thumbnailSize, jpegQuality));
+  }
+
+
+  void PreviewCache::Store(const std::string& instancePublicId,
+                           unsigned int frame,
+                           ImageExtractionMode mode,
+                           unsigned int thumbnailSize,
+                           unsigned int jpegQuality,
+                           const std::string& image)
+  {
+    namespace fs = boost::filesystem;
+
+    const std::string directory = GetInstanceDirectory(instancePublicId);
+    const std::string key = GetKey(instancePublicId, frame, mode, thumbnailSize, jpegQuality);
+    const std::string path = GetPath(key);
+
+    if (image.size() > maximumSize_)
+    {
+      return;
+    }
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      if (index_.Contains(key))
+      {
+        return;
+      }
+    }
+
+    // Write the file outside of the mutex, under a temporary name, so
+    // that a partially written image is never served
+    const std::string tmp = path + "." + Toolbox::GenerateUuid() + TEMPORARY_EXTENSION;
+
+    try
+    {
+      boost::system::error_code err;
+      fs::create_directories(directory, err);
+      Toolbox::WriteFile(image, tmp);
+    }
+    catch (OrthancException&)
+    {
+      LOG(ERROR) << "Unable to write to the preview cache: " << tmp;
+      boost::system::error_code err;
+      fs::remove(tmp, err);
+      return;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    boost::system::error_code err;
+
+    if (index_.Contains(key))
+    {
+      // Concurrently stored by another thread
+      fs::remove(tmp, err);
+      return;
+    }
+
+    MakeRoom(image.size());
+
+    fs::rename(tmp, path, err);
+    if (err)
+    {
+      // The instance has been concurrently invalidated
+      fs::remove(tmp, err);
+      return;
+    }
+
+    index_.Add(key, image.size());
+    currentSize_ += image.size();
+  }
+
+
+  void PreviewCache::Invalidate(const std::string& instancePublicId)
+  {
+    namespace fs = boost::filesystem;
+
+    const fs::path directory(GetInstanceDirectory(instancePublicId));
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    boost::system::error_code err;
+    if (!fs::is_directory(directory, err))
+    {
+      return;
+    }
+
+    std::vector<std::string> keys;
+    for (fs::directory_iterator current(directory, err), end; !err && current != end; current.increment(err))
+    {
+      keys.push_back(instancePublicId + "/" + GetFilename(current->path()));
+    }
+
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+      if (index_.Contains(keys[i]))
+      {
+        RemoveEntry(keys[i]);
+      }
+      else
+      {
+        fs::remove(GetPath(keys[i]), err);
+      }
+    }
+
+    // Remove the two parent directories, if they are empty
+    fs::remove(directory, err);
+    fs::remove(directory.parent_path(), err);
+  }
+
+
+  void PreviewCache::Clear()
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    while (!index_.IsEmpty())
+    {
+      RemoveOldestEntry();
+    }
+  }
+}
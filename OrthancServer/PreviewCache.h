@@ -0,0 +1,126 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#pragma once
+
+#include "../Core/Cache/LeastRecentlyUsedIndex.h"
+#include "../Core/Enumerations.h"
+
+#include <string>
+#include <stdint.h>
+#include <boost/thread.hpp>
+
+namespace Orthanc
+{
+  /**
+   * Persistent cache of the rendered PNG or JPEG images (previews,
+   * frames and thumbnails), stored in a directory of the
+   * filesystem. The entries are keyed by the instance, the frame, the
+   * extraction mode, the size of the thumbnail ("0" for the full-size
+   * image) and the JPEG quality ("0" for PNG). The total
+   * size of the cache is bounded: The least recently used entries are
+   * removed first. The cache survives a restart of Orthanc, and this
+   * class is thread-safe.
+   **/
+  class PreviewCache : public boost::noncopyable
+  {
+  private:
+    typedef LeastRecentlyUsedIndex<std::string, uint64_t>  Index;
+
+    boost::mutex  mutex_;
+    std::string   root_;
+    uint64_t      maximumSize_;
+    uint64_t      currentSize_;
+    Index         index_;
+
+    std::string GetInstanceDirectory(const std::string& instancePublicId) const;
+
+    static std::string GetKey(const std::string& instancePublicId,
+                              unsigned int frame,
+                              ImageExtractionMode mode,
+                              unsigned int thumbnailSize,
+                              unsigned int jpegQuality);
+
+    std::string GetPath(const std::string& key) const;
+
+    void RemoveEntry(const std::string& key);
+
+    void RemoveOldestEntry();
+
+    void MakeRoom(uint64_t size);
+
+    void LoadExistingEntries();
+
+  public:
+    PreviewCache(const std::string& root,
+                 uint64_t maximumSize);
+
+    const std::string& GetRoot() const
+    {
+      return root_;
+    }
+
+    uint64_t GetMaximumSize() const
+    {
+      return maximumSize_;
+    }
+
+    uint64_t GetCurrentSize();
+
+    size_t GetEntriesCount();
+
+    bool Lookup(std::string& image,
+                const std::string& instancePublicId,
+                unsigned int frame,
+                ImageExtractionMode mode,
+                unsigned int thumbnailSize,
+                unsigned int jpegQuality);
+
+    bool Contains(const std::string& instancePublicId,
+                  unsigned int frame,
+                  ImageExtractionMode mode,
+                  unsigned int thumbnailSize,
+                  unsigned int jpegQuality);
+
+    void Store(const std::string& instancePublicId,
+               unsigned int frame,
+               ImageExtractionMode mode,
+               unsigned int thumbnailSize,
+               unsigned int jpegQuality,
+               const std::string& image);
+
+    // Removes all the entries related to one instance
+    void Invalidate(const std::string& instancePublicId);
+
+    void Clear();
+  };
+}
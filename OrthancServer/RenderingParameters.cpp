@@ -0,0 +1,126 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "PrecompiledHeadersServer.h"
+#include "RenderingParameters.h"
+
+#include "../Core/OrthancException.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <boost/math/special_functions/fpclassify.hpp>
+
+namespace Orthanc
+{
+  void RenderingParameters::SetWindowing(float center,
+                                         float width)
+  {
+    if (!boost::math::isfinite(center) ||
+        !boost::math::isfinite(width) ||
+        width < 1.0f)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    hasWindowing_ = true;
+    windowCenter_ = center;
+    windowWidth_ = width;
+  }
+
+
+  float RenderingParameters::GetWindowCenter() const
+  {
+    if (!hasWindowing_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    return windowCenter_;
+  }
+
+
+  float RenderingParameters::GetWindowWidth() const
+  {
+    if (!hasWindowing_)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    return windowWidth_;
+  }
+
+
+  void RenderingParameters::ComputeTargetSize(unsigned int& targetWidth,
+                                              unsigned int& targetHeight,
+                                              unsigned int sourceWidth,
+                                              unsigned int sourceHeight) const
+  {
+    FitSize(targetWidth, targetHeight, sourceWidth, sourceHeight, maximumWidth_, maximumHeight_);
+  }
+
+
+  void RenderingParameters::FitSize(unsigned int& targetWidth,
+                                    unsigned int& targetHeight,
+                                    unsigned int sourceWidth,
+                                    unsigned int sourceHeight,
+                                    unsigned int maximumWidth,
+                                    unsigned int maximumHeight)
+  {
+    targetWidth = sourceWidth;
+    targetHeight = sourceHeight;
+
+    if (sourceWidth == 0 ||
+        sourceHeight == 0)
+    {
+      return;
+    }
+
+    // Shrink the image to respect the constraint on the width, then
+    // the constraint on the height, keeping the aspect ratio
+    if (maximumWidth != 0 &&
+        targetWidth > maximumWidth)
+    {
+      targetHeight = std::max(1u, static_cast<unsigned int>
+                              ((static_cast<uint64_t>(sourceHeight) * maximumWidth + sourceWidth / 2) / sourceWidth));
+      targetWidth = maximumWidth;
+    }
+
+    if (maximumHeight != 0 &&
+        targetHeight > maximumHeight)
+    {
+      targetWidth = std::max(1u, static_cast<unsigned int>
+                             ((static_cast<uint64_t>(sourceWidth) * maximumHeight + sourceHeight / 2) / sourceHeight));
+      targetHeight = maximumHeight;
+    }
+  }
+}
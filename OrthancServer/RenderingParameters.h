@@ -0,0 +1,111 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+namespace Orthanc
+{
+  /**
+   * Parameters of the server-side rendering of a grayscale frame into
+   * an 8bpp image: Optional window center/width that override those
+   * of the DICOM instance, and optional maximum size of the rendered
+   * image. The aspect ratio is always preserved, and the images are
+   * never enlarged.
+   **/
+  class RenderingParameters
+  {
+  private:
+    bool          hasWindowing_;
+    float         windowCenter_;
+    float         windowWidth_;
+    unsigned int  maximumWidth_;
+    unsigned int  maximumHeight_;
+
+  public:
+    RenderingParameters() :
+      hasWindowing_(false),
+      windowCenter_(0),
+      windowWidth_(0),
+      maximumWidth_(0),
+      maximumHeight_(0)
+    {
+    }
+
+    void SetWindowing(float center,
+                      float width);
+
+    void ClearWindowing()
+    {
+      hasWindowing_ = false;
+    }
+
+    bool HasWindowing() const
+    {
+      return hasWindowing_;
+    }
+
+    float GetWindowCenter() const;
+
+    float GetWindowWidth() const;
+
+    // "0" means that the corresponding dimension is not constrained
+    void SetMaximumSize(unsigned int width,
+                        unsigned int height)
+    {
+      maximumWidth_ = width;
+      maximumHeight_ = height;
+    }
+
+    unsigned int GetMaximumWidth() const
+    {
+      return maximumWidth_;
+    }
+
+    unsigned int GetMaximumHeight() const
+    {
+      return maximumHeight_;
+    }
+
+    void ComputeTargetSize(unsigned int& targetWidth,
+                           unsigned int& targetHeight,
+                           unsigned int sourceWidth,
+                           unsigned int sourceHeight) const;
+
+    static void FitSize(unsigned int& targetWidth,
+                        unsigned int& targetHeight,
+                        unsigned int sourceWidth,
+                        unsigned int sourceHeight,
+                        unsigned int maximumWidth,
+                        unsigned int maximumHeight);
+  };
+}
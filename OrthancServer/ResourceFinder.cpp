@@ -0,0 +1,711 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "PrecompiledHeadersServer.h"
+#include "ResourceFinder.h"
+
+#include "FromDcmtkBridge.h"
+#include "ServerToolbox.h"
+
+#include <glog/logging.h>
+#include <boost/regex.hpp> 
+
+namespace Orthanc
+{
+  static bool IsWildcard(const std::string& constraint)
+  {
+    return (constraint.find('-') != std::string::npos ||
+            constraint.find('*') != std::string::npos ||
+            constraint.find('\\') != std::string::npos ||
+            constraint.find('?') != std::string::npos);
+  }
+
+  static void Normalize(std::string& target,
+                        const std::string& source,
+                        bool caseSensitive)
+  {
+    if (caseSensitive)
+    {
+      target = source;
+    }
+    else
+    {
+      Toolbox::ToLowerCase(target, source);
+    }
+  }
+
+
+  static bool ApplyRangeConstraint(const std::string& value,
+                                   const std::string& constraint,
+                                   bool caseSensitive)
+  {
+    size_t separator = constraint.find('-');
+    std::string lower, upper, v;
+    Normalize(lower, constraint.substr(0, separator), caseSensitive);
+    Normalize(upper, constraint.substr(separator + 1), caseSensitive);
+    Normalize(v, value, caseSensitive);
+
+    if (lower.size() == 0 && upper.size() == 0)
+    {
+      return false;
+    }
+
+    if (lower.size() == 0)
+    {
+      return v <= upper;
+    }
+
+    if (upper.size() == 0)
+    {
+      return v >= lower;
+    }
+    
+    return (v >= lower && v <= upper);
+  }
+
+
+  static bool ApplyListConstraint(const std::string& value,
+                                  const std::string& constraint,
+                                  bool caseSensitive)
+  {
+    std::string v1;
+    Normalize(v1, value, caseSensitive);
+
+    std::vector<std::string> items;
+    Toolbox::TokenizeString(items, constraint, '\\');
+
+    for (size_t i = 0; i < items.size(); i++)
+    {
+      std::string item;
+      Normalize(item, items[i], caseSensitive);
+      if (item == v1)
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+
+  bool ResourceFinder::Matches(const std::string& value,
+                               const std::string& constraint,
+                               bool caseSensitive)
+  {
+    // http://www.itk.org/Wiki/DICOM_QueryRetrieve_Explained
+    // http://dicomiseasy.blogspot.be/2012/01/dicom-queryretrieve-part-i.html  
+
+    if (constraint.find('-') != std::string::npos)
+    {
+      return ApplyRangeConstraint(value, constraint, caseSensitive);
+    }
+    
+    if (constraint.find('\\') != std::string::npos)
+    {
+      return ApplyListConstraint(value, constraint, caseSensitive);
+    }
+
+    if (constraint.find('*') != std::string::npos ||
+        constraint.find('?') != std::string::npos)
+    {
+      // TODO - Cache the constructed regular expression
+      boost::regex pattern(Toolbox::WildcardToRegularExpression(constraint),
+                           caseSensitive ? boost::regex::normal : boost::regex::icase);
+      return boost::regex_match(value, pattern);
+    }
+    else
+    {
+      std::string v, c;
+      Normalize(v, value, caseSensitive);
+      Normalize(c, constraint, caseSensitive);
+      return v == c;
+    }
+  }
+
+
+  static bool IsSpecialTag(const DicomTag& tag)
+  {
+    // These tags of a C-FIND query are not matched against the
+    // resources
+    return (tag == DICOM_TAG_QUERY_RETRIEVE_LEVEL ||
+            tag == DICOM_TAG_SPECIFIC_CHARACTER_SET ||
+            tag == DICOM_TAG_MODALITIES_IN_STUDY);
+  }
+
+
+  static bool LookupOneInstance(std::string& result,
+                                ServerIndex& index,
+                                const std::string& id,
+                                ResourceType type)
+  {
+    if (type == ResourceType_Instance)
+    {
+      result = id;
+      return true;
+    }
+
+    std::string childId;
+    
+    {
+      std::list<std::string> children;
+      index.GetChildInstances(children, id);
+
+      if (children.empty())
+      {
+        return false;
+      }
+
+      childId = children.front();
+    }
+
+    return LookupOneInstance(result, index, childId, GetChildResourceType(type));
+  }
+
+
+  static bool IsIndexedQuery(const DicomArray& query,
+                             ResourceType level)
+  {
+    for (size_t i = 0; i < query.GetSize(); i++)
+    {
+      const DicomTag& tag = query.GetElement(i).GetTag();
+
+      if (IsSpecialTag(tag))
+      {
+        continue;
+      }
+
+      bool found = false;
+      ResourceType current = level;
+      for (;;)
+      {
+        if (DicomMap::IsMainDicomTag(tag, current))
+        {
+          found = true;
+          break;
+        }
+
+        if (current == ResourceType_Patient)
+        {
+          break;
+        }
+
+        current = GetParentResourceType(current);
+      }
+
+      if (!found)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+
+  static void ExtractQueriedTags(DicomMap& target,
+                                 const Json::Value& resource,
+                                 const DicomArray& query)
+  {
+    target.Clear();
+
+    for (size_t i = 0; i < query.GetSize(); i++)
+    {
+      std::string tag = query.GetElement(i).GetTag().Format();
+      if (resource.isMember(tag))
+      {
+        const Json::Value& value = resource[tag];
+        if (value.type() == Json::objectValue &&
+            value.isMember("Value") &&
+            value["Value"].type() == Json::stringValue)
+        {
+          target.SetValue(query.GetElement(i).GetTag(), value["Value"].asString());
+        }
+      }
+    }
+  }
+
+
+  class ResourceFinder::CandidateResources
+  {
+  private:
+    ServerIndex&  index_;
+    ResourceType  level_;
+    bool  isFilterApplied_;
+    std::set<std::string>  filtered_;
+    Json::Value*  plan_;
+
+    static void ListToSet(std::set<std::string>& target,
+                          const std::list<std::string>& source)
+    {
+      for (std::list<std::string>::const_iterator
+             it = source.begin(); it != source.end(); ++it)
+      {
+        target.insert(*it);
+      }
+    }
+
+    void AddToPlan(const std::string& lookup,
+                   const std::string& tag,
+                   const std::string& constraint,
+                   size_t candidates)
+    {
+      if (plan_ != NULL)
+      {
+        Json::Value step = Json::objectValue;
+        step["Level"] = EnumerationToString(level_);
+        step["Lookup"] = lookup;
+
+        if (!tag.empty())
+        {
+          step["Tag"] = tag;
+          step["Constraint"] = constraint;
+        }
+
+        step["Candidates"] = static_cast<unsigned int>(candidates);
+        plan_->append(step);
+      }
+    }
+
+    void Intersect(const std::list<std::string>& resources)
+    {
+      if (isFilterApplied_)
+      {
+        std::set<std::string>  s;
+        ListToSet(s, resources);
+
+        std::set<std::string> tmp = filtered_;
+        filtered_.clear();
+
+        for (std::set<std::string>::const_iterator 
+               it = tmp.begin(); it != tmp.end(); ++it)
+        {
+          if (s.find(*it) != s.end())
+          {
+            filtered_.insert(*it);
+          }
+        }
+      }
+      else
+      {
+        assert(filtered_.empty());
+        isFilterApplied_ = true;
+        ListToSet(filtered_, resources);
+      }
+    }
+
+    void ApplyExactFilter(const DicomTag& tag, const std::string& value)
+    {
+      LOG(INFO) << "Applying exact filter on tag "
+                << FromDcmtkBridge::GetName(tag) << " (value: " << value << ")";
+
+      std::list<std::string> resources;
+      index_.LookupIdentifier(resources, tag, value, level_);
+      Intersect(resources);
+
+      AddToPlan("ExactIdentifier", FromDcmtkBridge::GetName(tag), value, filtered_.size());
+    }
+
+    void ApplyRangeFilter(const DicomTag& tag, const std::string& constraint)
+    {
+      // Translate the constraint into a set of ranges that are
+      // looked up in the index. The result is a superset of the
+      // matching resources, that is refined by "Matches()".
+      std::vector< std::pair<std::string, std::string> > ranges;
+
+      if (constraint.find('-') != std::string::npos)
+      {
+        size_t separator = constraint.find('-');
+        std::string lower = constraint.substr(0, separator);
+        std::string upper = constraint.substr(separator + 1);
+        if (lower.empty() && upper.empty())
+        {
+          // This constraint matches nothing
+          Intersect(std::list<std::string>());
+          AddToPlan("Empty", FromDcmtkBridge::GetName(tag), constraint, 0);
+          return;
+        }
+
+        ranges.push_back(std::make_pair(lower, upper));
+      }
+      else if (constraint.find('\\') != std::string::npos)
+      {
+        std::vector<std::string> items;
+        Toolbox::TokenizeString(items, constraint, '\\');
+
+        for (size_t i = 0; i < items.size(); i++)
+        {
+          if (items[i].empty())
+          {
+            // The empty item cannot be looked up in the index
+            AddToPlan("NotIndexed", FromDcmtkBridge::GetName(tag), constraint, filtered_.size());
+            return;
+          }
+
+          ranges.push_back(std::make_pair(items[i], items[i]));
+        }
+      }
+      else if (constraint.find('*') != std::string::npos ||
+               constraint.find('?') != std::string::npos)
+      {
+        std::string prefix = constraint.substr(0, constraint.find_first_of("*?"));
+        if (prefix.empty())
+        {
+          // No prefix, the index is of no help
+          AddToPlan("NotIndexed", FromDcmtkBridge::GetName(tag), constraint, filtered_.size());
+          return;
+        }
+
+        // The character 0xff is greater than any byte of a valid
+        // UTF-8 string, hence this range contains all the strings
+        // starting with the prefix
+        ranges.push_back(std::make_pair(prefix, prefix + "\xff"));
+      }
+      else
+      {
+        ranges.push_back(std::make_pair(constraint, constraint));
+      }
+
+      LOG(INFO) << "Applying indexed filter on tag "
+                << FromDcmtkBridge::GetName(tag) << " (constraint: " << constraint << ")";
+
+      std::list<std::string> resources;
+      for (size_t i = 0; i < ranges.size(); i++)
+      {
+        std::list<std::string> tmp;
+        index_.LookupTagRange(tmp, tag, ranges[i].first, ranges[i].second, level_);
+        resources.splice(resources.end(), tmp);
+      }
+
+      Intersect(resources);
+
+      AddToPlan(tag.IsIdentifier() ? "IdentifierRange" : "SearchableTagRange",
+                FromDcmtkBridge::GetName(tag), constraint, filtered_.size());
+    }
+
+  public:
+    CandidateResources(ServerIndex& index,
+                       Json::Value* plan) : 
+      index_(index), 
+      level_(ResourceType_Patient), 
+      isFilterApplied_(false),
+      plan_(plan)
+    {
+    }
+
+    ResourceType GetLevel() const
+    {
+      return level_;
+    }
+
+    void GoDown()
+    {
+      assert(level_ != ResourceType_Instance);
+
+      if (isFilterApplied_)
+      {
+        std::set<std::string> tmp = filtered_;
+
+        filtered_.clear();
+
+        for (std::set<std::string>::const_iterator 
+               it = tmp.begin(); it != tmp.end(); ++it)
+        {
+          std::list<std::string> children;
+          index_.GetChildren(children, *it);
+          ListToSet(filtered_, children);
+        }
+      }
+
+      switch (level_)
+      {
+        case ResourceType_Patient:
+          level_ = ResourceType_Study;
+          break;
+
+        case ResourceType_Study:
+          level_ = ResourceType_Series;
+          break;
+
+        case ResourceType_Series:
+          level_ = ResourceType_Instance;
+          break;
+
+        default:
+          throw OrthancException(ErrorCode_InternalError);
+      }
+
+      if (isFilterApplied_)
+      {
+        AddToPlan("Children", "", "", filtered_.size());
+      }
+    }
+
+    void Flatten(std::list<std::string>& resources) const
+    {
+      resources.clear();
+
+      if (isFilterApplied_)
+      {
+        for (std::set<std::string>::const_iterator 
+               it = filtered_.begin(); it != filtered_.end(); ++it)
+        {
+          resources.push_back(*it);
+        }
+      }
+      else
+      {
+        Json::Value tmp;
+        index_.GetAllUuids(tmp, level_);
+        for (Json::Value::ArrayIndex i = 0; i < tmp.size(); i++)
+        {
+          resources.push_back(tmp[i].asString());
+        }
+      }
+    }
+
+    void ApplyFilter(const DicomTag& tag, const DicomMap& query)
+    {
+      if (query.HasTag(tag))
+      {
+        const DicomValue& value = query.GetValue(tag);
+        if (!value.IsNull())
+        {
+          std::string value = query.GetValue(tag).AsString();
+          if (value.empty())
+          {
+            // Universal matching
+          }
+          else if (tag.IsSearchable() ||
+                   (tag.IsIdentifier() && IsWildcard(value)))
+          {
+            ApplyRangeFilter(tag, value);
+          }
+          else if (tag.IsIdentifier())
+          {
+            ApplyExactFilter(tag, value);
+          }
+        }
+      }
+    }
+
+    void ApplyModalitiesInStudyFilter(const DicomMap& query)
+    {
+      /**
+       * Filtering on modalities for studies (this is an extension
+       * to standard DICOM). The studies are looked up through the
+       * indexed "Modality" tag of their child series.
+       * http://www.medicalconnections.co.uk/kb/Filtering_on_and_Retrieving_the_Modality_in_a_C_FIND
+       **/
+
+      assert(level_ == ResourceType_Study);
+
+      const DicomValue* v = query.TestAndGetValue(DICOM_TAG_MODALITIES_IN_STUDY);
+      if (v == NULL || v->IsNull() || v->AsString().empty())
+      {
+        return;
+      }
+
+      std::vector<std::string>  modalities;
+      Toolbox::TokenizeString(modalities, v->AsString(), '\\'); 
+
+      std::list<std::string> studies;
+      for (size_t i = 0; i < modalities.size(); i++)
+      {
+        if (!modalities[i].empty())
+        {
+          std::list<std::string> tmp;
+          index_.LookupTagRange(tmp, DICOM_TAG_MODALITY, modalities[i], modalities[i], ResourceType_Study);
+          studies.splice(studies.end(), tmp);
+        }
+      }
+
+      Intersect(studies);
+
+      AddToPlan("ModalitiesInStudy", FromDcmtkBridge::GetName(DICOM_TAG_MODALITIES_IN_STUDY),
+                v->AsString(), filtered_.size());
+    }
+  };
+
+
+  ResourceFinder::ResourceFinder(ServerContext& context,
+                                 ResourceType level,
+                                 const DicomMap& query) :
+    context_(context),
+    level_(level),
+    query_(query.Clone()),
+    queryArray_(new DicomArray(query))
+  {
+    if (level != ResourceType_Patient &&
+        level != ResourceType_Study &&
+        level != ResourceType_Series &&
+        level != ResourceType_Instance)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    isIndexed_ = IsIndexedQuery(*queryArray_, level);
+  }
+
+
+  void ResourceFinder::FindCandidates(std::list<std::string>& resources,
+                                      Json::Value* plan)
+  {
+    if (plan != NULL)
+    {
+      *plan = Json::arrayValue;
+    }
+
+    /**
+     * Whenever possible, we avoid returning ALL the resources for
+     * this query level, by applying the constraints on the
+     * identifiers and on the searchable tags that are indexed by the
+     * database.
+     **/
+
+    CandidateResources candidates(context_.GetIndex(), plan);
+
+    for (;;)
+    {
+      switch (candidates.GetLevel())
+      {
+        case ResourceType_Patient:
+          candidates.ApplyFilter(DICOM_TAG_PATIENT_ID, *query_);
+          candidates.ApplyFilter(DICOM_TAG_PATIENT_NAME, *query_);
+          candidates.ApplyFilter(DICOM_TAG_PATIENT_BIRTH_DATE, *query_);
+          candidates.ApplyFilter(DICOM_TAG_PATIENT_SEX, *query_);
+          break;
+
+        case ResourceType_Study:
+          candidates.ApplyFilter(DICOM_TAG_STUDY_INSTANCE_UID, *query_);
+          candidates.ApplyFilter(DICOM_TAG_ACCESSION_NUMBER, *query_);
+          candidates.ApplyFilter(DICOM_TAG_STUDY_DATE, *query_);
+          candidates.ApplyFilter(DICOM_TAG_STUDY_DESCRIPTION, *query_);
+          candidates.ApplyFilter(DICOM_TAG_STUDY_ID, *query_);
+
+          if (level_ == ResourceType_Study)
+          {
+            candidates.ApplyModalitiesInStudyFilter(*query_);
+          }
+          break;
+
+        case ResourceType_Series:
+          candidates.ApplyFilter(DICOM_TAG_SERIES_INSTANCE_UID, *query_);
+          candidates.ApplyFilter(DICOM_TAG_SERIES_DATE, *query_);
+          candidates.ApplyFilter(DICOM_TAG_SERIES_DESCRIPTION, *query_);
+          candidates.ApplyFilter(DICOM_TAG_MODALITY, *query_);
+          break;
+
+        case ResourceType_Instance:
+          candidates.ApplyFilter(DICOM_TAG_SOP_INSTANCE_UID, *query_);
+          break;
+
+        default:
+          throw OrthancException(ErrorCode_InternalError);
+      }      
+
+      if (candidates.GetLevel() == level_)
+      {
+        break;
+      }
+
+      candidates.GoDown();
+    }
+
+    candidates.Flatten(resources);
+
+    if (plan != NULL)
+    {
+      Json::Value step = Json::objectValue;
+      step["Level"] = EnumerationToString(level_);
+      step["Lookup"] = isIndexed_ ? "MatchFromIndex" : "MatchFromStorageArea";
+      step["Candidates"] = static_cast<unsigned int>(resources.size());
+      plan->append(step);
+    }
+
+    LOG(INFO) << "Number of candidate resources after filtering: " << resources.size();
+  }
+
+
+  bool ResourceFinder::GetTags(DicomMap& tags,
+                               const std::string& resource)
+  {
+    if (isIndexed_)
+    {
+      return context_.GetIndex().GetMainDicomTags(tags, resource, level_, true);
+    }
+    else
+    {
+      std::string instance;
+      if (!LookupOneInstance(instance, context_.GetIndex(), resource, level_))
+      {
+        return false;
+      }
+
+      Json::Value info;
+      context_.ReadJson(info, instance);
+      ExtractQueriedTags(tags, info, *queryArray_);
+      return true;
+    }
+  }
+
+
+  bool ResourceFinder::Matches(const DicomMap& tags) const
+  {
+    for (size_t i = 0; i < queryArray_->GetSize(); i++)
+    {
+      const DicomElement& element = queryArray_->GetElement(i);
+
+      if (element.GetValue().IsNull() ||
+          IsSpecialTag(element.GetTag()))
+      {
+        continue;
+      }
+
+      std::string value;
+      const DicomValue* v = tags.TestAndGetValue(element.GetTag());
+      if (v != NULL && !v->IsNull())
+      {
+        value = v->AsString();
+      }
+
+      // The identifiers are case-sensitive, consistently with their
+      // lookups in the index (cf. "DicomIdentifiersIndexValues")
+      if (!Matches(value, element.GetValue().AsString(), element.GetTag().IsIdentifier()))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+}
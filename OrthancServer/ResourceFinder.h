@@ -0,0 +1,111 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include "ServerContext.h"
+#include "../Core/DicomFormat/DicomArray.h"
+
+#include <memory>
+
+namespace Orthanc
+{
+  /**
+   * Lookup of the resources of one level of the DICOM hierarchy
+   * (patients, studies, series or instances) that match a query. As
+   * in C-FIND, the query associates DICOM tags with constraints: An
+   * exact value, a wildcard ("*" and "?"), a range ("lower-upper")
+   * or a list of values ("a\b\c"), the empty value being a universal
+   * match. This class is shared by the C-FIND SCP and by the REST API.
+   *
+   * The lookup is made of two steps. First, the constraints on the
+   * identifiers and on the searchable tags are looked up in the
+   * index of the database, which gives a superset of the matching
+   * resources. Then, the tags of each of these candidate resources
+   * are matched against the full query.
+   **/
+  class ResourceFinder : public boost::noncopyable
+  {
+  private:
+    class CandidateResources;
+
+    ServerContext&             context_;
+    ResourceType               level_;
+    std::auto_ptr<DicomMap>    query_;
+    std::auto_ptr<DicomArray>  queryArray_;
+    bool                       isIndexed_;
+
+  public:
+    ResourceFinder(ServerContext& context,
+                   ResourceType level,
+                   const DicomMap& query);
+
+    ResourceType GetLevel() const
+    {
+      return level_;
+    }
+
+    /**
+     * Whether all the tags of the query are main DICOM tags of the
+     * query level or of its ancestors, in which case the matching can
+     * be done against the index, without reading the storage area.
+     **/
+    bool IsIndexed() const
+    {
+      return isIndexed_;
+    }
+
+    /**
+     * Lists the candidate resources, by looking up the constraints in
+     * the index. If "plan" is not NULL, it is filled with a JSON array
+     * describing each of the lookups, for debugging purpose.
+     **/
+    void FindCandidates(std::list<std::string>& resources,
+                        Json::Value* plan);
+
+    /**
+     * Reads the queried tags of one resource, either from the index
+     * or, if the query is not indexed, from the DICOM-as-JSON summary
+     * of one of its child instances. Returns "false" if the resource
+     * does not exist anymore.
+     **/
+    bool GetTags(DicomMap& tags,
+                 const std::string& resource);
+
+    bool Matches(const DicomMap& tags) const;
+
+    static bool Matches(const std::string& value,
+                        const std::string& constraint,
+                        bool caseSensitive = false);
+  };
+}
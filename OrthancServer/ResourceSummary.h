@@ -0,0 +1,131 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include "../Core/DicomFormat/DicomTag.h"
+#include "../Core/Enumerations.h"
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+namespace Orthanc
+{
+  /**
+   * Summary of one resource, as read in batch from the index to
+   * answer the expanded listings of the REST API. It contains the
+   * main DICOM tags of the resource, the public identifier of its
+   * parent, and the number of its descendants.
+   **/
+  class ResourceSummary
+  {
+  public:
+    typedef std::map<DicomTag, std::string>  MainDicomTags;
+
+  private:
+    int64_t        internalId_;
+    ResourceType   type_;
+    std::string    publicId_;
+    std::string    parentPublicId_;
+    unsigned int   countStudies_;
+    unsigned int   countSeries_;
+    unsigned int   countInstances_;
+    MainDicomTags  mainDicomTags_;
+
+  public:
+    ResourceSummary(int64_t internalId,
+                    ResourceType type,
+                    const std::string& publicId,
+                    const std::string& parentPublicId,
+                    unsigned int countStudies,
+                    unsigned int countSeries,
+                    unsigned int countInstances) :
+      internalId_(internalId),
+      type_(type),
+      publicId_(publicId),
+      parentPublicId_(parentPublicId),
+      countStudies_(countStudies),
+      countSeries_(countSeries),
+      countInstances_(countInstances)
+    {
+    }
+
+    int64_t GetInternalId() const
+    {
+      return internalId_;
+    }
+
+    ResourceType GetResourceType() const
+    {
+      return type_;
+    }
+
+    const std::string& GetPublicId() const
+    {
+      return publicId_;
+    }
+
+    // Empty for the patients
+    const std::string& GetParentPublicId() const
+    {
+      return parentPublicId_;
+    }
+
+    unsigned int GetCountStudies() const
+    {
+      return countStudies_;
+    }
+
+    unsigned int GetCountSeries() const
+    {
+      return countSeries_;
+    }
+
+    unsigned int GetCountInstances() const
+    {
+      return countInstances_;
+    }
+
+    void SetMainDicomTag(const DicomTag& tag,
+                         const std::string& value)
+    {
+      mainDicomTags_[tag] = value;
+    }
+
+    const MainDicomTags& GetMainDicomTags() const
+    {
+      return mainDicomTags_;
+    }
+  };
+}
@@ -49,5 +49,13 @@ namespace Orthanc
 
     virtual bool Apply(ListOfStrings& outputs,
                        const ListOfStrings& inputs) = 0;
+
+    // Identifier of the remote destination of this command (empty if
+    // none). The scheduler can limit the number of commands that are
+    // simultaneously running against the same destination.
+    virtual std::string GetDestination() const
+    {
+      return "";
+    }
   };
 }
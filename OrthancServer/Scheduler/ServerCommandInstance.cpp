@@ -36,31 +36,25 @@
 
 namespace Orthanc
 {
-  bool ServerCommandInstance::Execute(IListener& listener)
+  bool ServerCommandInstance::Execute(ListOfStrings& outputs)
   {
-    ListOfStrings outputs;
-
-    bool success = false;
+    outputs.clear();
 
     try
     {
-      if (command_->Apply(outputs, inputs_))
-      {
-        success = true;
-      }
+      return command_->Apply(outputs, inputs_);
     }
     catch (OrthancException&)
     {
+      return false;
     }
+  }
 
-    if (!success)
-    {
-      listener.SignalFailure(jobId_);
-      return true;
-    }
 
+  void ServerCommandInstance::ForwardOutputs(const ListOfStrings& outputs)
+  {
     for (std::list<ServerCommandInstance*>::iterator
-           it = next_.begin(); it != next_.end(); it++)
+           it = receivers_.begin(); it != receivers_.end(); it++)
     {
       for (ListOfStrings::const_iterator
              output = outputs.begin(); output != outputs.end(); output++)
@@ -68,9 +62,6 @@ namespace Orthanc
         (*it)->AddInput(*output);
       }
     }
-
-    listener.SignalSuccess(jobId_);
-    return true;
   }
 
 
@@ -78,7 +69,8 @@ namespace Orthanc
                                                const std::string& jobId) : 
     command_(command), 
     jobId_(jobId),
-    connectedToSink_(false)
+    connectedToSink_(false),
+    predecessors_(0)
   {
     if (command_ == NULL)
     {
@@ -40,6 +40,7 @@ namespace Orthanc
   class ServerCommandInstance : public IDynamicObject
   {
     friend class ServerScheduler;
+    friend class ServerJob;
 
   public:
     class IListener
@@ -60,10 +61,14 @@ namespace Orthanc
     IServerCommand *command_;
     std::string jobId_;
     ListOfStrings inputs_;
-    std::list<ServerCommandInstance*> next_;
+    std::list<ServerCommandInstance*> next_;       // Commands that wait for this one
+    std::list<ServerCommandInstance*> receivers_;  // Commands that get the outputs of this one
     bool connectedToSink_;
+    unsigned int predecessors_;  // Number of commands that must be executed before this one
 
-    bool Execute(IListener& listener);
+    bool Execute(ListOfStrings& outputs);
+
+    void ForwardOutputs(const ListOfStrings& outputs);
 
   public:
     ServerCommandInstance(IServerCommand *command,
@@ -82,6 +87,14 @@ namespace Orthanc
     }
 
     void ConnectOutput(ServerCommandInstance& next)
+    {
+      next_.push_back(&next);
+      receivers_.push_back(&next);
+    }
+
+    // The next command will only be started once this one is over,
+    // but it does not receive the outputs of this one
+    void ConnectSuccessor(ServerCommandInstance& next)
     {
       next_.push_back(&next);
     }
@@ -100,5 +113,10 @@ namespace Orthanc
     {
       return next_;
     }
+
+    std::string GetDestination() const
+    {
+      return command_->GetDestination();
+    }
   };
 }
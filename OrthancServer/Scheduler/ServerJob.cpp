@@ -68,7 +68,7 @@ namespace Orthanc
   }
 
 
-  size_t ServerJob::Submit(SharedMessageQueue& target,
+  size_t ServerJob::Submit(std::list<ServerCommandInstance*>& target,
                            ServerCommandInstance::IListener& listener)
   {
     if (submitted_)
@@ -81,10 +81,24 @@ namespace Orthanc
 
     size_t size = filters_.size();
 
+    // Count the predecessors of each command, so that the scheduler
+    // only starts a command once all its inputs are available
     for (std::list<ServerCommandInstance*>::iterator 
            it = filters_.begin(); it != filters_.end(); it++)
     {
-      target.Enqueue(*it);
+      const std::list<ServerCommandInstance*>& nextCommands = (*it)->GetNextCommands();
+
+      for (std::list<ServerCommandInstance*>::const_iterator
+             next = nextCommands.begin(); next != nextCommands.end(); next++)
+      {
+        (*next)->predecessors_++;
+      }
+    }
+
+    for (std::list<ServerCommandInstance*>::iterator 
+           it = filters_.begin(); it != filters_.end(); it++)
+    {
+      target.push_back(*it);
     }
 
     filters_.clear();
@@ -33,7 +33,6 @@
 #pragma once
 
 #include "ServerCommandInstance.h"
-#include "../../Core/MultiThreading/SharedMessageQueue.h"
 
 namespace Orthanc
 {
@@ -50,7 +49,7 @@ namespace Orthanc
 
     void CheckOrdering();
 
-    size_t Submit(SharedMessageQueue& target,
+    size_t Submit(std::list<ServerCommandInstance*>& target,
                   ServerCommandInstance::IListener& listener);
 
   public:
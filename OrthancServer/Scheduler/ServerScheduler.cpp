@@ -38,6 +38,12 @@
 
 namespace Orthanc
 {
+  static boost::posix_time::ptime Now()
+  {
+    return boost::posix_time::microsec_clock::local_time();
+  }
+
+
   namespace
   {
     // Anonymous namespace to avoid clashes between compilation modules
@@ -79,85 +85,227 @@ namespace Orthanc
   }
 
 
-  void ServerScheduler::SignalSuccess(const std::string& jobId)
+  void ServerScheduler::CheckJobCompleted(const std::string& jobId)
   {
-    boost::mutex::scoped_lock lock(mutex_);
-
+    // The mutex must be locked by the caller. As several workers can
+    // run independent commands of the same job, a command can succeed
+    // after another one has failed: The job is over as soon as all
+    // its commands are over, whatever their outcome.
     JobInfo& info = GetJobInfo(jobId);
-    info.success_++;
 
-    assert(info.failures_ == 0);
+    if (info.success_ + info.failures_ < info.size_)
+    {
+      return;
+    }
+
+    bool success = (info.failures_ == 0);
 
-    if (info.success_ >= info.size_)
+    if (info.watched_)
     {
-      if (info.watched_)
-      {
-        watchedJobStatus_[jobId] = JobStatus_Success;
-        watchedJobFinished_.notify_all();
-      }
+      watchedJobStatus_[jobId] = (success ? JobStatus_Success : JobStatus_Failure);
+      watchedJobFinished_.notify_all();
+    }
 
+    if (success)
+    {
       LOG(INFO) << "Job successfully finished (" << info.description_ << ")";
-      jobs_.erase(jobId);
-
-      availableJob_.Release();
     }
+    else
+    {
+      LOG(ERROR) << "Job has failed (" << info.description_ << ")";
+    }
+
+    assert(info.pending_.empty());
+    jobs_.erase(jobId);
+    roundRobin_.remove(jobId);
+
+    availableJob_.Release();
+  }
+
+
+  void ServerScheduler::SignalSuccessInternal(const std::string& jobId)
+  {
+    // The mutex must be locked by the caller
+    GetJobInfo(jobId).success_++;
+    CheckJobCompleted(jobId);
+  }
+
+
+  void ServerScheduler::SignalFailureInternal(const std::string& jobId)
+  {
+    // The mutex must be locked by the caller
+    GetJobInfo(jobId).failures_++;
+    CheckJobCompleted(jobId);
+  }
+
+
+  void ServerScheduler::SignalSuccess(const std::string& jobId)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    SignalSuccessInternal(jobId);
   }
 
 
   void ServerScheduler::SignalFailure(const std::string& jobId)
   {
     boost::mutex::scoped_lock lock(mutex_);
+    SignalFailureInternal(jobId);
+  }
 
-    JobInfo& info = GetJobInfo(jobId);
-    info.failures_++;
 
-    if (info.success_ + info.failures_ >= info.size_)
+  bool ServerScheduler::PickCommand(ServerCommandInstance*& command,
+                                    bool& skip)
+  {
+    // The jobs are served in a round-robin fashion. Inside a job, a
+    // command is only started once all its predecessors are over.
+    for (std::list<std::string>::iterator 
+           job = roundRobin_.begin(); job != roundRobin_.end(); ++job)
     {
-      if (info.watched_)
+      JobInfo& info = GetJobInfo(*job);
+
+      // Skip the execution of the commands of a job that has
+      // previously failed or that was canceled
+      bool jobHasFailed = (info.failures_ > 0 || info.cancel_); 
+
+      for (std::list<ServerCommandInstance*>::iterator 
+             it = info.pending_.begin(); it != info.pending_.end(); ++it)
       {
-        watchedJobStatus_[jobId] = JobStatus_Failure;
-        watchedJobFinished_.notify_all();
-      }
+        if ((*it)->predecessors_ != 0)
+        {
+          continue;
+        }
 
-      LOG(ERROR) << "Job has failed (" << info.description_ << ")";
-      jobs_.erase(jobId);
+        if (!jobHasFailed &&
+            maxCommandsPerDestination_ != 0)
+        {
+          std::map<std::string, unsigned int>::const_iterator 
+            running = runningPerDestination_.find((*it)->GetDestination());
+          if (running != runningPerDestination_.end() &&
+              running->second >= maxCommandsPerDestination_)
+          {
+            // Too many commands are running against this destination
+            continue;
+          }
+        }
+
+        command = *it;
+        skip = jobHasFailed;
+        info.pending_.erase(it);
 
-      availableJob_.Release();
+        // This job will be served after all the other ones
+        roundRobin_.splice(roundRobin_.end(), roundRobin_, job);
+
+        return true;
+      }
     }
+
+    return false;
   }
 
 
-  void ServerScheduler::Worker(ServerScheduler* that)
+  void ServerScheduler::Worker(ServerScheduler* that,
+                               size_t workerIndex)
   {
     static const int32_t TIMEOUT = 100;
 
-    LOG(WARNING) << "The server scheduler has started";
+    LOG(INFO) << "Worker " << workerIndex << " of the server scheduler has started";
 
-    while (!that->finish_)
+    for (;;)
     {
-      std::auto_ptr<IDynamicObject> object(that->queue_.Dequeue(TIMEOUT));
-      if (object.get() != NULL)
+      ServerCommandInstance* command = NULL;
+      bool skip = false;
+      std::string destination;
+
+      {
+        boost::mutex::scoped_lock lock(that->mutex_);
+
+        while (!that->finish_ &&
+               !that->PickCommand(command, skip))
+        {
+          that->commandAvailable_.timed_wait(lock, boost::posix_time::milliseconds(TIMEOUT));
+        }
+
+        if (that->finish_)
+        {
+          if (command != NULL)
+          {
+            // This command was picked right before the scheduler was
+            // stopped, give it back
+            that->GetJobInfo(command->GetJobId()).pending_.push_front(command);
+          }
+
+          return;
+        }
+
+        destination = command->GetDestination();
+        if (!skip && !destination.empty())
+        {
+          that->runningPerDestination_[destination]++;
+        }
+
+        WorkerInfo& worker = that->workersInfo_[workerIndex];
+        worker.busy_ = true;
+        worker.jobId_ = command->GetJobId();
+        worker.destination_ = destination;
+        worker.start_ = Now();
+      }
+
+      std::auto_ptr<ServerCommandInstance> guard(command);
+      const std::string jobId = command->GetJobId();
+
+      ListOfStrings outputs;
+      bool success = (!skip && command->Execute(outputs));
+
       {
-        ServerCommandInstance& filter = dynamic_cast<ServerCommandInstance&>(*object);
+        boost::mutex::scoped_lock lock(that->mutex_);
+
+        if (success)
+        {
+          command->ForwardOutputs(outputs);
+        }
 
-        // Skip the execution of this filter if its parent job has
-        // previously failed.
-        bool jobHasFailed;
+        // Unlock the next commands in the job
+        const std::list<ServerCommandInstance*>& nextCommands = command->GetNextCommands();
+        for (std::list<ServerCommandInstance*>::const_iterator
+               next = nextCommands.begin(); next != nextCommands.end(); next++)
         {
-          boost::mutex::scoped_lock lock(that->mutex_);
-          JobInfo& info = that->GetJobInfo(filter.GetJobId());
-          jobHasFailed = (info.failures_ > 0 || info.cancel_); 
+          assert((*next)->predecessors_ > 0);
+          (*next)->predecessors_--;
         }
 
-        if (jobHasFailed)
+        if (!skip && !destination.empty())
         {
-          that->SignalFailure(filter.GetJobId());
+          std::map<std::string, unsigned int>::iterator 
+            running = that->runningPerDestination_.find(destination);
+          assert(running != that->runningPerDestination_.end());
+          if (--running->second == 0)
+          {
+            that->runningPerDestination_.erase(running);
+          }
+        }
+
+        WorkerInfo& worker = that->workersInfo_[workerIndex];
+        worker.busy_ = false;
+        worker.busyTime_ += Now() - worker.start_;
+        if (!skip)
+        {
+          worker.executedCommands_++;
+        }
+
+        // The outcome of the command must be recorded before the lock
+        // is released: Otherwise, another worker could start one of
+        // the next commands of a failed job, without skipping it
+        if (success)
+        {
+          that->SignalSuccessInternal(jobId);
         }
         else
         {
-          filter.Execute(*that);
+          that->SignalFailureInternal(jobId);
         }
       }
+
+      that->commandAvailable_.notify_all();
     }
   }
 
@@ -170,7 +318,7 @@ namespace Orthanc
     boost::mutex::scoped_lock lock(mutex_);
 
     JobInfo info;
-    info.size_ = job.Submit(queue_, *this);
+    info.size_ = job.Submit(info.pending_, *this);
     info.cancel_ = false;
     info.success_ = 0;
     info.failures_ = 0;
@@ -185,22 +333,75 @@ namespace Orthanc
     }
 
     jobs_[job.GetId()] = info;
+    roundRobin_.push_back(job.GetId());
 
     LOG(INFO) << "New job submitted (" << job.description_ << ")";
+
+    commandAvailable_.notify_all();
   }
 
 
-  ServerScheduler::ServerScheduler(unsigned int maxJobs) : availableJob_(maxJobs)
+  ServerScheduler::ServerScheduler(unsigned int maxJobs,
+                                   unsigned int threadsCount) : 
+    maxCommandsPerDestination_(0),
+    availableJob_(maxJobs)
   {
+    if (threadsCount == 0)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
     finish_ = false;
-    worker_ = boost::thread(Worker, this);
+    startTime_ = Now();
+
+    WorkerInfo info;
+    info.busy_ = false;
+    info.busyTime_ = boost::posix_time::seconds(0);
+    info.executedCommands_ = 0;
+    workersInfo_.resize(threadsCount, info);
+
+    workers_.resize(threadsCount);
+    for (unsigned int i = 0; i < threadsCount; i++)
+    {
+      workers_[i] = new boost::thread(Worker, this, i);
+    }
+
+    LOG(WARNING) << "The server scheduler has started with " << threadsCount << " worker(s)";
   }
 
 
   ServerScheduler::~ServerScheduler()
   {
-    finish_ = true;
-    worker_.join();
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      finish_ = true;
+    }
+
+    commandAvailable_.notify_all();
+
+    for (size_t i = 0; i < workers_.size(); i++)
+    {
+      workers_[i]->join();
+      delete workers_[i];
+    }
+
+    // Free the commands that have not been started
+    for (Jobs::iterator job = jobs_.begin(); job != jobs_.end(); ++job)
+    {
+      for (std::list<ServerCommandInstance*>::iterator
+             it = job->second.pending_.begin(); it != job->second.pending_.end(); ++it)
+      {
+        delete *it;
+      }
+    }
+  }
+
+
+  void ServerScheduler::SetMaxCommandsPerDestination(unsigned int count)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    maxCommandsPerDestination_ = count;
+    commandAvailable_.notify_all();
   }
 
 
@@ -333,4 +534,67 @@ namespace Orthanc
       jobs.push_back(it->first);
     }
   }
+
+
+  void ServerScheduler::GetStatus(Json::Value& target)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+
+    const boost::posix_time::ptime now = Now();
+
+    size_t queueDepth = 0;
+    Json::Value jobs = Json::arrayValue;
+
+    for (std::list<std::string>::const_iterator
+           it = roundRobin_.begin(); it != roundRobin_.end(); ++it)
+    {
+      const JobInfo& info = GetJobInfo(*it);
+      queueDepth += info.pending_.size();
+
+      Json::Value job = Json::objectValue;
+      job["ID"] = *it;
+      job["Description"] = info.description_;
+      job["Commands"] = static_cast<unsigned int>(info.size_);
+      job["Succeeded"] = static_cast<unsigned int>(info.success_);
+      job["Failed"] = static_cast<unsigned int>(info.failures_);
+      job["Pending"] = static_cast<unsigned int>(info.pending_.size());
+      job["Canceled"] = info.cancel_;
+      jobs.append(job);
+    }
+
+    const double uptime = static_cast<double>((now - startTime_).total_milliseconds());
+
+    unsigned int running = 0;
+    Json::Value workers = Json::arrayValue;
+
+    for (size_t i = 0; i < workersInfo_.size(); i++)
+    {
+      const WorkerInfo& info = workersInfo_[i];
+      boost::posix_time::time_duration busyTime = info.busyTime_;
+
+      Json::Value worker = Json::objectValue;
+      worker["Busy"] = info.busy_;
+      worker["ExecutedCommands"] = static_cast<unsigned int>(info.executedCommands_);
+
+      if (info.busy_)
+      {
+        running++;
+        busyTime += now - info.start_;
+        worker["Job"] = info.jobId_;
+        worker["Destination"] = info.destination_;
+        worker["ElapsedMilliseconds"] = static_cast<unsigned int>((now - info.start_).total_milliseconds());
+      }
+
+      worker["Utilization"] = (uptime > 0 ? 
+                               static_cast<double>(busyTime.total_milliseconds()) / uptime : 0.0);
+      workers.append(worker);
+    }
+
+    target = Json::objectValue;
+    target["QueueDepth"] = static_cast<unsigned int>(queueDepth);
+    target["RunningCommands"] = running;
+    target["MaxCommandsPerDestination"] = maxCommandsPerDestination_;
+    target["Jobs"] = jobs;
+    target["Workers"] = workers;
+  }
 }
@@ -36,6 +36,9 @@
 
 #include "../../Core/MultiThreading/Semaphore.h"
 
+#include <json/value.h>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
 namespace Orthanc
 {
   class ServerScheduler : public ServerCommandInstance::IListener
@@ -49,6 +52,17 @@ namespace Orthanc
       size_t success_;
       size_t failures_;
       std::string description_;
+      std::list<ServerCommandInstance*> pending_;   // Commands not started yet
+    };
+
+    struct WorkerInfo
+    {
+      bool busy_;
+      std::string jobId_;
+      std::string destination_;
+      boost::posix_time::ptime start_;
+      boost::posix_time::time_duration busyTime_;
+      uint64_t executedCommands_;
     };
 
     enum JobStatus
@@ -63,29 +77,48 @@ namespace Orthanc
 
     boost::mutex mutex_;
     boost::condition_variable watchedJobFinished_;
+    boost::condition_variable commandAvailable_;
     Jobs jobs_;
-    SharedMessageQueue queue_;
+    std::list<std::string> roundRobin_;  // Jobs in the order they will be served
+    std::map<std::string, unsigned int> runningPerDestination_;
+    unsigned int maxCommandsPerDestination_;
     bool finish_;
-    boost::thread worker_;
+    std::vector<boost::thread*> workers_;
+    std::vector<WorkerInfo> workersInfo_;
+    boost::posix_time::ptime startTime_;
     std::map<std::string, JobStatus> watchedJobStatus_;
     Semaphore availableJob_;
 
     JobInfo& GetJobInfo(const std::string& jobId);
 
+    void CheckJobCompleted(const std::string& jobId);
+
+    void SignalSuccessInternal(const std::string& jobId);
+
+    void SignalFailureInternal(const std::string& jobId);
+
     virtual void SignalSuccess(const std::string& jobId);
 
     virtual void SignalFailure(const std::string& jobId);
 
-    static void Worker(ServerScheduler* that);
+    bool PickCommand(ServerCommandInstance*& command,
+                     bool& skip);
+
+    static void Worker(ServerScheduler* that,
+                       size_t workerIndex);
 
     void SubmitInternal(ServerJob& job,
                         bool watched);
 
   public:
-    ServerScheduler(unsigned int maxjobs);
+    ServerScheduler(unsigned int maxjobs,
+                    unsigned int threadsCount = 1);
 
     ~ServerScheduler();
 
+    // The value "0" means no limit
+    void SetMaxCommandsPerDestination(unsigned int count);
+
     void Submit(ServerJob& job);
 
     bool SubmitAndWait(ListOfStrings& outputs,
@@ -116,5 +149,7 @@ namespace Orthanc
     }
 
     void GetListOfJobs(ListOfStrings& jobs);
+
+    void GetStatus(Json::Value& target);
   };
 }
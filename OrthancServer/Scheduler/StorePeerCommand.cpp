@@ -32,12 +32,17 @@
 
 #include "StorePeerCommand.h"
 
-#include "../../Core/HttpClient.h"
-
 #include <glog/logging.h>
+#include <boost/lexical_cast.hpp>
 
 namespace Orthanc
 {
+  // The instances are sent to the peer by batches, each batch being
+  // packed into a single "multipart/related" request whose size is
+  // bounded
+  static const size_t MAX_BATCH_SIZE = 64 * 1024 * 1024;
+
+
   StorePeerCommand::StorePeerCommand(ServerContext& context,
                                      const OrthancPeerParameters& peer,
                                      bool ignoreExceptions) : 
@@ -47,6 +52,143 @@ namespace Orthanc
   {
   }
 
+
+  void StorePeerCommand::SendInstance(ListOfStrings& outputs,
+                                      HttpClient& client,
+                                      const std::string& instance)
+  {
+    LOG(INFO) << "Sending resource " << instance << " to peer \"" 
+              << peer_.GetUrl() << "\"";
+
+    try
+    {
+      context_.ReadFile(client.AccessPostData(), instance, FileContentType_Dicom);
+
+      client.SetContentType("application/dicom");
+      client.SetTimeout(0);
+
+      std::string answer;
+      if (!client.Apply(answer))
+      {
+        LOG(ERROR) << "Unable to send resource " << instance << " to peer \"" << peer_.GetUrl() << "\"";
+        throw OrthancException(ErrorCode_NetworkProtocol);
+      }
+
+      // Only chain with other commands if this command succeeds
+      outputs.push_back(instance);
+    }
+    catch (OrthancException& e)
+    {
+      LOG(ERROR) << "Unable to forward to an Orthanc peer in a Lua script (instance " 
+                 << instance << ", peer " << peer_.GetUrl() << "): " << e.What();
+
+      if (!ignoreExceptions_)
+      {
+        throw;
+      }
+    }
+  }
+
+
+  void StorePeerCommand::SignalBatchFailure(const std::vector<std::string>& instances,
+                                            const std::string& reason)
+  {
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+      LOG(ERROR) << "Unable to forward to an Orthanc peer in a Lua script (instance " 
+                 << instances[i] << ", peer " << peer_.GetUrl() << "): " << reason;
+    }
+
+    if (!ignoreExceptions_)
+    {
+      throw OrthancException(ErrorCode_NetworkProtocol);
+    }
+  }
+
+
+  bool StorePeerCommand::SendBatch(ListOfStrings& outputs,
+                                   HttpClient& client,
+                                   MultipartRelatedWriter& batch,
+                                   const std::vector<std::string>& instances)
+  {
+    LOG(INFO) << "Sending a batch of " << instances.size() << " resources to peer \"" 
+              << peer_.GetUrl() << "\"";
+
+    client.SetContentType(batch.GetContentType());
+    client.SetTimeout(Configuration::GetGlobalIntegerParameter("OrthancPeersBatchTimeout", 0));
+    batch.Finish(client.AccessPostData());
+
+    std::string s;
+    bool success;
+
+    try
+    {
+      success = client.Apply(s);
+    }
+    catch (OrthancException& e)
+    {
+      // Network error or timeout: The peer might have received the
+      // batch, but this cannot be known
+      client.AccessPostData().clear();
+      SignalBatchFailure(instances, e.What());
+      return true;
+    }
+
+    client.AccessPostData().clear();
+
+    Json::Value answer;
+    Json::Reader reader;
+    if (!reader.parse(s, answer) ||
+        answer.type() != Json::arrayValue)
+    {
+      // This peer is unable to ingest batches (e.g. an older version
+      // of Orthanc, that answers with a single status): Resend the
+      // instances one by one. Resending an instance that was already
+      // received is harmless.
+      LOG(WARNING) << "The Orthanc peer " << peer_.GetUrl() 
+                   << " does not accept batches of instances, sending them one by one";
+
+      for (size_t i = 0; i < instances.size(); i++)
+      {
+        SendInstance(outputs, client, instances[i]);
+      }
+
+      return false;
+    }
+
+    if (!success ||
+        answer.size() != instances.size())
+    {
+      SignalBatchFailure(instances, "Bad answer to the batch (HTTP status " + 
+                         boost::lexical_cast<std::string>(client.GetLastStatus()) + ")");
+      return true;
+    }
+
+    for (Json::Value::ArrayIndex i = 0; i < answer.size(); i++)
+    {
+      if (answer[i].type() == Json::objectValue &&
+          answer[i].isMember("Status") &&
+          answer[i]["Status"].asString() != EnumerationToString(StoreStatus_Failure))
+      {
+        // Only chain with other commands if this instance was stored
+        outputs.push_back(instances[i]);
+      }
+      else
+      {
+        LOG(ERROR) << "Unable to forward to an Orthanc peer in a Lua script (instance " 
+                   << instances[i] << ", peer " << peer_.GetUrl() << "): The peer has rejected the instance";
+
+        if (!ignoreExceptions_)
+        {
+          throw OrthancException(ErrorCode_NetworkProtocol);
+        }
+      }
+    }
+
+    return true;
+  }
+
+
   bool StorePeerCommand::Apply(ListOfStrings& outputs,
                                const ListOfStrings& inputs)
   {
@@ -63,25 +205,39 @@ namespace Orthanc
     client.SetUrl(peer_.GetUrl() + "instances");
     client.SetMethod(HttpMethod_Post);
 
+    int batchSize = Configuration::GetGlobalIntegerParameter("OrthancPeersBatchSize", 16);
+
+    if (batchSize <= 1 ||
+        inputs.size() <= 1)
+    {
+      for (ListOfStrings::const_iterator
+             it = inputs.begin(); it != inputs.end(); ++it)
+      {
+        SendInstance(outputs, client, *it);
+      }
+
+      return true;
+    }
+
+    MultipartRelatedWriter batch("application/dicom");
+    std::vector<std::string> instances;
+    bool isBatchSupported = true;
+
     for (ListOfStrings::const_iterator
            it = inputs.begin(); it != inputs.end(); ++it)
     {
-      LOG(INFO) << "Sending resource " << *it << " to peer \"" 
-                << peer_.GetUrl() << "\"";
+      if (!isBatchSupported)
+      {
+        SendInstance(outputs, client, *it);
+        continue;
+      }
 
       try
       {
-        context_.ReadFile(client.AccessPostData(), *it, FileContentType_Dicom);
-
-        std::string answer;
-        if (!client.Apply(answer))
-        {
-          LOG(ERROR) << "Unable to send resource " << *it << " to peer \"" << peer_.GetUrl() << "\"";
-          throw OrthancException(ErrorCode_NetworkProtocol);
-        }
-
-        // Only chain with other commands if this command succeeds
-        outputs.push_back(*it);
+        std::string dicom;
+        context_.ReadFile(dicom, *it, FileContentType_Dicom);
+        batch.AddPart(dicom);
+        instances.push_back(*it);
       }
       catch (OrthancException& e)
       {
@@ -93,6 +249,18 @@ namespace Orthanc
           throw;
         }
       }
+
+      if (instances.size() >= static_cast<size_t>(batchSize) ||
+          batch.GetSize() >= MAX_BATCH_SIZE)
+      {
+        isBatchSupported = SendBatch(outputs, client, batch, instances);
+        instances.clear();
+      }
+    }
+
+    if (!instances.empty())
+    {
+      SendBatch(outputs, client, batch, instances);
     }
 
     return true;
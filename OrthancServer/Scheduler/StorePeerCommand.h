@@ -35,6 +35,8 @@
 #include "IServerCommand.h"
 #include "../ServerContext.h"
 #include "../OrthancInitialization.h"
+#include "../../Core/HttpClient.h"
+#include "../../Core/MultipartRelatedWriter.h"
 
 namespace Orthanc
 {
@@ -45,6 +47,18 @@ namespace Orthanc
     OrthancPeerParameters peer_;
     bool ignoreExceptions_;
 
+    void SendInstance(ListOfStrings& outputs,
+                      HttpClient& client,
+                      const std::string& instance);
+
+    void SignalBatchFailure(const std::vector<std::string>& instances,
+                            const std::string& reason);
+
+    bool SendBatch(ListOfStrings& outputs,
+                   HttpClient& client,
+                   MultipartRelatedWriter& batch,
+                   const std::vector<std::string>& instances);
+
   public:
     StorePeerCommand(ServerContext& context,
                      const OrthancPeerParameters& peer,
@@ -52,5 +66,10 @@ namespace Orthanc
     
     virtual bool Apply(ListOfStrings& outputs,
                        const ListOfStrings& inputs);
+
+    virtual std::string GetDestination() const
+    {
+      return "peer:" + peer_.GetUrl();
+    }
   };
 }
@@ -51,5 +51,10 @@ namespace Orthanc
 
     virtual bool Apply(ListOfStrings& outputs,
                        const ListOfStrings& inputs);
+
+    virtual std::string GetDestination() const
+    {
+      return "modality:" + modality_.GetApplicationEntityTitle();
+    }
   };
 }
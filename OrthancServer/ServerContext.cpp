@@ -34,12 +34,17 @@
 #include "ServerContext.h"
 
 #include "../Core/HttpServer/FilesystemHttpSender.h"
+#include "../Core/ImageFormats/ImageProcessing.h"
+#include "../Core/ImageFormats/JpegWriter.h"
+#include "../Core/ImageFormats/PngWriter.h"
 #include "../Core/Lua/LuaFunctionCall.h"
+#include "DicomFrameIndex.h"
 #include "FromDcmtkBridge.h"
 #include "ServerToolbox.h"
 #include "OrthancInitialization.h"
 
 #include <glog/logging.h>
+#include <json/writer.h>
 #include <EmbeddedResources.h>
 #include <dcmtk/dcmdata/dcfilefo.h>
 
@@ -52,13 +57,13 @@
 #include "OrthancRestApi/OrthancRestApi.h"
 #include "../Plugins/Engine/OrthancPlugins.h"
 
-
-#define ENABLE_DICOM_CACHE  1
-
 static const char* RECEIVED_INSTANCE_FILTER = "ReceivedInstanceFilter";
 static const char* ON_STORED_INSTANCE = "OnStoredInstance";
 
-static const size_t DICOM_CACHE_SIZE = 2;
+static const unsigned int DICOM_CACHE_SHARDS = 16;
+static const uint64_t MEGA_BYTES = 1024 * 1024;
+static const unsigned int DEFAULT_THUMBNAIL_SIZE = 128;
+static const int32_t PREGENERATE_THUMBNAILS_TIMEOUT = 100;  // In milliseconds
 
 /**
  * IMPORTANT: We make the assumption that the same instance of
@@ -71,12 +76,169 @@ static const size_t DICOM_CACHE_SIZE = 2;
 
 namespace Orthanc
 {
+  static unsigned int GetIndexReadConnections()
+  {
+    int count = Configuration::GetGlobalIntegerParameter("IndexReadConnections", 4);
+    return (count > 0 ? static_cast<unsigned int>(count) : 0);
+  }
+
+
+  static unsigned int GetSchedulerThreads()
+  {
+    // Bound the number of workers, as each of them is a thread
+    static const int MAX_SCHEDULER_THREADS = 64;
+
+    int count = Configuration::GetGlobalIntegerParameter("SchedulerThreads", 4);
+    if (count < 1 ||
+        count > MAX_SCHEDULER_THREADS)
+    {
+      int clamped = (count < 1 ? 1 : MAX_SCHEDULER_THREADS);
+      LOG(WARNING) << "Invalid value for \"SchedulerThreads\" (" << count
+                   << "), using " << clamped << " worker(s)";
+      count = clamped;
+    }
+
+    return static_cast<unsigned int>(count);
+  }
+
+
+  namespace
+  {
+    // Anonymous namespace to avoid clashes between compilation modules
+
+    class StableSeries : public IDynamicObject
+    {
+    private:
+      std::string  publicId_;
+
+    public:
+      StableSeries(const std::string& publicId) : publicId_(publicId)
+      {
+      }
+
+      const std::string& GetPublicId() const
+      {
+        return publicId_;
+      }
+    };
+  }
+
+
+  void ServerContext::PregenerateThumbnailsThread(ServerContext* that)
+  {
+    while (!that->done_)
+    {
+      std::auto_ptr<IDynamicObject> obj(that->stableSeriesQueue_.Dequeue(PREGENERATE_THUMBNAILS_TIMEOUT));
+      if (obj.get() == NULL)
+      {
+        continue;
+      }
+
+      const std::string& series = dynamic_cast<StableSeries&>(*obj).GetPublicId();
+
+      std::list<std::string> instances;
+      try
+      {
+        that->index_.GetChildInstances(instances, series);
+      }
+      catch (OrthancException&)
+      {
+        // The series has been deleted in the meantime
+        continue;
+      }
+
+      for (std::list<std::string>::const_iterator
+             it = instances.begin(); it != instances.end() && !that->done_; ++it)
+      {
+        try
+        {
+          if (!that->previewCache_->Contains(*it, 0, ImageExtractionMode_Preview, that->thumbnailSize_, 0))
+          {
+            // Do not go through the cache of parsed DICOM instances,
+            // which is reserved to the interactive accesses
+            std::string dicom, png;
+            that->ReadFile(dicom, *it, FileContentType_Dicom);
+
+            ParsedDicomFile parsed(dicom);
+            RenderImage(png, parsed, 0, ImageExtractionMode_Preview, that->thumbnailSize_, 0);
+            that->StorePreview(*it, 0, ImageExtractionMode_Preview, that->thumbnailSize_, 0, png);
+          }
+        }
+        catch (OrthancException& e)
+        {
+          LOG(INFO) << "Cannot generate the thumbnail of instance " << *it << ": " << e.What();
+        }
+      }
+
+      LOG(INFO) << "Thumbnails are available for the " << instances.size() 
+                << " instances of series " << series;
+    }
+  }
+
+
+  void ServerContext::RenderImage(std::string& result,
+                                  ParsedDicomFile& dicom,
+                                  unsigned int frame,
+                                  ImageExtractionMode mode,
+                                  unsigned int thumbnailSize,
+                                  unsigned int jpegQuality)
+  {
+    if (thumbnailSize == 0)
+    {
+      if (jpegQuality == 0)
+      {
+        dicom.ExtractPngImage(result, frame, mode);
+      }
+      else
+      {
+        dicom.ExtractJpegImage(result, frame, mode, static_cast<uint8_t>(jpegQuality));
+      }
+
+      return;
+    }
+
+    ImageBuffer buffer;
+    dicom.ExtractImage(buffer, frame, mode);
+    ImageAccessor source(buffer.GetConstAccessor());
+
+    // Fit the image into a square of size "thumbnailSize", keeping
+    // its aspect ratio. Small images are never enlarged.
+    unsigned int width, height;
+    RenderingParameters::FitSize(width, height, source.GetWidth(), source.GetHeight(),
+                                 thumbnailSize, thumbnailSize);
+
+    ImageBuffer thumbnail(width, height, source.GetFormat());
+    ImageAccessor target(thumbnail.GetAccessor());
+    ImageProcessing::Downscale(target, source);
+
+    if (jpegQuality == 0)
+    {
+      PngWriter writer;
+      writer.WriteToMemory(result, target);
+    }
+    else
+    {
+      JpegWriter writer;
+      writer.SetQuality(static_cast<uint8_t>(jpegQuality));
+      writer.WriteToMemory(result, target);
+    }
+  }
+
+
   ServerContext::ServerContext(IDatabaseWrapper& database) :
-    index_(*this, database),
+    index_(*this, database, GetIndexReadConnections()),
     compressionEnabled_(false),
+    storeDicomAsJson_(true),
     provider_(*this),
-    dicomCache_(provider_, DICOM_CACHE_SIZE),
-    scheduler_(Configuration::GetGlobalIntegerParameter("LimitJobs", 10)),
+    dicomCache_(provider_, 
+                static_cast<size_t>(Configuration::GetGlobalIntegerParameter("DicomCacheSize", 128)) * MEGA_BYTES,
+                DICOM_CACHE_SHARDS),
+    scheduler_(Configuration::GetGlobalIntegerParameter("LimitJobs", 10),
+               GetSchedulerThreads()),
+    previewCache_(NULL),
+    thumbnailSize_(DEFAULT_THUMBNAIL_SIZE),
+    pregenerateThumbnails_(false),
+    done_(false),
     plugins_(NULL),
     pluginsManager_(NULL)
   {
@@ -85,10 +247,159 @@ namespace Orthanc
     uint64_t s = Configuration::GetGlobalIntegerParameter("DicomAssociationCloseDelay", 5);  // In seconds
     scu_.SetMillisecondsBeforeClose(s * 1000);  // Milliseconds are expected here
 
+    int associations = Configuration::GetGlobalIntegerParameter("DicomAssociationsPerModality", 4);
+    if (associations < 1)
+    {
+      LOG(WARNING) << "Invalid value for \"DicomAssociationsPerModality\" (" << associations 
+                   << "), using 1 association per modality";
+      associations = 1;
+    }
+
+    scu_.SetMaxConnectionsPerModality(static_cast<unsigned int>(associations));
+
+    int perDestination = Configuration::GetGlobalIntegerParameter("SchedulerThreadsPerDestination", 0);
+    if (perDestination < 0)
+    {
+      LOG(WARNING) << "Invalid value for \"SchedulerThreadsPerDestination\" (" << perDestination 
+                   << "), not limiting the number of workers per destination";
+      perDestination = 0;
+    }
+
+    scheduler_.SetMaxCommandsPerDestination(static_cast<unsigned int>(perDestination));
+
     lua_.Execute(Orthanc::EmbeddedResources::LUA_TOOLBOX);
     lua_.SetHttpProxy(Configuration::GetGlobalStringParameter("HttpProxy", ""));
   }
 
+  ServerContext::~ServerContext()
+  {
+    done_ = true;
+
+    if (pregenerateThumbnailsThread_.joinable())
+    {
+      pregenerateThumbnailsThread_.join();
+    }
+  }
+
+
+  void ServerContext::SetPreviewCache(PreviewCache& cache,
+                                      bool pregenerateThumbnails)
+  {
+    if (previewCache_ != NULL)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    previewCache_ = &cache;
+    pregenerateThumbnails_ = pregenerateThumbnails;
+
+    if (pregenerateThumbnails)
+    {
+      pregenerateThumbnailsThread_ = boost::thread(PregenerateThumbnailsThread, this);
+    }
+  }
+
+
+  PreviewCache& ServerContext::GetPreviewCache()
+  {
+    if (previewCache_ == NULL)
+    {
+      throw OrthancException(ErrorCode_BadSequenceOfCalls);
+    }
+
+    return *previewCache_;
+  }
+
+
+  void ServerContext::SetThumbnailSize(unsigned int size)
+  {
+    if (size == 0)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    thumbnailSize_ = size;
+  }
+
+
+  void ServerContext::StorePreview(const std::string& instancePublicId,
+                                   unsigned int frame,
+                                   ImageExtractionMode mode,
+                                   unsigned int thumbnailSize,
+                                   unsigned int jpegQuality,
+                                   const std::string& image)
+  {
+    previewCache_->Store(instancePublicId, frame, mode, thumbnailSize, jpegQuality, image);
+
+    /**
+     * The image might have been rendered from an instance that was
+     * deleted in the meantime, in which case "Invalidate()" may have
+     * been called before "Store()": The stale preview must not
+     * survive. Checking the index once the image is in the cache
+     * closes the race, as the deletion is written to the index before
+     * the preview cache is invalidated. This check cannot be done
+     * within the mutex of the preview cache, as "SignalChange()" is
+     * called while the index is locked.
+     **/
+    std::map<MetadataType, std::string> metadata;
+    if (!index_.LookupStoredInstance(metadata, instancePublicId))
+    {
+      previewCache_->Invalidate(instancePublicId);
+    }
+  }
+
+
+  void ServerContext::ExtractImage(std::string& result,
+                                   const std::string& instancePublicId,
+                                   unsigned int frame,
+                                   ImageExtractionMode mode,
+                                   unsigned int thumbnailSize,
+                                   unsigned int jpegQuality)
+  {
+    if (previewCache_ != NULL &&
+        previewCache_->Lookup(result, instancePublicId, frame, mode, thumbnailSize, jpegQuality))
+    {
+      return;
+    }
+
+    {
+      FrameLocker locker(*this, instancePublicId, frame);
+      RenderImage(result, locker.GetDicom(), locker.GetFrame(), mode, thumbnailSize, jpegQuality);
+    }
+
+    if (previewCache_ != NULL)
+    {
+      StorePreview(instancePublicId, frame, mode, thumbnailSize, jpegQuality, result);
+    }
+  }
+
+
+  void ServerContext::ExtractPngImage(std::string& png,
+                                      const std::string& instancePublicId,
+                                      unsigned int frame,
+                                      ImageExtractionMode mode,
+                                      unsigned int thumbnailSize)
+  {
+    ExtractImage(png, instancePublicId, frame, mode, thumbnailSize, 0);
+  }
+
+
+  void ServerContext::ExtractJpegImage(std::string& jpeg,
+                                       const std::string& instancePublicId,
+                                       unsigned int frame,
+                                       ImageExtractionMode mode,
+                                       unsigned int thumbnailSize,
+                                       uint8_t quality)
+  {
+    if (quality < 1 || quality > 100)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    ExtractImage(jpeg, instancePublicId, frame, mode, thumbnailSize, quality);
+  }
+
+
   void ServerContext::SetCompressionEnabled(bool enabled)
   {
     if (enabled)
@@ -99,6 +410,20 @@ namespace Orthanc
     compressionEnabled_ = enabled;
   }
 
+  void ServerContext::SetStoreDicomAsJson(bool store)
+  {
+    if (store)
+    {
+      LOG(WARNING) << "The DICOM-as-JSON attachments are written at ingest";
+    }
+    else
+    {
+      LOG(WARNING) << "The DICOM-as-JSON attachments are generated on their first access";
+    }
+
+    storeDicomAsJson_ = store;
+  }
+
   void ServerContext::RemoveFile(const std::string& fileUuid,
                                  FileContentType type)
   {
@@ -267,6 +592,14 @@ namespace Orthanc
         else 
         {
           command.AddInput(instance);
+
+          // The operations of the script must be applied in order,
+          // even if they are chained through an explicit instance
+          // (e.g. "Delete(SendToModality(instanceId, 'sample'))")
+          if (previousCommand != NULL)
+          {
+            previousCommand->ConnectSuccessor(command);
+          }
         }
 
         previousCommand = &command;
@@ -278,6 +611,33 @@ namespace Orthanc
   }
 
 
+  ServerContext::PendingInstanceLocker::PendingInstanceLocker(ServerContext& that,
+                                                              const std::string& instancePublicId) :
+    that_(that),
+    instancePublicId_(instancePublicId)
+  {
+    boost::mutex::scoped_lock lock(that_.pendingInstancesMutex_);
+
+    while (that_.pendingInstances_.find(instancePublicId_) != that_.pendingInstances_.end())
+    {
+      that_.pendingInstancesChanged_.wait(lock);
+    }
+
+    that_.pendingInstances_.insert(instancePublicId_);
+  }
+
+
+  ServerContext::PendingInstanceLocker::~PendingInstanceLocker()
+  {
+    {
+      boost::mutex::scoped_lock lock(that_.pendingInstancesMutex_);
+      that_.pendingInstances_.erase(instancePublicId_);
+    }
+
+    that_.pendingInstancesChanged_.notify_all();
+  }
+
+
   StoreStatus ServerContext::Store(std::string& resultPublicId,
                                    DicomInstanceToStore& dicom)
   {
@@ -296,26 +656,78 @@ namespace Orthanc
         return StoreStatus_FilteredOut;
       }
 
-      if (compressionEnabled_)
-      {
-        accessor_.SetCompressionForNextOperations(CompressionType_Zlib);
-      }
-      else
+      typedef std::map<MetadataType, std::string>  InstanceMetadata;
+      InstanceMetadata  instanceMetadata;
+      StoreStatus status;
+
       {
-        accessor_.SetCompressionForNextOperations(CompressionType_None);
-      }      
+        // Wait for any concurrent storage of the same instance to
+        // complete, then check whether the instance is already in
+        // the index, in which case nothing is written to the disk
+        PendingInstanceLocker pending(*this, resultPublicId);
+
+        if (index_.LookupStoredInstance(instanceMetadata, resultPublicId))
+        {
+          status = StoreStatus_AlreadyStored;
+        }
+        else
+        {
+          // The compression is given explicitly to the shared accessor,
+          // so that several instances can be compressed, hashed and
+          // written to the disk in parallel, without any lock
+          CompressionType compression = (compressionEnabled_ ? CompressionType_Zlib : CompressionType_None);
+
+          // Locate the frames of multi-frame instances once for all,
+          // so that they can later be read one at a time
+          DicomFrameIndex frameIndex;
+          bool hasFrameIndex = (dicom.HasFile() ?
+                                frameIndex.ParseFile(dicom.GetFilePath()) :
+                                frameIndex.Parse(dicom.GetBufferData(), dicom.GetBufferSize()));
+
+          if (hasFrameIndex &&
+              frameIndex.GetFramesCount() > 1)
+          {
+            std::string serialized;
+            frameIndex.Serialize(serialized);
+            dicom.GetMetadata()[std::make_pair(ResourceType_Instance, MetadataType_Instance_FrameIndex)] = serialized;
+          }
 
-      FileInfo dicomInfo = accessor_.Write(dicom.GetBufferData(), dicom.GetBufferSize(), FileContentType_Dicom);
-      FileInfo jsonInfo = accessor_.Write(dicom.GetJson().toStyledString(), FileContentType_DicomAsJson);
+          ServerIndex::Attachments attachments;
 
-      ServerIndex::Attachments attachments;
-      attachments.push_back(dicomInfo);
-      attachments.push_back(jsonInfo);
+          if (dicom.HasFile())
+          {
+            // The instance was streamed to a file (large HTTP upload):
+            // Without compression, this file is adopted as such by the
+            // storage area, and its MD5 is already known
+            attachments.push_back(accessor_.WriteFile(dicom.GetFilePath(), dicom.GetFileSize(), dicom.GetFileMD5(),
+                                                      FileContentType_Dicom, compression));
+          }
+          else
+          {
+            attachments.push_back(accessor_.Write(dicom.GetBufferData(), dicom.GetBufferSize(), 
+                                                  FileContentType_Dicom, compression));
+          }
 
-      typedef std::map<MetadataType, std::string>  InstanceMetadata;
-      InstanceMetadata  instanceMetadata;
-      StoreStatus status = index_.Store(instanceMetadata, dicom.GetSummary(), attachments, 
-                                        dicom.GetRemoteAet(), dicom.GetMetadata());
+          if (storeDicomAsJson_)
+          {
+            // Compact JSON, without the indentation of "toStyledString()"
+            attachments.push_back(accessor_.Write(Json::FastWriter().write(dicom.GetJson()),
+                                                  FileContentType_DicomAsJson, compression));
+          }
+
+          status = index_.Store(instanceMetadata, dicom.GetSummary(), attachments, 
+                                dicom.GetRemoteAet(), dicom.GetMetadata());
+
+          if (status != StoreStatus_Success)
+          {
+            for (ServerIndex::Attachments::const_iterator 
+                   it = attachments.begin(); it != attachments.end(); ++it)
+            {
+              accessor_.Remove(it->GetUuid(), it->GetContentType());
+            }
+          }
+        }
+      }
 
       dicom.GetMetadata().clear();
 
@@ -325,12 +737,6 @@ namespace Orthanc
         dicom.GetMetadata().insert(std::make_pair(std::make_pair(ResourceType_Instance, it->first),
                                                   it->second));
       }
-            
-      if (status != StoreStatus_Success)
-      {
-        accessor_.Remove(dicomInfo.GetUuid(), FileContentType_Dicom);
-        accessor_.Remove(jsonInfo.GetUuid(), FileContentType_DicomAsJson);
-      }
 
       switch (status)
       {
@@ -402,28 +808,82 @@ namespace Orthanc
 
   void ServerContext::AnswerAttachment(RestApiOutput& output,
                                        const std::string& instancePublicId,
-                                       FileContentType content)
+                                       FileContentType content,
+                                       const std::string& range)
   {
     FileInfo attachment;
-    if (!index_.LookupAttachment(attachment, instancePublicId, content))
+    if (!LookupAttachment(attachment, instancePublicId, content))
     {
       throw OrthancException(ErrorCode_InternalError);
     }
 
-    accessor_.SetCompressionForNextOperations(attachment.GetCompressionType());
-
-    std::auto_ptr<HttpFileSender> sender(accessor_.ConstructHttpFileSender(attachment.GetUuid(), attachment.GetContentType()));
+    std::auto_ptr<HttpFileSender> sender(accessor_.ConstructHttpFileSender(attachment.GetUuid(), 
+                                                                           attachment.GetContentType(),
+                                                                           attachment.GetCompressionType()));
     sender->SetContentType(GetMimeType(content));
     sender->SetDownloadFilename(instancePublicId + ".dcm");
-    output.AnswerFile(*sender);
+    output.AnswerFile(*sender, range);
+  }
+
+
+  void ServerContext::GenerateDicomAsJson(const std::string& instancePublicId)
+  {
+    LOG(INFO) << "Generating the DICOM-as-JSON summary of instance " << instancePublicId;
+
+    Json::Value json;
+
+    {
+      DicomCacheLocker locker(*this, instancePublicId);
+      locker.GetDicom().ToJson(json, false);
+    }
+
+    std::string s = Json::FastWriter().write(json);
+    if (!AddAttachment(instancePublicId, FileContentType_DicomAsJson, s.c_str(), s.size()))
+    {
+      LOG(WARNING) << "Cannot store the DICOM-as-JSON summary of instance " << instancePublicId;
+    }
+  }
+
+
+  bool ServerContext::LookupAttachment(FileInfo& attachment,
+                                       const std::string& instancePublicId,
+                                       FileContentType content)
+  {
+    if (index_.LookupAttachment(attachment, instancePublicId, content))
+    {
+      return true;
+    }
+
+    if (content != FileContentType_DicomAsJson)
+    {
+      return false;
+    }
+
+    // The summary was not written at ingest (or was deleted to be
+    // regenerated in the compact format). Only one thread generates
+    // it: The others wait, then find it in the index.
+    PendingInstanceLocker pending(*this, instancePublicId);
+
+    if (!index_.LookupAttachment(attachment, instancePublicId, content))
+    {
+      GenerateDicomAsJson(instancePublicId);
+    }
+
+    return index_.LookupAttachment(attachment, instancePublicId, content);
   }
 
 
   void ServerContext::ReadJson(Json::Value& result,
                                const std::string& instancePublicId)
   {
+    FileInfo attachment;
+    if (!LookupAttachment(attachment, instancePublicId, FileContentType_DicomAsJson))
+    {
+      throw OrthancException(ErrorCode_InternalError);
+    }
+
     std::string s;
-    ReadFile(s, instancePublicId, FileContentType_DicomAsJson);
+    accessor_.Read(s, attachment.GetUuid(), attachment.GetContentType(), attachment.GetCompressionType());
 
     Json::Reader reader;
     if (!reader.parse(s, result))
@@ -439,44 +899,36 @@ namespace Orthanc
                                bool uncompressIfNeeded)
   {
     FileInfo attachment;
-    if (!index_.LookupAttachment(attachment, instancePublicId, content))
+    if (!LookupAttachment(attachment, instancePublicId, content))
     {
       throw OrthancException(ErrorCode_InternalError);
     }
 
-    if (uncompressIfNeeded)
-    {
-      accessor_.SetCompressionForNextOperations(attachment.GetCompressionType());
-    }
-    else
-    {
-      accessor_.SetCompressionForNextOperations(CompressionType_None);
-    }
-
-    accessor_.Read(result, attachment.GetUuid(), attachment.GetContentType());
+    // This method can be called concurrently from several threads
+    // (e.g. to prefetch the instances of an archive)
+    accessor_.Read(result, attachment.GetUuid(), attachment.GetContentType(),
+                   uncompressIfNeeded ? attachment.GetCompressionType() : CompressionType_None);
   }
 
 
-  IDynamicObject* ServerContext::DicomCacheProvider::Provide(const std::string& instancePublicId)
+  IDynamicObject* ServerContext::DicomCacheProvider::Provide(size_t& size,
+                                                             const std::string& instancePublicId)
   {
     std::string content;
     context_.ReadFile(content, instancePublicId, FileContentType_Dicom);
+
+    // The memory used by DCMTK is roughly the size of the DICOM file
+    size = content.size();
+
     return new ParsedDicomFile(content);
   }
 
 
   ServerContext::DicomCacheLocker::DicomCacheLocker(ServerContext& that,
                                                     const std::string& instancePublicId) : 
-    that_(that),
-    lock_(that_.dicomCacheMutex_)
+    accessor_(that.dicomCache_, instancePublicId)
   {
-#if ENABLE_DICOM_CACHE == 0
-    static std::auto_ptr<IDynamicObject> p;
-    p.reset(provider_.Provide(instancePublicId));
-    dicom_ = dynamic_cast<ParsedDicomFile*>(p.get());
-#else
-    dicom_ = &dynamic_cast<ParsedDicomFile&>(that_.dicomCache_.Access(instancePublicId));
-#endif
+    dicom_ = &dynamic_cast<ParsedDicomFile&>(accessor_.GetContent());
   }
 
 
@@ -485,6 +937,120 @@ namespace Orthanc
   }
 
 
+  ParsedDicomFile* ServerContext::ReadSingleFrame(const std::string& instancePublicId,
+                                                  unsigned int frame)
+  {
+    FileInfo attachment;
+    if (!index_.LookupAttachment(attachment, instancePublicId, FileContentType_Dicom) ||
+        attachment.GetCompressionType() != CompressionType_None)
+    {
+      // Compressed files have no random access: Rather than
+      // uncompressing the whole file for each frame, use the cache of
+      // the parsed DICOM files, so that the next frames are served
+      // from memory
+      return NULL;
+    }
+
+    DicomFrameIndex frameIndex;
+    std::string serialized;
+
+    bool hasMetadata = index_.LookupMetadata(serialized, instancePublicId, MetadataType_Instance_FrameIndex);
+
+    if (hasMetadata &&
+        serialized.empty())
+    {
+      // This instance cannot be indexed
+      return NULL;
+    }
+    else if (hasMetadata &&
+             frameIndex.Unserialize(serialized))
+    {
+      // The index is up-to-date
+    }
+    else if (!hasMetadata &&
+             frame == 0)
+    {
+      // Instance stored by a previous version of Orthanc. Only index
+      // it when accessing a frame that is not the first one, which
+      // reveals a multi-frame instance.
+      return NULL;
+    }
+    else
+    {
+      // The instance has not been indexed yet, or its index was
+      // serialized by a previous version of Orthanc: (Re-)index it
+      std::string content;
+      ReadFile(content, instancePublicId, FileContentType_Dicom);
+
+      if (frameIndex.Parse(content) &&
+          frameIndex.GetFramesCount() > 1)
+      {
+        frameIndex.Serialize(serialized);
+        index_.SetMetadata(instancePublicId, MetadataType_Instance_FrameIndex, serialized);
+      }
+      else
+      {
+        // Remember that this instance cannot be indexed
+        index_.SetMetadata(instancePublicId, MetadataType_Instance_FrameIndex, "");
+        return NULL;
+      }
+    }
+
+    if (frame >= frameIndex.GetFramesCount())
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    uint64_t start, end;
+    frameIndex.GetFrameRange(start, end, frame);
+
+    std::string header, range;
+    accessor_.ReadRange(header, attachment.GetUuid(), FileContentType_Dicom, 
+                        CompressionType_None, 0, frameIndex.GetHeaderSize());
+    accessor_.ReadRange(range, attachment.GetUuid(), FileContentType_Dicom, 
+                        CompressionType_None, start, end);
+
+    std::string single;
+    frameIndex.CreateSingleFrameFile(single, header, range, frame);
+
+    std::auto_ptr<ParsedDicomFile> dicom(new ParsedDicomFile(single));
+    dicom->Replace(DICOM_TAG_NUMBER_OF_FRAMES, "1", DicomReplaceMode_InsertIfAbsent);
+
+    return dicom.release();
+  }
+
+
+  ServerContext::FrameLocker::FrameLocker(ServerContext& that,
+                                          const std::string& instancePublicId,
+                                          unsigned int frame)
+  {
+    single_.reset(that.ReadSingleFrame(instancePublicId, frame));
+
+    if (single_.get() == NULL)
+    {
+      cache_.reset(new DicomCacheLocker(that, instancePublicId));
+      frame_ = frame;
+    }
+    else
+    {
+      frame_ = 0;
+    }
+  }
+
+
+  ParsedDicomFile& ServerContext::FrameLocker::GetDicom()
+  {
+    if (single_.get() != NULL)
+    {
+      return *single_;
+    }
+    else
+    {
+      return cache_->GetDicom();
+    }
+  }
+
+
   void ServerContext::SetStoreMD5ForAttachments(bool storeMD5)
   {
     LOG(INFO) << "Storing MD5 for attachments: " << (storeMD5 ? "yes" : "no");
@@ -499,16 +1065,8 @@ namespace Orthanc
   {
     LOG(INFO) << "Adding attachment " << EnumerationToString(attachmentType) << " to resource " << resourceId;
     
-    if (compressionEnabled_)
-    {
-      accessor_.SetCompressionForNextOperations(CompressionType_Zlib);
-    }
-    else
-    {
-      accessor_.SetCompressionForNextOperations(CompressionType_None);
-    }      
-
-    FileInfo info = accessor_.Write(data, size, attachmentType);
+    CompressionType compression = (compressionEnabled_ ? CompressionType_Zlib : CompressionType_None);
+    FileInfo info = accessor_.Write(data, size, attachmentType, compression);
     StoreStatus status = index_.AddAttachment(info, resourceId);
 
     if (status != StoreStatus_Success)
@@ -531,8 +1089,44 @@ namespace Orthanc
   }
 
 
+  void ServerContext::GetDicomCacheStatistics(Json::Value& target)
+  {
+    uint64_t hits, misses, evictions;
+    dicomCache_.GetStatistics(hits, misses, evictions);
+
+    target = Json::objectValue;
+    target["Hits"] = boost::lexical_cast<std::string>(hits);
+    target["Misses"] = boost::lexical_cast<std::string>(misses);
+    target["Evictions"] = boost::lexical_cast<std::string>(evictions);
+    target["CountInstances"] = static_cast<unsigned int>(dicomCache_.GetNumberOfPages());
+    target["Size"] = boost::lexical_cast<std::string>(dicomCache_.GetCurrentSize());
+    target["SizeMB"] = static_cast<unsigned int>(dicomCache_.GetCurrentSize() / MEGA_BYTES);
+    target["MaximumSizeMB"] = static_cast<unsigned int>(dicomCache_.GetMaximumSize() / MEGA_BYTES);
+  }
+
+
   void ServerContext::SignalChange(const ServerIndexChange& change)
   {
+    if (change.GetChangeType() == ChangeType_Deleted &&
+        change.GetResourceType() == ResourceType_Instance)
+    {
+      // Do not serve a parsed version of a deleted instance
+      dicomCache_.Invalidate(change.GetPublicId());
+
+      if (previewCache_ != NULL)
+      {
+        previewCache_->Invalidate(change.GetPublicId());
+      }
+    }
+
+    if (change.GetChangeType() == ChangeType_StableSeries &&
+        pregenerateThumbnails_)
+    {
+      // This method is called while the index is locked: The
+      // thumbnails are generated by a separate thread
+      stableSeriesQueue_.Enqueue(new StableSeries(change.GetPublicId()));
+    }
+
     if (plugins_ != NULL)
     {
       try
@@ -32,19 +32,23 @@
 
 #pragma once
 
-#include "../Core/Cache/MemoryCache.h"
+#include "../Core/Cache/SharedMemoryCache.h"
 #include "../Core/FileStorage/CompressedFileStorageAccessor.h"
 #include "../Core/FileStorage/IStorageArea.h"
 #include "../Core/RestApi/RestApiOutput.h"
 #include "../Core/Lua/LuaContext.h"
+#include "../Core/MultiThreading/SharedMessageQueue.h"
 #include "ServerIndex.h"
 #include "ParsedDicomFile.h"
 #include "DicomProtocol/ReusableDicomUserConnection.h"
 #include "Scheduler/ServerScheduler.h"
 #include "DicomInstanceToStore.h"
 #include "ServerIndexChange.h"
+#include "PreviewCache.h"
 
 #include <boost/filesystem.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <set>
 
 namespace Orthanc
 {
@@ -59,7 +63,7 @@ namespace Orthanc
   class ServerContext
   {
   private:
-    class DicomCacheProvider : public ICachePageProvider
+    class DicomCacheProvider : public ISizedCachePageProvider
     {
     private:
       ServerContext& context_;
@@ -69,7 +73,27 @@ namespace Orthanc
       {
       }
       
-      virtual IDynamicObject* Provide(const std::string& id);
+      virtual IDynamicObject* Provide(size_t& size,
+                                      const std::string& id);
+    };
+
+    /**
+     * Serializes the concurrent storage of the same instance (as
+     * identified by its public ID), so that the check for duplicates
+     * that precedes the write to the storage area is consistent. Also
+     * used to generate the DICOM-as-JSON summary only once.
+     **/
+    class PendingInstanceLocker : public boost::noncopyable
+    {
+    private:
+      ServerContext& that_;
+      std::string    instancePublicId_;
+
+    public:
+      PendingInstanceLocker(ServerContext& that,
+                            const std::string& instancePublicId);
+
+      ~PendingInstanceLocker();
     };
 
     bool ApplyReceivedInstanceFilter(const Json::Value& simplified,
@@ -81,28 +105,80 @@ namespace Orthanc
                                   const std::string& remoteAet,
                                   const std::string& calledAet);
 
+    void GenerateDicomAsJson(const std::string& instancePublicId);
+
+    bool LookupAttachment(FileInfo& attachment,
+                          const std::string& instancePublicId,
+                          FileContentType content);
+
+    static void PregenerateThumbnailsThread(ServerContext* that);
+
+    // "jpegQuality" is zero for PNG images
+    static void RenderImage(std::string& result,
+                            ParsedDicomFile& dicom,
+                            unsigned int frame,
+                            ImageExtractionMode mode,
+                            unsigned int thumbnailSize,
+                            unsigned int jpegQuality);
+
+    void StorePreview(const std::string& instancePublicId,
+                      unsigned int frame,
+                      ImageExtractionMode mode,
+                      unsigned int thumbnailSize,
+                      unsigned int jpegQuality,
+                      const std::string& image);
+
+    void ExtractImage(std::string& result,
+                      const std::string& instancePublicId,
+                      unsigned int frame,
+                      ImageExtractionMode mode,
+                      unsigned int thumbnailSize,
+                      unsigned int jpegQuality);
+
+    // Returns NULL if the frame index of this instance is not available,
+    // or if its DICOM file is compressed
+    ParsedDicomFile* ReadSingleFrame(const std::string& instancePublicId,
+                                     unsigned int frame);
+
     ServerIndex index_;
     CompressedFileStorageAccessor accessor_;
     bool compressionEnabled_;
+    bool storeDicomAsJson_;
+
+    boost::mutex pendingInstancesMutex_;
+    boost::condition_variable pendingInstancesChanged_;
+    std::set<std::string> pendingInstances_;
     
     DicomCacheProvider provider_;
-    boost::mutex dicomCacheMutex_;
-    MemoryCache dicomCache_;
+    SharedMemoryCache dicomCache_;
     ReusableDicomUserConnection scu_;
     ServerScheduler scheduler_;
 
+    PreviewCache* previewCache_;
+    unsigned int thumbnailSize_;
+    bool pregenerateThumbnails_;
+    bool done_;
+    SharedMessageQueue stableSeriesQueue_;
+    boost::thread pregenerateThumbnailsThread_;
+
     boost::mutex luaMutex_;
     LuaContext lua_;
     OrthancPlugins* plugins_;  // TODO Turn it into a listener pattern (idem for Lua callbacks)
     const PluginsManager* pluginsManager_;
 
   public:
+    /**
+     * Gives access to a parsed DICOM instance that is stored in the
+     * cache. The DCMTK objects are not safe to read from several
+     * threads, so the other threads accessing the same instance wait
+     * for this locker to be released. The instance remains in the
+     * cache: It must NOT be modified (use "Clone()" first).
+     **/
     class DicomCacheLocker : public boost::noncopyable
     {
     private:
-      ServerContext& that_;
+      SharedMemoryCache::Accessor accessor_;
       ParsedDicomFile *dicom_;
-      boost::mutex::scoped_lock lock_;
 
     public:
       DicomCacheLocker(ServerContext& that,
@@ -116,6 +192,34 @@ namespace Orthanc
       }
     };
 
+    /**
+     * Gives access to one frame of a DICOM instance. If the frame
+     * index of a multi-frame instance is available, only the bytes of
+     * the requested frame are read from the storage area, and they
+     * are wrapped in a single-frame DICOM instance. Otherwise, the
+     * full instance is retrieved from the DICOM cache. In both cases,
+     * "GetFrame()" gives the frame to be extracted from "GetDicom()".
+     **/
+    class FrameLocker : public boost::noncopyable
+    {
+    private:
+      std::auto_ptr<DicomCacheLocker>  cache_;
+      std::auto_ptr<ParsedDicomFile>   single_;
+      unsigned int                     frame_;
+
+    public:
+      FrameLocker(ServerContext& that,
+                  const std::string& instancePublicId,
+                  unsigned int frame);
+
+      ParsedDicomFile& GetDicom();
+
+      unsigned int GetFrame() const
+      {
+        return frame_;
+      }
+    };
+
     class LuaContextLocker : public boost::noncopyable
     {
     private:
@@ -141,6 +245,8 @@ namespace Orthanc
 
     ServerContext(IDatabaseWrapper& database);
 
+    ~ServerContext();
+
     void SetStorageArea(IStorageArea& storage)
     {
       accessor_.SetStorageArea(storage);
@@ -158,6 +264,61 @@ namespace Orthanc
       return compressionEnabled_;
     }
 
+    /**
+     * If "false", the "DicomAsJson" attachment is not written at
+     * ingest, but generated from the DICOM file on its first access.
+     **/
+    void SetStoreDicomAsJson(bool store);
+
+    bool IsStoreDicomAsJson() const
+    {
+      return storeDicomAsJson_;
+    }
+
+    /**
+     * The rendered images are stored in the preview cache, which must
+     * outlive this object. If "pregenerateThumbnails" is "true", the
+     * thumbnails of the instances of each series that becomes stable
+     * are generated in the background.
+     **/
+    void SetPreviewCache(PreviewCache& cache,
+                         bool pregenerateThumbnails);
+
+    bool HasPreviewCache() const
+    {
+      return previewCache_ != NULL;
+    }
+
+    PreviewCache& GetPreviewCache();
+
+    // Size of the larger side of the thumbnails (in pixels)
+    void SetThumbnailSize(unsigned int size);
+
+    unsigned int GetThumbnailSize() const
+    {
+      return thumbnailSize_;
+    }
+
+    /**
+     * Renders one frame of an instance as a PNG image, going through
+     * the preview cache if available. If "thumbnailSize" is not zero,
+     * the image is downscaled so that it fits in a square of this size.
+     **/
+    void ExtractPngImage(std::string& png,
+                         const std::string& instancePublicId,
+                         unsigned int frame,
+                         ImageExtractionMode mode,
+                         unsigned int thumbnailSize);
+
+    // Same as "ExtractPngImage()", with a lossy JPEG compression of
+    // the given quality (between 1 and 100)
+    void ExtractJpegImage(std::string& jpeg,
+                          const std::string& instancePublicId,
+                          unsigned int frame,
+                          ImageExtractionMode mode,
+                          unsigned int thumbnailSize,
+                          uint8_t quality);
+
     void RemoveFile(const std::string& fileUuid,
                     FileContentType type);
 
@@ -171,7 +332,8 @@ namespace Orthanc
 
     void AnswerAttachment(RestApiOutput& output,
                           const std::string& instancePublicId,
-                          FileContentType content);
+                          FileContentType content,
+                          const std::string& range);
 
     void ReadJson(Json::Value& result,
                   const std::string& instancePublicId);
@@ -199,6 +361,8 @@ namespace Orthanc
       return scheduler_;
     }
 
+    void GetDicomCacheStatistics(Json::Value& target);
+
     void SetOrthancPlugins(const PluginsManager& manager,
                            OrthancPlugins& plugins)
     {
@@ -113,6 +113,7 @@ namespace Orthanc
     MetadataType_ModifiedFrom = 5,
     MetadataType_AnonymizedFrom = 6,
     MetadataType_LastUpdate = 7,
+    MetadataType_Instance_FrameIndex = 8,
 
     // Make sure that the value "65535" can be stored into this enumeration
     MetadataType_StartUser = 1024,
@@ -226,11 +226,13 @@ namespace Orthanc
 
       assert(index_.currentStorageSize_ == index_.db_.GetTotalCompressedSize());
 
+      index_.pendingStorageSize_ = 0;
       index_.listener_->StartTransaction();
     }
 
     ~Transaction()
     {
+      index_.pendingStorageSize_ = 0;
       index_.listener_->EndTransaction();
     }
 
@@ -249,6 +251,7 @@ namespace Orthanc
 
         assert(index_.currentStorageSize_ >= index_.listener_->GetSizeOfFilesToRemove());
         index_.currentStorageSize_ -= index_.listener_->GetSizeOfFilesToRemove();
+        index_.pendingStorageSize_ = 0;
 
         // Send all the pending changes to the Orthanc plugins
         index_.listener_->CommitChanges();
@@ -259,6 +262,168 @@ namespace Orthanc
   };
 
 
+  /**
+   * Gives access to the database for read-only operations. If
+   * read-only connections are available, one of them is borrowed
+   * from the pool for the lifetime of this object, and the reads are
+   * done inside a SQLite transaction so as to work on a consistent
+   * snapshot of the database (thanks to the WAL journal). Such reads
+   * can run concurrently with each other, and with the writers that
+   * lock "mutex_". Otherwise, this object falls back to locking
+   * "mutex_" and uses the main connection.
+   **/
+  class ServerIndex::ReaderLock : public boost::noncopyable
+  {
+  private:
+    ServerIndex& index_;
+    IDatabaseWrapper* db_;
+    std::auto_ptr<boost::mutex::scoped_lock> lock_;
+    std::auto_ptr<SQLite::ITransaction> transaction_;
+
+    void Release()
+    {
+      boost::mutex::scoped_lock lock(index_.readConnectionsMutex_);
+      index_.availableReadConnections_.push(db_);
+      index_.readConnectionAvailable_.notify_one();
+    }
+
+  public:
+    ReaderLock(ServerIndex& index) : 
+      index_(index),
+      db_(NULL)
+    {
+      if (index_.readConnections_.empty())
+      {
+        lock_.reset(new boost::mutex::scoped_lock(index_.mutex_));
+        db_ = &index_.db_;
+      }
+      else
+      {
+        {
+          boost::mutex::scoped_lock lock(index_.readConnectionsMutex_);
+
+          while (index_.availableReadConnections_.empty())
+          {
+            index_.readConnectionAvailable_.wait(lock);
+          }
+
+          db_ = index_.availableReadConnections_.top();
+          index_.availableReadConnections_.pop();
+        }
+
+        try
+        {
+          transaction_.reset(db_->StartTransaction());
+          transaction_->Begin();
+        }
+        catch (...)
+        {
+          transaction_.reset(NULL);
+          Release();
+          throw;
+        }
+      }
+    }
+
+    ~ReaderLock()
+    {
+      if (transaction_.get() != NULL)
+      {
+        // Nothing was written, so committing only releases the snapshot
+        try
+        {
+          transaction_->Commit();
+        }
+        catch (OrthancException&)
+        {
+        }
+
+        transaction_.reset(NULL);
+        Release();
+      }
+    }
+
+    IDatabaseWrapper& GetDatabase()
+    {
+      return *db_;
+    }
+  };
+
+
+  class ServerIndex::PendingStore : public boost::noncopyable
+  {
+  private:
+    std::map<MetadataType, std::string>& instanceMetadata_;
+    const DicomMap& dicomSummary_;
+    const Attachments& attachments_;
+    const std::string& remoteAet_;
+    const MetadataMap& metadata_;
+    StoreStatus status_;
+    bool done_;
+
+  public:
+    PendingStore(std::map<MetadataType, std::string>& instanceMetadata,
+                 const DicomMap& dicomSummary,
+                 const Attachments& attachments,
+                 const std::string& remoteAet,
+                 const MetadataMap& metadata) :
+      instanceMetadata_(instanceMetadata),
+      dicomSummary_(dicomSummary),
+      attachments_(attachments),
+      remoteAet_(remoteAet),
+      metadata_(metadata),
+      status_(StoreStatus_Failure),
+      done_(false)
+    {
+    }
+
+    std::map<MetadataType, std::string>& GetInstanceMetadata()
+    {
+      return instanceMetadata_;
+    }
+
+    const DicomMap& GetDicomSummary() const
+    {
+      return dicomSummary_;
+    }
+
+    const Attachments& GetAttachments() const
+    {
+      return attachments_;
+    }
+
+    const std::string& GetRemoteAet() const
+    {
+      return remoteAet_;
+    }
+
+    const MetadataMap& GetMetadata() const
+    {
+      return metadata_;
+    }
+
+    StoreStatus GetStatus() const
+    {
+      return status_;
+    }
+
+    void SetStatus(StoreStatus status)
+    {
+      status_ = status;
+    }
+
+    bool IsDone() const
+    {
+      return done_;
+    }
+
+    void SetDone()
+    {
+      done_ = true;
+    }
+  };
+
+
   class ServerIndex::UnstableResourcePayload
   {
   private:
@@ -420,11 +585,12 @@ namespace Orthanc
 
 
   bool ServerIndex::GetMetadataAsInteger(int64_t& result,
+                                         IDatabaseWrapper& db,
                                          int64_t id,
                                          MetadataType type)
   {
     std::string s;
-    if (!db_.LookupMetadata(s, id, type))
+    if (!db.LookupMetadata(s, id, type))
     {
       return false;
     }
@@ -485,17 +651,42 @@ namespace Orthanc
 
 
   ServerIndex::ServerIndex(ServerContext& context,
-                           IDatabaseWrapper& db) : 
+                           IDatabaseWrapper& db,
+                           unsigned int countReadConnections) : 
     done_(false),
     db_(db),
+    pendingStorageSize_(0),
     maximumStorageSize_(0),
-    maximumPatients_(0)
+    maximumPatients_(0),
+    groupCommitSize_(1),
+    groupCommitLatency_(0),
+    hasGroupCommitLeader_(false),
+    storeTransactions_(0),
+    storedInstances_(0)
   {
     listener_.reset(new Internals::ServerIndexListener(context));
     db_.SetListener(*listener_);
 
     currentStorageSize_ = db_.GetTotalCompressedSize();
 
+    if (countReadConnections > 0)
+    {
+      for (unsigned int i = 0; i < countReadConnections; i++)
+      {
+        IDatabaseWrapper* connection = db_.OpenReadOnlyConnection();
+        if (connection == NULL)
+        {
+          // This database does not support concurrent readers
+          break;
+        }
+
+        readConnections_.push_back(connection);
+        availableReadConnections_.push(connection);
+      }
+
+      LOG(INFO) << "Number of read-only connections to the index: " << readConnections_.size();
+    }
+
     // Initial recycling if the parameters have changed since the last
     // execution of Orthanc
     StandaloneRecycling();
@@ -518,263 +709,467 @@ namespace Orthanc
     {
       unstableResourcesMonitorThread_.join();
     }
+
+    for (size_t i = 0; i < readConnections_.size(); i++)
+    {
+      delete readConnections_[i];
+    }
   }
 
 
-  StoreStatus ServerIndex::Store(std::map<MetadataType, std::string>& instanceMetadata,
-                                 const DicomMap& dicomSummary,
-                                 const Attachments& attachments,
-                                 const std::string& remoteAet,
-                                 const MetadataMap& metadata)
+  StoreStatus ServerIndex::StoreInternal(std::map<MetadataType, std::string>& instanceMetadata,
+                                         const DicomMap& dicomSummary,
+                                         const Attachments& attachments,
+                                         const std::string& remoteAet,
+                                         const MetadataMap& metadata)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    // WARNING: Before calling this method, "mutex_" must be locked,
+    // and a transaction must be open.
 
     instanceMetadata.clear();
 
     DicomInstanceHasher hasher(dicomSummary);
 
-    try
+    // Do nothing if the instance already exists
     {
-      Transaction t(*this);
-
-      // Do nothing if the instance already exists
+      ResourceType type;
+      int64_t tmp;
+      if (db_.LookupResource(hasher.HashInstance(), tmp, type))
       {
-        ResourceType type;
-        int64_t tmp;
-        if (db_.LookupResource(hasher.HashInstance(), tmp, type))
-        {
-          assert(type == ResourceType_Instance);
-          db_.GetAllMetadata(instanceMetadata, tmp);
-          return StoreStatus_AlreadyStored;
-        }
+        assert(type == ResourceType_Instance);
+        db_.GetAllMetadata(instanceMetadata, tmp);
+        return StoreStatus_AlreadyStored;
       }
+    }
 
-      // Ensure there is enough room in the storage for the new instance
-      uint64_t instanceSize = 0;
-      for (Attachments::const_iterator it = attachments.begin();
-           it != attachments.end(); ++it)
-      {
-        instanceSize += it->GetCompressedSize();
-      }
+    // Ensure there is enough room in the storage for the new instance
+    uint64_t instanceSize = 0;
+    for (Attachments::const_iterator it = attachments.begin();
+         it != attachments.end(); ++it)
+    {
+      instanceSize += it->GetCompressedSize();
+    }
 
-      Recycle(instanceSize, hasher.HashPatient());
+    Recycle(instanceSize, hasher.HashPatient());
 
-      // Create the instance
-      int64_t instance = db_.CreateResource(hasher.HashInstance(), ResourceType_Instance);
+    // Create the instance
+    int64_t instance = db_.CreateResource(hasher.HashInstance(), ResourceType_Instance);
 
-      DicomMap dicom;
-      dicomSummary.ExtractInstanceInformation(dicom);
-      SetMainDicomTags(instance, dicom);
+    DicomMap dicom;
+    dicomSummary.ExtractInstanceInformation(dicom);
+    SetMainDicomTags(instance, dicom);
 
-      // Detect up to which level the patient/study/series/instance
-      // hierarchy must be created
-      int64_t patient = -1, study = -1, series = -1;
-      bool isNewPatient = false;
-      bool isNewStudy = false;
-      bool isNewSeries = false;
+    // Detect up to which level the patient/study/series/instance
+    // hierarchy must be created
+    int64_t patient = -1, study = -1, series = -1;
+    bool isNewPatient = false;
+    bool isNewStudy = false;
+    bool isNewSeries = false;
 
-      {
-        ResourceType dummy;
+    {
+      ResourceType dummy;
 
-        if (db_.LookupResource(hasher.HashSeries(), series, dummy))
-        {
-          assert(dummy == ResourceType_Series);
-          // The patient, the study and the series already exist
+      if (db_.LookupResource(hasher.HashSeries(), series, dummy))
+      {
+        assert(dummy == ResourceType_Series);
+        // The patient, the study and the series already exist
 
-          bool ok = (db_.LookupResource(hasher.HashPatient(), patient, dummy) &&
-                     db_.LookupResource(hasher.HashStudy(), study, dummy));
-          assert(ok);
-        }
-        else if (db_.LookupResource(hasher.HashStudy(), study, dummy))
-        {
-          assert(dummy == ResourceType_Study);
+        bool ok = (db_.LookupResource(hasher.HashPatient(), patient, dummy) &&
+                   db_.LookupResource(hasher.HashStudy(), study, dummy));
+        assert(ok);
+      }
+      else if (db_.LookupResource(hasher.HashStudy(), study, dummy))
+      {
+        assert(dummy == ResourceType_Study);
 
-          // New series: The patient and the study already exist
-          isNewSeries = true;
+        // New series: The patient and the study already exist
+        isNewSeries = true;
 
-          bool ok = db_.LookupResource(hasher.HashPatient(), patient, dummy);
-          assert(ok);
-        }
-        else if (db_.LookupResource(hasher.HashPatient(), patient, dummy))
-        {
-          assert(dummy == ResourceType_Patient);
-
-          // New study and series: The patient already exist
-          isNewStudy = true;
-          isNewSeries = true;
-        }
-        else
-        {
-          // New patient, study and series: Nothing exists
-          isNewPatient = true;
-          isNewStudy = true;
-          isNewSeries = true;
-        }
+        bool ok = db_.LookupResource(hasher.HashPatient(), patient, dummy);
+        assert(ok);
       }
-
-      // Create the series if needed
-      if (isNewSeries)
+      else if (db_.LookupResource(hasher.HashPatient(), patient, dummy))
       {
-        series = db_.CreateResource(hasher.HashSeries(), ResourceType_Series);
-        dicomSummary.ExtractSeriesInformation(dicom);
-        SetMainDicomTags(series, dicom);
-      }
+        assert(dummy == ResourceType_Patient);
 
-      // Create the study if needed
-      if (isNewStudy)
-      {
-        study = db_.CreateResource(hasher.HashStudy(), ResourceType_Study);
-        dicomSummary.ExtractStudyInformation(dicom);
-        SetMainDicomTags(study, dicom);
+        // New study and series: The patient already exist
+        isNewStudy = true;
+        isNewSeries = true;
       }
-
-      // Create the patient if needed
-      if (isNewPatient)
+      else
       {
-        patient = db_.CreateResource(hasher.HashPatient(), ResourceType_Patient);
-        dicomSummary.ExtractPatientInformation(dicom);
-        SetMainDicomTags(patient, dicom);
+        // New patient, study and series: Nothing exists
+        isNewPatient = true;
+        isNewStudy = true;
+        isNewSeries = true;
       }
+    }
 
-      // Create the parent-to-child links
-      db_.AttachChild(series, instance);
+    // Create the series if needed
+    if (isNewSeries)
+    {
+      series = db_.CreateResource(hasher.HashSeries(), ResourceType_Series);
+      dicomSummary.ExtractSeriesInformation(dicom);
+      SetMainDicomTags(series, dicom);
+    }
 
-      if (isNewSeries)
-      {
-        db_.AttachChild(study, series);
-      }
+    // Create the study if needed
+    if (isNewStudy)
+    {
+      study = db_.CreateResource(hasher.HashStudy(), ResourceType_Study);
+      dicomSummary.ExtractStudyInformation(dicom);
+      SetMainDicomTags(study, dicom);
+    }
+
+    // Create the patient if needed
+    if (isNewPatient)
+    {
+      patient = db_.CreateResource(hasher.HashPatient(), ResourceType_Patient);
+      dicomSummary.ExtractPatientInformation(dicom);
+      SetMainDicomTags(patient, dicom);
+    }
+
+    // Create the parent-to-child links
+    db_.AttachChild(series, instance);
+
+    if (isNewSeries)
+    {
+      db_.AttachChild(study, series);
+    }
+
+    if (isNewStudy)
+    {
+      db_.AttachChild(patient, study);
+    }
+
+    // Sanity checks
+    assert(patient != -1);
+    assert(study != -1);
+    assert(series != -1);
+    assert(instance != -1);
+
+    // Attach the files to the newly created instance
+    for (Attachments::const_iterator it = attachments.begin();
+         it != attachments.end(); ++it)
+    {
+      db_.AddAttachment(instance, *it);
+    }
 
-      if (isNewStudy)
+    pendingStorageSize_ += instanceSize;
+
+    // Attach the user-specified metadata
+    for (MetadataMap::const_iterator 
+           it = metadata.begin(); it != metadata.end(); ++it)
+    {
+      switch (it->first.first)
       {
-        db_.AttachChild(patient, study);
+        case ResourceType_Patient:
+          db_.SetMetadata(patient, it->first.second, it->second);
+          break;
+
+        case ResourceType_Study:
+          db_.SetMetadata(study, it->first.second, it->second);
+          break;
+
+        case ResourceType_Series:
+          db_.SetMetadata(series, it->first.second, it->second);
+          break;
+
+        case ResourceType_Instance:
+          db_.SetMetadata(instance, it->first.second, it->second);
+          instanceMetadata[it->first.second] = it->second;
+          break;
+
+        default:
+          throw OrthancException(ErrorCode_ParameterOutOfRange);
       }
+    }
+
+    // Attach the auto-computed metadata for the patient/study/series levels
+    std::string now = Toolbox::GetNowIsoString();
+    db_.SetMetadata(series, MetadataType_LastUpdate, now);
+    db_.SetMetadata(study, MetadataType_LastUpdate, now);
+    db_.SetMetadata(patient, MetadataType_LastUpdate, now);
+
+    // Attach the auto-computed metadata for the instance level,
+    // reflecting these additions into the input metadata map
+    db_.SetMetadata(instance, MetadataType_Instance_ReceptionDate, now);
+    instanceMetadata[MetadataType_Instance_ReceptionDate] = now;
+
+    db_.SetMetadata(instance, MetadataType_Instance_RemoteAet, remoteAet);
+    instanceMetadata[MetadataType_Instance_RemoteAet] = remoteAet;
+
+    const DicomValue* value;
+    if ((value = dicomSummary.TestAndGetValue(DICOM_TAG_INSTANCE_NUMBER)) != NULL ||
+        (value = dicomSummary.TestAndGetValue(DICOM_TAG_IMAGE_INDEX)) != NULL)
+    {
+      db_.SetMetadata(instance, MetadataType_Instance_IndexInSeries, value->AsString());
+      instanceMetadata[MetadataType_Instance_IndexInSeries] = value->AsString();
+    }
+
+    // Check whether the series of this new instance is now completed
+    if (isNewSeries)
+    {
+      ComputeExpectedNumberOfInstances(db_, series, dicomSummary);
+    }
+
+    SeriesStatus seriesStatus = GetSeriesStatus(db_, series);
+    if (seriesStatus == SeriesStatus_Complete)
+    {
+      LogChange(series, ChangeType_CompletedSeries, ResourceType_Series, hasher.HashSeries());
+    }
 
-      // Sanity checks
-      assert(patient != -1);
-      assert(study != -1);
-      assert(series != -1);
-      assert(instance != -1);
+    // Mark the parent resources of this instance as unstable
+    MarkAsUnstable(series, ResourceType_Series, hasher.HashSeries());
+    MarkAsUnstable(study, ResourceType_Study, hasher.HashStudy());
+    MarkAsUnstable(patient, ResourceType_Patient, hasher.HashPatient());
 
-      // Attach the files to the newly created instance
-      for (Attachments::const_iterator it = attachments.begin();
-           it != attachments.end(); ++it)
+    return StoreStatus_Success;
+  }
+
+
+  StoreStatus ServerIndex::StoreSingle(PendingStore& request)
+  {
+    // WARNING: Before calling this method, "mutex_" must be locked.
+
+    try
+    {
+      Transaction t(*this);
+
+      StoreStatus status = StoreInternal(request.GetInstanceMetadata(), request.GetDicomSummary(), 
+                                         request.GetAttachments(), request.GetRemoteAet(),
+                                         request.GetMetadata());
+
+      if (status == StoreStatus_Success)
       {
-        db_.AddAttachment(instance, *it);
+        t.Commit(pendingStorageSize_);
+        storeTransactions_++;
+        storedInstances_++;
       }
 
-      // Attach the user-specified metadata
-      for (MetadataMap::const_iterator 
-             it = metadata.begin(); it != metadata.end(); ++it)
+      return status;
+    }
+    catch (OrthancException& e)
+    {
+      LOG(ERROR) << "EXCEPTION [" << e.What() << "]";
+    }
+
+    return StoreStatus_Failure;
+  }
+
+
+  void ServerIndex::StoreBatch(const std::vector<PendingStore*>& batch)
+  {
+    // WARNING: Before calling this method, "mutex_" must be locked.
+
+    if (batch.size() > 1)
+    {
+      try
       {
-        switch (it->first.first)
-        {
-          case ResourceType_Patient:
-            db_.SetMetadata(patient, it->first.second, it->second);
-            break;
+        Transaction t(*this);
 
-          case ResourceType_Study:
-            db_.SetMetadata(study, it->first.second, it->second);
-            break;
+        std::vector<StoreStatus> status(batch.size());
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+          status[i] = StoreInternal(batch[i]->GetInstanceMetadata(), batch[i]->GetDicomSummary(), 
+                                    batch[i]->GetAttachments(), batch[i]->GetRemoteAet(),
+                                    batch[i]->GetMetadata());
+        }
 
-          case ResourceType_Series:
-            db_.SetMetadata(series, it->first.second, it->second);
-            break;
+        t.Commit(pendingStorageSize_);
+        storeTransactions_++;
 
-          case ResourceType_Instance:
-            db_.SetMetadata(instance, it->first.second, it->second);
-            instanceMetadata[it->first.second] = it->second;
-            break;
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+          if (status[i] == StoreStatus_Success)
+          {
+            storedInstances_++;
+          }
 
-          default:
-            throw OrthancException(ErrorCode_ParameterOutOfRange);
+          batch[i]->SetStatus(status[i]);
         }
+
+        VLOG(1) << "Group commit of " << batch.size() << " instances";
+        return;
       }
+      catch (OrthancException& e)
+      {
+        // The whole transaction has been rolled back: Store the
+        // instances one by one, so that the error only affects the
+        // instance that caused it
+        LOG(WARNING) << "Error in a group commit of " << batch.size() 
+                     << " instances, storing them one by one: " << e.What();
+      }
+    }
 
-      // Attach the auto-computed metadata for the patient/study/series levels
-      std::string now = Toolbox::GetNowIsoString();
-      db_.SetMetadata(series, MetadataType_LastUpdate, now);
-      db_.SetMetadata(study, MetadataType_LastUpdate, now);
-      db_.SetMetadata(patient, MetadataType_LastUpdate, now);
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+      batch[i]->SetStatus(StoreSingle(*batch[i]));
+    }
+  }
 
-      // Attach the auto-computed metadata for the instance level,
-      // reflecting these additions into the input metadata map
-      db_.SetMetadata(instance, MetadataType_Instance_ReceptionDate, now);
-      instanceMetadata[MetadataType_Instance_ReceptionDate] = now;
 
-      db_.SetMetadata(instance, MetadataType_Instance_RemoteAet, remoteAet);
-      instanceMetadata[MetadataType_Instance_RemoteAet] = remoteAet;
+  StoreStatus ServerIndex::Store(std::map<MetadataType, std::string>& instanceMetadata,
+                                 const DicomMap& dicomSummary,
+                                 const Attachments& attachments,
+                                 const std::string& remoteAet,
+                                 const MetadataMap& metadata)
+  {
+    PendingStore request(instanceMetadata, dicomSummary, attachments, remoteAet, metadata);
 
-      const DicomValue* value;
-      if ((value = dicomSummary.TestAndGetValue(DICOM_TAG_INSTANCE_NUMBER)) != NULL ||
-          (value = dicomSummary.TestAndGetValue(DICOM_TAG_IMAGE_INDEX)) != NULL)
+    boost::mutex::scoped_lock lock(groupCommitMutex_);
+
+    if (groupCommitSize_ <= 1)
+    {
+      // Group commit is disabled
+      lock.unlock();
+
+      boost::mutex::scoped_lock indexLock(mutex_);
+      return StoreSingle(request);
+    }
+
+    groupCommitQueue_.push_back(&request);
+    groupCommitCondition_.notify_all();
+
+    while (!request.IsDone())
+    {
+      if (hasGroupCommitLeader_)
+      {
+        // Another thread is writing a batch to the database: Wait
+        // for the result of the current batch, or for a chance to
+        // become the next leader
+        groupCommitCondition_.wait(lock);
+        continue;
+      }
+
+      // This thread becomes the leader of the next batch
+      hasGroupCommitLeader_ = true;
+
+      if (groupCommitLatency_ > 0)
       {
-        db_.SetMetadata(instance, MetadataType_Instance_IndexInSeries, value->AsString());
-        instanceMetadata[MetadataType_Instance_IndexInSeries] = value->AsString();
+        // Give the opportunity to the concurrent writers to join the batch
+        boost::system_time deadline = (boost::get_system_time() + 
+                                       boost::posix_time::milliseconds(groupCommitLatency_));
+
+        while (groupCommitQueue_.size() < groupCommitSize_ &&
+               groupCommitCondition_.timed_wait(lock, deadline))
+        {
+        }
       }
 
-      // Check whether the series of this new instance is now completed
-      if (isNewSeries)
+      std::vector<PendingStore*> batch;
+
+      lock.unlock();
+
       {
-        ComputeExpectedNumberOfInstances(db_, series, dicomSummary);
+        // The batch keeps on growing while waiting for the index
+        boost::mutex::scoped_lock indexLock(mutex_);
+
+        lock.lock();
+        while (!groupCommitQueue_.empty() &&
+               batch.size() < groupCommitSize_)
+        {
+          batch.push_back(groupCommitQueue_.front());
+          groupCommitQueue_.pop_front();
+        }
+        lock.unlock();
+
+        try
+        {
+          StoreBatch(batch);
+        }
+        catch (...)
+        {
+          // Never leave the other writers of the batch waiting forever
+          lock.lock();
+          for (size_t i = 0; i < batch.size(); i++)
+          {
+            batch[i]->SetDone();
+          }
+
+          hasGroupCommitLeader_ = false;
+          groupCommitCondition_.notify_all();
+          throw;
+        }
       }
 
-      SeriesStatus seriesStatus = GetSeriesStatus(series);
-      if (seriesStatus == SeriesStatus_Complete)
+      lock.lock();
+      for (size_t i = 0; i < batch.size(); i++)
       {
-        LogChange(series, ChangeType_CompletedSeries, ResourceType_Series, hasher.HashSeries());
+        batch[i]->SetDone();
       }
 
-      // Mark the parent resources of this instance as unstable
-      MarkAsUnstable(series, ResourceType_Series, hasher.HashSeries());
-      MarkAsUnstable(study, ResourceType_Study, hasher.HashStudy());
-      MarkAsUnstable(patient, ResourceType_Patient, hasher.HashPatient());
+      hasGroupCommitLeader_ = false;
+      groupCommitCondition_.notify_all();
+    }
+
+    return request.GetStatus();
+  }
+
+
+  void ServerIndex::GetGroupCommitStatistics(uint64_t& transactions,
+                                             uint64_t& instances)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    transactions = storeTransactions_;
+    instances = storedInstances_;
+  }
+
+
+  void ServerIndex::SetGroupCommit(unsigned int maxSize,
+                                   unsigned int maxLatency)
+  {
+    boost::mutex::scoped_lock lock(groupCommitMutex_);
 
-      t.Commit(instanceSize);
+    groupCommitSize_ = (maxSize == 0 ? 1 : maxSize);
+    groupCommitLatency_ = maxLatency;
 
-      return StoreStatus_Success;
+    if (groupCommitSize_ == 1)
+    {
+      LOG(WARNING) << "Group commit of the incoming instances is disabled";
     }
-    catch (OrthancException& e)
+    else
     {
-      LOG(ERROR) << "EXCEPTION [" << e.What() << "]";
+      LOG(WARNING) << "Group commit of at most " << groupCommitSize_ << " instances, waiting for at most "
+                   << groupCommitLatency_ << "ms";
     }
-
-    return StoreStatus_Failure;
   }
 
 
   void ServerIndex::ComputeStatistics(Json::Value& target)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
     target = Json::objectValue;
 
-    uint64_t cs = currentStorageSize_;
-    assert(cs == db_.GetTotalCompressedSize());
-    uint64_t us = db_.GetTotalUncompressedSize();
+    uint64_t cs = db.GetTotalCompressedSize();
+    uint64_t us = db.GetTotalUncompressedSize();
     target["TotalDiskSize"] = boost::lexical_cast<std::string>(cs);
     target["TotalUncompressedSize"] = boost::lexical_cast<std::string>(us);
     target["TotalDiskSizeMB"] = boost::lexical_cast<unsigned int>(cs / MEGA_BYTES);
     target["TotalUncompressedSizeMB"] = boost::lexical_cast<unsigned int>(us / MEGA_BYTES);
 
-    target["CountPatients"] = static_cast<unsigned int>(db_.GetResourceCount(ResourceType_Patient));
-    target["CountStudies"] = static_cast<unsigned int>(db_.GetResourceCount(ResourceType_Study));
-    target["CountSeries"] = static_cast<unsigned int>(db_.GetResourceCount(ResourceType_Series));
-    target["CountInstances"] = static_cast<unsigned int>(db_.GetResourceCount(ResourceType_Instance));
+    target["CountPatients"] = static_cast<unsigned int>(db.GetResourceCount(ResourceType_Patient));
+    target["CountStudies"] = static_cast<unsigned int>(db.GetResourceCount(ResourceType_Study));
+    target["CountSeries"] = static_cast<unsigned int>(db.GetResourceCount(ResourceType_Series));
+    target["CountInstances"] = static_cast<unsigned int>(db.GetResourceCount(ResourceType_Instance));
   }          
 
 
 
-  SeriesStatus ServerIndex::GetSeriesStatus(int64_t id)
+  SeriesStatus ServerIndex::GetSeriesStatus(IDatabaseWrapper& db,
+                                            int64_t id)
   {
     // Get the expected number of instances in this series (from the metadata)
     int64_t expected;
-    if (!GetMetadataAsInteger(expected, id, MetadataType_Series_ExpectedNumberOfInstances))
+    if (!GetMetadataAsInteger(expected, db, id, MetadataType_Series_ExpectedNumberOfInstances))
     {
       return SeriesStatus_Unknown;
     }
 
     // Loop over the instances of this series
     std::list<int64_t> children;
-    db_.GetChildrenInternalId(children, id);
+    db.GetChildrenInternalId(children, id);
 
     std::set<int64_t> instances;
     for (std::list<int64_t>::const_iterator 
@@ -782,7 +1177,7 @@ namespace Orthanc
     {
       // Get the index of this instance in the series
       int64_t index;
-      if (!GetMetadataAsInteger(index, *it, MetadataType_Instance_IndexInSeries))
+      if (!GetMetadataAsInteger(index, db, *it, MetadataType_Instance_IndexInSeries))
       {
         return SeriesStatus_Unknown;
       }
@@ -815,10 +1210,11 @@ namespace Orthanc
 
 
   void ServerIndex::MainDicomTagsToJson(Json::Value& target,
+                                        IDatabaseWrapper& db,
                                         int64_t resourceId)
   {
     DicomMap tags;
-    db_.GetMainDicomTags(tags, resourceId);
+    db.GetMainDicomTags(tags, resourceId);
     target["MainDicomTags"] = Json::objectValue;
     FromDcmtkBridge::ToJson(target["MainDicomTags"], tags);
   }
@@ -829,12 +1225,13 @@ namespace Orthanc
   {
     result = Json::objectValue;
 
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     // Lookup for the requested resource
     int64_t id;
     ResourceType type;
-    if (!db_.LookupResource(publicId, id, type) ||
+    if (!db.LookupResource(publicId, id, type) ||
         type != expectedType)
     {
       return false;
@@ -844,12 +1241,12 @@ namespace Orthanc
     if (type != ResourceType_Patient)
     {
       int64_t parentId;
-      if (!db_.LookupParent(parentId, id))
+      if (!db.LookupParent(parentId, id))
       {
         throw OrthancException(ErrorCode_InternalError);
       }
 
-      std::string parent = db_.GetPublicId(parentId);
+      std::string parent = db.GetPublicId(parentId);
 
       switch (type)
       {
@@ -872,7 +1269,7 @@ namespace Orthanc
 
     // List the children resources
     std::list<std::string> children;
-    db_.GetChildrenPublicId(children, id);
+    db.GetChildrenPublicId(children, id);
 
     if (type != ResourceType_Instance)
     {
@@ -917,10 +1314,10 @@ namespace Orthanc
       case ResourceType_Series:
       {
         result["Type"] = "Series";
-        result["Status"] = EnumerationToString(GetSeriesStatus(id));
+        result["Status"] = EnumerationToString(GetSeriesStatus(db, id));
 
         int64_t i;
-        if (GetMetadataAsInteger(i, id, MetadataType_Series_ExpectedNumberOfInstances))
+        if (GetMetadataAsInteger(i, db, id, MetadataType_Series_ExpectedNumberOfInstances))
           result["ExpectedNumberOfInstances"] = static_cast<int>(i);
         else
           result["ExpectedNumberOfInstances"] = Json::nullValue;
@@ -933,7 +1330,7 @@ namespace Orthanc
         result["Type"] = "Instance";
 
         FileInfo attachment;
-        if (!db_.LookupAttachment(attachment, id, FileContentType_Dicom))
+        if (!db.LookupAttachment(attachment, id, FileContentType_Dicom))
         {
           throw OrthancException(ErrorCode_InternalError);
         }
@@ -942,7 +1339,7 @@ namespace Orthanc
         result["FileUuid"] = attachment.GetUuid();
 
         int64_t i;
-        if (GetMetadataAsInteger(i, id, MetadataType_Instance_IndexInSeries))
+        if (GetMetadataAsInteger(i, db, id, MetadataType_Instance_IndexInSeries))
           result["IndexInSeries"] = static_cast<int>(i);
         else
           result["IndexInSeries"] = Json::nullValue;
@@ -956,16 +1353,16 @@ namespace Orthanc
 
     // Record the remaining information
     result["ID"] = publicId;
-    MainDicomTagsToJson(result, id);
+    MainDicomTagsToJson(result, db, id);
 
     std::string tmp;
 
-    if (db_.LookupMetadata(tmp, id, MetadataType_AnonymizedFrom))
+    if (db.LookupMetadata(tmp, id, MetadataType_AnonymizedFrom))
     {
       result["AnonymizedFrom"] = tmp;
     }
 
-    if (db_.LookupMetadata(tmp, id, MetadataType_ModifiedFrom))
+    if (db.LookupMetadata(tmp, id, MetadataType_ModifiedFrom))
     {
       result["ModifiedFrom"] = tmp;
     }
@@ -974,9 +1371,14 @@ namespace Orthanc
         type == ResourceType_Study ||
         type == ResourceType_Series)
     {
-      result["IsStable"] = !unstableResources_.Contains(id);
+      {
+        // This method might run under a "ReaderLock" that does not
+        // hold "mutex_", which protects the writers of this index
+        boost::mutex::scoped_lock lock(unstableResourcesMutex_);
+        result["IsStable"] = !unstableResources_.Contains(id);
+      }
 
-      if (db_.LookupMetadata(tmp, id, MetadataType_LastUpdate))
+      if (db.LookupMetadata(tmp, id, MetadataType_LastUpdate))
       {
         result["LastUpdate"] = tmp;
       }
@@ -990,16 +1392,17 @@ namespace Orthanc
                                      const std::string& instanceUuid,
                                      FileContentType contentType)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     int64_t id;
     ResourceType type;
-    if (!db_.LookupResource(instanceUuid, id, type))
+    if (!db.LookupResource(instanceUuid, id, type))
     {
       throw OrthancException(ErrorCode_UnknownResource);
     }
 
-    if (db_.LookupAttachment(attachment, id, contentType))
+    if (db.LookupAttachment(attachment, id, contentType))
     {
       assert(attachment.GetContentType() == contentType);
       return true;
@@ -1012,14 +1415,36 @@ namespace Orthanc
 
 
 
+  bool ServerIndex::LookupStoredInstance(std::map<MetadataType, std::string>& instanceMetadata,
+                                         const std::string& instancePublicId)
+  {
+    instanceMetadata.clear();
+
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
+
+    int64_t id;
+    ResourceType type;
+    if (!db.LookupResource(instancePublicId, id, type) ||
+        type != ResourceType_Instance)
+    {
+      return false;
+    }
+
+    db.GetAllMetadata(instanceMetadata, id);
+    return true;
+  }
+
+
   void ServerIndex::GetAllUuids(Json::Value& target,
                                 ResourceType resourceType)
   {
     std::list<std::string> lst;
 
     {
-      boost::mutex::scoped_lock lock(mutex_);
-      db_.GetAllPublicIds(lst, resourceType);
+      ReaderLock reader(*this);
+      IDatabaseWrapper& db = reader.GetDatabase();
+      db.GetAllPublicIds(lst, resourceType);
     }
 
     target = Json::arrayValue;
@@ -1031,6 +1456,102 @@ namespace Orthanc
   }
 
 
+  bool ServerIndex::GetAllUuids(std::list<std::string>& target,
+                                int64_t& since,
+                                ResourceType resourceType,
+                                unsigned int maxResults)
+  {
+    if (maxResults == 0)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
+    db.GetAllPublicIds(target, since, resourceType, since, maxResults);
+
+    return target.size() < maxResults;
+  }
+
+
+  bool ServerIndex::ExpandAllResources(Json::Value& target,
+                                       int64_t& since,
+                                       ResourceType resourceType,
+                                       unsigned int maxResults)
+  {
+    if (maxResults == 0 ||
+        target.type() != Json::arrayValue)
+    {
+      throw OrthancException(ErrorCode_ParameterOutOfRange);
+    }
+
+    std::list<ResourceSummary> summaries;
+
+    {
+      ReaderLock reader(*this);
+      IDatabaseWrapper& db = reader.GetDatabase();
+      db.GetResourcesSummary(summaries, since, resourceType, since, maxResults);
+    }
+
+    for (std::list<ResourceSummary>::const_iterator 
+           it = summaries.begin(); it != summaries.end(); ++it)
+    {
+      Json::Value item = Json::objectValue;
+      item["ID"] = it->GetPublicId();
+      item["Type"] = EnumerationToString(resourceType);
+
+      Json::Value& tags = item["MainDicomTags"];
+      tags = Json::objectValue;
+
+      for (ResourceSummary::MainDicomTags::const_iterator
+             tag = it->GetMainDicomTags().begin(); tag != it->GetMainDicomTags().end(); ++tag)
+      {
+        tags[FromDcmtkBridge::GetName(tag->first)] = tag->second;
+      }
+
+      switch (resourceType)
+      {
+        // Do NOT add "break" below this point!
+        case ResourceType_Patient:
+          item["CountStudies"] = it->GetCountStudies();
+
+        case ResourceType_Study:
+          item["CountSeries"] = it->GetCountSeries();
+
+        case ResourceType_Series:
+          item["CountInstances"] = it->GetCountInstances();
+
+        case ResourceType_Instance:
+        default:
+          break;
+      }
+
+      switch (resourceType)
+      {
+        case ResourceType_Study:
+          item["ParentPatient"] = it->GetParentPublicId();
+          break;
+
+        case ResourceType_Series:
+          item["ParentStudy"] = it->GetParentPublicId();
+          break;
+
+        case ResourceType_Instance:
+          item["ParentSeries"] = it->GetParentPublicId();
+          break;
+
+        default:
+          break;
+      }
+
+      target.append(item);
+    }
+
+    return summaries.size() < maxResults;
+  }
+
+
+
   template <typename T>
   static void FormatLog(Json::Value& target,
                         const std::list<T>& log,
@@ -1064,8 +1585,9 @@ namespace Orthanc
     bool done;
 
     {
-      boost::mutex::scoped_lock lock(mutex_);
-      db_.GetChanges(changes, done, since, maxResults);
+      ReaderLock reader(*this);
+      IDatabaseWrapper& db = reader.GetDatabase();
+      db.GetChanges(changes, done, since, maxResults);
     }
 
     FormatLog(target, changes, "Changes", done, since);
@@ -1077,8 +1599,9 @@ namespace Orthanc
     std::list<ServerIndexChange> changes;
 
     {
-      boost::mutex::scoped_lock lock(mutex_);
-      db_.GetLastChange(changes);
+      ReaderLock reader(*this);
+      IDatabaseWrapper& db = reader.GetDatabase();
+      db.GetLastChange(changes);
     }
 
     FormatLog(target, changes, "Changes", true, 0);
@@ -1169,8 +1692,9 @@ namespace Orthanc
     bool done;
 
     {
-      boost::mutex::scoped_lock lock(mutex_);
-      db_.GetExportedResources(exported, done, since, maxResults);
+      ReaderLock reader(*this);
+      IDatabaseWrapper& db = reader.GetDatabase();
+      db.GetExportedResources(exported, done, since, maxResults);
     }
 
     FormatLog(target, exported, "Exports", done, since);
@@ -1182,8 +1706,9 @@ namespace Orthanc
     std::list<ExportedResource> exported;
 
     {
-      boost::mutex::scoped_lock lock(mutex_);
-      db_.GetLastExportedResource(exported);
+      ReaderLock reader(*this);
+      IDatabaseWrapper& db = reader.GetDatabase();
+      db.GetLastExportedResource(exported);
     }
 
     FormatLog(target, exported, "Exports", true, 0);
@@ -1194,7 +1719,8 @@ namespace Orthanc
   {
     if (maximumStorageSize_ != 0)
     {
-      uint64_t currentSize = currentStorageSize_ - listener_->GetSizeOfFilesToRemove();
+      uint64_t currentSize = (currentStorageSize_ + pendingStorageSize_ - 
+                              listener_->GetSizeOfFilesToRemove());
       assert(db_.GetTotalCompressedSize() == currentSize);
 
       if (currentSize + instanceSize > maximumStorageSize_)
@@ -1307,18 +1833,19 @@ namespace Orthanc
 
   bool ServerIndex::IsProtectedPatient(const std::string& publicId)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     // Lookup for the requested resource
     int64_t id;
     ResourceType type;
-    if (!db_.LookupResource(publicId, id, type) ||
+    if (!db.LookupResource(publicId, id, type) ||
         type != ResourceType_Patient)
     {
       throw OrthancException(ErrorCode_ParameterOutOfRange);
     }
 
-    return db_.IsProtectedPatient(id);
+    return db.IsProtectedPatient(id);
   }
      
 
@@ -1351,11 +1878,12 @@ namespace Orthanc
   {
     result.clear();
 
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     ResourceType type;
     int64_t resource;
-    if (!db_.LookupResource(publicId, resource, type))
+    if (!db.LookupResource(publicId, resource, type))
     {
       throw OrthancException(ErrorCode_UnknownResource);
     }
@@ -1367,12 +1895,12 @@ namespace Orthanc
     }
 
     std::list<int64_t> tmp;
-    db_.GetChildrenInternalId(tmp, resource);
+    db.GetChildrenInternalId(tmp, resource);
 
     for (std::list<int64_t>::const_iterator 
            it = tmp.begin(); it != tmp.end(); ++it)
     {
-      result.push_back(db_.GetPublicId(*it));
+      result.push_back(db.GetPublicId(*it));
     }
   }
 
@@ -1382,11 +1910,12 @@ namespace Orthanc
   {
     result.clear();
 
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     ResourceType type;
     int64_t top;
-    if (!db_.LookupResource(publicId, top, type))
+    if (!db.LookupResource(publicId, top, type))
     {
       throw OrthancException(ErrorCode_UnknownResource);
     }
@@ -1409,14 +1938,14 @@ namespace Orthanc
       int64_t resource = toExplore.top();
       toExplore.pop();
 
-      if (db_.GetResourceType(resource) == ResourceType_Instance)
+      if (db.GetResourceType(resource) == ResourceType_Instance)
       {
-        result.push_back(db_.GetPublicId(resource));
+        result.push_back(db.GetPublicId(resource));
       }
       else
       {
         // Tag all the children of this resource as to be explored
-        db_.GetChildrenInternalId(tmp, resource);
+        db.GetChildrenInternalId(tmp, resource);
         for (std::list<int64_t>::const_iterator 
                it = tmp.begin(); it != tmp.end(); ++it)
         {
@@ -1464,32 +1993,34 @@ namespace Orthanc
                                    const std::string& publicId,
                                    MetadataType type)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     ResourceType rtype;
     int64_t id;
-    if (!db_.LookupResource(publicId, id, rtype))
+    if (!db.LookupResource(publicId, id, rtype))
     {
       throw OrthancException(ErrorCode_UnknownResource);
     }
 
-    return db_.LookupMetadata(target, id, type);
+    return db.LookupMetadata(target, id, type);
   }
 
 
   void ServerIndex::ListAvailableMetadata(std::list<MetadataType>& target,
                                           const std::string& publicId)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     ResourceType rtype;
     int64_t id;
-    if (!db_.LookupResource(publicId, id, rtype))
+    if (!db.LookupResource(publicId, id, rtype))
     {
       throw OrthancException(ErrorCode_UnknownResource);
     }
 
-    db_.ListAvailableMetadata(target, id);
+    db.ListAvailableMetadata(target, id);
   }
 
 
@@ -1497,36 +2028,38 @@ namespace Orthanc
                                              const std::string& publicId,
                                              ResourceType expectedType)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     ResourceType type;
     int64_t id;
-    if (!db_.LookupResource(publicId, id, type) ||
+    if (!db.LookupResource(publicId, id, type) ||
         expectedType != type)
     {
       throw OrthancException(ErrorCode_UnknownResource);
     }
 
-    db_.ListAvailableAttachments(target, id);
+    db.ListAvailableAttachments(target, id);
   }
 
 
   bool ServerIndex::LookupParent(std::string& target,
                                  const std::string& publicId)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     ResourceType type;
     int64_t id;
-    if (!db_.LookupResource(publicId, id, type))
+    if (!db.LookupResource(publicId, id, type))
     {
       throw OrthancException(ErrorCode_UnknownResource);
     }
 
     int64_t parentId;
-    if (db_.LookupParent(parentId, id))
+    if (db.LookupParent(parentId, id))
     {
-      target = db_.GetPublicId(parentId);
+      target = db.GetPublicId(parentId);
       return true;
     }
     else
@@ -1589,69 +2122,13 @@ namespace Orthanc
                                           /* out */ unsigned int& countStudies, 
                                           /* out */ unsigned int& countSeries, 
                                           /* out */ unsigned int& countInstances, 
-                                          /* in  */ int64_t id,
-                                          /* in  */ ResourceType type)
+                                          /* in  */ IDatabaseWrapper& db,
+                                          /* in  */ int64_t id)
   {
-    std::stack<int64_t> toExplore;
-    toExplore.push(id);
-
-    countInstances = 0;
-    countSeries = 0;
-    countStudies = 0;
-    compressedSize = 0;
-    uncompressedSize = 0;
-
-    while (!toExplore.empty())
+    if (!db.LookupStatistics(compressedSize, uncompressedSize, countStudies,
+                             countSeries, countInstances, id))
     {
-      // Get the internal ID of the current resource
-      int64_t resource = toExplore.top();
-      toExplore.pop();
-
-      ResourceType thisType = db_.GetResourceType(resource);
-
-      std::list<FileContentType> f;
-      db_.ListAvailableAttachments(f, resource);
-
-      for (std::list<FileContentType>::const_iterator
-             it = f.begin(); it != f.end(); ++it)
-      {
-        FileInfo attachment;
-        if (db_.LookupAttachment(attachment, resource, *it))
-        {
-          compressedSize += attachment.GetCompressedSize();
-          uncompressedSize += attachment.GetUncompressedSize();
-        }
-      }
-
-      if (thisType == ResourceType_Instance)
-      {
-        countInstances++;
-      }
-      else
-      {
-        switch (thisType)
-        {
-          case ResourceType_Study:
-            countStudies++;
-            break;
-
-          case ResourceType_Series:
-            countSeries++;
-            break;
-
-          default:
-            break;
-        }
-
-        // Tag all the children of this resource as to be explored
-        std::list<int64_t> tmp;
-        db_.GetChildrenInternalId(tmp, resource);
-        for (std::list<int64_t>::const_iterator 
-               it = tmp.begin(); it != tmp.end(); ++it)
-        {
-          toExplore.push(*it);
-        }
-      }
+      throw OrthancException(ErrorCode_InternalError);
     }
 
     if (countStudies == 0)
@@ -1670,11 +2147,12 @@ namespace Orthanc
   void ServerIndex::GetStatistics(Json::Value& target,
                                   const std::string& publicId)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     ResourceType type;
     int64_t top;
-    if (!db_.LookupResource(publicId, top, type))
+    if (!db.LookupResource(publicId, top, type))
     {
       throw OrthancException(ErrorCode_UnknownResource);
     }
@@ -1685,7 +2163,7 @@ namespace Orthanc
     unsigned int countSeries;
     unsigned int countInstances;
     GetStatisticsInternal(compressedSize, uncompressedSize, countStudies, 
-                          countSeries, countInstances, top, type);
+                          countSeries, countInstances, db, top);
 
     target = Json::objectValue;
     target["DiskSize"] = boost::lexical_cast<std::string>(compressedSize);
@@ -1719,17 +2197,18 @@ namespace Orthanc
                                   /* out */ unsigned int& countInstances, 
                                   const std::string& publicId)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     ResourceType type;
     int64_t top;
-    if (!db_.LookupResource(publicId, top, type))
+    if (!db.LookupResource(publicId, top, type))
     {
       throw OrthancException(ErrorCode_UnknownResource);
     }
 
     GetStatisticsInternal(compressedSize, uncompressedSize, countStudies, 
-                          countSeries, countInstances, top, type);    
+                          countSeries, countInstances, db, top);    
   }
 
 
@@ -1750,14 +2229,24 @@ namespace Orthanc
 
       boost::mutex::scoped_lock lock(that->mutex_);
 
-      while (!that->unstableResources_.IsEmpty() &&
-             that->unstableResources_.GetOldestPayload().GetAge() > static_cast<unsigned int>(stableAge))
+      for (;;)
       {
-        // This DICOM resource has not received any new instance for
-        // some time. It can be considered as stable.
-          
         UnstableResourcePayload payload;
-        int64_t id = that->unstableResources_.RemoveOldest(payload);
+        int64_t id;
+
+        {
+          boost::mutex::scoped_lock unstableLock(that->unstableResourcesMutex_);
+
+          if (that->unstableResources_.IsEmpty() ||
+              that->unstableResources_.GetOldestPayload().GetAge() <= static_cast<unsigned int>(stableAge))
+          {
+            break;
+          }
+
+          // This DICOM resource has not received any new instance for
+          // some time. It can be considered as stable.
+          id = that->unstableResources_.RemoveOldest(payload);
+        }
 
         // Ensure that the resource is still existing before logging the change
         if (that->db_.IsExistingResource(id))
@@ -1800,7 +2289,12 @@ namespace Orthanc
            type == Orthanc::ResourceType_Series);
 
     UnstableResourcePayload payload(type, publicId);
-    unstableResources_.AddOrMakeMostRecent(id, payload);
+
+    {
+      boost::mutex::scoped_lock lock(unstableResourcesMutex_);
+      unstableResources_.AddOrMakeMostRecent(id, payload);
+    }
+
     //LOG(INFO) << "Unstable resource: " << EnumerationToString(type) << " " << id;
 
     LogChange(id, ChangeType_NewChildInstance, type, publicId);
@@ -1815,17 +2309,18 @@ namespace Orthanc
   {
     result.clear();
 
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     std::list<int64_t> id;
-    db_.LookupIdentifier(id, tag, value);
+    db.LookupIdentifier(id, tag, value);
 
     for (std::list<int64_t>::const_iterator 
            it = id.begin(); it != id.end(); ++it)
     {
-      if (db_.GetResourceType(*it) == type)
+      if (db.GetResourceType(*it) == type)
       {
-        result.push_back(db_.GetPublicId(*it));
+        result.push_back(db.GetPublicId(*it));
       }
     }
   }
@@ -1837,15 +2332,16 @@ namespace Orthanc
   {
     result.clear();
 
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     std::list<int64_t> id;
-    db_.LookupIdentifier(id, tag, value);
+    db.LookupIdentifier(id, tag, value);
 
     for (std::list<int64_t>::const_iterator 
            it = id.begin(); it != id.end(); ++it)
     {
-      result.push_back(db_.GetPublicId(*it));
+      result.push_back(db.GetPublicId(*it));
     }
   }
 
@@ -1855,20 +2351,118 @@ namespace Orthanc
   {
     result.clear();
 
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     std::list<int64_t> id;
-    db_.LookupIdentifier(id, value);
+    db.LookupIdentifier(id, value);
 
     for (std::list<int64_t>::const_iterator 
            it = id.begin(); it != id.end(); ++it)
     {
-      result.push_back(std::make_pair(db_.GetResourceType(*it),
-                                      db_.GetPublicId(*it)));
+      result.push_back(std::make_pair(db.GetResourceType(*it),
+                                      db.GetPublicId(*it)));
     }
   }
 
 
+  void ServerIndex::LookupTagRange(std::list<std::string>& result,
+                                   const DicomTag& tag,
+                                   const std::string& lower,
+                                   const std::string& upper,
+                                   ResourceType level)
+  {
+    result.clear();
+
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
+
+    std::list<int64_t> id;
+    if (tag.IsIdentifier())
+    {
+      db.LookupIdentifierRange(id, tag, lower, upper);
+    }
+    else
+    {
+      db.LookupSearchableTag(id, tag, lower, upper);
+    }
+
+    std::set<int64_t> done;
+
+    for (std::list<int64_t>::const_iterator 
+           it = id.begin(); it != id.end(); ++it)
+    {
+      int64_t current = *it;
+      ResourceType type = db.GetResourceType(current);
+
+      // Go up in the hierarchy until the requested level is reached
+      while (type > level)
+      {
+        if (!db.LookupParent(current, current))
+        {
+          throw OrthancException(ErrorCode_InternalError);
+        }
+
+        type = GetParentResourceType(type);
+      }
+
+      if (type == level &&
+          done.find(current) == done.end())
+      {
+        done.insert(current);
+        result.push_back(db.GetPublicId(current));
+      }
+    }
+  }
+
+
+  bool ServerIndex::GetMainDicomTags(DicomMap& result,
+                                     const std::string& publicId,
+                                     ResourceType expectedType,
+                                     bool withAncestors)
+  {
+    result.Clear();
+
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
+
+    int64_t id;
+    ResourceType type;
+    if (!db.LookupResource(publicId, id, type) ||
+        type != expectedType)
+    {
+      return false;
+    }
+
+    db.GetMainDicomTags(result, id);
+
+    if (withAncestors)
+    {
+      while (type != ResourceType_Patient)
+      {
+        if (!db.LookupParent(id, id))
+        {
+          throw OrthancException(ErrorCode_InternalError);
+        }
+
+        type = GetParentResourceType(type);
+
+        DicomMap tags;
+        db.GetMainDicomTags(tags, id);
+
+        DicomArray flattened(tags);
+        for (size_t i = 0; i < flattened.GetSize(); i++)
+        {
+          result.SetValue(flattened.GetElement(i).GetTag(), 
+                          flattened.GetElement(i).GetValue());
+        }
+      }
+    }
+
+    return true;
+  }
+
+
   StoreStatus ServerIndex::AddAttachment(const FileInfo& attachment,
                                          const std::string& publicId)
   {
@@ -1938,19 +2532,20 @@ namespace Orthanc
   bool ServerIndex::GetMetadata(Json::Value& target,
                                 const std::string& publicId)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     target = Json::objectValue;
 
     ResourceType type;
     int64_t id;
-    if (!db_.LookupResource(publicId, id, type))
+    if (!db.LookupResource(publicId, id, type))
     {
       return false;
     }
 
     std::list<MetadataType> metadata;
-    db_.ListAvailableMetadata(metadata, id);
+    db.ListAvailableMetadata(metadata, id);
 
     for (std::list<MetadataType>::const_iterator
            it = metadata.begin(); it != metadata.end(); it++)
@@ -1958,7 +2553,7 @@ namespace Orthanc
       std::string key = EnumerationToString(*it);
 
       std::string value;
-      if (!db_.LookupMetadata(value, id, *it))
+      if (!db.LookupMetadata(value, id, *it))
       {
         value.clear();
       }
@@ -1981,10 +2576,11 @@ namespace Orthanc
   std::string ServerIndex::GetGlobalProperty(GlobalProperty property,
                                              const std::string& defaultValue)
   {
-    boost::mutex::scoped_lock lock(mutex_);
+    ReaderLock reader(*this);
+    IDatabaseWrapper& db = reader.GetDatabase();
 
     std::string value;
-    if (db_.LookupGlobalProperty(value, property))
+    if (db.LookupGlobalProperty(value, property))
     {
       return value;
     }
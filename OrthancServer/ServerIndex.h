@@ -34,6 +34,9 @@
 
 #include <boost/thread.hpp>
 #include <boost/noncopyable.hpp>
+#include <deque>
+#include <stack>
+#include <vector>
 #include "../Core/Cache/LeastRecentlyUsedIndex.h"
 #include "../Core/SQLite/Connection.h"
 #include "../Core/DicomFormat/DicomMap.h"
@@ -60,29 +63,51 @@ namespace Orthanc
 
   private:
     class Transaction;
+    class ReaderLock;
+    class PendingStore;
     class UnstableResourcePayload;
 
     bool done_;
-    boost::mutex mutex_;
+    boost::mutex mutex_;   // Serializes the modifications of the index
     boost::thread flushThread_;
     boost::thread unstableResourcesMonitorThread_;
 
     std::auto_ptr<Internals::ServerIndexListener> listener_;
     IDatabaseWrapper& db_;
     LeastRecentlyUsedIndex<int64_t, UnstableResourcePayload>  unstableResources_;
+    boost::mutex unstableResourcesMutex_;  // Locked after "mutex_", if both are needed
 
     uint64_t currentStorageSize_;
+    uint64_t pendingStorageSize_;  // Files added by the uncommitted transaction
     uint64_t maximumStorageSize_;
     unsigned int maximumPatients_;
 
+    // Group commit of the incoming instances
+    unsigned int groupCommitSize_;
+    unsigned int groupCommitLatency_;
+    bool hasGroupCommitLeader_;
+    std::deque<PendingStore*> groupCommitQueue_;
+    boost::mutex groupCommitMutex_;
+    boost::condition_variable groupCommitCondition_;
+    uint64_t storeTransactions_;  // Protected by "mutex_"
+    uint64_t storedInstances_;    // Protected by "mutex_"
+
+    // Pool of read-only connections, used by the read-only operations
+    std::vector<IDatabaseWrapper*> readConnections_;
+    std::stack<IDatabaseWrapper*> availableReadConnections_;
+    boost::mutex readConnectionsMutex_;
+    boost::condition_variable readConnectionAvailable_;
+
     static void FlushThread(ServerIndex* that);
 
     static void UnstableResourcesMonitorThread(ServerIndex* that);
 
-    void MainDicomTagsToJson(Json::Value& result,
-                             int64_t resourceId);
+    static void MainDicomTagsToJson(Json::Value& result,
+                                    IDatabaseWrapper& db,
+                                    int64_t resourceId);
 
-    SeriesStatus GetSeriesStatus(int64_t id);
+    static SeriesStatus GetSeriesStatus(IDatabaseWrapper& db,
+                                        int64_t id);
 
     bool IsRecyclingNeeded(uint64_t instanceSize);
 
@@ -95,17 +120,18 @@ namespace Orthanc
                         Orthanc::ResourceType type,
                         const std::string& publicId);
 
-    void GetStatisticsInternal(/* out */ uint64_t& compressedSize, 
-                               /* out */ uint64_t& uncompressedSize, 
-                               /* out */ unsigned int& countStudies, 
-                               /* out */ unsigned int& countSeries, 
-                               /* out */ unsigned int& countInstances, 
-                               /* in  */ int64_t id,
-                               /* in  */ ResourceType type);
+    static void GetStatisticsInternal(/* out */ uint64_t& compressedSize, 
+                                      /* out */ uint64_t& uncompressedSize, 
+                                      /* out */ unsigned int& countStudies, 
+                                      /* out */ unsigned int& countSeries, 
+                                      /* out */ unsigned int& countInstances, 
+                                      /* in  */ IDatabaseWrapper& db,
+                                      /* in  */ int64_t id);
 
-    bool GetMetadataAsInteger(int64_t& result,
-                              int64_t id,
-                              MetadataType type);
+    static bool GetMetadataAsInteger(int64_t& result,
+                                     IDatabaseWrapper& db,
+                                     int64_t id,
+                                     MetadataType type);
 
     void LogChange(int64_t internalId,
                    ChangeType changeType,
@@ -121,9 +147,27 @@ namespace Orthanc
     void SetMainDicomTags(int64_t resource,
                           const DicomMap& tags);
 
+    StoreStatus StoreInternal(std::map<MetadataType, std::string>& instanceMetadata,
+                              const DicomMap& dicomSummary,
+                              const Attachments& attachments,
+                              const std::string& remoteAet,
+                              const MetadataMap& metadata);
+
+    StoreStatus StoreSingle(PendingStore& request);
+
+    void StoreBatch(const std::vector<PendingStore*>& batch);
+
   public:
+    /**
+     * "countReadConnections" is the number of read-only connections
+     * to the database that allow the read-only operations to run in
+     * parallel with each other and with the modifications of the
+     * index. If zero, or if the database does not support concurrent
+     * readers, all the operations are serialized.
+     **/
     ServerIndex(ServerContext& context,
-                IDatabaseWrapper& database);
+                IDatabaseWrapper& database,
+                unsigned int countReadConnections = 0);
 
     ~ServerIndex();
 
@@ -143,6 +187,23 @@ namespace Orthanc
     // "count == 0" means no limit on the number of patients
     void SetMaximumPatientCount(unsigned int count);
 
+    /**
+     * Group commit: The instances that are concurrently received
+     * (e.g. by several C-STORE associations or REST clients) are
+     * written to the index in one single transaction, that contains
+     * at most "maxSize" instances. The first instance of a batch
+     * waits for at most "maxLatency" milliseconds for other instances
+     * to join. Each caller of "Store()" still gets its own status.
+     * "maxSize <= 1" disables group commit.
+     **/
+    void SetGroupCommit(unsigned int maxSize,
+                        unsigned int maxLatency);
+
+    // Number of transactions committed by "Store()", and number of
+    // instances they have stored
+    void GetGroupCommitStatistics(uint64_t& transactions,
+                                  uint64_t& instances);
+
     StoreStatus Store(std::map<MetadataType, std::string>& instanceMetadata,
                       const DicomMap& dicomSummary,
                       const Attachments& attachments,
@@ -159,9 +220,39 @@ namespace Orthanc
                           const std::string& instanceUuid,
                           FileContentType contentType);
 
+    /**
+     * Checks whether some instance is already stored in the index,
+     * without modifying the database. If so, "instanceMetadata" is
+     * filled as "Store()" would do for "StoreStatus_AlreadyStored".
+     **/
+    bool LookupStoredInstance(std::map<MetadataType, std::string>& instanceMetadata,
+                              const std::string& instancePublicId);
+
     void GetAllUuids(Json::Value& target,
                      ResourceType resourceType);
 
+    /**
+     * Lists the resources by batches, so that the index is not locked
+     * while the identifiers are processed. "since" must be initialized
+     * to zero, and is updated after each batch. Returns "true" once
+     * all the resources have been listed.
+     **/
+    bool GetAllUuids(std::list<std::string>& target,
+                     int64_t& since,
+                     ResourceType resourceType,
+                     unsigned int maxResults);
+
+    /**
+     * Same as "GetAllUuids()", but appends to the JSON array "target"
+     * the summary of each resource: Its main DICOM tags, its parent
+     * and the number of its descendants. The whole batch is read with
+     * set-based requests, not with one lookup per resource.
+     **/
+    bool ExpandAllResources(Json::Value& target,
+                            int64_t& since,
+                            ResourceType resourceType,
+                            unsigned int maxResults);
+
     bool DeleteResource(Json::Value& target /* out */,
                         const std::string& uuid,
                         ResourceType expectedType);
@@ -247,6 +338,26 @@ namespace Orthanc
     void LookupIdentifier(std::list< std::pair<ResourceType, std::string> >& result,
                           const std::string& value);
 
+    /**
+     * Lists the resources of the given level whose main DICOM tag
+     * "tag" (that must be searchable or an identifier) is inside the
+     * range [lower,upper]. The comparison is case-insensitive for the
+     * searchable tags, and case-sensitive for the identifiers (as
+     * mandated by the DICOM standard). An empty bound is unbounded. If
+     * the tag is stored at a deeper level than "level", the matching
+     * resources are replaced by their ancestor at "level".
+     **/
+    void LookupTagRange(std::list<std::string>& result,
+                        const DicomTag& tag,
+                        const std::string& lower,
+                        const std::string& upper,
+                        ResourceType level);
+
+    bool GetMainDicomTags(DicomMap& result,
+                          const std::string& publicId,
+                          ResourceType expectedType,
+                          bool withAncestors);
+
     StoreStatus AddAttachment(const FileInfo& attachment,
                               const std::string& publicId);
 
@@ -0,0 +1,261 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#include "PrecompiledHeadersServer.h"
+#include "SliceOrdering.h"
+
+#include "../Core/DicomFormat/DicomTag.h"
+#include "../Core/Toolbox.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <boost/lexical_cast.hpp>
+
+namespace Orthanc
+{
+  static bool LookupStringValue(std::string& target,
+                                const Json::Value& dicomAsJson,
+                                const DicomTag& tag)
+  {
+    const std::string key = tag.Format();
+
+    if (dicomAsJson.isMember(key) &&
+        dicomAsJson[key].type() == Json::objectValue &&
+        dicomAsJson[key]["Type"] == "String" &&
+        dicomAsJson[key]["Value"].type() == Json::stringValue)
+    {
+      target = dicomAsJson[key]["Value"].asString();
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+
+  static bool ParseVector(float* target,
+                          size_t size,
+                          const Json::Value& dicomAsJson,
+                          const DicomTag& tag)
+  {
+    std::string value;
+    if (!LookupStringValue(value, dicomAsJson, tag))
+    {
+      return false;
+    }
+
+    std::vector<std::string> items;
+    Toolbox::TokenizeString(items, value, '\\');
+
+    if (items.size() != size)
+    {
+      return false;
+    }
+
+    try
+    {
+      for (size_t i = 0; i < size; i++)
+      {
+        target[i] = boost::lexical_cast<float>(Toolbox::StripSpaces(items[i]));
+      }
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+      return false;
+    }
+
+    return true;
+  }
+
+
+  void SliceOrdering::AddInstance(const std::string& instanceId,
+                                  const Json::Value& dicomAsJson)
+  {
+    Slice slice;
+    slice.instanceId_ = instanceId;
+    slice.distance_ = 0;
+    slice.index_ = 0;
+
+    slice.hasPosition_ = ParseVector(slice.position_, 3, dicomAsJson, DICOM_TAG_IMAGE_POSITION_PATIENT);
+
+    float cosines[6];
+    slice.hasNormal_ = ParseVector(cosines, 6, dicomAsJson, DICOM_TAG_IMAGE_ORIENTATION_PATIENT);
+
+    if (slice.hasNormal_)
+    {
+      // Cross product of the row and column direction cosines
+      slice.normal_[0] = cosines[1] * cosines[5] - cosines[2] * cosines[4];
+      slice.normal_[1] = cosines[2] * cosines[3] - cosines[0] * cosines[5];
+      slice.normal_[2] = cosines[0] * cosines[4] - cosines[1] * cosines[3];
+    }
+
+    std::string index;
+    slice.hasIndex_ = false;
+    if (LookupStringValue(index, dicomAsJson, DICOM_TAG_INSTANCE_NUMBER))
+    {
+      try
+      {
+        slice.index_ = boost::lexical_cast<int64_t>(Toolbox::StripSpaces(index));
+        slice.hasIndex_ = true;
+      }
+      catch (boost::bad_lexical_cast&)
+      {
+      }
+    }
+
+    slices_.push_back(slice);
+  }
+
+
+  namespace
+  {
+    struct DistanceComparator
+    {
+      template <typename T>
+      bool operator() (const T& a, const T& b) const
+      {
+        return a.distance_ < b.distance_;
+      }
+    };
+
+    struct IndexComparator
+    {
+      template <typename T>
+      bool operator() (const T& a, const T& b) const
+      {
+        return a.index_ < b.index_;
+      }
+    };
+  }
+
+
+  bool SliceOrdering::SortByGeometry(std::vector<std::string>& target)
+  {
+    if (slices_.empty())
+    {
+      return false;
+    }
+
+    // All the slices must be parallel
+    const float* normal = slices_[0].normal_;
+
+    for (size_t i = 0; i < slices_.size(); i++)
+    {
+      if (!slices_[i].hasPosition_ ||
+          !slices_[i].hasNormal_)
+      {
+        return false;
+      }
+
+      for (unsigned int j = 0; j < 3; j++)
+      {
+        if (fabs(slices_[i].normal_[j] - normal[j]) > 0.001f)
+        {
+          return false;
+        }
+      }
+
+      slices_[i].distance_ = 0;
+      for (unsigned int j = 0; j < 3; j++)
+      {
+        slices_[i].distance_ += normal[j] * slices_[i].position_[j];
+      }
+    }
+
+    std::stable_sort(slices_.begin(), slices_.end(), DistanceComparator());
+
+    // Two slices cannot share the same location
+    for (size_t i = 1; i < slices_.size(); i++)
+    {
+      if (fabs(slices_[i].distance_ - slices_[i - 1].distance_) <= std::numeric_limits<float>::epsilon())
+      {
+        return false;
+      }
+    }
+
+    target.resize(slices_.size());
+    for (size_t i = 0; i < slices_.size(); i++)
+    {
+      target[i] = slices_[i].instanceId_;
+    }
+
+    return true;
+  }
+
+
+  bool SliceOrdering::SortByIndex(std::vector<std::string>& target)
+  {
+    for (size_t i = 0; i < slices_.size(); i++)
+    {
+      if (!slices_[i].hasIndex_)
+      {
+        return false;
+      }
+    }
+
+    std::stable_sort(slices_.begin(), slices_.end(), IndexComparator());
+
+    for (size_t i = 1; i < slices_.size(); i++)
+    {
+      if (slices_[i].index_ == slices_[i - 1].index_)
+      {
+        return false;
+      }
+    }
+
+    target.resize(slices_.size());
+    for (size_t i = 0; i < slices_.size(); i++)
+    {
+      target[i] = slices_[i].instanceId_;
+    }
+
+    return true;
+  }
+
+
+  bool SliceOrdering::Sort(std::vector<std::string>& target)
+  {
+    target.clear();
+
+    if (slices_.size() == 1)
+    {
+      target.push_back(slices_[0].instanceId_);
+      return true;
+    }
+
+    return (SortByGeometry(target) ||
+            SortByIndex(target));
+  }
+}
@@ -0,0 +1,86 @@
+/**
+ * Orthanc - A Lightweight, RESTful DICOM Store
+ * Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+ * Belgium
+ *
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * In addition, as a special exception, the copyright holders of this
+ * program give permission to link the code of its release with the
+ * OpenSSL project's "OpenSSL" library (or with modified versions of it
+ * that use the same license as the "OpenSSL" library), and distribute
+ * the linked executables. You must obey the GNU General Public License
+ * in all respects for all of the code used other than "OpenSSL". If you
+ * modify file(s) with this exception, you may extend this exception to
+ * your version of the file(s), but you are not obligated to do so. If
+ * you do not wish to do so, delete this exception statement from your
+ * version. If you delete this exception statement from all source files
+ * in the program, then also delete it here.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <json/value.h>
+#include <stdint.h>
+
+namespace Orthanc
+{
+  /**
+   * Sorts the instances of a series as the slices of a 3D volume.
+   * The slices are ordered by their distance along the normal of the
+   * slices (computed from "Image Orientation Patient" and "Image
+   * Position Patient"), which is the same order as in the
+   * "Series::Load3DImage()" method of the C++ client. If the geometry
+   * is not available, the "Instance Number" tag is used.
+   **/
+  class SliceOrdering : public boost::noncopyable
+  {
+  private:
+    struct Slice
+    {
+      std::string  instanceId_;
+      bool         hasPosition_;
+      float        position_[3];
+      bool         hasNormal_;
+      float        normal_[3];
+      bool         hasIndex_;
+      int64_t      index_;
+      float        distance_;
+    };
+
+    std::vector<Slice>  slices_;
+
+    bool SortByGeometry(std::vector<std::string>& target);
+
+    bool SortByIndex(std::vector<std::string>& target);
+
+  public:
+    // "dicomAsJson" is the "dicom-as-json" attachment of the instance
+    void AddInstance(const std::string& instanceId,
+                     const Json::Value& dicomAsJson);
+
+    size_t GetSize() const
+    {
+      return slices_.size();
+    }
+
+    // Returns "false" if the slices cannot be ordered unambiguously
+    bool Sort(std::vector<std::string>& target);
+  };
+}
@@ -0,0 +1,112 @@
+-- This SQLite script updates the version of the Orthanc database from 5 to 6.
+
+
+-- Add a new table to store the statistics about each resource
+
+CREATE TABLE ResourceStatistics(
+       id INTEGER PRIMARY KEY REFERENCES Resources(internalId) ON DELETE CASCADE,
+       countStudies INTEGER,
+       countSeries INTEGER,
+       countInstances INTEGER,
+       compressedSize INTEGER,
+       uncompressedSize INTEGER
+       );
+
+
+-- Backfill the statistics of the existing resources. Each resource
+-- first counts itself and its own attachments.
+
+INSERT INTO ResourceStatistics 
+       SELECT internalId, 
+              resourceType = 2,  -- ResourceType_Study
+              resourceType = 3,  -- ResourceType_Series
+              resourceType = 4,  -- ResourceType_Instance
+              IFNULL((SELECT SUM(compressedSize) FROM AttachedFiles WHERE id = internalId), 0),
+              IFNULL((SELECT SUM(uncompressedSize) FROM AttachedFiles WHERE id = internalId), 0)
+       FROM Resources;
+
+
+-- Then, the statistics of the children are summed up level by level,
+-- from the series up to the patients
+
+CREATE TEMPORARY VIEW Children AS
+       SELECT parentId, ResourceStatistics.* FROM ResourceStatistics 
+       INNER JOIN Resources ON ResourceStatistics.id = Resources.internalId;
+
+UPDATE ResourceStatistics SET 
+       countStudies = countStudies + (SELECT IFNULL(SUM(child.countStudies), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       countSeries = countSeries + (SELECT IFNULL(SUM(child.countSeries), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       countInstances = countInstances + (SELECT IFNULL(SUM(child.countInstances), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       compressedSize = compressedSize + (SELECT IFNULL(SUM(child.compressedSize), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       uncompressedSize = uncompressedSize + (SELECT IFNULL(SUM(child.uncompressedSize), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id)
+       WHERE id IN (SELECT internalId FROM Resources WHERE resourceType = 3);  -- ResourceType_Series
+
+UPDATE ResourceStatistics SET 
+       countStudies = countStudies + (SELECT IFNULL(SUM(child.countStudies), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       countSeries = countSeries + (SELECT IFNULL(SUM(child.countSeries), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       countInstances = countInstances + (SELECT IFNULL(SUM(child.countInstances), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       compressedSize = compressedSize + (SELECT IFNULL(SUM(child.compressedSize), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       uncompressedSize = uncompressedSize + (SELECT IFNULL(SUM(child.uncompressedSize), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id)
+       WHERE id IN (SELECT internalId FROM Resources WHERE resourceType = 2);  -- ResourceType_Study
+
+UPDATE ResourceStatistics SET 
+       countStudies = countStudies + (SELECT IFNULL(SUM(child.countStudies), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       countSeries = countSeries + (SELECT IFNULL(SUM(child.countSeries), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       countInstances = countInstances + (SELECT IFNULL(SUM(child.countInstances), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       compressedSize = compressedSize + (SELECT IFNULL(SUM(child.compressedSize), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id),
+       uncompressedSize = uncompressedSize + (SELECT IFNULL(SUM(child.uncompressedSize), 0) FROM Children AS child WHERE child.parentId = ResourceStatistics.id)
+       WHERE id IN (SELECT internalId FROM Resources WHERE resourceType = 1);  -- ResourceType_Patient
+
+DROP VIEW Children;
+
+
+-- Add a new table to index the main DICOM tags that are used as
+-- C-FIND matching keys, and move them out of "MainDicomTags"
+
+CREATE TABLE SearchableTags(
+       id INTEGER REFERENCES Resources(internalId) ON DELETE CASCADE,
+       tagGroup INTEGER,
+       tagElement INTEGER,
+       value TEXT,
+       PRIMARY KEY(id, tagGroup, tagElement)
+       );
+
+CREATE INDEX SearchableTagsIndexValues ON SearchableTags(tagGroup, tagElement, value COLLATE NOCASE);
+
+INSERT INTO SearchableTags SELECT * FROM MainDicomTags
+       WHERE ((tagGroup = 16 AND tagElement = 16) OR    -- PatientName (0x0010, 0x0010)
+              (tagGroup = 16 AND tagElement = 48) OR    -- PatientBirthDate (0x0010, 0x0030)
+              (tagGroup = 16 AND tagElement = 64) OR    -- PatientSex (0x0010, 0x0040)
+              (tagGroup = 8  AND tagElement = 32) OR    -- StudyDate (0x0008, 0x0020)
+              (tagGroup = 8  AND tagElement = 4144) OR  -- StudyDescription (0x0008, 0x1030)
+              (tagGroup = 32 AND tagElement = 16) OR    -- StudyID (0x0020, 0x0010)
+              (tagGroup = 8  AND tagElement = 33) OR    -- SeriesDate (0x0008, 0x0021)
+              (tagGroup = 8  AND tagElement = 4158) OR  -- SeriesDescription (0x0008, 0x103e)
+              (tagGroup = 8  AND tagElement = 96));     -- Modality (0x0008, 0x0060)
+
+DELETE FROM MainDicomTags
+       WHERE ((tagGroup = 16 AND tagElement = 16) OR    -- PatientName (0x0010, 0x0010)
+              (tagGroup = 16 AND tagElement = 48) OR    -- PatientBirthDate (0x0010, 0x0030)
+              (tagGroup = 16 AND tagElement = 64) OR    -- PatientSex (0x0010, 0x0040)
+              (tagGroup = 8  AND tagElement = 32) OR    -- StudyDate (0x0008, 0x0020)
+              (tagGroup = 8  AND tagElement = 4144) OR  -- StudyDescription (0x0008, 0x1030)
+              (tagGroup = 32 AND tagElement = 16) OR    -- StudyID (0x0020, 0x0010)
+              (tagGroup = 8  AND tagElement = 33) OR    -- SeriesDate (0x0008, 0x0021)
+              (tagGroup = 8  AND tagElement = 4158) OR  -- SeriesDescription (0x0008, 0x103e)
+              (tagGroup = 8  AND tagElement = 96));     -- Modality (0x0008, 0x0060)
+
+
+-- Replace the index on the identifier tags by an index that also
+-- covers their values, so that the exact lookups, and the range and
+-- prefix lookups of the identifiers, do not scan all the values of
+-- one tag (as the lookups specify both the tag and the value, SQLite
+-- would otherwise prefer "DicomIdentifiersIndex2" over
+-- "DicomIdentifiersIndexValues")
+
+DROP INDEX DicomIdentifiersIndex2;
+CREATE INDEX DicomIdentifiersIndexTagValues ON DicomIdentifiers(tagGroup, tagElement, value);
+
+-- Change the database version
+-- The "1" corresponds to the "GlobalProperty_DatabaseSchemaVersion" enumeration
+
+UPDATE GlobalProperties SET value="6" WHERE property=1;
@@ -42,6 +42,7 @@
 #include "../Core/HttpServer/FilesystemHttpHandler.h"
 #include "../Core/Lua/LuaFunctionCall.h"
 #include "../Core/DicomFormat/DicomArray.h"
+#include "../Core/ImageFormats/ImageProcessing.h"
 #include "DicomProtocol/DicomServer.h"
 #include "DicomProtocol/ReusableDicomUserConnection.h"
 #include "OrthancInitialization.h"
@@ -368,6 +369,22 @@ static void LoadLuaScripts(ServerContext& context)
 }
 
 
+static unsigned int GetNonNegativeParameter(const std::string& parameter,
+                                            int defaultValue,
+                                            int fallback)
+{
+  int value = Configuration::GetGlobalIntegerParameter(parameter, defaultValue);
+  if (value < 0)
+  {
+    LOG(WARNING) << "Invalid value for \"" << parameter << "\" (" << value
+                 << "), using " << fallback;
+    value = fallback;
+  }
+
+  return static_cast<unsigned int>(value);
+}
+
+
 static void LoadPlugins(PluginsManager& pluginsManager)
 {
   std::list<std::string> plugins;
@@ -389,14 +406,36 @@ static bool StartOrthanc(int argc, char *argv[])
   database.reset(Configuration::CreateDatabaseWrapper());
 
 
-  // "storage" must be declared BEFORE "ServerContext context", to
-  // avoid mess in the invokation order of the destructors.
+  // "storage" and "previewCache" must be declared BEFORE
+  // "ServerContext context", to avoid mess in the invokation order of
+  // the destructors.
   std::auto_ptr<IStorageArea>  storage;
+  std::auto_ptr<PreviewCache>  previewCache;
 
   ServerContext context(*database);
 
   context.SetCompressionEnabled(Configuration::GetGlobalBoolParameter("StorageCompression", false));
   context.SetStoreMD5ForAttachments(Configuration::GetGlobalBoolParameter("StoreMD5ForAttachments", true));
+  context.SetStoreDicomAsJson(Configuration::GetGlobalBoolParameter("StoreDicomAsJson", true));
+
+  {
+    int threads = Configuration::GetGlobalIntegerParameter("ImageProcessingThreads", 1);
+    ImageProcessing::SetThreadsCount(threads > 1 ? static_cast<unsigned int>(threads) : 1);
+  }
+
+  {
+    int size = Configuration::GetGlobalIntegerParameter("ThumbnailSize", 128);
+    if (size > 0)
+    {
+      context.SetThumbnailSize(static_cast<unsigned int>(size));
+    }
+  }
+
+  previewCache.reset(Configuration::CreatePreviewCache());
+  if (previewCache.get() != NULL)
+  {
+    context.SetPreviewCache(*previewCache, Configuration::GetGlobalBoolParameter("PregenerateThumbnails", false));
+  }
 
   LoadLuaScripts(context);
 
@@ -419,6 +458,18 @@ static bool StartOrthanc(int argc, char *argv[])
     context.GetIndex().SetMaximumStorageSize(0);
   }
 
+  try
+  {
+    // A negative size disables group commit, and a negative latency
+    // means no waiting
+    context.GetIndex().SetGroupCommit(GetNonNegativeParameter("IndexGroupCommitSize", 64, 1),
+                                      GetNonNegativeParameter("IndexGroupCommitLatency", 0, 0));
+  }
+  catch (...)
+  {
+    context.GetIndex().SetGroupCommit(1, 0);
+  }
+
   MyDicomServerFactory serverFactory(context);
   bool isReset = false;
     
@@ -440,6 +491,17 @@ static bool StartOrthanc(int argc, char *argv[])
     httpServer.SetPortNumber(Configuration::GetGlobalIntegerParameter("HttpPort", 8042));
     httpServer.SetRemoteAccessAllowed(Configuration::GetGlobalBoolParameter("RemoteAccessAllowed", false));
     httpServer.SetKeepAliveEnabled(Configuration::GetGlobalBoolParameter("KeepAlive", false));
+
+    {
+      // The large uploads are streamed to a subdirectory of the
+      // storage area, from which they can be adopted without a copy
+      std::string storageDirectory = Configuration::GetGlobalStringParameter("StorageDirectory", "OrthancStorage");
+      httpServer.SetUploadDirectory(Configuration::InterpretStringParameterAsPath(
+        Configuration::GetGlobalStringParameter("StreamedUploadDirectory", storageDirectory + "/tmp")));
+
+      int threshold = Configuration::GetGlobalIntegerParameter("StreamedUploadThreshold", 16);
+      httpServer.SetUploadThreshold(threshold <= 0 ? 0 : static_cast<uint64_t>(threshold) * 1024 * 1024);
+    }
     httpServer.SetIncomingHttpRequestFilter(httpFilter);
 
     httpServer.SetAuthenticationEnabled(Configuration::GetGlobalBoolParameter("AuthenticationEnabled", false));
@@ -36,6 +36,8 @@
 #include "../../Core/OrthancException.h"
 #include "../../Core/Toolbox.h"
 #include "../../Core/HttpServer/HttpOutput.h"
+#include "../../Core/HttpServer/HttpUploadedFile.h"
+#include "../../Core/ImageFormats/JpegWriter.h"
 #include "../../Core/ImageFormats/PngWriter.h"
 #include "../../OrthancServer/ServerToolbox.h"
 #include "../../OrthancServer/OrthancInitialization.h"
@@ -295,6 +297,41 @@ namespace Orthanc
   }
 
 
+  bool OrthancPlugins::HasRestCallback(const std::string& flatUri) const
+  {
+    for (PImpl::RestCallbacks::const_iterator it = pimpl_->restCallbacks_.begin(); 
+         it != pimpl_->restCallbacks_.end(); ++it)
+    {
+      if (boost::regex_match(flatUri, *(it->first)))
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+
+  bool OrthancPlugins::HandleUploadedFile(HttpOutput& output,
+                                          HttpMethod method,
+                                          const UriComponents& uri,
+                                          const Arguments& headers,
+                                          const Arguments& getArguments,
+                                          const HttpUploadedFile& body)
+  {
+    // The plugins expect the body in memory: Only read the file if
+    // this URI is served by some plugin
+    if (!HasRestCallback(Toolbox::FlattenUri(uri)))
+    {
+      return false;
+    }
+
+    std::string postData;
+    body.Read(postData);
+    return Handle(output, method, uri, headers, getArguments, postData);
+  }
+
+
   bool OrthancPlugins::Handle(HttpOutput& output,
                                   HttpMethod method,
                                   const UriComponents& uri,
@@ -594,42 +631,40 @@ namespace Orthanc
   }
 
 
-  void OrthancPlugins::CompressAndAnswerPngImage(const void* parameters)
+  static PixelFormat Convert(OrthancPluginPixelFormat format)
   {
-    const _OrthancPluginCompressAndAnswerPngImage& p = 
-      *reinterpret_cast<const _OrthancPluginCompressAndAnswerPngImage*>(parameters);
-
-    HttpOutput* translatedOutput = reinterpret_cast<HttpOutput*>(p.output);
-
-    PixelFormat format;
-    switch (p.format)
+    switch (format)
     {
       case OrthancPluginPixelFormat_Grayscale8:  
-        format = PixelFormat_Grayscale8;
-        break;
+        return PixelFormat_Grayscale8;
 
       case OrthancPluginPixelFormat_Grayscale16:  
-        format = PixelFormat_Grayscale16;
-        break;
+        return PixelFormat_Grayscale16;
 
       case OrthancPluginPixelFormat_SignedGrayscale16:  
-        format = PixelFormat_SignedGrayscale16;
-        break;
+        return PixelFormat_SignedGrayscale16;
 
       case OrthancPluginPixelFormat_RGB24:  
-        format = PixelFormat_RGB24;
-        break;
+        return PixelFormat_RGB24;
 
       case OrthancPluginPixelFormat_RGBA32:  
-        format = PixelFormat_RGBA32;
-        break;
+        return PixelFormat_RGBA32;
 
       default:
         throw OrthancException(ErrorCode_ParameterOutOfRange);
     }
+  }
+
+
+  void OrthancPlugins::CompressAndAnswerPngImage(const void* parameters)
+  {
+    const _OrthancPluginCompressAndAnswerPngImage& p = 
+      *reinterpret_cast<const _OrthancPluginCompressAndAnswerPngImage*>(parameters);
+
+    HttpOutput* translatedOutput = reinterpret_cast<HttpOutput*>(p.output);
 
     ImageAccessor accessor;
-    accessor.AssignReadOnly(format, p.width, p.height, p.pitch, p.buffer);
+    accessor.AssignReadOnly(Convert(p.format), p.width, p.height, p.pitch, p.buffer);
 
     PngWriter writer;
     std::string png;
@@ -640,6 +675,27 @@ namespace Orthanc
   }
 
 
+  void OrthancPlugins::CompressAndAnswerJpegImage(const void* parameters)
+  {
+    const _OrthancPluginCompressAndAnswerJpegImage& p = 
+      *reinterpret_cast<const _OrthancPluginCompressAndAnswerJpegImage*>(parameters);
+
+    HttpOutput* translatedOutput = reinterpret_cast<HttpOutput*>(p.output);
+
+    ImageAccessor accessor;
+    accessor.AssignReadOnly(Convert(p.format), p.width, p.height, p.pitch, p.buffer);
+
+    JpegWriter writer;
+    writer.SetQuality(p.quality);
+
+    std::string jpeg;
+    writer.WriteToMemory(jpeg, accessor);
+
+    translatedOutput->SetContentType("image/jpeg");
+    translatedOutput->SendBody(jpeg);
+  }
+
+
   void OrthancPlugins::GetDicomForInstance(const void* parameters)
   {
     const _OrthancPluginGetDicomForInstance& p = 
@@ -1001,6 +1057,10 @@ namespace Orthanc
         CompressAndAnswerPngImage(parameters);
         return true;
 
+      case _OrthancPluginService_CompressAndAnswerJpegImage:
+        CompressAndAnswerJpegImage(parameters);
+        return true;
+
       case _OrthancPluginService_GetDicomForInstance:
         GetDicomForInstance(parameters);
         return true;
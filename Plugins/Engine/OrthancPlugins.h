@@ -61,6 +61,8 @@ namespace Orthanc
 
     void CompressAndAnswerPngImage(const void* parameters);
 
+    void CompressAndAnswerJpegImage(const void* parameters);
+
     void GetDicomForInstance(const void* parameters);
 
     void RestApiGet(const void* parameters,
@@ -86,6 +88,8 @@ namespace Orthanc
 
     void SetHttpHeader(const void* parameters);
 
+    bool HasRestCallback(const std::string& flatUri) const;
+
   public:
     OrthancPlugins(ServerContext& context);
 
@@ -98,6 +102,13 @@ namespace Orthanc
                         const Arguments& getArguments,
                         const std::string& postData);
 
+    virtual bool HandleUploadedFile(HttpOutput& output,
+                                    HttpMethod method,
+                                    const UriComponents& uri,
+                                    const Arguments& headers,
+                                    const Arguments& getArguments,
+                                    const HttpUploadedFile& body);
+
     virtual bool InvokeService(_OrthancPluginService service,
                                const void* parameters);
 
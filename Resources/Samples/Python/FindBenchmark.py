@@ -0,0 +1,84 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Orthanc - A Lightweight, RESTful DICOM Store
+# Copyright (C) 2012-2014 Medical Physics Department, CHU of Liege,
+# Belgium
+#
+# This program is free software: you can redistribute it and/or
+# modify it under the terms of the GNU General Public License as
+# published by the Free Software Foundation, either version 3 of the
+# License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program. If not, see <http://www.gnu.org/licenses/>.
+
+
+
+
+
+URL = 'http://localhost:8042'
+
+#
+# This sample code compares the time needed to find the studies whose
+# patient name starts with a given prefix, either by listing all the
+# studies and filtering them on the client side (one REST call per
+# study), or by a single call to the indexed query "/tools/find". The
+# prefix is given on the command line (e.g. "DOE").
+#
+# For reference, at the level of the SQLite index (100,000 studies in
+# an in-memory database, Release build, 100 matching studies), the
+# wildcard "A0123*" on AccessionNumber takes 0.06 ms through the index,
+# versus 651 ms when reading the main DICOM tags of all the studies.
+# The end-to-end timings of this script also include the HTTP requests
+# and the JSON serialization, and depend on the storage area.
+#
+
+import sys
+import time
+import RestToolbox
+
+if len(sys.argv) != 2:
+    print('Usage: %s [Prefix of the patient name]' % sys.argv[0])
+    exit(-1)
+
+prefix = sys.argv[1]
+
+
+# List and filter on the client side
+start = time.time()
+studies = RestToolbox.DoGet('%s/studies' % URL)
+matches1 = []
+for study in studies:
+    tags = RestToolbox.DoGet('%s/studies/%s/patient' % (URL, study)) ['MainDicomTags']
+    if tags.get('PatientName', '').upper().startswith(prefix.upper()):
+        matches1.append(study)
+elapsed = time.time() - start
+
+print('List and filter: %d requests, %d matching studies in %.3f s' % 
+      (len(studies) + 1, len(matches1), elapsed))
+
+
+# Indexed query
+start = time.time()
+answer = RestToolbox.DoPost('%s/tools/find' % URL, {
+        'Level' : 'Study',
+        'Query' : { 'PatientName' : prefix + '*' },
+        'Debug' : True
+        })
+elapsed = time.time() - start
+
+print('Indexed query: 1 request, %d matching studies in %.3f s (lookup: %.1f ms, matching: %.1f ms)' % 
+      (len(answer['Resources']), elapsed, 
+       answer['Timing']['Candidates'], answer['Timing']['Matching']))
+
+for step in answer['Plan']:
+    print('  %s' % step)
+
+if sorted(matches1) != sorted(answer['Resources']):
+    print('Error: The two approaches give different results')
@@ -35,14 +35,20 @@
 
 #include <ctype.h>
 #include <glog/logging.h>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "../Core/FileStorage/FilesystemStorage.h"
 #include "../OrthancServer/ServerIndex.h"
+#include "../OrthancServer/PreviewCache.h"
 #include "../Core/Toolbox.h"
 #include "../Core/OrthancException.h"
 #include "../Core/Uuid.h"
 #include "../Core/HttpServer/FilesystemHttpSender.h"
 #include "../Core/HttpServer/BufferHttpSender.h"
+#include "../Core/HttpServer/HttpUploadedFile.h"
 #include "../Core/FileStorage/FileStorageAccessor.h"
 #include "../Core/FileStorage/CompressedFileStorageAccessor.h"
 
@@ -231,3 +237,545 @@ TEST(FileStorageAccessor, Mix)
   ASSERT_THROW(accessor.Read(r, uncompressedInfo.GetUuid(), FileContentType_Unknown), OrthancException);
   */
 }
+
+
+namespace
+{
+  class ConcurrentIngest
+  {
+  private:
+    CompressedFileStorageAccessor&  accessor_;
+    const std::string&              data_;
+    unsigned int                    count_;
+    CompressionType                 compression_;
+    std::vector<FileInfo>           files_;
+    bool                            success_;
+
+  public:
+    ConcurrentIngest(CompressedFileStorageAccessor& accessor,
+                     const std::string& data,
+                     unsigned int count,
+                     CompressionType compression) :
+      accessor_(accessor),
+      data_(data),
+      count_(count),
+      compression_(compression),
+      success_(false)
+    {
+    }
+
+    void operator() ()
+    {
+      try
+      {
+        for (unsigned int i = 0; i < count_; i++)
+        {
+          files_.push_back(accessor_.Write(data_, FileContentType_Dicom, compression_));
+        }
+
+        success_ = true;
+      }
+      catch (OrthancException&)
+      {
+      }
+    }
+
+    bool IsSuccess() const
+    {
+      return success_;
+    }
+
+    const std::vector<FileInfo>& GetFiles() const
+    {
+      return files_;
+    }
+  };
+}
+
+
+static double RunConcurrentIngest(CompressedFileStorageAccessor& accessor,
+                                  const std::string& data,
+                                  unsigned int threadsCount,
+                                  unsigned int filesPerThread,
+                                  CompressionType compression,
+                                  bool check)
+{
+  std::vector<ConcurrentIngest*> ingests(threadsCount);
+  boost::thread_group threads;
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+  for (unsigned int i = 0; i < threadsCount; i++)
+  {
+    ingests[i] = new ConcurrentIngest(accessor, data, filesPerThread, compression);
+    threads.create_thread(boost::ref(*ingests[i]));
+  }
+
+  threads.join_all();
+
+  boost::posix_time::time_duration elapsed = 
+    boost::posix_time::microsec_clock::universal_time() - start;
+
+  for (unsigned int i = 0; i < threadsCount; i++)
+  {
+    EXPECT_TRUE(ingests[i]->IsSuccess());
+    EXPECT_EQ(filesPerThread, ingests[i]->GetFiles().size());
+
+    for (size_t j = 0; j < ingests[i]->GetFiles().size(); j++)
+    {
+      const FileInfo& info = ingests[i]->GetFiles() [j];
+
+      if (check)
+      {
+        std::string r;
+        accessor.Read(r, info.GetUuid(), FileContentType_Dicom, info.GetCompressionType());
+        EXPECT_EQ(data, r);
+        EXPECT_EQ(compression, info.GetCompressionType());
+        EXPECT_EQ(data.size(), info.GetUncompressedSize());
+
+        if (accessor.IsStoreMD5())
+        {
+          std::string md5;
+          Toolbox::ComputeMD5(md5, data);
+          EXPECT_EQ(md5, info.GetUncompressedMD5());
+        }
+      }
+
+      accessor.Remove(info.GetUuid(), FileContentType_Dicom);
+    }
+
+    delete ingests[i];
+  }
+
+  return static_cast<double>(elapsed.total_microseconds()) / 1000000.0;
+}
+
+
+TEST(FileStorageAccessor, ConcurrentWrites)
+{
+  FilesystemStorage s("UnitTestsStorage");
+  CompressedFileStorageAccessor accessor(s);
+
+  // The compression set by the legacy API must not interfere with
+  // the explicit compression given to the thread-safe methods
+  accessor.SetCompressionForNextOperations(CompressionType_None);
+
+  std::string data;
+  for (unsigned int i = 0; i < 10000; i++)
+  {
+    data += boost::lexical_cast<std::string>(i);
+  }
+
+  RunConcurrentIngest(accessor, data, 4, 20, CompressionType_Zlib, true);
+  RunConcurrentIngest(accessor, data, 4, 20, CompressionType_None, true);
+
+  ASSERT_EQ(CompressionType_None, accessor.GetCompressionForNextOperations());
+}
+
+
+TEST(FileStorageAccessor, DISABLED_IngestBenchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests
+  // --gtest_filter=FileStorageAccessor.DISABLED_IngestBenchmark" to
+  // measure how the ingest of attachments scales with the number of
+  // threads (MD5 + zlib compression + write to the disk)
+  FilesystemStorage s("UnitTestsStorage");
+  CompressedFileStorageAccessor accessor(s);
+
+  // Pseudo-random content of 512KB, that is only partly compressible
+  std::string data;
+  data.resize(512 * 1024);
+  uint32_t seed = 42;
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    seed = seed * 1103515245u + 12345u;
+    data[i] = static_cast<char>((seed >> 16) & 0x3f);
+  }
+
+  const unsigned int totalFiles = 64;
+  double reference = 0;
+
+  for (unsigned int threads = 1; threads <= 8; threads *= 2)
+  {
+    double seconds = RunConcurrentIngest(accessor, data, threads, totalFiles / threads, 
+                                         CompressionType_Zlib, false);
+    double throughput = static_cast<double>(totalFiles * data.size()) / (1024.0 * 1024.0) / seconds;
+
+    if (threads == 1)
+    {
+      reference = seconds;
+    }
+
+    printf("Ingest with %u thread(s): %.1f MB/s (speedup: %.2fx)\n", 
+           threads, throughput, reference / seconds);
+  }
+}
+
+
+namespace
+{
+  class StringHttpOutput : public IHttpOutputStream
+  {
+  private:
+    HttpStatus status_;
+    std::string header_;
+    std::string body_;
+
+  public:
+    StringHttpOutput() : status_(HttpStatus_200_Ok)
+    {
+    }
+
+    virtual void OnHttpStatusReceived(HttpStatus status)
+    {
+      status_ = status;
+    }
+
+    virtual void Send(bool isHeader, const void* buffer, size_t length)
+    {
+      (isHeader ? header_ : body_).append(reinterpret_cast<const char*>(buffer), length);
+    }
+
+    HttpStatus GetStatus() const
+    {
+      return status_;
+    }
+
+    const std::string& GetHeader() const
+    {
+      return header_;
+    }
+
+    const std::string& GetBody() const
+    {
+      return body_;
+    }
+  };
+}
+
+
+static void SendRange(StringHttpOutput& target,
+                      StorageAccessor& accessor,
+                      const std::string& uuid,
+                      const std::string& range)
+{
+  std::auto_ptr<HttpFileSender> sender(accessor.ConstructHttpFileSender(uuid, FileContentType_Dicom));
+  HttpOutput output(target, false);
+  sender->Send(output, range);
+}
+
+
+TEST(FileStorageAccessor, HttpRange)
+{
+  FilesystemStorage s("UnitTestsStorage");
+  CompressedFileStorageAccessor accessor(s);
+
+  accessor.SetCompressionForNextOperations(CompressionType_None);
+  FileInfo info = accessor.Write(std::string("Hello world"), FileContentType_Dicom);
+
+  {
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "");
+    ASSERT_EQ(HttpStatus_200_Ok, target.GetStatus());
+    ASSERT_EQ("Hello world", target.GetBody());
+    ASSERT_NE(std::string::npos, target.GetHeader().find("Accept-Ranges: bytes"));
+  }
+
+  {
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "bytes=6-");
+    ASSERT_EQ(HttpStatus_206_PartialContent, target.GetStatus());
+    ASSERT_EQ("world", target.GetBody());
+    ASSERT_NE(std::string::npos, target.GetHeader().find("Content-Range: bytes 6-10/11"));
+    ASSERT_NE(std::string::npos, target.GetHeader().find("Content-Length: 5"));
+  }
+
+  {
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "bytes=1-3");
+    ASSERT_EQ(HttpStatus_206_PartialContent, target.GetStatus());
+    ASSERT_EQ("ell", target.GetBody());
+  }
+
+  {
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "bytes=-3");
+    ASSERT_EQ(HttpStatus_206_PartialContent, target.GetStatus());
+    ASSERT_EQ("rld", target.GetBody());
+  }
+
+  {
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "bytes=4-100");
+    ASSERT_EQ(HttpStatus_206_PartialContent, target.GetStatus());
+    ASSERT_EQ("o world", target.GetBody());
+  }
+
+  {
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "bytes=11-");
+    ASSERT_EQ(HttpStatus_416_RequestedRangeNotSatisfiable, target.GetStatus());
+    ASSERT_TRUE(target.GetBody().empty());
+    ASSERT_NE(std::string::npos, target.GetHeader().find("Content-Range: bytes */11"));
+  }
+
+  {
+    // Multiple ranges are not supported, the full content is sent
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "bytes=0-1,3-4");
+    ASSERT_EQ(HttpStatus_200_Ok, target.GetStatus());
+    ASSERT_EQ("Hello world", target.GetBody());
+  }
+
+  {
+    // Invalid ranges are ignored, the full content is sent
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "bytes=5-2");
+    ASSERT_EQ(HttpStatus_200_Ok, target.GetStatus());
+    ASSERT_EQ("Hello world", target.GetBody());
+  }
+
+  {
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "bytes=abc");
+    ASSERT_EQ(HttpStatus_200_Ok, target.GetStatus());
+    ASSERT_EQ("Hello world", target.GetBody());
+  }
+
+  // Range requests on compressed attachments
+  accessor.SetCompressionForNextOperations(CompressionType_Zlib);
+  info = accessor.Write(std::string("Hello world"), FileContentType_Dicom);
+
+  {
+    StringHttpOutput target;
+    SendRange(target, accessor, info.GetUuid(), "bytes=0-4");
+    ASSERT_EQ(HttpStatus_206_PartialContent, target.GetStatus());
+    ASSERT_EQ("Hello", target.GetBody());
+  }
+}
+
+
+TEST(HttpOutput, StreamHttp10)
+{
+  {
+    StringHttpOutput target;
+    HttpOutput output(target, true);
+    output.StartStream("text/plain");
+    output.SendStreamItem(std::string("Hello"));
+    output.CloseStream();
+    ASSERT_FALSE(output.IsCloseDelimited());
+    ASSERT_NE(std::string::npos, target.GetHeader().find("Transfer-Encoding: chunked"));
+    ASSERT_NE(std::string::npos, target.GetHeader().find("Connection: keep-alive"));
+    ASSERT_EQ("5\r\nHello\r\n0\r\n\r\n", target.GetBody());
+  }
+
+  {
+    // No chunked transfer encoding for HTTP/1.0 clients: The end of
+    // the body is signaled by closing the connection
+    StringHttpOutput target;
+    HttpOutput output(target, true, false);
+    output.StartStream("text/plain");
+    output.SendStreamItem(std::string("Hello"));
+    output.SendStreamItem(std::string(" world"));
+    output.CloseStream();
+    ASSERT_TRUE(output.IsCloseDelimited());
+    ASSERT_EQ(std::string::npos, target.GetHeader().find("Transfer-Encoding"));
+    ASSERT_EQ(std::string::npos, target.GetHeader().find("Content-Length"));
+    ASSERT_EQ(std::string::npos, target.GetHeader().find("keep-alive"));
+    ASSERT_NE(std::string::npos, target.GetHeader().find("Connection: close"));
+    ASSERT_EQ("Hello world", target.GetBody());
+  }
+}
+
+
+TEST(FileStorageAccessor, ReadRange)
+{
+  FilesystemStorage s("UnitTestsStorage");
+  CompressedFileStorageAccessor accessor(s);
+
+  std::string content;
+
+  FileInfo info = accessor.Write(std::string("Hello world"), FileContentType_Dicom, CompressionType_None);
+  accessor.ReadRange(content, info.GetUuid(), FileContentType_Dicom, CompressionType_None, 0, 5);
+  ASSERT_EQ("Hello", content);
+  accessor.ReadRange(content, info.GetUuid(), FileContentType_Dicom, CompressionType_None, 6, 11);
+  ASSERT_EQ("world", content);
+  accessor.ReadRange(content, info.GetUuid(), FileContentType_Dicom, CompressionType_None, 3, 3);
+  ASSERT_TRUE(content.empty());
+  ASSERT_THROW(accessor.ReadRange(content, info.GetUuid(), FileContentType_Dicom, 
+                                  CompressionType_None, 5, 12), OrthancException);
+  ASSERT_THROW(accessor.ReadRange(content, info.GetUuid(), FileContentType_Dicom, 
+                                  CompressionType_None, 6, 5), OrthancException);
+
+  info = accessor.Write(std::string("Hello world"), FileContentType_Dicom, CompressionType_Zlib);
+  accessor.ReadRange(content, info.GetUuid(), FileContentType_Dicom, CompressionType_Zlib, 4, 7);
+  ASSERT_EQ("o w", content);
+  ASSERT_THROW(accessor.ReadRange(content, info.GetUuid(), FileContentType_Dicom, 
+                                  CompressionType_Zlib, 0, 12), OrthancException);
+}
+
+
+TEST(FileStorageAccessor, WriteFile)
+{
+  FilesystemStorage s("UnitTestsStorage");
+  CompressedFileStorageAccessor accessor(s);
+
+  Toolbox::CreateDirectory("UnitTestsStorage/tmp");
+  HttpUploadedFile upload("UnitTestsStorage/tmp");
+  ASSERT_EQ(0u, upload.GetPath().find("UnitTestsStorage/tmp"));
+  ASSERT_THROW(upload.GetSize(), OrthancException);
+  upload.Append("Hello ", 6);
+  upload.Append("world", 5);
+  upload.Close();
+  ASSERT_THROW(upload.Append("!", 1), OrthancException);
+
+  std::string md5;
+  Toolbox::ComputeMD5(md5, "Hello world");
+  ASSERT_EQ(11u, upload.GetSize());
+  ASSERT_EQ(md5, upload.GetMD5());
+
+  std::string content;
+  upload.Read(content);
+  ASSERT_EQ("Hello world", content);
+
+  // The temporary files are not part of the storage area
+  std::set<std::string> files;
+  s.ListAllFiles(files);
+  size_t count = files.size();
+
+  // Without compression, the file is adopted as such
+  FileInfo info = accessor.WriteFile(upload.GetPath(), upload.GetSize(), upload.GetMD5(),
+                                     FileContentType_Dicom, CompressionType_None);
+  ASSERT_EQ(CompressionType_None, info.GetCompressionType());
+  ASSERT_EQ(11u, info.GetUncompressedSize());
+  ASSERT_EQ(md5, info.GetUncompressedMD5());
+  accessor.Read(content, info.GetUuid(), FileContentType_Dicom, CompressionType_None);
+  ASSERT_EQ("Hello world", content);
+
+  FileInfo compressed = accessor.WriteFile(upload.GetPath(), upload.GetSize(), upload.GetMD5(),
+                                           FileContentType_Dicom, CompressionType_Zlib);
+  ASSERT_EQ(CompressionType_Zlib, compressed.GetCompressionType());
+  ASSERT_EQ(md5, compressed.GetUncompressedMD5());
+  accessor.Read(content, compressed.GetUuid(), FileContentType_Dicom, CompressionType_Zlib);
+  ASSERT_EQ("Hello world", content);
+
+  s.ListAllFiles(files);
+  ASSERT_EQ(count + 2, files.size());
+
+  // The source file is left untouched
+  upload.Read(content);
+  ASSERT_EQ("Hello world", content);
+
+  accessor.Remove(info.GetUuid(), FileContentType_Dicom);
+  accessor.Remove(compressed.GetUuid(), FileContentType_Dicom);
+  ASSERT_THROW(accessor.WriteFile("nope", 0, "", FileContentType_Dicom, CompressionType_None), OrthancException);
+}
+
+
+TEST(HttpUploadedFile, RemoveStaleFiles)
+{
+  Toolbox::CreateDirectory("UnitTestsResults/uploads");
+  Toolbox::WriteFile("Hello", "UnitTestsResults/uploads/other");
+
+  std::string path;
+
+  {
+    HttpUploadedFile upload("UnitTestsResults/uploads");
+    upload.Append("Hello", 5);
+    upload.Close();
+    path = upload.GetPath();
+  }
+
+  // The destructor removes the temporary file: Recreate it, as if
+  // Orthanc had crashed during the upload
+  ASSERT_FALSE(boost::filesystem::exists(path));
+  Toolbox::WriteFile("Hello", path);
+
+  // Only the temporary files are removed
+  HttpUploadedFile::RemoveStaleFiles("UnitTestsResults/uploads");
+  ASSERT_FALSE(boost::filesystem::exists(path));
+  ASSERT_TRUE(boost::filesystem::exists("UnitTestsResults/uploads/other"));
+
+  HttpUploadedFile::RemoveStaleFiles("UnitTestsResults/nope");
+}
+
+
+TEST(PreviewCache, Basic)
+{
+  const std::string a = "6e0b6e2a-3a3b0e88-73f1d6f8-80fcf07a-8d6a4a5c";
+  const std::string b = "b2e5bd10-2a29cc3e-e3b36d32-24f1a3fd-3c4c9d4e";
+
+  std::string png;
+
+  {
+    PreviewCache cache("UnitTestsPreviews", 20);
+    cache.Clear();
+    ASSERT_EQ(0u, cache.GetCurrentSize());
+    ASSERT_FALSE(cache.Lookup(png, a, 0, ImageExtractionMode_Preview, 0, 0));
+
+    cache.Store(a, 0, ImageExtractionMode_Preview, 0, 0, "aaaaa");
+    cache.Store(a, 0, ImageExtractionMode_Preview, 128, 0, "thumb");
+    cache.Store(a, 1, ImageExtractionMode_UInt8, 0, 0, "01234");
+    cache.Store(b, 0, ImageExtractionMode_Preview, 0, 0, "bbbbb");
+    ASSERT_EQ(4u, cache.GetEntriesCount());
+    ASSERT_EQ(20u, cache.GetCurrentSize());
+
+    ASSERT_TRUE(cache.Lookup(png, a, 0, ImageExtractionMode_Preview, 0, 0));
+    ASSERT_EQ("aaaaa", png);
+    ASSERT_TRUE(cache.Lookup(png, a, 0, ImageExtractionMode_Preview, 128, 0));
+    ASSERT_EQ("thumb", png);
+    ASSERT_FALSE(cache.Lookup(png, a, 1, ImageExtractionMode_Preview, 0, 0));
+    ASSERT_FALSE(cache.Lookup(png, a, 0, ImageExtractionMode_UInt8, 0, 0));
+    ASSERT_FALSE(cache.Lookup(png, a, 0, ImageExtractionMode_Preview, 0, 90));
+
+    // The least recently used entry is removed to make room
+    cache.Store(b, 1, ImageExtractionMode_Preview, 0, 0, "bb");
+    ASSERT_FALSE(cache.Contains(a, 1, ImageExtractionMode_UInt8, 0, 0));
+    ASSERT_TRUE(cache.Contains(a, 0, ImageExtractionMode_Preview, 0, 0));
+    ASSERT_TRUE(cache.Contains(b, 0, ImageExtractionMode_Preview, 0, 0));
+    ASSERT_EQ(17u, cache.GetCurrentSize());
+
+    // Images larger than the cache are ignored
+    cache.Store(b, 2, ImageExtractionMode_Preview, 0, 0, std::string(21, 'x'));
+    ASSERT_FALSE(cache.Contains(b, 2, ImageExtractionMode_Preview, 0, 0));
+    ASSERT_EQ(4u, cache.GetEntriesCount());
+
+    cache.Invalidate(a);
+    ASSERT_FALSE(cache.Contains(a, 0, ImageExtractionMode_Preview, 0, 0));
+    ASSERT_FALSE(cache.Contains(a, 0, ImageExtractionMode_Preview, 128, 0));
+    ASSERT_EQ(2u, cache.GetEntriesCount());
+    ASSERT_EQ(7u, cache.GetCurrentSize());
+
+    ASSERT_THROW(cache.Lookup(png, "../../etc", 0, ImageExtractionMode_Preview, 0, 0), OrthancException);
+    ASSERT_THROW(cache.Store("nope", 0, ImageExtractionMode_Preview, 0, 0, "x"), OrthancException);
+  }
+
+  {
+    // The content of the cache is persistent
+    PreviewCache cache("UnitTestsPreviews", 20);
+    ASSERT_EQ(2u, cache.GetEntriesCount());
+    ASSERT_EQ(7u, cache.GetCurrentSize());
+    ASSERT_TRUE(cache.Lookup(png, b, 1, ImageExtractionMode_Preview, 0, 0));
+    ASSERT_EQ("bb", png);
+
+    // JPEG images are distinguished by their quality
+    cache.Store(a, 0, ImageExtractionMode_Preview, 0, 90, "jpeg");
+    ASSERT_TRUE(cache.Lookup(png, a, 0, ImageExtractionMode_Preview, 0, 90));
+    ASSERT_EQ("jpeg", png);
+    ASSERT_FALSE(cache.Contains(a, 0, ImageExtractionMode_Preview, 0, 75));
+    ASSERT_FALSE(cache.Contains(a, 0, ImageExtractionMode_Preview, 0, 0));
+    cache.Invalidate(a);
+    ASSERT_EQ(2u, cache.GetEntriesCount());
+  }
+
+  {
+    // Reopening with a smaller size removes entries
+    PreviewCache cache("UnitTestsPreviews", 5);
+    ASSERT_EQ(1u, cache.GetEntriesCount());
+    ASSERT_LE(cache.GetCurrentSize(), 5u);
+
+    cache.Clear();
+    ASSERT_EQ(0u, cache.GetEntriesCount());
+    ASSERT_EQ(0u, cache.GetCurrentSize());
+  }
+}
@@ -36,6 +36,7 @@
 #include "../OrthancServer/FromDcmtkBridge.h"
 #include "../OrthancServer/OrthancInitialization.h"
 #include "../OrthancServer/DicomModification.h"
+#include "../OrthancServer/DicomFrameIndex.h"
 #include "../Core/OrthancException.h"
 #include "../Core/ImageFormats/ImageBuffer.h"
 #include "../Core/ImageFormats/PngReader.h"
@@ -267,3 +268,360 @@ TEST(FromDcmtkBridge, Encodings3)
     }
   }
 }
+
+
+
+namespace
+{
+  // Minimal writer of explicit/implicit VR little endian DICOM files,
+  // to test the frame index without DCMTK
+  class TestDicomWriter
+  {
+  private:
+    std::string  buffer_;
+    bool         explicitVR_;
+
+    void WriteUInt16(uint16_t v)
+    {
+      buffer_.push_back(static_cast<char>(v & 0xff));
+      buffer_.push_back(static_cast<char>(v >> 8));
+    }
+
+    void WriteUInt32(uint32_t v)
+    {
+      WriteUInt16(static_cast<uint16_t>(v & 0xffff));
+      WriteUInt16(static_cast<uint16_t>(v >> 16));
+    }
+
+  public:
+    TestDicomWriter(const std::string& transferSyntax,
+                    bool explicitVR) :
+      buffer_(128, '\0'),
+      explicitVR_(true)
+    {
+      buffer_ += "DICM";
+
+      std::string ts = transferSyntax;
+      if (ts.size() % 2)
+      {
+        ts.push_back('\0');
+      }
+
+      AddElement(0x0002, 0x0010, "UI", ts);
+      explicitVR_ = explicitVR;
+    }
+
+    void AddHeader(uint16_t group,
+                   uint16_t element,
+                   const char* vr,
+                   uint32_t length)
+    {
+      WriteUInt16(group);
+      WriteUInt16(element);
+
+      if (group == 0xfffe || !explicitVR_)
+      {
+        WriteUInt32(length);
+      }
+      else
+      {
+        buffer_.append(vr, 2);
+
+        std::string s(vr);
+        if (s == "OB" || s == "OW" || s == "SQ" || s == "UN")
+        {
+          WriteUInt16(0);
+          WriteUInt32(length);
+        }
+        else
+        {
+          WriteUInt16(static_cast<uint16_t>(length));
+        }
+      }
+    }
+
+    void AddElement(uint16_t group,
+                    uint16_t element,
+                    const char* vr,
+                    const std::string& value)
+    {
+      AddHeader(group, element, vr, static_cast<uint32_t>(value.size()));
+      buffer_ += value;
+    }
+
+    void AddUnsignedShort(uint16_t group,
+                          uint16_t element,
+                          uint16_t value)
+    {
+      AddHeader(group, element, "US", 2);
+      WriteUInt16(value);
+    }
+
+    void AddRaw(const std::string& s)
+    {
+      buffer_ += s;
+    }
+
+    void AddUInt32(uint32_t value)
+    {
+      WriteUInt32(value);
+    }
+
+    void AddImageTags(unsigned int frames)
+    {
+      // Sequence of undefined length that must be skipped
+      AddHeader(0x0008, 0x1140, "SQ", 0xffffffffu);
+      AddHeader(0xfffe, 0xe000, "", 0xffffffffu);
+      AddElement(0x0008, 0x1150, "UI", "1.2.3.4");
+      AddHeader(0xfffe, 0xe00d, "", 0);
+      AddHeader(0xfffe, 0xe0dd, "", 0);
+
+      AddUnsignedShort(0x0028, 0x0002, 1);
+      AddElement(0x0028, 0x0008, "IS", boost::lexical_cast<std::string>(frames) + " ");
+      AddUnsignedShort(0x0028, 0x0010, 2);
+      AddUnsignedShort(0x0028, 0x0011, 3);
+      AddUnsignedShort(0x0028, 0x0100, 8);
+    }
+
+    const std::string& GetBuffer() const
+    {
+      return buffer_;
+    }
+
+    size_t GetSize() const
+    {
+      return buffer_.size();
+    }
+  };
+}
+
+
+static void ExtractFrame(std::string& target,
+                         const DicomFrameIndex& index,
+                         const std::string& dicom,
+                         unsigned int frame)
+{
+  uint64_t start, end;
+  index.GetFrameRange(start, end, frame);
+  index.CreateSingleFrameFile(target, dicom.substr(0, static_cast<size_t>(index.GetHeaderSize())), 
+                              dicom.substr(static_cast<size_t>(start), static_cast<size_t>(end - start)), frame);
+}
+
+
+TEST(DicomFrameIndex, Native)
+{
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    const bool explicitVR = (i == 0);
+    TestDicomWriter w(explicitVR ? "1.2.840.10008.1.2.1" : "1.2.840.10008.1.2", explicitVR);
+    w.AddImageTags(3);
+
+    const size_t headerSize = w.GetSize();
+    w.AddElement(0x7fe0, 0x0010, "OB", "aaaaaabbbbbbcccccc");
+
+    DicomFrameIndex index;
+    ASSERT_TRUE(index.Parse(w.GetBuffer()));
+    ASSERT_FALSE(index.IsEncapsulated());
+    ASSERT_EQ(headerSize, index.GetHeaderSize());
+    ASSERT_EQ(3u, index.GetFramesCount());
+
+    uint64_t start, end;
+    index.GetFrameRange(start, end, 1);
+    ASSERT_EQ("bbbbbb", w.GetBuffer().substr(static_cast<size_t>(start), static_cast<size_t>(end - start)));
+    ASSERT_THROW(index.GetFrameRange(start, end, 3), OrthancException);
+
+    std::string single;
+    ExtractFrame(single, index, w.GetBuffer(), 2);
+    ASSERT_EQ(headerSize + (explicitVR ? 12 : 8) + 6, single.size());
+    ASSERT_EQ(w.GetBuffer().substr(0, headerSize), single.substr(0, headerSize));
+    ASSERT_EQ("cccccc", single.substr(single.size() - 6));
+
+    // Serialization
+    DicomFrameIndex index2;
+    std::string s;
+    index.Serialize(s);
+    ASSERT_TRUE(index2.Unserialize(s));
+    ASSERT_FALSE(index2.IsEncapsulated());
+    ASSERT_EQ(index.GetHeaderSize(), index2.GetHeaderSize());
+    ASSERT_EQ(3u, index2.GetFramesCount());
+    index2.GetFrameRange(start, end, 2);
+    ASSERT_EQ("cccccc", w.GetBuffer().substr(static_cast<size_t>(start), static_cast<size_t>(end - start)));
+  }
+
+  {
+    // Truncated pixel data
+    TestDicomWriter w("1.2.840.10008.1.2.1", true);
+    w.AddImageTags(3);
+    w.AddElement(0x7fe0, 0x0010, "OB", "aaaaaabbbbbb");
+
+    DicomFrameIndex index;
+    ASSERT_FALSE(index.Parse(w.GetBuffer()));
+  }
+
+  {
+    // Big endian is not supported
+    TestDicomWriter w("1.2.840.10008.1.2.2", true);
+    w.AddImageTags(1);
+    w.AddElement(0x7fe0, 0x0010, "OB", "aaaaaa");
+
+    DicomFrameIndex index;
+    ASSERT_FALSE(index.Parse(w.GetBuffer()));
+  }
+
+  DicomFrameIndex index;
+  ASSERT_FALSE(index.Parse(std::string("Hello")));
+  ASSERT_FALSE(index.Parse(std::string(200, '\0')));
+  ASSERT_FALSE(index.Unserialize(""));
+  ASSERT_FALSE(index.Unserialize("{}"));
+}
+
+
+TEST(DicomFrameIndex, Encapsulated)
+{
+  const char* JPEG_BASELINE = "1.2.840.10008.1.2.4.50";
+
+  {
+    // With a basic offset table, 2 fragments for the second frame
+    TestDicomWriter w(JPEG_BASELINE, true);
+    w.AddImageTags(2);
+    w.AddHeader(0x7fe0, 0x0010, "OB", 0xffffffffu);
+    w.AddHeader(0xfffe, 0xe000, "", 8);
+    w.AddUInt32(0);
+    w.AddUInt32(12);
+    w.AddElement(0xfffe, 0xe000, "", "abcd");
+    w.AddElement(0xfffe, 0xe000, "", "efgh");
+    w.AddElement(0xfffe, 0xe000, "", "ij");
+    w.AddHeader(0xfffe, 0xe0dd, "", 0);
+
+    DicomFrameIndex index;
+    ASSERT_TRUE(index.Parse(w.GetBuffer()));
+    ASSERT_TRUE(index.IsEncapsulated());
+    ASSERT_EQ(2u, index.GetFramesCount());
+    ASSERT_EQ(1u, index.GetFragments(0).size());
+    ASSERT_EQ(2u, index.GetFragments(1).size());
+    ASSERT_EQ(4u, index.GetFragments(1)[0].size_);
+    ASSERT_EQ(2u, index.GetFragments(1)[1].size_);
+
+    std::string single;
+    ExtractFrame(single, index, w.GetBuffer(), 1);
+
+    // The single-frame file has an empty basic offset table, and
+    // still announces 2 frames: Its 2 fragments are mapped 1:1
+    DicomFrameIndex index2;
+    ASSERT_TRUE(index2.Parse(single));
+    ASSERT_EQ(2u, index2.GetFramesCount());
+    ASSERT_EQ("efgh", single.substr(static_cast<size_t>(index2.GetFragments(0)[0].offset_), 4));
+    ASSERT_EQ("ij", single.substr(static_cast<size_t>(index2.GetFragments(1)[0].offset_), 2));
+
+    std::string s;
+    index.Serialize(s);
+    ASSERT_TRUE(index2.Unserialize(s));
+    ASSERT_TRUE(index2.IsEncapsulated());
+    ASSERT_EQ(2u, index2.GetFramesCount());
+    ASSERT_EQ(2u, index2.GetFragments(1).size());
+    ASSERT_EQ(index.GetFragments(1)[1].offset_, index2.GetFragments(1)[1].offset_);
+  }
+
+  {
+    // Empty basic offset table, one fragment per frame
+    TestDicomWriter w(JPEG_BASELINE, true);
+    w.AddImageTags(3);
+    w.AddHeader(0x7fe0, 0x0010, "OB", 0xffffffffu);
+    w.AddHeader(0xfffe, 0xe000, "", 0);
+    w.AddElement(0xfffe, 0xe000, "", "ab");
+    w.AddElement(0xfffe, 0xe000, "", "cd");
+    w.AddElement(0xfffe, 0xe000, "", "ef");
+    w.AddHeader(0xfffe, 0xe0dd, "", 0);
+
+    DicomFrameIndex index;
+    ASSERT_TRUE(index.Parse(w.GetBuffer()));
+    ASSERT_EQ(3u, index.GetFramesCount());
+    ASSERT_EQ("cd", w.GetBuffer().substr(static_cast<size_t>(index.GetFragments(1)[0].offset_), 2));
+  }
+
+  {
+    // Empty basic offset table, ambiguous fragments
+    TestDicomWriter w(JPEG_BASELINE, true);
+    w.AddImageTags(2);
+    w.AddHeader(0x7fe0, 0x0010, "OB", 0xffffffffu);
+    w.AddHeader(0xfffe, 0xe000, "", 0);
+    w.AddElement(0xfffe, 0xe000, "", "ab");
+    w.AddElement(0xfffe, 0xe000, "", "cd");
+    w.AddElement(0xfffe, 0xe000, "", "ef");
+    w.AddHeader(0xfffe, 0xe0dd, "", 0);
+
+    DicomFrameIndex index;
+    ASSERT_FALSE(index.Parse(w.GetBuffer()));
+  }
+}
+
+
+TEST(DicomFrameIndex, File)
+{
+  TestDicomWriter w("1.2.840.10008.1.2.4.50", true);
+  w.AddImageTags(2);
+  w.AddElement(0x0010, 0x0010, "PN", std::string(5000, 'a'));  // Skipped on the disk
+  w.AddHeader(0x7fe0, 0x0010, "OB", 0xffffffffu);
+  w.AddHeader(0xfffe, 0xe000, "", 8);
+  w.AddUInt32(0);
+  w.AddUInt32(12);
+  w.AddElement(0xfffe, 0xe000, "", "abcd");
+  w.AddElement(0xfffe, 0xe000, "", "efgh");
+  w.AddElement(0xfffe, 0xe000, "", "ij");
+  w.AddHeader(0xfffe, 0xe0dd, "", 0);
+
+  Toolbox::TemporaryFile tmp;
+  tmp.Write(w.GetBuffer());
+
+  DicomFrameIndex fromMemory, fromFile;
+  ASSERT_TRUE(fromMemory.Parse(w.GetBuffer()));
+  ASSERT_TRUE(fromFile.ParseFile(tmp.GetPath()));
+
+  std::string a, b;
+  fromMemory.Serialize(a);
+  fromFile.Serialize(b);
+  ASSERT_EQ(a, b);
+  ASSERT_EQ(2u, fromFile.GetFramesCount());
+  ASSERT_EQ("ij", w.GetBuffer().substr(static_cast<size_t>(fromFile.GetFragments(1)[1].offset_), 2));
+
+  // Truncated file
+  tmp.Write(w.GetBuffer().substr(0, w.GetSize() - 10));
+  ASSERT_FALSE(fromFile.ParseFile(tmp.GetPath()));
+
+  ASSERT_THROW(fromFile.ParseFile(tmp.GetPath() + ".nope"), OrthancException);
+}
+
+
+TEST(DicomFrameIndex, LargeFiles)
+{
+  // Positions beyond 4GB must survive the serialization
+  const uint64_t offset = 5000000000ull;
+
+  DicomFrameIndex index;
+  ASSERT_TRUE(index.Unserialize("{ \"Version\" : 2, \"TransferSyntax\" : \"1.2.840.10008.1.2.4.50\", "
+                                "\"ExplicitVR\" : true, \"HeaderSize\" : \"300\", \"Encapsulated\" : true, "
+                                "\"Frames\" : [ [ \"5000000000\", \"10\" ], [ \"5000000018\", \"4\", \"5000000030\", \"6\" ] ] }"));
+  ASSERT_EQ(2u, index.GetFramesCount());
+
+  uint64_t start, end;
+  index.GetFrameRange(start, end, 1);
+  ASSERT_EQ(offset + 18, start);
+  ASSERT_EQ(offset + 36, end);
+
+  std::string s;
+  index.Serialize(s);
+
+  DicomFrameIndex index2;
+  ASSERT_TRUE(index2.Unserialize(s));
+  ASSERT_EQ(300u, index2.GetHeaderSize());
+  index2.GetFrameRange(start, end, 0);
+  ASSERT_EQ(offset, start);
+  ASSERT_EQ(offset + 10, end);
+
+  // The obsolete format with 32-bit positions is not accepted anymore
+  ASSERT_FALSE(index2.Unserialize("{ \"Version\" : 1, \"TransferSyntax\" : \"1.2.840.10008.1.2.1\", "
+                                  "\"ExplicitVR\" : true, \"HeaderSize\" : 300, \"Encapsulated\" : false, "
+                                  "\"FramesCount\" : 2, \"Offset\" : 300, \"FrameSize\" : 10 }"));
+  ASSERT_FALSE(index2.Unserialize("{ \"Version\" : 2, \"HeaderSize\" : 300 }"));
+  ASSERT_FALSE(index2.Unserialize("nope"));
+}
@@ -34,8 +34,20 @@
 #include "gtest/gtest.h"
 
 #include "../Core/DicomFormat/DicomImageInformation.h"
+#include "../Core/DicomFormat/DicomIntegerPixelAccessor.h"
 #include "../Core/ImageFormats/ImageBuffer.h"
 #include "../Core/ImageFormats/ImageProcessing.h"
+#include "../Core/ImageFormats/RawFramesHeader.h"
+#include "../Core/OrthancException.h"
+#include "../OrthancServer/RenderingParameters.h"
+#include "../OrthancServer/SliceOrdering.h"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread.hpp>
+#include <limits>
+#include <stdio.h>
+#include <string.h>
 
 using namespace Orthanc;
 
@@ -78,3 +90,1044 @@ TEST(DicomImageInformation, ExtractPixelFormat2)
   ASSERT_TRUE(info.ExtractPixelFormat(format));
   ASSERT_EQ(PixelFormat_SignedGrayscale16, format);
 }
+
+
+namespace
+{
+  // This is the per-sample loop that was used by "DicomImageDecoder"
+  // before "DicomIntegerPixelAccessor::ExtractFrame()": It is the
+  // reference for the specialized decoding kernels
+  template <typename PixelType>
+  void ReferenceCopyPixels(ImageAccessor& target,
+                           const DicomIntegerPixelAccessor& source)
+  {
+    const PixelType minValue = std::numeric_limits<PixelType>::min();
+    const PixelType maxValue = std::numeric_limits<PixelType>::max();
+
+    for (unsigned int y = 0; y < source.GetInformation().GetHeight(); y++)
+    {
+      PixelType* pixel = reinterpret_cast<PixelType*>(target.GetRow(y));
+      for (unsigned int x = 0; x < source.GetInformation().GetWidth(); x++)
+      {
+        for (unsigned int c = 0; c < source.GetInformation().GetChannelCount(); c++, pixel++)
+        {
+          int32_t v = source.GetValue(x, y, c);
+          if (v < static_cast<int32_t>(minValue))
+          {
+            *pixel = minValue;
+          }
+          else if (v > static_cast<int32_t>(maxValue))
+          {
+            *pixel = maxValue;
+          }
+          else
+          {
+            *pixel = static_cast<PixelType>(v);
+          }
+        }
+      }
+    }
+  }
+
+
+  void ReferenceCopyPixels(ImageAccessor& target,
+                           const DicomIntegerPixelAccessor& source)
+  {
+    switch (target.GetFormat())
+    {
+      case PixelFormat_RGB24:
+      case PixelFormat_Grayscale8:
+        ReferenceCopyPixels<uint8_t>(target, source);
+        break;
+        
+      case PixelFormat_Grayscale16:
+        ReferenceCopyPixels<uint16_t>(target, source);
+        break;
+
+      case PixelFormat_SignedGrayscale16:
+        ReferenceCopyPixels<int16_t>(target, source);
+        break;
+
+      default:
+        throw OrthancException(ErrorCode_InternalError);
+    }
+  }
+
+
+  void SetupImage(DicomMap& m,
+                  unsigned int width,
+                  unsigned int height,
+                  unsigned int frames,
+                  unsigned int channels,
+                  bool planar,
+                  unsigned int bitsAllocated,
+                  unsigned int bitsStored,
+                  unsigned int highBit,
+                  bool isSigned)
+  {
+    m.SetValue(DICOM_TAG_COLUMNS, boost::lexical_cast<std::string>(width));
+    m.SetValue(DICOM_TAG_ROWS, boost::lexical_cast<std::string>(height));
+    m.SetValue(DICOM_TAG_NUMBER_OF_FRAMES, boost::lexical_cast<std::string>(frames));
+    m.SetValue(DICOM_TAG_SAMPLES_PER_PIXEL, boost::lexical_cast<std::string>(channels));
+    m.SetValue(DICOM_TAG_PLANAR_CONFIGURATION, planar ? "1" : "0");
+    m.SetValue(DICOM_TAG_BITS_ALLOCATED, boost::lexical_cast<std::string>(bitsAllocated));
+    m.SetValue(DICOM_TAG_BITS_STORED, boost::lexical_cast<std::string>(bitsStored));
+    m.SetValue(DICOM_TAG_HIGH_BIT, boost::lexical_cast<std::string>(highBit));
+    m.SetValue(DICOM_TAG_PIXEL_REPRESENTATION, isSigned ? "1" : "0");
+    m.SetValue(DICOM_TAG_PHOTOMETRIC_INTERPRETATION, channels == 3 ? "RGB" : "MONOCHROME2");
+  }
+
+
+  void FillRandom(std::string& buffer, 
+                  size_t size)
+  {
+    buffer.resize(size);
+
+    uint32_t seed = 42;
+    for (size_t i = 0; i < size; i++)
+    {
+      seed = seed * 1103515245u + 12345u;
+      buffer[i] = static_cast<char>(seed >> 16);
+    }
+  }
+
+
+  void FillRandom(ImageAccessor& image)
+  {
+    std::string buffer;
+    FillRandom(buffer, image.GetSize());
+
+    const size_t rowSize = image.GetWidth() * image.GetBytesPerPixel();
+    for (unsigned int y = 0; y < image.GetHeight(); y++)
+    {
+      if (rowSize > 0)
+      {
+        memcpy(image.GetRow(y), &buffer[y * image.GetPitch()], rowSize);
+      }
+    }
+  }
+
+
+  bool IsSameImage(const ImageAccessor& a,
+                   const ImageAccessor& b)
+  {
+    if (a.GetFormat() != b.GetFormat() ||
+        a.GetWidth() != b.GetWidth() ||
+        a.GetHeight() != b.GetHeight())
+    {
+      return false;
+    }
+
+    const size_t rowSize = a.GetWidth() * a.GetBytesPerPixel();
+    for (unsigned int y = 0; y < a.GetHeight(); y++)
+    {
+      if (rowSize > 0 &&
+          memcmp(a.GetConstRow(y), b.GetConstRow(y), rowSize) != 0)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+
+  const PixelFormat GRAYSCALE_FORMATS[] = {
+    PixelFormat_Grayscale8,
+    PixelFormat_Grayscale16,
+    PixelFormat_SignedGrayscale16
+  };
+
+
+  /**
+   * Checks that the SIMD and the multithreaded implementations of an
+   * operation give the same result as the scalar, single-threaded
+   * reference implementation. The widths are not multiple of the SIMD
+   * vector size, and the second image is split between threads.
+   **/
+  template <typename Operation>
+  void CheckImplementations(PixelFormat format,
+                            const Operation& operation)
+  {
+    const unsigned int sizes[2][2] = { { 37, 5 }, { 1023, 700 } };
+
+    for (unsigned int i = 0; i < 2; i++)
+    {
+      ImageBuffer source(sizes[i][0], sizes[i][1], format);
+      ImageAccessor s(source.GetAccessor());
+      FillRandom(s);
+
+      ImageProcessing::SetSimdEnabled(false);
+      ImageProcessing::SetThreadsCount(1);
+      ImageBuffer reference(sizes[i][0], sizes[i][1], format);
+      ImageAccessor r(reference.GetAccessor());
+      ImageProcessing::Copy(r, s);
+      operation(r);
+
+      for (unsigned int k = 0; k < 3; k++)
+      {
+        ImageProcessing::SetSimdEnabled(k != 0);
+        ImageProcessing::SetThreadsCount(k == 2 ? 4 : 1);
+
+        ImageBuffer image(sizes[i][0], sizes[i][1], format);
+        ImageAccessor a(image.GetAccessor());
+        ImageProcessing::Copy(a, s);
+        operation(a);
+
+        ASSERT_TRUE(IsSameImage(r, a));
+      }
+    }
+
+    ImageProcessing::SetSimdEnabled(true);
+    ImageProcessing::SetThreadsCount(1);
+  }
+
+
+  class AddConstantOperation
+  {
+  private:
+    int64_t value_;
+
+  public:
+    AddConstantOperation(int64_t value) : value_(value)
+    {
+    }
+
+    void operator() (ImageAccessor& image) const
+    {
+      ImageProcessing::AddConstant(image, value_);
+    }
+  };
+
+
+  class MultiplyConstantOperation
+  {
+  private:
+    float factor_;
+
+  public:
+    MultiplyConstantOperation(float factor) : factor_(factor)
+    {
+    }
+
+    void operator() (ImageAccessor& image) const
+    {
+      ImageProcessing::MultiplyConstant(image, factor_);
+    }
+  };
+
+
+  class ShiftScaleOperation
+  {
+  private:
+    float offset_;
+    float scaling_;
+
+  public:
+    ShiftScaleOperation(float offset,
+                        float scaling) : 
+      offset_(offset),
+      scaling_(scaling)
+    {
+    }
+
+    void operator() (ImageAccessor& image) const
+    {
+      ImageProcessing::ShiftScale(image, offset_, scaling_);
+    }
+  };
+
+
+  class ConvertOperation
+  {
+  private:
+    PixelFormat  target_;
+
+  public:
+    ConvertOperation(PixelFormat target) : target_(target)
+    {
+    }
+
+    void operator() (ImageAccessor& image) const
+    {
+      // Convert back and forth, so that the result has the format of the source
+      ImageBuffer tmp(image.GetWidth(), image.GetHeight(), target_);
+      ImageAccessor t(tmp.GetAccessor());
+      ImageProcessing::Convert(t, image);
+
+      if (image.GetFormat() == PixelFormat_RGB24)
+      {
+        // No conversion to color: Keep the grayscale pixels in the color rows
+        for (unsigned int y = 0; y < image.GetHeight(); y++)
+        {
+          memset(image.GetRow(y), 0, image.GetWidth() * image.GetBytesPerPixel());
+          memcpy(image.GetRow(y), t.GetConstRow(y), t.GetWidth() * t.GetBytesPerPixel());
+        }
+      }
+      else
+      {
+        ImageProcessing::Convert(image, t);
+      }
+    }
+  };
+
+
+  class GetMinMaxValueOperation
+  {
+  public:
+    void operator() (ImageAccessor& image) const
+    {
+      // Store the result of the operation into the first pixels of the image
+      int64_t minValue, maxValue;
+      ImageProcessing::GetMinMaxValue(minValue, maxValue, image);
+      ImageProcessing::Set(image, 0);
+      ImageProcessing::AddConstant(image, minValue);
+      reinterpret_cast<int64_t*>(image.GetRow(0))[0] = maxValue;
+    }
+  };
+}
+
+
+TEST(DicomIntegerPixelAccessor, ExtractFrame)
+{
+  struct Configuration
+  {
+    unsigned int channels_;
+    bool planar_;
+    unsigned int bitsAllocated_;
+    unsigned int bitsStored_;
+    unsigned int highBit_;
+    bool isSigned_;
+    PixelFormat format_;
+  };
+
+  // The pixel data is random, so that the bits above "BitsStored" are
+  // not zero: Their masking must also be identical
+  const Configuration configurations[] = {
+    { 1, false, 8, 8, 7, false, PixelFormat_Grayscale8 },
+    { 1, false, 8, 8, 7, true, PixelFormat_Grayscale8 },
+    { 1, false, 8, 6, 6, false, PixelFormat_Grayscale8 },
+    { 1, false, 16, 8, 7, false, PixelFormat_Grayscale8 },
+    { 1, false, 16, 12, 11, false, PixelFormat_Grayscale16 },
+    { 1, false, 16, 12, 15, false, PixelFormat_Grayscale16 },
+    { 1, false, 16, 16, 15, false, PixelFormat_Grayscale16 },
+    { 1, false, 16, 16, 15, true, PixelFormat_Grayscale16 },
+    { 1, false, 16, 12, 11, true, PixelFormat_SignedGrayscale16 },
+    { 1, false, 16, 12, 13, true, PixelFormat_SignedGrayscale16 },
+    { 1, false, 16, 16, 15, true, PixelFormat_SignedGrayscale16 },
+    { 1, false, 16, 16, 15, false, PixelFormat_SignedGrayscale16 },
+    { 1, false, 32, 24, 23, true, PixelFormat_SignedGrayscale16 },
+    { 1, false, 32, 16, 15, false, PixelFormat_Grayscale16 },
+    { 1, false, 24, 20, 19, false, PixelFormat_Grayscale16 },
+    { 3, false, 8, 8, 7, false, PixelFormat_RGB24 },
+    { 3, true, 8, 8, 7, false, PixelFormat_RGB24 },
+    { 3, true, 16, 12, 11, false, PixelFormat_RGB24 }
+  };
+
+  // The width is not a multiple of 8, to test the tail of the SIMD loops
+  const unsigned int width = 37;
+  const unsigned int height = 5;
+  const unsigned int frames = 3;
+
+  for (size_t i = 0; i < sizeof(configurations) / sizeof(Configuration); i++)
+  {
+    const Configuration& config = configurations[i];
+
+    DicomMap m;
+    SetupImage(m, width, height, frames, config.channels_, config.planar_, 
+               config.bitsAllocated_, config.bitsStored_, config.highBit_, config.isSigned_);
+
+    std::string pixelData;
+    FillRandom(pixelData, width * height * frames * config.channels_ * config.bitsAllocated_ / 8);
+
+    DicomIntegerPixelAccessor accessor(m, pixelData.c_str(), pixelData.size());
+
+    for (unsigned int frame = 0; frame < frames; frame++)
+    {
+      accessor.SetCurrentFrame(frame);
+
+      ImageBuffer expected(width, height, config.format_);
+      ImageBuffer actual(width, height, config.format_);
+      ImageAccessor expectedAccessor(expected.GetAccessor());
+      ImageAccessor actualAccessor(actual.GetAccessor());
+
+      ReferenceCopyPixels(expectedAccessor, accessor);
+      accessor.ExtractFrame(actualAccessor);
+
+      for (unsigned int y = 0; y < height; y++)
+      {
+        ASSERT_EQ(0, memcmp(expectedAccessor.GetConstRow(y), actualAccessor.GetConstRow(y),
+                            width * expectedAccessor.GetBytesPerPixel())) 
+          << "Configuration " << i << ", frame " << frame << ", row " << y;
+      }
+    }
+  }
+}
+
+
+TEST(DicomIntegerPixelAccessor, ExtractFrameErrors)
+{
+  DicomMap m;
+  SetupImage(m, 16, 16, 1, 1, false, 16, 12, 11, true);
+
+  std::string pixelData;
+  FillRandom(pixelData, 16 * 16 * 2);
+  DicomIntegerPixelAccessor accessor(m, pixelData.c_str(), pixelData.size());
+
+  {
+    ImageBuffer image(15, 16, PixelFormat_SignedGrayscale16);
+    ImageAccessor a(image.GetAccessor());
+    ASSERT_THROW(accessor.ExtractFrame(a), OrthancException);
+  }
+
+  {
+    ImageBuffer image(16, 16, PixelFormat_RGB24);
+    ImageAccessor a(image.GetAccessor());
+    ASSERT_THROW(accessor.ExtractFrame(a), OrthancException);
+  }
+}
+
+
+TEST(DicomIntegerPixelAccessor, DISABLED_DecodingBenchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests
+  // --gtest_filter=DicomIntegerPixelAccessor.DISABLED_DecodingBenchmark"
+  // to compare the per-sample loop with the specialized kernels. Only
+  // the images that are not handled by the direct copy of
+  // "DicomImageDecoder" (i.e. "ImageProcessing::Convert()" followed
+  // by "ImageProcessing::ShiftRight()") use these kernels: The most
+  // common case is that of planar RGB images, here 512x512.
+  const unsigned int size = 512;
+  const unsigned int frames = 8;
+
+  DicomMap m;
+  SetupImage(m, size, size, frames, 3, true, 8, 8, 7, false);
+
+  std::string pixelData;
+  FillRandom(pixelData, size * size * frames * 3);
+  DicomIntegerPixelAccessor accessor(m, pixelData.c_str(), pixelData.size());
+
+  ImageBuffer image(size, size, PixelFormat_RGB24);
+  ImageAccessor target(image.GetAccessor());
+
+  for (unsigned int k = 0; k < 2; k++)
+  {
+    const unsigned int count = (k == 0 ? 20 : 500);
+
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+      accessor.SetCurrentFrame(i % frames);
+
+      if (k == 0)
+      {
+        ReferenceCopyPixels(target, accessor);
+      }
+      else
+      {
+        accessor.ExtractFrame(target);
+      }
+    }
+
+    double seconds = static_cast<double>
+      ((boost::posix_time::microsec_clock::universal_time() - start).total_microseconds()) / 1000000.0;
+
+    printf("%s: %.1f frames/s\n", (k == 0 ? "Per-sample loop" : "Specialized kernels"),
+           static_cast<double>(count) / seconds);
+  }
+}
+
+
+TEST(ImageProcessing, Convert)
+{
+  for (size_t i = 0; i < sizeof(GRAYSCALE_FORMATS) / sizeof(PixelFormat); i++)
+  {
+    for (size_t j = 0; j < sizeof(GRAYSCALE_FORMATS) / sizeof(PixelFormat); j++)
+    {
+      if (i != j)
+      {
+        CheckImplementations(GRAYSCALE_FORMATS[i], ConvertOperation(GRAYSCALE_FORMATS[j]));
+      }
+    }
+
+    CheckImplementations(PixelFormat_RGB24, ConvertOperation(GRAYSCALE_FORMATS[i]));
+  }
+}
+
+
+TEST(ImageProcessing, GetMinMaxValue)
+{
+  for (size_t i = 0; i < sizeof(GRAYSCALE_FORMATS) / sizeof(PixelFormat); i++)
+  {
+    CheckImplementations(GRAYSCALE_FORMATS[i], GetMinMaxValueOperation());
+  }
+
+  ImageBuffer image(33, 3, PixelFormat_Grayscale16);
+  ImageAccessor a(image.GetAccessor());
+  ImageProcessing::Set(a, 1000);
+  reinterpret_cast<uint16_t*>(a.GetRow(1))[17] = 65535;
+  reinterpret_cast<uint16_t*>(a.GetRow(2))[32] = 3;
+
+  int64_t minValue, maxValue;
+  ImageProcessing::GetMinMaxValue(minValue, maxValue, a);
+  ASSERT_EQ(3, minValue);
+  ASSERT_EQ(65535, maxValue);
+}
+
+
+TEST(ImageProcessing, AddConstant)
+{
+  const int64_t values[] = { -70000, -40000, -300, -1, 1, 200, 40000, 70000 };
+
+  for (size_t i = 0; i < sizeof(GRAYSCALE_FORMATS) / sizeof(PixelFormat); i++)
+  {
+    for (size_t j = 0; j < sizeof(values) / sizeof(int64_t); j++)
+    {
+      CheckImplementations(GRAYSCALE_FORMATS[i], AddConstantOperation(values[j]));
+    }
+  }
+}
+
+
+TEST(ImageProcessing, MultiplyConstant)
+{
+  const float values[] = { -2.5f, -1.0f, 0.0f, 0.5f, 0.7f, 1.5f, 3.0f, 1000.0f };
+
+  for (size_t i = 0; i < sizeof(GRAYSCALE_FORMATS) / sizeof(PixelFormat); i++)
+  {
+    for (size_t j = 0; j < sizeof(values) / sizeof(float); j++)
+    {
+      CheckImplementations(GRAYSCALE_FORMATS[i], MultiplyConstantOperation(values[j]));
+    }
+  }
+}
+
+
+TEST(ImageProcessing, ShiftScale)
+{
+  const float values[][2] = {
+    { 0.0f, 1.0f }, { 0.5f, 1.0f }, { -0.5f, 1.0f }, { 1024.0f, 0.25f }, 
+    { -40.0f, 255.0f / 400.0f }, { 100.0f, -3.0f }, { 0.0f, 0.5f }, { -1.0f, 1e6f }
+  };
+
+  for (size_t i = 0; i < sizeof(GRAYSCALE_FORMATS) / sizeof(PixelFormat); i++)
+  {
+    for (size_t j = 0; j < sizeof(values) / sizeof(values[0]); j++)
+    {
+      CheckImplementations(GRAYSCALE_FORMATS[i], ShiftScaleOperation(values[j][0], values[j][1]));
+    }
+  }
+}
+
+
+TEST(ImageProcessing, Downscale)
+{
+  {
+    const uint8_t pixels[] = { 
+      0, 10, 20, 31, 100, 
+      2, 12, 21, 32, 100,
+      4,  4, 200, 200, 255
+    };
+
+    ImageBuffer source(5, 3, PixelFormat_Grayscale8);
+    ImageAccessor s(source.GetAccessor());
+    for (unsigned int y = 0; y < 3; y++)
+    {
+      memcpy(s.GetRow(y), pixels + y * 5, 5);
+    }
+
+    // Same size: Plain copy
+    ImageBuffer copy(5, 3, PixelFormat_Grayscale8);
+    ImageAccessor c(copy.GetAccessor());
+    ImageProcessing::Downscale(c, s);
+    ASSERT_TRUE(IsSameImage(s, c));
+
+    // The columns [0,1), [1,3) and [3,5)
+    ImageBuffer target(3, 1, PixelFormat_Grayscale8);
+    ImageAccessor t(target.GetAccessor());
+    ImageProcessing::Downscale(t, s);
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(t.GetConstRow(0));
+    ASSERT_EQ(2, p[0]);     // 6 / 3
+    ASSERT_EQ(45, p[1]);    // 267 / 6 = 44.5
+    ASSERT_EQ(120, p[2]);   // 718 / 6
+
+    ImageBuffer single(1, 1, PixelFormat_Grayscale8);
+    ImageAccessor a(single.GetAccessor());
+    ImageProcessing::Downscale(a, s);
+    ASSERT_EQ(66, *reinterpret_cast<const uint8_t*>(a.GetConstRow(0)));  // 991 / 15
+  }
+
+  {
+    ImageBuffer source(4, 4, PixelFormat_RGB24);
+    ImageAccessor s(source.GetAccessor());
+    for (unsigned int y = 0; y < 4; y++)
+    {
+      uint8_t* p = reinterpret_cast<uint8_t*>(s.GetRow(y));
+      for (unsigned int x = 0; x < 4; x++, p += 3)
+      {
+        p[0] = 255;
+        p[1] = (x + y) % 2 ? 255 : 0;
+        p[2] = x * 10;
+      }
+    }
+
+    ImageBuffer target(2, 2, PixelFormat_RGB24);
+    ImageAccessor t(target.GetAccessor());
+    ImageProcessing::Downscale(t, s);
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(t.GetConstRow(1));
+    ASSERT_EQ(255, p[0]);
+    ASSERT_EQ(128, p[1]);
+    ASSERT_EQ(5, p[2]);
+    ASSERT_EQ(255, p[3]);
+    ASSERT_EQ(128, p[4]);
+    ASSERT_EQ(25, p[5]);
+  }
+
+  {
+    ImageBuffer source(3, 1, PixelFormat_SignedGrayscale16);
+    ImageAccessor s(source.GetAccessor());
+    int16_t* p = reinterpret_cast<int16_t*>(s.GetRow(0));
+    p[0] = -100;
+    p[1] = -201;
+    p[2] = 0;
+
+    ImageBuffer target(1, 1, PixelFormat_SignedGrayscale16);
+    ImageAccessor t(target.GetAccessor());
+    ImageProcessing::Downscale(t, s);
+    ASSERT_EQ(-100, *reinterpret_cast<const int16_t*>(t.GetConstRow(0)));
+  }
+
+  {
+    ImageBuffer source(4, 4, PixelFormat_Grayscale8);
+    ImageBuffer larger(5, 4, PixelFormat_Grayscale8);
+    ImageBuffer empty(0, 4, PixelFormat_Grayscale8);
+    ImageBuffer other(2, 2, PixelFormat_Grayscale16);
+    ImageAccessor s(source.GetAccessor());
+    ImageAccessor a(larger.GetAccessor());
+    ImageAccessor b(empty.GetAccessor());
+    ImageAccessor c(other.GetAccessor());
+    ASSERT_THROW(ImageProcessing::Downscale(a, s), OrthancException);
+    ASSERT_THROW(ImageProcessing::Downscale(b, s), OrthancException);
+    ASSERT_THROW(ImageProcessing::Downscale(c, s), OrthancException);
+  }
+}
+
+
+TEST(ImageProcessing, DownscaleThreads)
+{
+  ImageBuffer source(1500, 1200, PixelFormat_Grayscale16);
+  ImageAccessor s(source.GetAccessor());
+  FillRandom(s);
+
+  ImageBuffer target1(317, 250, PixelFormat_Grayscale16);
+  ImageBuffer target2(317, 250, PixelFormat_Grayscale16);
+  ImageAccessor t1(target1.GetAccessor());
+  ImageAccessor t2(target2.GetAccessor());
+
+  ImageProcessing::Downscale(t1, s);
+
+  ImageProcessing::SetThreadsCount(4);
+  ImageProcessing::Downscale(t2, s);
+  ImageProcessing::SetThreadsCount(1);
+
+  ASSERT_TRUE(IsSameImage(t1, t2));
+}
+
+
+TEST(ImageProcessing, ApplyWindowing)
+{
+  {
+    ImageBuffer source(6, 1, PixelFormat_SignedGrayscale16);
+    ImageAccessor s(source.GetAccessor());
+    int16_t* p = reinterpret_cast<int16_t*>(s.GetRow(0));
+    p[0] = -32768;
+    p[1] = -1024;
+    p[2] = 0;
+    p[3] = 40;
+    p[4] = 100;
+    p[5] = 32767;
+
+    ImageBuffer target(6, 1, PixelFormat_Grayscale8);
+    ImageAccessor t(target.GetAccessor());
+    const uint8_t* q = reinterpret_cast<const uint8_t*>(t.GetConstRow(0));
+
+    // Soft tissue window: [-160, 240]
+    ImageProcessing::ApplyWindowing(t, s, 40.0f, 401.0f, 1.0f, 0.0f, false);
+    ASSERT_EQ(0, q[0]);
+    ASSERT_EQ(0, q[1]);
+    ASSERT_EQ(102, q[2]);   // (0.5 / 400 + 0.1) * 255
+    ASSERT_EQ(128, q[3]);
+    ASSERT_EQ(166, q[4]);   // (60.5 / 400 + 0.5) * 255
+    ASSERT_EQ(255, q[5]);
+
+    ImageProcessing::ApplyWindowing(t, s, 40.0f, 401.0f, 1.0f, 0.0f, true);
+    ASSERT_EQ(255, q[0]);
+    ASSERT_EQ(153, q[2]);
+    ASSERT_EQ(0, q[5]);
+
+    // Modality LUT: The stored values are converted to HU
+    ImageProcessing::ApplyWindowing(t, s, 40.0f, 401.0f, 2.0f, -40.0f, false);
+    ASSERT_EQ(0, q[1]);
+    ASSERT_EQ(77, q[2]);    // -40 HU
+    ASSERT_EQ(128, q[3]);   // 40 HU
+    ASSERT_EQ(204, q[4]);   // 160 HU
+
+    // Window of width 1: Thresholding
+    ImageProcessing::ApplyWindowing(t, s, 40.0f, 1.0f, 1.0f, 0.0f, false);
+    ASSERT_EQ(0, q[2]);
+    ASSERT_EQ(255, q[3]);
+    ASSERT_EQ(255, q[4]);
+  }
+
+  {
+    // The lookup table gives the same results with multiple threads
+    ImageBuffer source(1024, 800, PixelFormat_Grayscale16);
+    ImageAccessor s(source.GetAccessor());
+    FillRandom(s);
+
+    ImageBuffer target1(1024, 800, PixelFormat_Grayscale8);
+    ImageBuffer target2(1024, 800, PixelFormat_Grayscale8);
+    ImageAccessor t1(target1.GetAccessor());
+    ImageAccessor t2(target2.GetAccessor());
+
+    ImageProcessing::ApplyWindowing(t1, s, 2000.0f, 3000.0f, 1.0f, -1024.0f, false);
+    ImageProcessing::SetThreadsCount(4);
+    ImageProcessing::ApplyWindowing(t2, s, 2000.0f, 3000.0f, 1.0f, -1024.0f, false);
+    ImageProcessing::SetThreadsCount(1);
+
+    ASSERT_TRUE(IsSameImage(t1, t2));
+  }
+
+  {
+    ImageBuffer source(4, 4, PixelFormat_Grayscale16);
+    ImageBuffer target(4, 4, PixelFormat_Grayscale8);
+    ImageBuffer other(4, 4, PixelFormat_Grayscale16);
+    ImageBuffer smaller(4, 3, PixelFormat_Grayscale8);
+    ImageBuffer color(4, 4, PixelFormat_RGB24);
+    ImageAccessor s(source.GetAccessor());
+    ImageAccessor t(target.GetAccessor());
+    ImageAccessor a(other.GetAccessor());
+    ImageAccessor b(smaller.GetAccessor());
+    ImageAccessor c(color.GetAccessor());
+    ASSERT_THROW(ImageProcessing::ApplyWindowing(t, s, 0.0f, 0.5f, 1.0f, 0.0f, false), OrthancException);
+    ASSERT_THROW(ImageProcessing::ApplyWindowing(a, s, 0.0f, 10.0f, 1.0f, 0.0f, false), OrthancException);
+    ASSERT_THROW(ImageProcessing::ApplyWindowing(b, s, 0.0f, 10.0f, 1.0f, 0.0f, false), OrthancException);
+    ASSERT_THROW(ImageProcessing::ApplyWindowing(t, c, 0.0f, 10.0f, 1.0f, 0.0f, false), OrthancException);
+  }
+}
+
+
+TEST(RenderingParameters, Basic)
+{
+  RenderingParameters p;
+  ASSERT_FALSE(p.HasWindowing());
+  ASSERT_THROW(p.GetWindowCenter(), OrthancException);
+  ASSERT_THROW(p.SetWindowing(40.0f, 0.0f), OrthancException);
+
+  p.SetWindowing(40.0f, 400.0f);
+  ASSERT_TRUE(p.HasWindowing());
+  ASSERT_FLOAT_EQ(40.0f, p.GetWindowCenter());
+  ASSERT_FLOAT_EQ(400.0f, p.GetWindowWidth());
+  p.ClearWindowing();
+  ASSERT_FALSE(p.HasWindowing());
+
+  unsigned int w, h;
+  p.ComputeTargetSize(w, h, 2000, 2500);
+  ASSERT_EQ(2000u, w);
+  ASSERT_EQ(2500u, h);
+
+  p.SetMaximumSize(512, 0);
+  p.ComputeTargetSize(w, h, 2000, 2500);
+  ASSERT_EQ(512u, w);
+  ASSERT_EQ(640u, h);
+
+  p.SetMaximumSize(512, 512);
+  p.ComputeTargetSize(w, h, 2000, 2500);
+  ASSERT_EQ(410u, w);   // 2000 * 512 / 2500 = 409.6
+  ASSERT_EQ(512u, h);
+
+  // Small images are never enlarged
+  p.ComputeTargetSize(w, h, 256, 100);
+  ASSERT_EQ(256u, w);
+  ASSERT_EQ(100u, h);
+
+  p.SetMaximumSize(0, 10);
+  p.ComputeTargetSize(w, h, 1000, 1);
+  ASSERT_EQ(1000u, w);
+  ASSERT_EQ(1u, h);
+
+  p.SetMaximumSize(10, 0);
+  p.ComputeTargetSize(w, h, 1000, 1);
+  ASSERT_EQ(10u, w);
+  ASSERT_EQ(1u, h);
+}
+
+
+static Json::Value CreateSliceTags(const char* position,
+                                   const char* orientation,
+                                   const char* instanceNumber)
+{
+  Json::Value tags = Json::objectValue;
+  const char* values[] = { position, orientation, instanceNumber };
+  const char* keys[] = { "0020,0032", "0020,0037", "0020,0013" };
+
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    if (values[i] != NULL)
+    {
+      tags[keys[i]]["Type"] = "String";
+      tags[keys[i]]["Value"] = values[i];
+    }
+  }
+
+  return tags;
+}
+
+
+TEST(SliceOrdering, Geometry)
+{
+  // Axial slices, in reverse order of the instance numbers
+  const char* axial = "1\\0\\0\\0\\1\\0";
+
+  SliceOrdering ordering;
+  ordering.AddInstance("a", CreateSliceTags("-100\\-100\\10.5", axial, "1"));
+  ordering.AddInstance("b", CreateSliceTags("-100\\-100\\-2", axial, "2"));
+  ordering.AddInstance("c", CreateSliceTags("-100\\-100\\ 4 ", axial, "3"));
+
+  std::vector<std::string> sorted;
+  ASSERT_TRUE(ordering.Sort(sorted));
+  ASSERT_EQ(3u, sorted.size());
+  ASSERT_EQ("b", sorted[0]);
+  ASSERT_EQ("c", sorted[1]);
+  ASSERT_EQ("a", sorted[2]);
+
+  // Sagittal slices: The normal is (-1,0,0), only the position
+  // along X is used
+  const char* sagittal = "0\\1\\0\\0\\0\\-1";
+
+  SliceOrdering ordering2;
+  ordering2.AddInstance("a", CreateSliceTags("3\\0\\0", sagittal, NULL));
+  ordering2.AddInstance("b", CreateSliceTags("1\\5\\0", sagittal, NULL));
+  ordering2.AddInstance("c", CreateSliceTags("2\\0\\9", sagittal, NULL));
+  ASSERT_TRUE(ordering2.Sort(sorted));
+  ASSERT_EQ("a", sorted[0]);
+  ASSERT_EQ("c", sorted[1]);
+  ASSERT_EQ("b", sorted[2]);
+}
+
+
+TEST(SliceOrdering, Fallback)
+{
+  const char* axial = "1\\0\\0\\0\\1\\0";
+
+  {
+    // Two slices at the same location: Use the instance numbers
+    SliceOrdering ordering;
+    ordering.AddInstance("a", CreateSliceTags("0\\0\\1", axial, " 12 "));
+    ordering.AddInstance("b", CreateSliceTags("0\\0\\1", axial, "3"));
+
+    std::vector<std::string> sorted;
+    ASSERT_TRUE(ordering.Sort(sorted));
+    ASSERT_EQ("b", sorted[0]);
+    ASSERT_EQ("a", sorted[1]);
+  }
+
+  {
+    // No geometry
+    SliceOrdering ordering;
+    ordering.AddInstance("a", CreateSliceTags(NULL, NULL, "2"));
+    ordering.AddInstance("b", CreateSliceTags("0\\0", axial, "1"));
+
+    std::vector<std::string> sorted;
+    ASSERT_TRUE(ordering.Sort(sorted));
+    ASSERT_EQ("b", sorted[0]);
+    ASSERT_EQ("a", sorted[1]);
+  }
+
+  {
+    // Duplicate instance numbers
+    SliceOrdering ordering;
+    ordering.AddInstance("a", CreateSliceTags(NULL, NULL, "1"));
+    ordering.AddInstance("b", CreateSliceTags(NULL, NULL, "1"));
+
+    std::vector<std::string> sorted;
+    ASSERT_FALSE(ordering.Sort(sorted));
+  }
+
+  {
+    // A single slice can always be ordered
+    SliceOrdering ordering;
+    ordering.AddInstance("a", Json::objectValue);
+
+    std::vector<std::string> sorted;
+    ASSERT_TRUE(ordering.Sort(sorted));
+    ASSERT_EQ(1u, sorted.size());
+  }
+}
+
+
+TEST(RawFramesHeader, Basic)
+{
+  RawFramesHeader header(PixelFormat_SignedGrayscale16, 512, 256, 600);
+  ASSERT_EQ(2u * 512u * 256u, header.GetFrameSize());
+  ASSERT_EQ(24u + 600u * 2u * 512u * 256u, header.GetTotalSize());
+
+  std::string s;
+  header.Write(s);
+  ASSERT_EQ(RawFramesHeader::HEADER_SIZE, s.size());
+  ASSERT_EQ("ORAW", s.substr(0, 4));
+
+  RawFramesHeader h;
+  h.Read(s.c_str(), s.size());
+  ASSERT_EQ(PixelFormat_SignedGrayscale16, h.GetFormat());
+  ASSERT_EQ(512u, h.GetWidth());
+  ASSERT_EQ(256u, h.GetHeight());
+  ASSERT_EQ(600u, h.GetDepth());
+
+  ASSERT_THROW(h.Read(s.c_str(), s.size() - 1), OrthancException);
+  s[8] = 42;  // Unknown pixel format
+  ASSERT_THROW(h.Read(s.c_str(), s.size()), OrthancException);
+  s[0] = 'X';
+  ASSERT_THROW(h.Read(s.c_str(), s.size()), OrthancException);
+}
+
+TEST(ImageProcessing, DISABLED_Benchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests
+  // --gtest_filter=ImageProcessing.DISABLED_Benchmark" to compare the
+  // scalar implementation with the SIMD and multithreaded ones, on a
+  // 2048x2048 signed 16bpp image
+  const unsigned int size = 2048;
+  const unsigned int count = 20;
+
+  ImageBuffer source(size, size, PixelFormat_SignedGrayscale16);
+  ImageAccessor s(source.GetAccessor());
+  FillRandom(s);
+
+  ImageBuffer image(size, size, PixelFormat_SignedGrayscale16);
+  ImageAccessor a(image.GetAccessor());
+
+  ImageBuffer target(size, size, PixelFormat_Grayscale8);
+  ImageAccessor t(target.GetAccessor());
+
+  const unsigned int threads = std::max(1u, boost::thread::hardware_concurrency());
+
+  for (unsigned int k = 0; k < 3; k++)
+  {
+    ImageProcessing::SetSimdEnabled(k != 0);
+    ImageProcessing::SetThreadsCount(k == 2 ? threads : 1);
+
+    for (unsigned int operation = 0; operation < 4; operation++)
+    {
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+      for (unsigned int i = 0; i < count; i++)
+      {
+        ImageProcessing::Copy(a, s);
+
+        switch (operation)
+        {
+          case 0:
+            ImageProcessing::Convert(t, a);
+            break;
+
+          case 1:
+          {
+            int64_t minValue, maxValue;
+            ImageProcessing::GetMinMaxValue(minValue, maxValue, a);
+            break;
+          }
+
+          case 2:
+            ImageProcessing::AddConstant(a, 1024);
+            break;
+
+          default:
+            ImageProcessing::ShiftScale(a, 1024.0f, 0.1f);
+            break;
+        }
+      }
+
+      double seconds = static_cast<double>
+        ((boost::posix_time::microsec_clock::universal_time() - start).total_microseconds()) / 1000000.0;
+
+      const char* names[] = { "Convert", "GetMinMaxValue", "AddConstant", "ShiftScale" };
+      printf("%-16s %-9s (%u thread%s): %.1f images/s\n", names[operation],
+             (k == 0 ? "scalar" : "SIMD"), (k == 2 ? threads : 1), 
+             (k == 2 && threads > 1 ? "s" : ""), static_cast<double>(count) / seconds);
+    }
+  }
+
+  ImageProcessing::SetSimdEnabled(true);
+  ImageProcessing::SetThreadsCount(1);
+}
+
+
+TEST(ImageProcessing, DISABLED_RenderingBenchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests
+  // --gtest_filter=ImageProcessing.DISABLED_RenderingBenchmark" to
+  // measure the latency of the server-side rendering (downscaling,
+  // then windowing) per megapixel of the source image
+  struct Scenario
+  {
+    const char*   name_;
+    PixelFormat   format_;
+    unsigned int  width_;
+    unsigned int  height_;
+    unsigned int  targetWidth_;
+    unsigned int  targetHeight_;
+  };
+
+  const Scenario scenarios[] = {
+    { "CT, full size",      PixelFormat_SignedGrayscale16, 512, 512, 512, 512 },
+    { "CT, 256x256",        PixelFormat_SignedGrayscale16, 512, 512, 256, 256 },
+    { "CR, full size",      PixelFormat_Grayscale16, 2000, 2500, 2000, 2500 },
+    { "CR, 819x1024",       PixelFormat_Grayscale16, 2000, 2500, 819, 1024 },
+    { "MG, 1024x1280",      PixelFormat_Grayscale16, 3328, 4096, 1040, 1280 }
+  };
+
+  const unsigned int count = 10;
+  const unsigned int threads = std::max(1u, boost::thread::hardware_concurrency());
+
+  for (size_t i = 0; i < sizeof(scenarios) / sizeof(Scenario); i++)
+  {
+    const Scenario& scenario = scenarios[i];
+
+    ImageBuffer source(scenario.width_, scenario.height_, scenario.format_);
+    ImageAccessor s(source.GetAccessor());
+    FillRandom(s);
+
+    const double megapixels = static_cast<double>(scenario.width_) * static_cast<double>(scenario.height_) / 1000000.0;
+
+    for (unsigned int k = 0; k < 2; k++)
+    {
+      ImageProcessing::SetThreadsCount(k == 0 ? 1 : threads);
+
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+      for (unsigned int j = 0; j < count; j++)
+      {
+        ImageBuffer resized(scenario.targetWidth_, scenario.targetHeight_, scenario.format_);
+        ImageAccessor r(resized.GetAccessor());
+        ImageProcessing::Downscale(r, s);  // Plain copy if the size is unchanged
+
+        ImageBuffer target(scenario.targetWidth_, scenario.targetHeight_, PixelFormat_Grayscale8);
+        ImageAccessor t(target.GetAccessor());
+        ImageProcessing::ApplyWindowing(t, r, 40.0f, 400.0f, 1.0f, -1024.0f, false);
+      }
+
+      double ms = static_cast<double>
+        ((boost::posix_time::microsec_clock::universal_time() - start).total_microseconds()) / 1000.0 / count;
+
+      printf("%-14s (%ux%u, %u thread%s): %6.2f ms, %6.2f ms/megapixel\n", scenario.name_, 
+             scenario.width_, scenario.height_, (k == 0 ? 1 : threads), 
+             (k == 1 && threads > 1 ? "s" : ""), ms, ms / megapixels);
+    }
+  }
+
+  ImageProcessing::SetThreadsCount(1);
+}
@@ -39,6 +39,7 @@
 #include <boost/lexical_cast.hpp>
 #include "../Core/IDynamicObject.h"
 #include "../Core/Cache/MemoryCache.h"
+#include "../Core/Cache/SharedMemoryCache.h"
 
 
 TEST(LRU, Basic)
@@ -175,17 +176,21 @@ namespace
   class Integer : public Orthanc::IDynamicObject
   {
   private:
+    boost::mutex& mutex_;
     std::string& log_;
     int value_;
 
   public:
-    Integer(std::string& log, int v) : log_(log), value_(v)
+    Integer(boost::mutex& mutex, std::string& log, int v) : mutex_(mutex), log_(log), value_(v)
     {
     }
 
     virtual ~Integer()
     {
       LOG(INFO) << "Removing cache entry for " << value_;
+
+      // The pages of a shared cache are freed by several threads
+      boost::mutex::scoped_lock lock(mutex_);
       log_ += boost::lexical_cast<std::string>(value_) + " ";
     }
 
@@ -198,12 +203,13 @@ namespace
   class IntegerProvider : public Orthanc::ICachePageProvider
   {
   public:
+    boost::mutex mutex_;
     std::string log_;
 
     Orthanc::IDynamicObject* Provide(const std::string& s)
     {
       LOG(INFO) << "Providing " << s;
-      return new Integer(log_, boost::lexical_cast<int>(s));
+      return new Integer(mutex_, log_, boost::lexical_cast<int>(s));
     }
   };
 }
@@ -228,3 +234,169 @@ TEST(MemoryCache, Basic)
 
   ASSERT_EQ("45 42 43 47 44 42 ", provider.log_);
 }
+
+
+
+namespace
+{
+  class SizedIntegerProvider : public Orthanc::ISizedCachePageProvider
+  {
+  public:
+    boost::mutex mutex_;  // Protects "log_" and "count_"
+    std::string log_;
+    unsigned int count_;
+
+    SizedIntegerProvider() : count_(0)
+    {
+    }
+
+    Orthanc::IDynamicObject* Provide(size_t& size,
+                                     const std::string& s)
+    {
+      LOG(INFO) << "Providing " << s;
+
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        count_++;
+      }
+
+      if (s == "error")
+      {
+        throw Orthanc::OrthancException(Orthanc::ErrorCode_InexistentFile);
+      }
+
+      // The size of each page is its value
+      int value = boost::lexical_cast<int>(s);
+      size = value;
+      return new Integer(mutex_, log_, value);
+    }
+  };
+}
+
+
+TEST(SharedMemoryCache, Basic)
+{
+  SizedIntegerProvider provider;
+
+  {
+    Orthanc::SharedMemoryCache cache(provider, 100, 1);
+
+    {
+      Orthanc::SharedMemoryCache::Accessor a(cache, "40");
+      ASSERT_EQ(40, dynamic_cast<Integer&>(a.GetContent()).GetValue());
+    }
+
+    {
+      Orthanc::SharedMemoryCache::Accessor a(cache, "50");
+      Orthanc::SharedMemoryCache::Accessor b(cache, "40");  // 40, 50
+      ASSERT_EQ(50, dynamic_cast<Integer&>(a.GetContent()).GetValue());
+      ASSERT_EQ(40, dynamic_cast<Integer&>(b.GetContent()).GetValue());
+    }
+
+    ASSERT_EQ(90u, cache.GetCurrentSize());
+    ASSERT_EQ(2u, cache.GetNumberOfPages());
+
+    {
+      // 50 is dropped, but is only freed once the accessor is released
+      Orthanc::SharedMemoryCache::Accessor a(cache, "50");  // 50, 40
+      Orthanc::SharedMemoryCache::Accessor b(cache, "40");  // 40, 50
+      Orthanc::SharedMemoryCache::Accessor c(cache, "30");  // 30, 40 -> 50 is removed
+      ASSERT_EQ("", provider.log_);
+      ASSERT_EQ(50, dynamic_cast<Integer&>(a.GetContent()).GetValue());
+    }
+
+    ASSERT_EQ("50 ", provider.log_);
+    ASSERT_EQ(70u, cache.GetCurrentSize());
+
+    {
+      // A page that is larger than the cache is not kept, but it
+      // remains available until its accessor is released
+      Orthanc::SharedMemoryCache::Accessor a(cache, "200");
+      ASSERT_EQ("50 40 30 ", provider.log_);
+      ASSERT_EQ(200, dynamic_cast<Integer&>(a.GetContent()).GetValue());
+      ASSERT_EQ(0u, cache.GetCurrentSize());
+      ASSERT_EQ(0u, cache.GetNumberOfPages());
+    }
+
+    ASSERT_EQ("50 40 30 200 ", provider.log_);
+
+    cache.Invalidate("200");
+    cache.Invalidate("nope");
+    ASSERT_EQ(0u, cache.GetCurrentSize());
+
+    ASSERT_THROW(Orthanc::SharedMemoryCache::Accessor(cache, "error"), Orthanc::OrthancException);
+    ASSERT_EQ(0u, cache.GetNumberOfPages());
+
+    uint64_t hits, misses, evictions;
+    cache.GetStatistics(hits, misses, evictions);
+    ASSERT_EQ(3u, hits);
+    ASSERT_EQ(5u, misses);
+    ASSERT_EQ(4u, evictions);
+  }
+
+  ASSERT_EQ(5u, provider.count_);
+}
+
+
+TEST(SharedMemoryCache, SizeBound)
+{
+  SizedIntegerProvider provider;
+  Orthanc::SharedMemoryCache cache(provider, 100, 16);
+
+  for (unsigned int i = 0; i < 200; i++)
+  {
+    // Pages of 30 to 69 bytes, spread over the 16 shards
+    int value = 30 + (i * 13) % 40;
+
+    {
+      Orthanc::SharedMemoryCache::Accessor a(cache, boost::lexical_cast<std::string>(value));
+      ASSERT_EQ(value, dynamic_cast<Integer&>(a.GetContent()).GetValue());
+    }
+
+    ASSERT_LE(cache.GetCurrentSize(), 100u);
+    ASSERT_LE(cache.GetNumberOfPages(), 3u);
+    ASSERT_GE(cache.GetNumberOfPages(), 1u);
+  }
+
+  uint64_t hits, misses, evictions;
+  cache.GetStatistics(hits, misses, evictions);
+  ASSERT_EQ(200u, hits + misses);
+  ASSERT_EQ(misses, evictions + cache.GetNumberOfPages());
+}
+
+
+static void AccessSharedMemoryCache(Orthanc::SharedMemoryCache* cache,
+                                    unsigned int seed)
+{
+  for (unsigned int i = 0; i < 1000; i++)
+  {
+    int value = 1 + (i * 7 + seed) % 20;
+    Orthanc::SharedMemoryCache::Accessor a(*cache, boost::lexical_cast<std::string>(value));
+    ASSERT_EQ(value, dynamic_cast<Integer&>(a.GetContent()).GetValue());
+  }
+}
+
+
+TEST(SharedMemoryCache, Concurrency)
+{
+  SizedIntegerProvider provider;
+  Orthanc::SharedMemoryCache cache(provider, 100, 4);
+
+  std::vector<boost::thread*> threads;
+  for (unsigned int i = 0; i < 8; i++)
+  {
+    threads.push_back(new boost::thread(AccessSharedMemoryCache, &cache, i));
+  }
+
+  for (size_t i = 0; i < threads.size(); i++)
+  {
+    threads[i]->join();
+    delete threads[i];
+  }
+
+  uint64_t hits, misses, evictions;
+  cache.GetStatistics(hits, misses, evictions);
+  ASSERT_EQ(8000u, hits + misses);
+  ASSERT_EQ(misses, provider.count_);
+  ASSERT_EQ(misses, evictions + cache.GetNumberOfPages());
+}
@@ -277,6 +277,155 @@ TEST(ReusableDicomUserConnection, DISABLED_Basic)
 
 
 
+namespace
+{
+  class NoNetworkDicomUserConnection : public ReusableDicomUserConnection
+  {
+  protected:
+    virtual void OpenConnection(DicomUserConnection& connection)
+    {
+      // Do not open any association: The connections are closed as
+      // soon as they are released
+    }
+  };
+
+  struct PoolUsage
+  {
+    boost::mutex  mutex_;
+    unsigned int  active_;
+    unsigned int  maxActive_;
+    unsigned int  uses_;
+
+    PoolUsage() : active_(0), maxActive_(0), uses_(0)
+    {
+    }
+  };
+}
+
+
+static void UseModality(ReusableDicomUserConnection* pool,
+                        PoolUsage* usage,
+                        std::string aet)
+{
+  for (unsigned int i = 0; i < 10; i++)
+  {
+    ReusableDicomUserConnection::Locker lock(*pool, aet, "localhost", 104, ModalityManufacturer_Generic);
+    ASSERT_EQ(aet, lock.GetConnection().GetRemoteApplicationEntityTitle());
+
+    {
+      boost::mutex::scoped_lock l(usage->mutex_);
+      usage->active_++;
+      usage->uses_++;
+      if (usage->active_ > usage->maxActive_)
+      {
+        usage->maxActive_ = usage->active_;
+      }
+    }
+
+    Toolbox::USleep(1000);
+
+    {
+      boost::mutex::scoped_lock l(usage->mutex_);
+      usage->active_--;
+    }
+  }
+}
+
+
+TEST(ReusableDicomUserConnection, MaxConnectionsPerModality)
+{
+  NoNetworkDicomUserConnection pool;
+  ASSERT_THROW(pool.SetMaxConnectionsPerModality(0), OrthancException);
+  pool.SetMaxConnectionsPerModality(2);
+
+  PoolUsage usage1, usage2;
+
+  std::vector<boost::thread*> threads;
+  for (unsigned int i = 0; i < 6; i++)
+  {
+    threads.push_back(new boost::thread(UseModality, &pool, &usage1, "MODALITY1"));
+    threads.push_back(new boost::thread(UseModality, &pool, &usage2, "MODALITY2"));
+  }
+
+  for (size_t i = 0; i < threads.size(); i++)
+  {
+    threads[i]->join();
+    delete threads[i];
+  }
+
+  // The limit applies separately to each modality
+  ASSERT_EQ(60u, usage1.uses_);
+  ASSERT_EQ(60u, usage2.uses_);
+  ASSERT_EQ(0u, usage1.active_);
+  ASSERT_EQ(0u, usage2.active_);
+  ASSERT_LE(usage1.maxActive_, 2u);
+  ASSERT_LE(usage2.maxActive_, 2u);
+}
+
+
+namespace
+{
+  class UnreachableDicomUserConnection : public ReusableDicomUserConnection
+  {
+  public:
+    bool          unreachable_;
+    unsigned int  opened_;
+
+    UnreachableDicomUserConnection() : unreachable_(true), opened_(0)
+    {
+    }
+
+  protected:
+    virtual void OpenConnection(DicomUserConnection& connection)
+    {
+      opened_++;
+      if (unreachable_)
+      {
+        throw OrthancException(ErrorCode_NetworkProtocol);
+      }
+    }
+  };
+}
+
+
+TEST(ReusableDicomUserConnection, Backoff)
+{
+  UnreachableDicomUserConnection pool;
+  pool.SetMillisecondsBeforeRetry(100);
+
+  ASSERT_EQ(0u, pool.GetConsecutiveFailures("MODALITY", "localhost", 104, ModalityManufacturer_Generic));
+
+  ASSERT_THROW(ReusableDicomUserConnection::Locker lock(pool, "MODALITY", "localhost", 104, ModalityManufacturer_Generic),
+               OrthancException);
+  ASSERT_EQ(1u, pool.opened_);
+  ASSERT_EQ(1u, pool.GetConsecutiveFailures("MODALITY", "localhost", 104, ModalityManufacturer_Generic));
+
+  // No new association is attempted before the delay
+  ASSERT_THROW(ReusableDicomUserConnection::Locker lock(pool, "MODALITY", "localhost", 104, ModalityManufacturer_Generic),
+               OrthancException);
+  ASSERT_EQ(1u, pool.opened_);
+  ASSERT_EQ(1u, pool.GetConsecutiveFailures("MODALITY", "localhost", 104, ModalityManufacturer_Generic));
+
+  // The other modalities are not affected
+  pool.unreachable_ = false;
+  {
+    ReusableDicomUserConnection::Locker lock(pool, "OTHER", "localhost", 104, ModalityManufacturer_Generic);
+  }
+  ASSERT_EQ(2u, pool.opened_);
+
+  // Once the delay is over, the association is opened again, and
+  // the failures are forgotten
+  Toolbox::USleep(150000);
+
+  {
+    ReusableDicomUserConnection::Locker lock(pool, "MODALITY", "localhost", 104, ModalityManufacturer_Generic);
+  }
+  ASSERT_EQ(3u, pool.opened_);
+  ASSERT_EQ(0u, pool.GetConsecutiveFailures("MODALITY", "localhost", 104, ModalityManufacturer_Generic));
+}
+
+
+
 class Tutu : public IServerCommand
 {
 private:
@@ -370,3 +519,290 @@ TEST(MultiThreading, ServerScheduler)
   done = true;
   t.join();
 }
+
+
+
+namespace
+{
+  class ConcurrencyCommand : public IServerCommand
+  {
+  private:
+    boost::mutex& mutex_;
+    unsigned int& running_;
+    unsigned int& maxRunning_;
+    std::string destination_;
+
+  public:
+    ConcurrencyCommand(boost::mutex& mutex,
+                       unsigned int& running,
+                       unsigned int& maxRunning,
+                       const std::string& destination) :
+      mutex_(mutex),
+      running_(running),
+      maxRunning_(maxRunning),
+      destination_(destination)
+    {
+    }
+
+    virtual bool Apply(ListOfStrings& outputs,
+                       const ListOfStrings& inputs)
+    {
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        running_++;
+        maxRunning_ = std::max(maxRunning_, running_);
+      }
+
+      Toolbox::USleep(50000);
+
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        running_--;
+      }
+
+      outputs = inputs;
+      return true;
+    }
+
+    virtual std::string GetDestination() const
+    {
+      return destination_;
+    }
+  };
+}
+
+
+static void RunConcurrencyJob(ServerScheduler& scheduler,
+                              unsigned int& maxRunning,
+                              const std::string& destination)
+{
+  boost::mutex mutex;
+  unsigned int running = 0;
+  maxRunning = 0;
+
+  // One source command, whose output is processed by 4 branches in parallel
+  ServerJob job;
+  ServerCommandInstance& source = job.AddCommand(new ConcurrencyCommand(mutex, running, maxRunning, ""));
+  source.AddInput("42");
+
+  for (unsigned int i = 0; i < 4; i++)
+  {
+    ServerCommandInstance& branch = job.AddCommand(new ConcurrencyCommand(mutex, running, maxRunning, destination));
+    source.ConnectOutput(branch);
+    branch.SetConnectedToSink(true);
+  }
+
+  IServerCommand::ListOfStrings l;
+  ASSERT_TRUE(scheduler.SubmitAndWait(l, job));
+
+  ASSERT_EQ(4u, l.size());
+  for (IServerCommand::ListOfStrings::const_iterator it = l.begin(); it != l.end(); ++it)
+  {
+    ASSERT_EQ("42", *it);
+  }
+}
+
+
+TEST(MultiThreading, ServerSchedulerWorkers)
+{
+  ServerScheduler scheduler(10, 4);
+
+  unsigned int maxRunning;
+  RunConcurrencyJob(scheduler, maxRunning, "");
+  ASSERT_LT(1u, maxRunning);
+  ASSERT_GE(4u, maxRunning);
+
+  scheduler.SetMaxCommandsPerDestination(1);
+  RunConcurrencyJob(scheduler, maxRunning, "modality:A");
+  ASSERT_EQ(1u, maxRunning);
+
+  Json::Value status;
+  scheduler.GetStatus(status);
+  ASSERT_EQ(0u, status["QueueDepth"].asUInt());
+  ASSERT_EQ(4u, status["Workers"].size());
+  ASSERT_EQ(0u, status["Jobs"].size());
+}
+
+
+
+namespace
+{
+  class FailingCommand : public IServerCommand
+  {
+  public:
+    virtual bool Apply(ListOfStrings& outputs,
+                       const ListOfStrings& inputs)
+    {
+      return false;
+    }
+  };
+
+
+  class SlowCommand : public IServerCommand
+  {
+  public:
+    virtual bool Apply(ListOfStrings& outputs,
+                       const ListOfStrings& inputs)
+    {
+      Toolbox::USleep(50000);
+      return true;
+    }
+  };
+
+
+  class CountingCommand : public IServerCommand
+  {
+  private:
+    boost::mutex& mutex_;
+    unsigned int& count_;
+
+  public:
+    CountingCommand(boost::mutex& mutex,
+                    unsigned int& count) :
+      mutex_(mutex),
+      count_(count)
+    {
+    }
+
+    virtual bool Apply(ListOfStrings& outputs,
+                       const ListOfStrings& inputs)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      count_++;
+      return true;
+    }
+  };
+}
+
+
+TEST(MultiThreading, ServerSchedulerFailure)
+{
+  ServerScheduler scheduler(10, 4);
+
+  boost::mutex mutex;
+  unsigned int count = 0;
+
+  // The next commands of a failed command must never be executed,
+  // even if they are picked by another worker
+  for (unsigned int i = 0; i < 20; i++)
+  {
+    ServerJob job;
+    ServerCommandInstance& source = job.AddCommand(new FailingCommand);
+    source.AddInput("42");
+
+    for (unsigned int j = 0; j < 8; j++)
+    {
+      ServerCommandInstance& next = job.AddCommand(new CountingCommand(mutex, count));
+      source.ConnectOutput(next);
+      next.SetConnectedToSink(true);
+    }
+
+    IServerCommand::ListOfStrings l;
+    ASSERT_FALSE(scheduler.SubmitAndWait(l, job));
+    ASSERT_TRUE(l.empty());
+  }
+
+  ASSERT_EQ(0u, count);
+}
+
+
+TEST(MultiThreading, ServerSchedulerSuccessAfterFailure)
+{
+  // Only one job at once, so that a job that is never finished would
+  // block the next submissions
+  ServerScheduler scheduler(1, 4);
+
+  for (unsigned int i = 0; i < 5; i++)
+  {
+    // Two independent commands run in parallel by two workers: The
+    // slow one is started first, and succeeds after the other one
+    // has failed
+    ServerJob watched;
+    watched.AddCommand(new SlowCommand);
+    watched.AddCommand(new FailingCommand);
+    ASSERT_FALSE(scheduler.SubmitAndWait(watched));
+
+    // The same, in a job that is not watched and that has no sink
+    ServerJob unwatched;
+    unwatched.AddCommand(new SlowCommand);
+    unwatched.AddCommand(new FailingCommand);
+    scheduler.Submit(unwatched);
+  }
+
+  ServerJob job;
+  job.AddCommand(new SlowCommand);
+  ASSERT_TRUE(scheduler.SubmitAndWait(job));
+
+  Json::Value status;
+  scheduler.GetStatus(status);
+  ASSERT_EQ(0u, status["Jobs"].size());
+}
+
+
+
+namespace
+{
+  class LoggingCommand : public IServerCommand
+  {
+  private:
+    boost::mutex& mutex_;
+    std::vector<std::string>& log_;
+    std::string name_;
+    unsigned int sleep_;
+
+  public:
+    LoggingCommand(boost::mutex& mutex,
+                   std::vector<std::string>& log,
+                   const std::string& name,
+                   unsigned int sleep) :
+      mutex_(mutex),
+      log_(log),
+      name_(name),
+      sleep_(sleep)
+    {
+    }
+
+    virtual bool Apply(ListOfStrings& outputs,
+                       const ListOfStrings& inputs)
+    {
+      Toolbox::USleep(sleep_);
+
+      boost::mutex::scoped_lock lock(mutex_);
+      for (ListOfStrings::const_iterator it = inputs.begin(); it != inputs.end(); ++it)
+      {
+        log_.push_back(name_ + " " + *it);
+        outputs.push_back(*it);
+      }
+
+      return true;
+    }
+  };
+}
+
+
+TEST(MultiThreading, ServerSchedulerSuccessor)
+{
+  ServerScheduler scheduler(10, 4);
+
+  // Mimics "Delete(SendToModality(instanceId, 'sample'))" in Lua: The
+  // deletion gets its instance explicitly, but must wait for the
+  // slow sending to be over, without receiving its outputs
+  for (unsigned int i = 0; i < 5; i++)
+  {
+    boost::mutex mutex;
+    std::vector<std::string> log;
+
+    ServerJob job;
+    ServerCommandInstance& send = job.AddCommand(new LoggingCommand(mutex, log, "send", 50000));
+    ServerCommandInstance& remove = job.AddCommand(new LoggingCommand(mutex, log, "delete", 0));
+    send.AddInput("42");
+    remove.AddInput("42");
+    send.ConnectSuccessor(remove);
+
+    ASSERT_TRUE(scheduler.SubmitAndWait(job));
+
+    ASSERT_EQ(2u, log.size());
+    ASSERT_EQ("send 42", log[0]);
+    ASSERT_EQ("delete 42", log[1]);
+  }
+}
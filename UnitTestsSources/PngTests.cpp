@@ -36,6 +36,8 @@
 #include <stdint.h>
 #include "../Core/ImageFormats/PngReader.h"
 #include "../Core/ImageFormats/PngWriter.h"
+#include "../Core/ImageFormats/JpegWriter.h"
+#include "../Core/OrthancException.h"
 #include "../Core/Toolbox.h"
 #include "../Core/Uuid.h"
 
@@ -184,3 +186,213 @@ TEST(PngWriter, EndToEnd)
     }
   }
 }
+
+
+
+#if ORTHANC_JPEG_ENABLED == 1
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <math.h>
+#include <stdio.h>
+
+namespace
+{
+  bool IsJpeg(const std::string& jpeg)
+  {
+    // Start of image (SOI) and end of image (EOI) markers
+    return (jpeg.size() > 4 &&
+            static_cast<uint8_t>(jpeg[0]) == 0xff &&
+            static_cast<uint8_t>(jpeg[1]) == 0xd8 &&
+            static_cast<uint8_t>(jpeg[jpeg.size() - 2]) == 0xff &&
+            static_cast<uint8_t>(jpeg[jpeg.size() - 1]) == 0xd9);
+  }
+
+
+  uint8_t Noise(uint32_t& seed,
+                int amplitude)
+  {
+    seed = seed * 1103515245u + 12345u;
+    return static_cast<uint8_t>((seed >> 16) % (2 * amplitude + 1));
+  }
+
+
+  uint8_t Clamp(int v)
+  {
+    return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+  }
+
+
+  // Synthetic images that mimic the statistics of typical previews
+  void GenerateImage(std::vector<uint8_t>& image,
+                     unsigned int& width,
+                     unsigned int& height,
+                     Orthanc::PixelFormat& format,
+                     const std::string& modality)
+  {
+    uint32_t seed = 42;
+
+    if (modality == "CR")
+    {
+      // Large radiograph: Smooth anatomy, with mild noise
+      width = 2000;
+      height = 2500;
+      format = Orthanc::PixelFormat_Grayscale8;
+      image.resize(width * height);
+
+      for (unsigned int y = 0; y < height; y++)
+      {
+        for (unsigned int x = 0; x < width; x++)
+        {
+          double dx = (static_cast<double>(x) - width / 2.0) / (width / 2.0);
+          double dy = (static_cast<double>(y) - height / 2.0) / (height / 2.0);
+          double v = 200.0 * exp(-2.0 * (dx * dx + dy * dy)) + 30.0 * sin(20.0 * dy);
+          image[y * width + x] = Clamp(static_cast<int>(v) + Noise(seed, 4) - 4);
+        }
+      }
+    }
+    else if (modality == "CT")
+    {
+      // Axial slice: Textured body in a black background
+      width = 512;
+      height = 512;
+      format = Orthanc::PixelFormat_Grayscale8;
+      image.resize(width * height);
+
+      for (unsigned int y = 0; y < height; y++)
+      {
+        for (unsigned int x = 0; x < width; x++)
+        {
+          double dx = static_cast<double>(x) - 256.0;
+          double dy = static_cast<double>(y) - 256.0;
+          double r = sqrt(dx * dx + dy * dy);
+          int v = (r < 220.0 ? 120 + static_cast<int>(40.0 * sin(x / 9.0) * cos(y / 13.0)) + Noise(seed, 10) - 10 : 0);
+          image[y * width + x] = Clamp(v);
+        }
+      }
+    }
+    else
+    {
+      // Ultrasound: Speckled sector, in color
+      width = 800;
+      height = 600;
+      format = Orthanc::PixelFormat_RGB24;
+      image.resize(width * height * 3);
+
+      for (unsigned int y = 0; y < height; y++)
+      {
+        for (unsigned int x = 0; x < width; x++)
+        {
+          double dx = static_cast<double>(x) - 400.0;
+          double dy = static_cast<double>(y) + 50.0;
+          double r = sqrt(dx * dx + dy * dy);
+          bool inside = (r < 600.0 && fabs(dx) < 0.7 * dy);
+          uint8_t v = inside ? Clamp(60 + Noise(seed, 60)) : 0;
+
+          uint8_t* p = &image[(y * width + x) * 3];
+          p[0] = v;
+          p[1] = v;
+          p[2] = (inside && x > 350 && x < 450 && y > 250 && y < 350) ? 255 : v;  // Doppler
+        }
+      }
+    }
+  }
+}
+
+
+TEST(JpegWriter, Basic)
+{
+  std::vector<uint8_t> image;
+  unsigned int width, height;
+  Orthanc::PixelFormat format;
+  GenerateImage(image, width, height, format, "CT");
+
+  Orthanc::JpegWriter w;
+  ASSERT_EQ(90, w.GetQuality());
+
+  std::string high, low;
+  w.WriteToMemory(high, width, height, width, format, &image[0]);
+  ASSERT_TRUE(IsJpeg(high));
+
+  w.SetQuality(50);
+  w.WriteToMemory(low, width, height, width, format, &image[0]);
+  ASSERT_TRUE(IsJpeg(low));
+  ASSERT_LT(low.size(), high.size());
+
+  // Color images, with a pitch larger than the row
+  GenerateImage(image, width, height, format, "US");
+  std::vector<uint8_t> padded((width * 3 + 5) * height);
+  for (unsigned int y = 0; y < height; y++)
+  {
+    memcpy(&padded[y * (width * 3 + 5)], &image[y * width * 3], width * 3);
+  }
+
+  std::string color, color2;
+  w.WriteToMemory(color, width, height, width * 3, format, &image[0]);
+  w.WriteToMemory(color2, width, height, width * 3 + 5, format, &padded[0]);
+  ASSERT_TRUE(IsJpeg(color));
+  ASSERT_EQ(color, color2);
+
+  w.WriteToFile("UnitTestsResults/Color.jpg", width, height, width * 3, format, &image[0]);
+
+  std::string f;
+  Orthanc::Toolbox::ReadFile(f, "UnitTestsResults/Color.jpg");
+  ASSERT_EQ(color, f);
+
+  ASSERT_THROW(w.SetQuality(0), Orthanc::OrthancException);
+  ASSERT_THROW(w.SetQuality(101), Orthanc::OrthancException);
+  ASSERT_EQ(50, w.GetQuality());
+
+  std::string s;
+  ASSERT_THROW(w.WriteToMemory(s, 16, 16, 32, Orthanc::PixelFormat_Grayscale16, &image[0]), Orthanc::OrthancException);
+  ASSERT_THROW(w.WriteToMemory(s, 0, 16, 0, Orthanc::PixelFormat_Grayscale8, &image[0]), Orthanc::OrthancException);
+}
+
+
+TEST(JpegWriter, DISABLED_Benchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests
+  // --gtest_filter=JpegWriter.DISABLED_Benchmark" to compare the
+  // encoding time and the size of PNG and JPEG previews
+  const char* modalities[] = { "CR", "CT", "US" };
+  const unsigned int count = 5;
+
+  for (size_t i = 0; i < sizeof(modalities) / sizeof(const char*); i++)
+  {
+    std::vector<uint8_t> image;
+    unsigned int width, height;
+    Orthanc::PixelFormat format;
+    GenerateImage(image, width, height, format, modalities[i]);
+
+    const unsigned int pitch = width * Orthanc::GetBytesPerPixel(format);
+
+    for (unsigned int k = 0; k < 3; k++)
+    {
+      std::string result;
+      boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+      for (unsigned int j = 0; j < count; j++)
+      {
+        if (k == 0)
+        {
+          Orthanc::PngWriter w;
+          w.WriteToMemory(result, width, height, pitch, format, &image[0]);
+        }
+        else
+        {
+          Orthanc::JpegWriter w;
+          w.SetQuality(k == 1 ? 90 : 75);
+          w.WriteToMemory(result, width, height, pitch, format, &image[0]);
+        }
+      }
+
+      double ms = static_cast<double>
+        ((boost::posix_time::microsec_clock::universal_time() - start).total_microseconds()) / 1000.0 / count;
+
+      printf("%s %ux%u %-12s: %8.1f ms, %9u bytes\n", modalities[i], width, height,
+             (k == 0 ? "PNG" : (k == 1 ? "JPEG (q=90)" : "JPEG (q=75)")), ms, 
+             static_cast<unsigned int>(result.size()));
+    }
+  }
+}
+
+#endif
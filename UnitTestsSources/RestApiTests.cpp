@@ -38,11 +38,17 @@
 
 #include "../Core/ChunkedBuffer.h"
 #include "../Core/HttpClient.h"
+#include "../Core/MultipartRelatedReader.h"
+#include "../Core/MultipartRelatedWriter.h"
 #include "../Core/RestApi/RestApi.h"
 #include "../Core/Uuid.h"
 #include "../Core/OrthancException.h"
 #include "../Core/Compression/ZlibCompressor.h"
 #include "../Core/RestApi/RestApiHierarchy.h"
+#include "../Core/RestApi/JsonStreamWriter.h"
+#include "../Core/HttpServer/HttpOutput.h"
+#include "../Core/HttpServer/HttpUploadedFile.h"
+#include "../Core/Toolbox.h"
 
 using namespace Orthanc;
 
@@ -120,6 +126,34 @@ TEST(RestApi, ParseCookies)
   ASSERT_EQ("v", cookies["n"]);
 }
 
+TEST(RestApi, AcceptedQuality)
+{
+  float q;
+
+  ASSERT_FALSE(HttpHandler::LookupAcceptedQuality(q, "", "image/png"));
+  ASSERT_FLOAT_EQ(1.0f, q);
+
+  ASSERT_TRUE(HttpHandler::LookupAcceptedQuality(q, "image/jpeg", "image/jpeg"));
+  ASSERT_FLOAT_EQ(1.0f, q);
+  ASSERT_FALSE(HttpHandler::LookupAcceptedQuality(q, "image/jpeg", "image/png"));
+  ASSERT_FLOAT_EQ(0.0f, q);
+
+  const std::string accept = "text/html, Image/JPEG ; q=0.8, image/*;q=0.5, */*;q=0.1";
+  ASSERT_TRUE(HttpHandler::LookupAcceptedQuality(q, accept, "image/jpeg"));
+  ASSERT_FLOAT_EQ(0.8f, q);
+  ASSERT_FALSE(HttpHandler::LookupAcceptedQuality(q, accept, "image/png"));
+  ASSERT_FLOAT_EQ(0.5f, q);
+  ASSERT_FALSE(HttpHandler::LookupAcceptedQuality(q, accept, "application/json"));
+  ASSERT_FLOAT_EQ(0.1f, q);
+  ASSERT_TRUE(HttpHandler::LookupAcceptedQuality(q, accept, "text/html"));
+  ASSERT_FLOAT_EQ(1.0f, q);
+
+  ASSERT_TRUE(HttpHandler::LookupAcceptedQuality(q, "image/png;q=0, image/*", "image/png"));
+  ASSERT_FLOAT_EQ(0.0f, q);
+  ASSERT_FALSE(HttpHandler::LookupAcceptedQuality(q, "image/png;q=nope, text/*", "image/gif"));
+  ASSERT_FLOAT_EQ(0.0f, q);
+}
+
 TEST(RestApi, RestApiPath)
 {
   HttpHandler::Arguments args;
@@ -281,3 +315,362 @@ TEST(RestApi, RestApiHierarchy)
   ASSERT_TRUE(HandleGet(root, "/hello2/a/b"));
   ASSERT_EQ(testValue, 4);
 }
+
+
+
+namespace
+{
+  class NullHttpStream : public IHttpOutputStream
+  {
+  public:
+    virtual void OnHttpStatusReceived(HttpStatus status)
+    {
+    }
+
+    virtual void Send(bool isHeader, const void* buffer, size_t length)
+    {
+    }
+  };
+
+  class RecordingHttpHandler : public HttpHandler
+  {
+  public:
+    unsigned int count_;
+
+    RecordingHttpHandler() : count_(0)
+    {
+    }
+
+    virtual bool Handle(HttpOutput& output,
+                        HttpMethod method,
+                        const UriComponents& uri,
+                        const Arguments& headers,
+                        const Arguments& getArguments,
+                        const std::string& postData)
+    {
+      count_++;
+      return true;
+    }
+  };
+
+  std::string uploadedBody;
+
+  void UploadCallback(RestApiPostCall& call)
+  {
+    ASSERT_TRUE(call.HasPostBodyFile());
+    uploadedBody = call.GetPostBody();
+    call.GetOutput().AnswerBuffer("ok", "text/plain");
+  }
+
+  bool HandleUpload(const std::vector<HttpHandler*>& handlers,
+                    const std::string& path,
+                    const HttpUploadedFile& body)
+  {
+    NullHttpStream stream;
+    HttpOutput output(stream, false);
+
+    UriComponents uri;
+    Toolbox::SplitUriComponents(uri, path);
+
+    HttpHandler::Arguments headers, getArguments;
+
+    // Same loop as in the HTTP server
+    for (size_t i = 0; i < handlers.size(); i++)
+    {
+      if (handlers[i]->HandleUploadedFile(output, HttpMethod_Post, uri, headers, getArguments, body))
+      {
+        return true;
+      }
+    }
+
+    return false;
+  }
+}
+
+
+TEST(RestApi, UploadedFileHandlers)
+{
+  HttpUploadedFile body("UnitTestsResults");
+  body.Append("Hello", 5);
+  body.Close();
+
+  RestApi api;
+  api.Register("/upload", UploadCallback);
+
+  // The handlers that do not serve uploaded files must neither
+  // accept them, nor read them
+  RecordingHttpHandler first, last;
+
+  std::vector<HttpHandler*> handlers;
+  handlers.push_back(&first);
+  handlers.push_back(&api);
+  handlers.push_back(&last);
+
+  uploadedBody.clear();
+  ASSERT_TRUE(HandleUpload(handlers, "/upload", body));
+  ASSERT_EQ("Hello", uploadedBody);
+  ASSERT_EQ(0u, first.count_);
+  ASSERT_EQ(0u, last.count_);
+
+  uploadedBody.clear();
+  ASSERT_FALSE(HandleUpload(handlers, "/nope", body));
+  ASSERT_TRUE(uploadedBody.empty());
+  ASSERT_EQ(0u, first.count_);
+  ASSERT_EQ(0u, last.count_);
+}
+
+
+
+namespace
+{
+  class StringJsonStream : public JsonStreamWriter::IOutputStream
+  {
+  public:
+    std::vector<std::string> chunks_;
+    bool closed_;
+
+    StringJsonStream() : closed_(false)
+    {
+    }
+
+    virtual void Write(const std::string& chunk)
+    {
+      chunks_.push_back(chunk);
+    }
+
+    virtual void Close()
+    {
+      closed_ = true;
+    }
+
+    std::string GetContent() const
+    {
+      std::string s;
+      for (size_t i = 0; i < chunks_.size(); i++)
+      {
+        s += chunks_[i];
+      }
+      return s;
+    }
+  };
+}
+
+
+TEST(JsonStreamWriter, Compact)
+{
+  Json::Value v = Json::objectValue;
+  v["hello"] = "world \"quoted\"";
+  v["int"] = -42;
+  v["uint"] = 42u;
+  v["double"] = 1.5;
+  v["bool"] = true;
+  v["null"] = Json::nullValue;
+  v["array"] = Json::arrayValue;
+  v["array"].append(1);
+  v["array"].append("a");
+  v["array"].append(Json::objectValue);
+  v["empty"] = Json::arrayValue;
+
+  StringJsonStream stream;
+  JsonStreamWriter writer(stream, false);
+  writer.WriteValue(v);
+  writer.Close();
+
+  ASSERT_TRUE(stream.closed_);
+
+  // Same output as "Json::FastWriter", without its trailing newline
+  std::string expected = Json::FastWriter().write(v);
+  ASSERT_EQ(expected.substr(0, expected.size() - 1), stream.GetContent());
+
+  Json::Value parsed;
+  ASSERT_TRUE(Json::Reader().parse(stream.GetContent(), parsed));
+  ASSERT_EQ("world \"quoted\"", parsed["hello"].asString());
+  ASSERT_EQ(-42, parsed["int"].asInt());
+  ASSERT_EQ(3u, parsed["array"].size());
+}
+
+
+TEST(JsonStreamWriter, Incremental)
+{
+  StringJsonStream stream;
+  JsonStreamWriter writer(stream, true);
+  writer.SetChunkSize(16);
+
+  writer.StartObject();
+  writer.WriteKey("items");
+  writer.StartArray();
+  for (int i = 0; i < 100; i++)
+  {
+    writer.WriteString("item " + boost::lexical_cast<std::string>(i));
+  }
+  writer.EndArray();
+  writer.WriteKey("count");
+  writer.WriteInteger(100);
+  writer.EndObject();
+  writer.Close();
+
+  ASSERT_TRUE(stream.closed_);
+  ASSERT_LT(1u, stream.chunks_.size());
+
+  Json::Value parsed;
+  ASSERT_TRUE(Json::Reader().parse(stream.GetContent(), parsed));
+  ASSERT_EQ(100, parsed["count"].asInt());
+  ASSERT_EQ(100u, parsed["items"].size());
+  ASSERT_EQ("item 99", parsed["items"][99].asString());
+}
+
+
+TEST(JsonStreamWriter, Errors)
+{
+  {
+    StringJsonStream stream;
+    JsonStreamWriter writer(stream, false);
+    ASSERT_THROW(writer.EndArray(), OrthancException);
+    ASSERT_THROW(writer.WriteKey("a"), OrthancException);
+    writer.StartObject();
+    ASSERT_THROW(writer.WriteString("a"), OrthancException);
+    ASSERT_THROW(writer.EndArray(), OrthancException);
+    writer.WriteKey("a");
+    ASSERT_THROW(writer.WriteKey("b"), OrthancException);
+    ASSERT_THROW(writer.EndObject(), OrthancException);
+    writer.WriteNull();
+    writer.EndObject();
+    ASSERT_THROW(writer.WriteNull(), OrthancException);
+    writer.Close();
+    ASSERT_EQ("{\"a\":null}", stream.GetContent());
+  }
+
+  {
+    StringJsonStream stream;
+    JsonStreamWriter writer(stream, false);
+    writer.StartArray();
+    ASSERT_THROW(writer.Close(), OrthancException);
+  }
+}
+
+
+TEST(MultipartRelated, ContentType)
+{
+  std::string boundary;
+  ASSERT_FALSE(MultipartRelatedReader::ParseContentType(boundary, "application/dicom"));
+  ASSERT_FALSE(MultipartRelatedReader::ParseContentType(boundary, "multipart/form-data; boundary=abc"));
+  ASSERT_THROW(MultipartRelatedReader::ParseContentType(boundary, "multipart/related"), OrthancException);
+
+  ASSERT_TRUE(MultipartRelatedReader::ParseContentType(boundary, "multipart/related; boundary=abc"));
+  ASSERT_EQ("abc", boundary);
+  ASSERT_TRUE(MultipartRelatedReader::ParseContentType(boundary, " Multipart/Related ; type=\"application/dicom\"; Boundary=\"a b\" "));
+  ASSERT_EQ("a b", boundary);
+
+  MultipartRelatedWriter writer("application/dicom");
+  ASSERT_TRUE(MultipartRelatedReader::ParseContentType(boundary, writer.GetContentType()));
+  ASSERT_EQ(writer.GetBoundary(), boundary);
+}
+
+
+TEST(MultipartRelated, Basic)
+{
+  const std::string binary("a\0b\r\n--c\r\n", 10);
+
+  MultipartRelatedWriter writer("application/dicom");
+  writer.AddPart("hello");
+  writer.AddPart("");
+  writer.AddPart(binary);
+  ASSERT_EQ(3u, writer.GetPartsCount());
+  ASSERT_THROW(writer.AddPart("--" + writer.GetBoundary()), OrthancException);
+
+  std::string body;
+  writer.Finish(body);
+  ASSERT_EQ(0u, writer.GetPartsCount());
+  ASSERT_EQ(0u, writer.GetSize());
+
+  MultipartRelatedReader reader(body, writer.GetBoundary());
+  ASSERT_EQ(3u, reader.GetPartsCount());
+  ASSERT_EQ("application/dicom", reader.GetContentType(0));
+  ASSERT_EQ(5u, reader.GetSize(0));
+  ASSERT_EQ(0u, reader.GetSize(1));
+  ASSERT_TRUE(reader.GetData(1) == NULL);
+
+  std::string s;
+  reader.GetPart(s, 0);  ASSERT_EQ("hello", s);
+  reader.GetPart(s, 1);  ASSERT_TRUE(s.empty());
+  reader.GetPart(s, 2);  ASSERT_EQ(binary, s);
+  ASSERT_THROW(reader.GetPart(s, 3), OrthancException);
+}
+
+
+TEST(MultipartRelated, Parse)
+{
+  // Preamble, parts without headers, transport padding and epilogue
+  const std::string body = 
+    "preamble\r\n--xyz\r\n\r\nfirst\r\n--xyz  \r\nContent-Type: text/plain\r\n\r\n"
+    "second\r\n--xyz--\r\nepilogue";
+
+  MultipartRelatedReader reader(body, "xyz");
+  ASSERT_EQ(2u, reader.GetPartsCount());
+
+  std::string s;
+  reader.GetPart(s, 0);  ASSERT_EQ("first", s);
+  ASSERT_EQ("", reader.GetContentType(0));
+  reader.GetPart(s, 1);  ASSERT_EQ("second", s);
+  ASSERT_EQ("text/plain", reader.GetContentType(1));
+
+  ASSERT_THROW(MultipartRelatedReader r(body, "nope"), OrthancException);
+  ASSERT_THROW(MultipartRelatedReader r("--xyz\r\n\r\nTruncated", "xyz"), OrthancException);
+  ASSERT_THROW(MultipartRelatedReader r("--xyz", "xyz"), OrthancException);
+}
+
+
+namespace
+{
+  class StringHttpStream : public IHttpOutputStream
+  {
+  public:
+    std::string header_;
+    std::string body_;
+
+    virtual void OnHttpStatusReceived(HttpStatus status)
+    {
+    }
+
+    virtual void Send(bool isHeader, const void* buffer, size_t length)
+    {
+      (isHeader ? header_ : body_).append(reinterpret_cast<const char*>(buffer), length);
+    }
+  };
+}
+
+
+TEST(RestApiOutput, LargeJsonHttp10)
+{
+  // A JSON answer that spans several chunks of the JSON writer
+  Json::Value v = Json::arrayValue;
+  for (unsigned int i = 0; i < 20000; i++)
+  {
+    v.append("item " + boost::lexical_cast<std::string>(i));
+  }
+
+  {
+    StringHttpStream stream;
+    HttpOutput http(stream, false);
+    RestApiOutput output(http);
+    output.AnswerJson(v);
+    ASSERT_NE(std::string::npos, stream.header_.find("Transfer-Encoding: chunked"));
+  }
+
+  {
+    // HTTP/1.0: The answer is buffered, and sent with its length
+    StringHttpStream stream;
+    HttpOutput http(stream, false, false);
+    RestApiOutput output(http);
+    output.AnswerJson(v);
+    ASSERT_FALSE(http.IsCloseDelimited());
+    ASSERT_EQ(std::string::npos, stream.header_.find("Transfer-Encoding"));
+    ASSERT_NE(std::string::npos, stream.header_.find("Content-Length: " + 
+                                                   boost::lexical_cast<std::string>(stream.body_.size())));
+
+    Json::Value parsed;
+    ASSERT_TRUE(Json::Reader().parse(stream.body_, parsed));
+    ASSERT_EQ(20000u, parsed.size());
+    ASSERT_EQ("item 19999", parsed[19999].asString());
+  }
+}
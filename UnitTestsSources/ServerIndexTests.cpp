@@ -35,7 +35,11 @@
 
 #include "../OrthancServer/DatabaseWrapper.h"
 #include "../OrthancServer/ServerContext.h"
+#include "../OrthancServer/InstancesIngester.h"
+#include "../OrthancServer/InstancesPrefetcher.h"
+#include "../OrthancServer/ParsedDicomFile.h"
 #include "../OrthancServer/ServerIndex.h"
+#include "../OrthancServer/ResourceFinder.h"
 #include "../Core/Uuid.h"
 #include "../Core/DicomFormat/DicomNullValue.h"
 #include "../Core/FileStorage/FilesystemStorage.h"
@@ -190,6 +194,23 @@ TEST_P(DatabaseWrapperTest, Simple)
     ASSERT_EQ(3u, t.size());
   }
 
+  {
+    // Batched enumeration of the resources
+    std::list<std::string> t;
+    int64_t last;
+    index_->GetAllPublicIds(t, last, ResourceType_Instance, 0, 2);
+    ASSERT_EQ(2u, t.size());
+    ASSERT_EQ("d", t.front());
+    ASSERT_EQ("e", t.back());
+
+    index_->GetAllPublicIds(t, last, ResourceType_Instance, last, 2);
+    ASSERT_EQ(1u, t.size());
+    ASSERT_EQ("f", t.front());
+
+    index_->GetAllPublicIds(t, last, ResourceType_Instance, last, 2);
+    ASSERT_EQ(0u, t.size());
+  }
+
   index_->SetGlobalProperty(GlobalProperty_FlushSleep, "World");
 
   index_->AttachChild(a[0], a[1]);
@@ -319,7 +340,8 @@ TEST_P(DatabaseWrapperTest, Simple)
   CheckTableRecordCount(7, "Resources");
   CheckTableRecordCount(3, "AttachedFiles");
   CheckTableRecordCount(1, "Metadata");
-  CheckTableRecordCount(1, "MainDicomTags");
+  CheckTableRecordCount(0, "MainDicomTags");
+  CheckTableRecordCount(1, "SearchableTags");
 
   index_->DeleteResource(a[0]);
   ASSERT_EQ(5u, listener_->deletedResources_.size());
@@ -335,6 +357,7 @@ TEST_P(DatabaseWrapperTest, Simple)
   CheckTableRecordCount(0, "Metadata");
   CheckTableRecordCount(1, "AttachedFiles");
   CheckTableRecordCount(0, "MainDicomTags");
+  CheckTableRecordCount(0, "SearchableTags");
 
   index_->DeleteResource(a[5]);
   ASSERT_EQ(7u, listener_->deletedResources_.size());
@@ -623,6 +646,31 @@ TEST_P(DatabaseWrapperTest, LookupIdentifier)
   ASSERT_EQ(1u, s.size());
   ASSERT_TRUE(std::find(s.begin(), s.end(), a[1]) != s.end());
 
+  // Range lookups, as used for prefix matching
+  index_->SetMainDicomTag(a[0], DICOM_TAG_ACCESSION_NUMBER, "ABC001");
+  index_->SetMainDicomTag(a[1], DICOM_TAG_ACCESSION_NUMBER, "ABC002");
+  index_->SetMainDicomTag(a[2], DICOM_TAG_ACCESSION_NUMBER, "abc003");
+
+  index_->LookupIdentifierRange(s, DICOM_TAG_ACCESSION_NUMBER, "ABC", "ABC\xff");
+  ASSERT_EQ(2u, s.size());
+  ASSERT_TRUE(std::find(s.begin(), s.end(), a[0]) != s.end());
+  ASSERT_TRUE(std::find(s.begin(), s.end(), a[1]) != s.end());
+
+  index_->LookupIdentifierRange(s, DICOM_TAG_ACCESSION_NUMBER, "ABC002", "");
+  ASSERT_EQ(2u, s.size());  // Case-sensitive: "ABC002" < "abc003"
+  ASSERT_TRUE(std::find(s.begin(), s.end(), a[1]) != s.end());
+  ASSERT_TRUE(std::find(s.begin(), s.end(), a[2]) != s.end());
+
+  index_->LookupIdentifierRange(s, DICOM_TAG_ACCESSION_NUMBER, "", "ABC001");
+  ASSERT_EQ(1u, s.size());
+  ASSERT_EQ(a[0], s.front());
+
+  index_->LookupIdentifierRange(s, DICOM_TAG_STUDY_INSTANCE_UID, "0", "0");
+  ASSERT_EQ(2u, s.size());
+
+  ASSERT_THROW(index_->LookupIdentifierRange(s, DICOM_TAG_ACCESSION_NUMBER, "", ""), OrthancException);
+  ASSERT_THROW(index_->LookupIdentifierRange(s, DICOM_TAG_STUDY_DATE, "A", "B"), OrthancException);
+
 
   /*{
       std::list<std::string> s;
@@ -636,6 +684,451 @@ TEST_P(DatabaseWrapperTest, LookupIdentifier)
 
 
 
+TEST(ResourceFinder, Matches)
+{
+  // Exact match, case-insensitive
+  ASSERT_TRUE(ResourceFinder::Matches("Hello", "hello"));
+  ASSERT_FALSE(ResourceFinder::Matches("Hello", "hell"));
+
+  // Wildcards
+  ASSERT_TRUE(ResourceFinder::Matches("DOE^JOHN", "doe*"));
+  ASSERT_TRUE(ResourceFinder::Matches("DOE^JOHN", "D?E^*N"));
+  ASSERT_FALSE(ResourceFinder::Matches("DOE^JOHN", "JOHN*"));
+
+  // Ranges
+  ASSERT_TRUE(ResourceFinder::Matches("20140215", "20140101-20141231"));
+  ASSERT_TRUE(ResourceFinder::Matches("20140101", "20140101-20141231"));
+  ASSERT_FALSE(ResourceFinder::Matches("20150101", "20140101-20141231"));
+  ASSERT_TRUE(ResourceFinder::Matches("20150101", "20140101-"));
+  ASSERT_FALSE(ResourceFinder::Matches("20130101", "20140101-"));
+  ASSERT_TRUE(ResourceFinder::Matches("20130101", "-20140101"));
+  ASSERT_FALSE(ResourceFinder::Matches("20130101", "-"));
+
+  // Lists
+  ASSERT_TRUE(ResourceFinder::Matches("CT", "MR\\ct\\US"));
+  ASSERT_FALSE(ResourceFinder::Matches("CR", "MR\\CT\\US"));
+
+  // Case-sensitive matching, for the identifiers
+  ASSERT_TRUE(ResourceFinder::Matches("ABC1", "ABC1", true));
+  ASSERT_FALSE(ResourceFinder::Matches("ABC1", "abc1", true));
+  ASSERT_TRUE(ResourceFinder::Matches("ABC1", "ABC*", true));
+  ASSERT_FALSE(ResourceFinder::Matches("ABC1", "abc*", true));
+  ASSERT_TRUE(ResourceFinder::Matches("ABC1", "ABC0-ABC9", true));
+  ASSERT_FALSE(ResourceFinder::Matches("ABC1", "abc0-abc9", true));
+  ASSERT_TRUE(ResourceFinder::Matches("ABC1", "XYZ\\ABC1", true));
+  ASSERT_FALSE(ResourceFinder::Matches("ABC1", "xyz\\abc1", true));
+}
+
+
+TEST_P(DatabaseWrapperTest, LookupSearchableTag)
+{
+  int64_t a[] = {
+    index_->CreateResource("a", ResourceType_Study),   // 0
+    index_->CreateResource("b", ResourceType_Study),   // 1
+    index_->CreateResource("c", ResourceType_Study),   // 2
+    index_->CreateResource("d", ResourceType_Series)   // 3
+  };
+
+  index_->SetMainDicomTag(a[0], DICOM_TAG_STUDY_DATE, "20140101");
+  index_->SetMainDicomTag(a[1], DICOM_TAG_STUDY_DATE, "20140215");
+  index_->SetMainDicomTag(a[2], DICOM_TAG_STUDY_DATE, "20140320");
+  index_->SetMainDicomTag(a[2], DICOM_TAG_STUDY_DESCRIPTION, "Chest CT");
+  index_->SetMainDicomTag(a[3], DICOM_TAG_MODALITY, "CT");
+  index_->SetMainDicomTag(a[3], DICOM_TAG_SERIES_INSTANCE_UID, "0");
+
+  CheckTableRecordCount(5, "SearchableTags");
+  CheckTableRecordCount(1, "DicomIdentifiers");
+  CheckTableRecordCount(0, "MainDicomTags");
+
+  DicomMap m;
+  index_->GetMainDicomTags(m, a[2]);
+  ASSERT_TRUE(m.HasTag(DICOM_TAG_STUDY_DATE));
+  ASSERT_EQ("Chest CT", m.GetValue(DICOM_TAG_STUDY_DESCRIPTION).AsString());
+
+  std::list<int64_t> s;
+
+  index_->LookupSearchableTag(s, DICOM_TAG_STUDY_DATE, "20140215", "20140215");
+  ASSERT_EQ(1u, s.size());
+  ASSERT_EQ(a[1], s.front());
+
+  index_->LookupSearchableTag(s, DICOM_TAG_STUDY_DATE, "20140110", "20140320");
+  ASSERT_EQ(2u, s.size());
+  ASSERT_TRUE(std::find(s.begin(), s.end(), a[1]) != s.end());
+  ASSERT_TRUE(std::find(s.begin(), s.end(), a[2]) != s.end());
+
+  index_->LookupSearchableTag(s, DICOM_TAG_STUDY_DATE, "", "20140215");
+  ASSERT_EQ(2u, s.size());
+  ASSERT_TRUE(std::find(s.begin(), s.end(), a[0]) != s.end());
+  ASSERT_TRUE(std::find(s.begin(), s.end(), a[1]) != s.end());
+
+  index_->LookupSearchableTag(s, DICOM_TAG_STUDY_DATE, "20140301", "");
+  ASSERT_EQ(1u, s.size());
+  ASSERT_EQ(a[2], s.front());
+
+  // Case-insensitive prefix lookup
+  index_->LookupSearchableTag(s, DICOM_TAG_STUDY_DESCRIPTION, "chest", "chest\xff");
+  ASSERT_EQ(1u, s.size());
+  ASSERT_EQ(a[2], s.front());
+
+  index_->LookupSearchableTag(s, DICOM_TAG_MODALITY, "ct", "ct");
+  ASSERT_EQ(1u, s.size());
+  ASSERT_EQ(a[3], s.front());
+
+  index_->LookupSearchableTag(s, DICOM_TAG_MODALITY, "MR", "MR");
+  ASSERT_EQ(0u, s.size());
+
+  ASSERT_THROW(index_->LookupSearchableTag(s, DICOM_TAG_STUDY_DATE, "", ""), OrthancException);
+  ASSERT_THROW(index_->LookupSearchableTag(s, DICOM_TAG_PATIENT_ID, "a", "b"), OrthancException);
+
+  index_->DeleteResource(a[2]);
+  CheckTableRecordCount(3, "SearchableTags");
+}
+
+
+
+static void CheckStatistics(IDatabaseWrapper& index,
+                            int64_t id,
+                            uint64_t expectedSize,
+                            unsigned int expectedStudies,
+                            unsigned int expectedSeries,
+                            unsigned int expectedInstances)
+{
+  uint64_t compressedSize, uncompressedSize;
+  unsigned int countStudies, countSeries, countInstances;
+  ASSERT_TRUE(index.LookupStatistics(compressedSize, uncompressedSize, countStudies,
+                                     countSeries, countInstances, id));
+  ASSERT_EQ(expectedSize, compressedSize);
+  ASSERT_EQ(expectedSize, uncompressedSize);
+  ASSERT_EQ(expectedStudies, countStudies);
+  ASSERT_EQ(expectedSeries, countSeries);
+  ASSERT_EQ(expectedInstances, countInstances);
+}
+
+
+TEST_P(DatabaseWrapperTest, Statistics)
+{
+  int64_t patient = index_->CreateResource("patient", ResourceType_Patient);
+  int64_t study = index_->CreateResource("study", ResourceType_Study);
+  int64_t series1 = index_->CreateResource("series1", ResourceType_Series);
+  int64_t series2 = index_->CreateResource("series2", ResourceType_Series);
+  int64_t instances[4];
+
+  for (int i = 0; i < 4; i++)
+  {
+    std::string id = "instance" + boost::lexical_cast<std::string>(i);
+    instances[i] = index_->CreateResource(id, ResourceType_Instance);
+    index_->AddAttachment(instances[i], FileInfo(id, FileContentType_Dicom, 10 * (i + 1), "md5"));
+    CheckStatistics(*index_, instances[i], 10 * (i + 1), 0, 0, 1);
+  }
+
+  // Attaching the children in any order gives the same statistics
+  index_->AttachChild(series1, instances[0]);
+  index_->AttachChild(series1, instances[1]);
+  index_->AttachChild(study, series1);
+  index_->AttachChild(patient, study);
+  index_->AttachChild(series2, instances[2]);
+  index_->AttachChild(study, series2);
+  index_->AttachChild(series2, instances[3]);
+
+  CheckStatistics(*index_, patient, 100, 1, 2, 4);
+  CheckStatistics(*index_, study, 100, 1, 2, 4);
+  CheckStatistics(*index_, series1, 30, 0, 1, 2);
+  CheckStatistics(*index_, series2, 70, 0, 1, 2);
+
+  // Attachments of the higher levels are taken into account
+  index_->AddAttachment(study, FileInfo("study-attachment", FileContentType_Dicom, 1000, "md5"));
+  CheckStatistics(*index_, patient, 1100, 1, 2, 4);
+  CheckStatistics(*index_, study, 1100, 1, 2, 4);
+  CheckStatistics(*index_, series1, 30, 0, 1, 2);
+
+  index_->DeleteAttachment(instances[3], FileContentType_Dicom);
+  CheckStatistics(*index_, patient, 1060, 1, 2, 4);
+  CheckStatistics(*index_, series2, 30, 0, 1, 2);
+  CheckStatistics(*index_, instances[3], 0, 0, 0, 1);
+
+  index_->DeleteResource(instances[2]);
+  CheckStatistics(*index_, patient, 1030, 1, 2, 3);
+  CheckStatistics(*index_, series2, 0, 0, 1, 1);
+
+  index_->DeleteResource(series1);
+  CheckStatistics(*index_, patient, 1000, 1, 1, 1);
+  CheckStatistics(*index_, study, 1000, 1, 1, 1);
+
+  // Removing the last instance also removes its parents
+  index_->DeleteResource(instances[3]);
+  CheckTableRecordCount(0, "Resources");
+  CheckTableRecordCount(0, "ResourceStatistics");
+
+  {
+    // The ancestors that are left empty by a deletion are deleted as
+    // well, and must be removed from the statistics of the patient:
+    //
+    // patient -> { study1 -> { series1 -> { instance1 },
+    //                          series2 -> { instance2, instance3 } },
+    //              study2 -> { series3 -> { instance4 } } }
+    int64_t patient = index_->CreateResource("patient", ResourceType_Patient);
+    int64_t study1 = index_->CreateResource("study1", ResourceType_Study);
+    int64_t study2 = index_->CreateResource("study2", ResourceType_Study);
+    int64_t series1 = index_->CreateResource("series1", ResourceType_Series);
+    int64_t series2 = index_->CreateResource("series2", ResourceType_Series);
+    int64_t series3 = index_->CreateResource("series3", ResourceType_Series);
+    int64_t instances[4];
+
+    for (int i = 0; i < 4; i++)
+    {
+      std::string id = "instance" + boost::lexical_cast<std::string>(i + 1);
+      instances[i] = index_->CreateResource(id, ResourceType_Instance);
+      index_->AddAttachment(instances[i], FileInfo(id, FileContentType_Dicom, 10 * (i + 1), "md5"));
+    }
+
+    index_->AttachChild(patient, study1);
+    index_->AttachChild(patient, study2);
+    index_->AttachChild(study1, series1);
+    index_->AttachChild(study1, series2);
+    index_->AttachChild(study2, series3);
+    index_->AttachChild(series1, instances[0]);
+    index_->AttachChild(series2, instances[1]);
+    index_->AttachChild(series2, instances[2]);
+    index_->AttachChild(series3, instances[3]);
+
+    CheckStatistics(*index_, patient, 100, 2, 3, 4);
+    CheckStatistics(*index_, study1, 60, 1, 2, 3);
+
+    // Deleting the last instance of a series also deletes the series
+    index_->DeleteResource(instances[0]);
+    CheckTableRecordCount(8, "Resources");
+    CheckStatistics(*index_, patient, 90, 2, 2, 3);
+    CheckStatistics(*index_, study1, 50, 1, 1, 2);
+
+    // Deleting the last instance of a study also deletes the series
+    // and the study
+    index_->DeleteResource(instances[3]);
+    CheckTableRecordCount(5, "Resources");
+    CheckStatistics(*index_, patient, 50, 1, 1, 2);
+    CheckStatistics(*index_, study1, 50, 1, 1, 2);
+  }
+}
+
+
+TEST_P(DatabaseWrapperTest, ResourcesSummary)
+{
+  int64_t patient = index_->CreateResource("patient", ResourceType_Patient);
+  int64_t study = index_->CreateResource("study", ResourceType_Study);
+  int64_t series1 = index_->CreateResource("series1", ResourceType_Series);
+  int64_t series2 = index_->CreateResource("series2", ResourceType_Series);
+  int64_t instance1 = index_->CreateResource("instance1", ResourceType_Instance);
+  int64_t instance2 = index_->CreateResource("instance2", ResourceType_Instance);
+  int64_t instance3 = index_->CreateResource("instance3", ResourceType_Instance);
+
+  index_->AttachChild(patient, study);
+  index_->AttachChild(study, series1);
+  index_->AttachChild(study, series2);
+  index_->AttachChild(series1, instance1);
+  index_->AttachChild(series1, instance2);
+  index_->AttachChild(series2, instance3);
+
+  index_->SetMainDicomTag(study, DICOM_TAG_STUDY_DESCRIPTION, "Chest CT");
+  index_->SetMainDicomTag(study, DICOM_TAG_STUDY_DATE, "20140101");
+  index_->SetMainDicomTag(series1, DICOM_TAG_MODALITY, "CT");
+  index_->SetMainDicomTag(series2, DICOM_TAG_MODALITY, "MR");
+
+  std::list<ResourceSummary> s;
+  int64_t last;
+
+  index_->GetResourcesSummary(s, last, ResourceType_Patient, 0, 10);
+  ASSERT_EQ(1u, s.size());
+  ASSERT_EQ(patient, last);
+  ASSERT_EQ("patient", s.front().GetPublicId());
+  ASSERT_EQ("", s.front().GetParentPublicId());
+  ASSERT_EQ(1u, s.front().GetCountStudies());
+  ASSERT_EQ(2u, s.front().GetCountSeries());
+  ASSERT_EQ(3u, s.front().GetCountInstances());
+  ASSERT_TRUE(s.front().GetMainDicomTags().empty());
+
+  index_->GetResourcesSummary(s, last, ResourceType_Study, 0, 10);
+  ASSERT_EQ(1u, s.size());
+  ASSERT_EQ("patient", s.front().GetParentPublicId());
+  ASSERT_EQ(2u, s.front().GetMainDicomTags().size());
+  ASSERT_EQ("Chest CT", s.front().GetMainDicomTags().find(DICOM_TAG_STUDY_DESCRIPTION)->second);
+  ASSERT_EQ("20140101", s.front().GetMainDicomTags().find(DICOM_TAG_STUDY_DATE)->second);
+
+  // Batches of one series
+  index_->GetResourcesSummary(s, last, ResourceType_Series, 0, 1);
+  ASSERT_EQ(1u, s.size());
+  ASSERT_EQ(series1, last);
+  ASSERT_EQ("series1", s.front().GetPublicId());
+  ASSERT_EQ("study", s.front().GetParentPublicId());
+  ASSERT_EQ(2u, s.front().GetCountInstances());
+  ASSERT_EQ(1u, s.front().GetMainDicomTags().size());
+  ASSERT_EQ("CT", s.front().GetMainDicomTags().find(DICOM_TAG_MODALITY)->second);
+
+  index_->GetResourcesSummary(s, last, ResourceType_Series, last, 1);
+  ASSERT_EQ(1u, s.size());
+  ASSERT_EQ(series2, last);
+  ASSERT_EQ("series2", s.front().GetPublicId());
+  ASSERT_EQ(1u, s.front().GetCountInstances());
+  ASSERT_EQ("MR", s.front().GetMainDicomTags().find(DICOM_TAG_MODALITY)->second);
+
+  index_->GetResourcesSummary(s, last, ResourceType_Series, last, 1);
+  ASSERT_EQ(0u, s.size());
+  ASSERT_EQ(series2, last);
+
+  index_->GetResourcesSummary(s, last, ResourceType_Instance, instance1, 10);
+  ASSERT_EQ(2u, s.size());
+  ASSERT_EQ(instance3, last);
+  ASSERT_EQ("instance2", s.front().GetPublicId());
+  ASSERT_EQ("series1", s.front().GetParentPublicId());
+  ASSERT_EQ("series2", s.back().GetParentPublicId());
+}
+
+
+static void FindResources(std::set<std::string>& result,
+                          Json::Value& plan,
+                          ServerContext& context,
+                          ResourceType level,
+                          const DicomMap& query)
+{
+  ResourceFinder finder(context, level, query);
+  ASSERT_TRUE(finder.IsIndexed());
+
+  std::list<std::string> candidates;
+  finder.FindCandidates(candidates, &plan);
+
+  result.clear();
+  for (std::list<std::string>::const_iterator 
+         it = candidates.begin(); it != candidates.end(); ++it)
+  {
+    DicomMap tags;
+    if (finder.GetTags(tags, *it) &&
+        finder.Matches(tags))
+    {
+      result.insert(*it);
+    }
+  }
+}
+
+
+TEST(ResourceFinder, Lookup)
+{
+  DatabaseWrapper db;   // The SQLite DB is in memory
+  ServerContext context(db);
+  ServerIndex& index = context.GetIndex();
+
+  const char* names[] = { "DOE^JOHN", "DOE^JANE", "SMITH^JOHN" };
+  const char* dates[] = { "20140101", "20140615", "20141231" };
+  const char* modalities[] = { "CT", "MR", "CT" };
+
+  std::vector<std::string> studies, series;
+  for (int i = 0; i < 3; i++)
+  {
+    std::string id = boost::lexical_cast<std::string>(i);
+    DicomMap instance;
+    instance.SetValue(DICOM_TAG_PATIENT_ID, "patient." + id);
+    instance.SetValue(DICOM_TAG_PATIENT_NAME, names[i]);
+    instance.SetValue(DICOM_TAG_STUDY_INSTANCE_UID, "1.2.3." + id);
+    instance.SetValue(DICOM_TAG_ACCESSION_NUMBER, "ACC" + id);
+    instance.SetValue(DICOM_TAG_STUDY_DATE, dates[i]);
+    instance.SetValue(DICOM_TAG_SERIES_INSTANCE_UID, "1.2.3.4." + id);
+    instance.SetValue(DICOM_TAG_MODALITY, modalities[i]);
+    instance.SetValue(DICOM_TAG_SOP_INSTANCE_UID, "1.2.3.4.5." + id);
+
+    std::map<MetadataType, std::string> instanceMetadata;
+    ServerIndex::Attachments attachments;
+    ServerIndex::MetadataMap metadata;
+    ASSERT_EQ(StoreStatus_Success, index.Store(instanceMetadata, instance, attachments, "", metadata));
+
+    DicomInstanceHasher hasher(instance);
+    studies.push_back(hasher.HashStudy());
+    series.push_back(hasher.HashSeries());
+  }
+
+  std::set<std::string> r;
+  Json::Value plan;
+
+  {
+    // Wildcard on a searchable tag of the parent level
+    DicomMap query;
+    query.SetValue(DICOM_TAG_PATIENT_NAME, "doe*");
+    FindResources(r, plan, context, ResourceType_Study, query);
+    ASSERT_EQ(2u, r.size());
+    ASSERT_TRUE(r.find(studies[0]) != r.end());
+    ASSERT_TRUE(r.find(studies[1]) != r.end());
+    ASSERT_EQ("SearchableTagRange", plan[0]["Lookup"].asString());
+  }
+
+  {
+    // Range, combined with a prefix on an identifier
+    DicomMap query;
+    query.SetValue(DICOM_TAG_STUDY_DATE, "20140201-");
+    query.SetValue(DICOM_TAG_ACCESSION_NUMBER, "ACC?");
+    FindResources(r, plan, context, ResourceType_Study, query);
+    ASSERT_EQ(2u, r.size());
+    ASSERT_TRUE(r.find(studies[1]) != r.end());
+    ASSERT_TRUE(r.find(studies[2]) != r.end());
+    ASSERT_EQ("IdentifierRange", plan[0]["Lookup"].asString());
+    ASSERT_EQ("SearchableTagRange", plan[1]["Lookup"].asString());
+  }
+
+  {
+    // Exact identifier
+    DicomMap query;
+    query.SetValue(DICOM_TAG_STUDY_INSTANCE_UID, "1.2.3.2");
+    FindResources(r, plan, context, ResourceType_Study, query);
+    ASSERT_EQ(1u, r.size());
+    ASSERT_TRUE(r.find(studies[2]) != r.end());
+    ASSERT_EQ("ExactIdentifier", plan[0]["Lookup"].asString());
+  }
+
+  {
+    // List of values
+    DicomMap query;
+    query.SetValue(DICOM_TAG_MODALITY, "US\\CT");
+    FindResources(r, plan, context, ResourceType_Series, query);
+    ASSERT_EQ(2u, r.size());
+    ASSERT_TRUE(r.find(series[0]) != r.end());
+    ASSERT_TRUE(r.find(series[2]) != r.end());
+  }
+
+  {
+    // No constraint: All the resources
+    DicomMap query;
+    FindResources(r, plan, context, ResourceType_Series, query);
+    ASSERT_EQ(3u, r.size());
+  }
+
+  {
+    // The constraint on the patient name is refined after the lookup
+    DicomMap query;
+    query.SetValue(DICOM_TAG_PATIENT_NAME, "*JOHN");
+    query.SetValue(DICOM_TAG_STUDY_DATE, "-20140615");
+    FindResources(r, plan, context, ResourceType_Study, query);
+    ASSERT_EQ(1u, r.size());
+    ASSERT_TRUE(r.find(studies[0]) != r.end());
+    ASSERT_EQ("NotIndexed", plan[0]["Lookup"].asString());
+  }
+
+  {
+    // The identifiers are case-sensitive, whether the lookup is
+    // indexed or not
+    DicomMap query;
+    query.SetValue(DICOM_TAG_ACCESSION_NUMBER, "acc*");
+    FindResources(r, plan, context, ResourceType_Study, query);
+    ASSERT_EQ(0u, r.size());
+    ASSERT_EQ("IdentifierRange", plan[0]["Lookup"].asString());
+
+    query.SetValue(DICOM_TAG_ACCESSION_NUMBER, "*cc1");
+    FindResources(r, plan, context, ResourceType_Study, query);
+    ASSERT_EQ(0u, r.size());
+    ASSERT_EQ("NotIndexed", plan[0]["Lookup"].asString());
+
+    query.SetValue(DICOM_TAG_ACCESSION_NUMBER, "*CC1");
+    FindResources(r, plan, context, ResourceType_Study, query);
+    ASSERT_EQ(1u, r.size());
+    ASSERT_TRUE(r.find(studies[1]) != r.end());
+  }
+}
+
+
 TEST(ServerIndex, AttachmentRecycling)
 {
   const std::string path = "UnitTestsStorage";
@@ -696,3 +1189,517 @@ TEST(ServerIndex, AttachmentRecycling)
   // Because the DB is in memory, the SQLite index must not have been created
   ASSERT_THROW(Toolbox::GetFileSize(path + "/index"), OrthancException);  
 }
+
+
+
+namespace
+{
+  class ConcurrencyContext
+  {
+  private:
+    boost::mutex mutex_;
+    bool done_;
+
+  public:
+    ServerIndex* index_;
+    std::vector<std::string> patients_;
+
+    ConcurrencyContext() : done_(false), index_(NULL)
+    {
+    }
+
+    bool IsDone()
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      return done_;
+    }
+
+    void SetDone(bool done)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      done_ = done;
+    }
+  };
+}
+
+
+static void StoreInstance(ServerIndex& index,
+                          const std::string& patient,
+                          const std::string& instance)
+{
+  DicomMap dicom;
+  dicom.SetValue(DICOM_TAG_PATIENT_ID, "patient-" + patient);
+  dicom.SetValue(DICOM_TAG_STUDY_INSTANCE_UID, "study-" + patient);
+  dicom.SetValue(DICOM_TAG_SERIES_INSTANCE_UID, "series-" + patient);
+  dicom.SetValue(DICOM_TAG_SOP_INSTANCE_UID, "instance-" + instance);
+
+  std::map<MetadataType, std::string> instanceMetadata;
+  ServerIndex::Attachments attachments;
+  ServerIndex::MetadataMap metadata;
+  ASSERT_EQ(StoreStatus_Success, index.Store(instanceMetadata, dicom, attachments, "", metadata));
+}
+
+
+static void ConcurrentWriter(ConcurrencyContext* context,
+                             unsigned int* count)
+{
+  while (!context->IsDone())
+  {
+    StoreInstance(*context->index_, "writer", Toolbox::GenerateUuid());
+    (*count)++;
+  }
+}
+
+
+static void ConcurrentReader(ConcurrencyContext* context,
+                             unsigned int seed,
+                             unsigned int* count)
+{
+  while (!context->IsDone())
+  {
+    const std::string& patient = context->patients_[(seed++) % context->patients_.size()];
+
+    Json::Value resource, statistics;
+    ASSERT_TRUE(context->index_->LookupResource(resource, patient, ResourceType_Patient));
+    context->index_->GetStatistics(statistics, patient);
+    ASSERT_EQ(1u, resource["Studies"].size());
+
+    std::list<std::string> instances;
+    context->index_->GetChildInstances(instances, patient);
+    ASSERT_EQ(statistics["CountInstances"].asUInt(), instances.size());
+
+    (*count)++;
+  }
+}
+
+
+TEST(DatabaseWrapper, ReadOnlyConnections)
+{
+  const std::string path = "UnitTestsResults/ReadOnlyConnections";
+  Toolbox::RemoveFile(path);
+  Toolbox::RemoveFile(path + "-wal");
+  Toolbox::RemoveFile(path + "-shm");
+
+  {
+    // The file is locked in exclusive mode
+    DatabaseWrapper db(path);
+    ASSERT_TRUE(db.OpenReadOnlyConnection() == NULL);
+  }
+
+  ServerIndexListener listener;
+  DatabaseWrapper db(path, true);
+  db.SetListener(listener);
+  db.SetGlobalProperty(GlobalProperty_FlushSleep, "World");
+
+  std::auto_ptr<IDatabaseWrapper> reader(db.OpenReadOnlyConnection());
+  ASSERT_TRUE(reader.get() != NULL);
+
+  std::string s;
+  ASSERT_TRUE(reader->LookupGlobalProperty(s, GlobalProperty_FlushSleep));
+  ASSERT_EQ("World", s);
+  ASSERT_TRUE(reader->LookupGlobalProperty(s, GlobalProperty_DatabaseSchemaVersion));
+  ASSERT_EQ("6", s);
+
+  // A read-only connection refuses a schema that differs from the
+  // one of its parent
+  db.SetGlobalProperty(GlobalProperty_DatabaseSchemaVersion, "5");
+  ASSERT_THROW(db.OpenReadOnlyConnection(), OrthancException);
+  db.SetGlobalProperty(GlobalProperty_DatabaseSchemaVersion, "6");
+  delete db.OpenReadOnlyConnection();
+}
+
+
+TEST(ServerIndex, DISABLED_ConcurrentReadersBenchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests
+  // --gtest_filter=ServerIndex.DISABLED_ConcurrentReadersBenchmark"
+  // to measure the throughput of the read-only operations on the
+  // index, while one writer ingests new instances
+  const std::string path = "UnitTestsResults/ConcurrentReaders";
+  Toolbox::RemoveFile(path);
+  Toolbox::RemoveFile(path + "-wal");
+  Toolbox::RemoveFile(path + "-shm");
+
+  DatabaseWrapper db(path, true);
+  ServerContext context(db);
+  ServerIndex& index = context.GetIndex();
+
+  ConcurrencyContext shared;
+  shared.index_ = &index;
+
+  unsigned int countInstances = 0;
+  for (unsigned int i = 0; i < 20; i++)
+  {
+    std::string patient = boost::lexical_cast<std::string>(i);
+    for (unsigned int j = 0; j < 20; j++)
+    {
+      StoreInstance(index, patient, patient + "-" + boost::lexical_cast<std::string>(j));
+      countInstances++;
+    }
+
+    shared.patients_.push_back(DicomInstanceHasher("patient-" + patient, "study-" + patient,
+                                                   "series-" + patient, "instance-" + patient + "-0").HashPatient());
+  }
+
+  const unsigned int duration = 500;  // In milliseconds
+
+  for (unsigned int countThreads = 1; countThreads <= 8; countThreads *= 2)
+  {
+    shared.SetDone(false);
+
+    unsigned int writes = 0;
+    std::vector<unsigned int> reads(countThreads, 0);
+
+    boost::thread writer(ConcurrentWriter, &shared, &writes);
+
+    std::vector<boost::thread*> readers(countThreads);
+    for (unsigned int i = 0; i < countThreads; i++)
+    {
+      readers[i] = new boost::thread(ConcurrentReader, &shared, i, &reads[i]);
+    }
+
+    boost::this_thread::sleep(boost::posix_time::milliseconds(duration));
+    shared.SetDone(true);
+
+    writer.join();
+
+    unsigned int totalReads = 0;
+    for (unsigned int i = 0; i < countThreads; i++)
+    {
+      readers[i]->join();
+      delete readers[i];
+      totalReads += reads[i];
+    }
+
+    countInstances += writes;
+
+    LOG(WARNING) << "Index benchmark with " << countThreads << " reader thread(s): "
+                 << (totalReads * 1000 / duration) << " reads/s, "
+                 << (writes * 1000 / duration) << " writes/s";
+
+    ASSERT_LT(0u, totalReads);
+  }
+
+  Json::Value statistics;
+  index.ComputeStatistics(statistics);
+  ASSERT_EQ(countInstances, statistics["CountInstances"].asUInt());
+}
+
+
+
+namespace
+{
+  struct IngestContext
+  {
+    ServerIndex* index_;
+    unsigned int countInstances_;
+    unsigned int countThreads_;
+  };
+}
+
+
+static void IngestThread(IngestContext* context,
+                         unsigned int thread)
+{
+  for (unsigned int i = thread; i < context->countInstances_; i += context->countThreads_)
+  {
+    std::string patient = boost::lexical_cast<std::string>(i / 100);
+    StoreInstance(*context->index_, patient, boost::lexical_cast<std::string>(i));
+  }
+}
+
+
+static double IngestConcurrently(ServerIndex& index,
+                                 unsigned int countInstances,
+                                 unsigned int countThreads)
+{
+  // Returns the elapsed time, in seconds
+  IngestContext ingest;
+  ingest.index_ = &index;
+  ingest.countInstances_ = countInstances;
+  ingest.countThreads_ = countThreads;
+
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::local_time();
+
+  std::vector<boost::thread*> threads(countThreads);
+  for (unsigned int i = 0; i < countThreads; i++)
+  {
+    threads[i] = new boost::thread(IngestThread, &ingest, i);
+  }
+
+  for (unsigned int i = 0; i < countThreads; i++)
+  {
+    threads[i]->join();
+    delete threads[i];
+  }
+
+  return static_cast<double>
+    ((boost::posix_time::microsec_clock::local_time() - start).total_milliseconds()) / 1000.0;
+}
+
+
+TEST(ServerIndex, GroupCommit)
+{
+  const unsigned int countInstances = 300;
+  const unsigned int groupCommitSizes[] = { 1, 64 };
+
+  for (unsigned int k = 0; k < 2; k++)
+  {
+    const unsigned int groupCommitSize = groupCommitSizes[k];
+
+    DatabaseWrapper db;   // The SQLite DB is in memory
+    ServerContext context(db);
+    ServerIndex& index = context.GetIndex();
+    index.SetGroupCommit(groupCommitSize, 5);
+
+    IngestConcurrently(index, countInstances, 4);
+
+    Json::Value statistics;
+    index.ComputeStatistics(statistics);
+    ASSERT_EQ(countInstances, statistics["CountInstances"].asUInt());
+    ASSERT_EQ(countInstances / 100, statistics["CountPatients"].asUInt());
+
+    uint64_t transactions, instances;
+    index.GetGroupCommitStatistics(transactions, instances);
+    ASSERT_EQ(countInstances, instances);
+
+    if (groupCommitSize == 1)
+    {
+      ASSERT_EQ(countInstances, transactions);
+    }
+    else
+    {
+      // The concurrent writers have shared some of the transactions
+      ASSERT_LT(0u, transactions);
+      ASSERT_GT(countInstances, transactions);
+    }
+
+    // Storing again an instance of the batch is detected
+    DicomMap dicom;
+    dicom.SetValue(DICOM_TAG_PATIENT_ID, "patient-0");
+    dicom.SetValue(DICOM_TAG_STUDY_INSTANCE_UID, "study-0");
+    dicom.SetValue(DICOM_TAG_SERIES_INSTANCE_UID, "series-0");
+    dicom.SetValue(DICOM_TAG_SOP_INSTANCE_UID, "instance-0");
+
+    std::map<MetadataType, std::string> instanceMetadata;
+    ServerIndex::Attachments attachments;
+    ServerIndex::MetadataMap metadata;
+    ASSERT_EQ(StoreStatus_AlreadyStored, index.Store(instanceMetadata, dicom, attachments, "", metadata));
+    ASSERT_EQ(2u, instanceMetadata.size());
+
+    index.GetGroupCommitStatistics(transactions, instances);
+    ASSERT_EQ(countInstances, instances);
+  }
+}
+
+
+TEST(ServerIndex, DISABLED_GroupCommitBenchmark)
+{
+  // Run with "--gtest_also_run_disabled_tests
+  // --gtest_filter=ServerIndex.DISABLED_GroupCommitBenchmark" to
+  // compare the throughput of single-commit vs. group-commit on the
+  // ingest of synthetic instances by concurrent writers
+  const std::string path = "UnitTestsResults/GroupCommit";
+  const unsigned int countInstances = 10000;
+  const unsigned int groupCommitSizes[] = { 1, 64 };
+
+  for (unsigned int k = 0; k < 2; k++)
+  {
+    const unsigned int groupCommitSize = groupCommitSizes[k];
+
+    Toolbox::RemoveFile(path);
+    Toolbox::RemoveFile(path + "-wal");
+    Toolbox::RemoveFile(path + "-shm");
+
+    DatabaseWrapper db(path, true);
+    ServerContext context(db);
+    ServerIndex& index = context.GetIndex();
+    index.SetGroupCommit(groupCommitSize, 0);
+
+    double elapsed = IngestConcurrently(index, countInstances, 8);
+
+    LOG(WARNING) << "Ingest of " << countInstances << " instances with group commit of size "
+                 << groupCommitSize << ": " << elapsed << "s ("
+                 << static_cast<unsigned int>(static_cast<double>(countInstances) / elapsed)
+                 << " instances/s)";
+
+    Json::Value statistics;
+    index.ComputeStatistics(statistics);
+    ASSERT_EQ(countInstances, statistics["CountInstances"].asUInt());
+  }
+}
+
+
+TEST(ServerIndex, LookupStoredInstance)
+{
+  DatabaseWrapper db;   // The SQLite DB is in memory
+  ServerContext context(db);
+  ServerIndex& index = context.GetIndex();
+
+  DicomMap dicom;
+  dicom.SetValue(DICOM_TAG_PATIENT_ID, "patient");
+  dicom.SetValue(DICOM_TAG_STUDY_INSTANCE_UID, "study");
+  dicom.SetValue(DICOM_TAG_SERIES_INSTANCE_UID, "series");
+  dicom.SetValue(DICOM_TAG_SOP_INSTANCE_UID, "instance");
+
+  DicomInstanceHasher hasher(dicom);
+
+  std::map<MetadataType, std::string> instanceMetadata, storedMetadata;
+  instanceMetadata[MetadataType_Instance_RemoteAet] = "nope";
+  ASSERT_FALSE(index.LookupStoredInstance(instanceMetadata, hasher.HashInstance()));
+  ASSERT_TRUE(instanceMetadata.empty());
+
+  ServerIndex::Attachments attachments;
+  ServerIndex::MetadataMap metadata;
+  ASSERT_EQ(StoreStatus_Success, index.Store(storedMetadata, dicom, attachments, "AET", metadata));
+
+  ASSERT_TRUE(index.LookupStoredInstance(instanceMetadata, hasher.HashInstance()));
+  ASSERT_EQ(storedMetadata, instanceMetadata);
+  ASSERT_EQ("AET", instanceMetadata[MetadataType_Instance_RemoteAet]);
+
+  // Only instances are considered
+  ASSERT_FALSE(index.LookupStoredInstance(instanceMetadata, hasher.HashSeries()));
+  ASSERT_FALSE(index.LookupStoredInstance(instanceMetadata, hasher.HashPatient()));
+}
+
+
+TEST(ServerIndex, InstancesPrefetcher)
+{
+  const std::string path = "UnitTestsStorage";
+
+  Toolbox::RemoveFile(path + "/index");
+  FilesystemStorage storage(path);
+  DatabaseWrapper db;   // The SQLite DB is in memory
+  ServerContext context(db);
+  context.SetStorageArea(storage);
+  ServerIndex& index = context.GetIndex();
+
+  std::vector<std::string> instances;
+  for (int i = 0; i < 50; i++)
+  {
+    std::string id = boost::lexical_cast<std::string>(i);
+    StoreInstance(index, "prefetch", id);
+
+    DicomMap dicom;
+    dicom.SetValue(DICOM_TAG_PATIENT_ID, "patient-prefetch");
+    dicom.SetValue(DICOM_TAG_STUDY_INSTANCE_UID, "study-prefetch");
+    dicom.SetValue(DICOM_TAG_SERIES_INSTANCE_UID, "series-prefetch");
+    dicom.SetValue(DICOM_TAG_SOP_INSTANCE_UID, "instance-" + id);
+    instances.push_back(DicomInstanceHasher(dicom).HashInstance());
+
+    std::string content = "dicom-" + id;
+    std::string uuid = Toolbox::GenerateUuid();
+    storage.Create(uuid, content.c_str(), content.size(), FileContentType_Dicom);
+    index.AddAttachment(FileInfo(uuid, FileContentType_Dicom, content.size(), "md5"), instances.back());
+  }
+
+  for (unsigned int threads = 0; threads <= 4; threads++)
+  {
+    InstancesPrefetcher prefetcher(context, instances, threads, 3);
+    ASSERT_EQ(50u, prefetcher.GetSize());
+
+    std::string dicom;
+    for (int i = 0; i < 50; i++)
+    {
+      ASSERT_TRUE(prefetcher.ReadNext(dicom));
+      ASSERT_EQ("dicom-" + boost::lexical_cast<std::string>(i), dicom);
+    }
+
+    ASSERT_FALSE(prefetcher.ReadNext(dicom));
+  }
+
+  // An error is reported when the consumer reaches the faulty instance
+  instances[10] = "nope";
+
+  for (unsigned int threads = 0; threads <= 4; threads++)
+  {
+    InstancesPrefetcher prefetcher(context, instances, threads, 3);
+
+    std::string dicom;
+    for (int i = 0; i < 10; i++)
+    {
+      ASSERT_TRUE(prefetcher.ReadNext(dicom));
+    }
+
+    ASSERT_THROW(prefetcher.ReadNext(dicom), OrthancException);
+  }
+
+  // The prefetcher can be destroyed before all the instances are read
+  InstancesPrefetcher prefetcher(context, instances, 4, 3);
+}
+
+
+TEST(ServerIndex, InstancesIngester)
+{
+  const std::string path = "UnitTestsStorage";
+
+  std::vector<std::string> instances;
+  for (int i = 0; i < 20; i++)
+  {
+    ParsedDicomFile f;
+    f.Replace(DICOM_TAG_PATIENT_ID, "patient-ingest");
+    f.Replace(DICOM_TAG_STUDY_INSTANCE_UID, "1.2.3");
+    f.Replace(DICOM_TAG_SERIES_INSTANCE_UID, "1.2.3.4");
+    f.Replace(DICOM_TAG_SOP_INSTANCE_UID, "1.2.3.4." + boost::lexical_cast<std::string>(i));
+
+    instances.push_back("");
+    f.SaveToMemoryBuffer(instances.back());
+  }
+
+  for (unsigned int threads = 0; threads <= 4; threads += 4)
+  {
+    Toolbox::RemoveFile(path + "/index");
+    FilesystemStorage storage(path);
+    DatabaseWrapper db;   // The SQLite DB is in memory
+    ServerContext context(db);
+    context.SetStorageArea(storage);
+
+    InstancesIngester ingester(context, threads, 3);
+
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+      std::string dicom = instances[i];
+      ingester.Post("instance-" + boost::lexical_cast<std::string>(i), dicom);
+      ASSERT_TRUE(dicom.empty());
+    }
+
+    std::string dicom = instances[5];
+    ingester.Post("duplicate", dicom);
+
+    dicom = "nope";
+    ingester.Post("garbage", dicom);
+
+    ingester.PostFailure("corrupted", "Corrupted file");
+
+    ASSERT_THROW(ingester.GetStatus(0), OrthancException);
+    ingester.Join();
+
+    std::string garbage = "nope";
+    ASSERT_THROW(ingester.Post("late", garbage), OrthancException);
+    ASSERT_THROW(ingester.PostFailure("late", "error"), OrthancException);
+
+    ASSERT_EQ(23u, ingester.GetSize());
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+      ASSERT_EQ("instance-" + boost::lexical_cast<std::string>(i), ingester.GetName(i));
+      ASSERT_EQ(StoreStatus_Success, ingester.GetStatus(i));
+      ASSERT_TRUE(ingester.GetError(i).empty());
+    }
+
+    ASSERT_EQ("duplicate", ingester.GetName(20));
+    ASSERT_EQ(StoreStatus_AlreadyStored, ingester.GetStatus(20));
+    ASSERT_EQ(ingester.GetPublicId(5), ingester.GetPublicId(20));
+
+    ASSERT_EQ(StoreStatus_Failure, ingester.GetStatus(21));
+    ASSERT_FALSE(ingester.GetError(21).empty());
+
+    ASSERT_EQ("corrupted", ingester.GetName(22));
+    ASSERT_EQ(StoreStatus_Failure, ingester.GetStatus(22));
+    ASSERT_EQ("Corrupted file", ingester.GetError(22));
+    ASSERT_THROW(ingester.GetStatus(23), OrthancException);
+
+    Json::Value uuids;
+    context.GetIndex().GetAllUuids(uuids, ResourceType_Instance);
+    ASSERT_EQ(20u, uuids.size());
+  }
+}
@@ -384,6 +384,23 @@ TEST(Toolbox, ComputeMD5)
   ASSERT_EQ("8b1a9953c4611296a827abf8c47804d7", s);
   Toolbox::ComputeMD5(s, "");
   ASSERT_EQ("d41d8cd98f00b204e9800998ecf8427e", s);
+
+  {
+    Toolbox::MD5Context context;
+    context.Append("He", 2);
+    context.Append(NULL, 0);
+    context.Append("llo", 3);
+    context.Finish(s);
+    ASSERT_EQ("8b1a9953c4611296a827abf8c47804d7", s);
+    ASSERT_THROW(context.Append("a", 1), OrthancException);
+    ASSERT_THROW(context.Finish(s), OrthancException);
+  }
+
+  {
+    Toolbox::MD5Context context;
+    context.Finish(s);
+    ASSERT_EQ("d41d8cd98f00b204e9800998ecf8427e", s);
+  }
 }
 
 TEST(Toolbox, ComputeSHA1)
@@ -561,6 +578,7 @@ TEST(EnumerationDictionary, ServerEnumerations)
 
   ASSERT_EQ("IndexInSeries", EnumerationToString(MetadataType_Instance_IndexInSeries));
   ASSERT_EQ("LastUpdate", EnumerationToString(MetadataType_LastUpdate));
+  ASSERT_EQ("FrameIndex", EnumerationToString(MetadataType_Instance_FrameIndex));
 
   ASSERT_EQ(ResourceType_Patient, StringToResourceType("PATienT"));
   ASSERT_EQ(ResourceType_Study, StringToResourceType("STudy"));
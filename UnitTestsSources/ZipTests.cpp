@@ -34,6 +34,7 @@
 #include "gtest/gtest.h"
 
 #include "../Core/OrthancException.h"
+#include "../Core/Compression/ZipReader.h"
 #include "../Core/Compression/ZipWriter.h"
 #include "../Core/Compression/HierarchicalZipWriter.h"
 #include "../Core/Toolbox.h"
@@ -95,6 +96,152 @@ TEST(ZipWriter, Append)
 
 
 
+namespace
+{
+  class MemoryZipStream : public ZipWriter::IOutputStream
+  {
+  public:
+    std::vector<std::string> chunks_;
+    bool closed_;
+
+    MemoryZipStream() : closed_(false)
+    {
+    }
+
+    virtual void Write(const std::string& chunk)
+    {
+      ASSERT_FALSE(closed_);
+      chunks_.push_back(chunk);
+    }
+
+    virtual void Close()
+    {
+      ASSERT_FALSE(closed_);
+      closed_ = true;
+    }
+
+    std::string GetContent() const
+    {
+      std::string s;
+      for (size_t i = 0; i < chunks_.size(); i++)
+      {
+        s += chunks_[i];
+      }
+
+      return s;
+    }
+  };
+}
+
+
+static void WriteSampleArchive(ZipWriter& w)
+{
+  w.OpenFile("hello");
+  w.Write("Hello world 1");
+  w.OpenFile("world/hello");
+  w.Write(std::string(100000, 'a'));
+  w.OpenFile("world/hello2");
+  w.Write("Hello world 2");
+  w.Close();
+}
+
+
+static void CheckSampleArchive(ZipReader& r)
+{
+  ASSERT_EQ(3u, r.GetFilesCount());
+  ASSERT_EQ("hello", r.GetFileName(0));
+  ASSERT_EQ("world/hello", r.GetFileName(1));
+  ASSERT_EQ("world/hello2", r.GetFileName(2));
+  ASSERT_EQ(100000u, r.GetUncompressedSize(1));
+  ASSERT_FALSE(r.IsDirectory(0));
+
+  std::string s;
+  r.ReadFile(s, 0);  ASSERT_EQ("Hello world 1", s);
+  r.ReadFile(s, 1);  ASSERT_EQ(std::string(100000, 'a'), s);
+  r.ReadFile(s, 2);  ASSERT_EQ("Hello world 2", s);
+
+  ASSERT_THROW(r.ReadFile(s, 3), OrthancException);
+}
+
+
+TEST(ZipWriter, Stream)
+{
+  for (int zip64 = 0; zip64 < 2; zip64++)
+  {
+    MemoryZipStream stream;
+
+    {
+      ZipWriter w;
+      w.SetOutputStream(stream);
+      w.SetZip64(zip64 != 0);
+      ASSERT_TRUE(w.IsStreaming());
+
+      w.OpenFile("hello");
+      w.Write("Hello world 1");
+      ASSERT_TRUE(stream.chunks_.empty());
+
+      // Each entry is sent as soon as the next one is started
+      w.OpenFile("world/hello");
+      ASSERT_EQ(1u, stream.chunks_.size());
+      ASSERT_EQ(std::string("PK\x03\x04", 4), stream.chunks_[0].substr(0, 4));
+      w.Write(std::string(100000, 'a'));
+
+      w.OpenFile("world/hello2");
+      w.Write("Hello world 2");
+      ASSERT_EQ(2u, stream.chunks_.size());
+      ASSERT_FALSE(stream.closed_);
+
+      w.Close();
+      ASSERT_EQ(3u, stream.chunks_.size());  // The last entry is sent with the central directory
+      ASSERT_TRUE(stream.closed_);
+    }
+
+    // The streamed archive has the same layout as on the filesystem
+    {
+      ZipWriter w;
+      w.SetOutputPath("UnitTestsResults/stream.zip");
+      w.SetZip64(zip64 != 0);
+      WriteSampleArchive(w);
+    }
+
+    std::string s;
+    Toolbox::ReadFile(s, "UnitTestsResults/stream.zip");
+
+    std::string content = stream.GetContent();
+    ASSERT_EQ(s.size(), content.size());
+
+    // Every entry of the streamed archive can be read back
+    ZipReader r;
+    r.OpenMemory(content);
+    CheckSampleArchive(r);
+  }
+}
+
+
+TEST(ZipWriter, StreamAborted)
+{
+  MemoryZipStream stream;
+
+  {
+    HierarchicalZipWriter w(stream);
+    w.OpenFile("hello");
+    w.Write("Hello world 1");
+    w.OpenFile("hello");
+    w.Write("Hello world 2");
+
+    // The writer is destroyed without being closed, as if an
+    // exception had occurred
+  }
+
+  ASSERT_FALSE(stream.closed_);
+  ASSERT_EQ(1u, stream.chunks_.size());
+
+  MemoryZipStream empty;
+  HierarchicalZipWriter w(empty);
+  w.Close();
+  ASSERT_TRUE(empty.closed_);
+  ASSERT_EQ(1u, empty.chunks_.size());  // Only the end of central directory
+}
 
 
 namespace Orthanc
@@ -186,3 +333,109 @@ TEST(HierarchicalZipWriter, Basic)
 
   **/
 }
+
+
+TEST(ZipReader, Basic)
+{
+  for (int zip64 = 0; zip64 < 2; zip64++)
+  {
+    for (int level = 0; level <= 9; level += 9)
+    {
+      {
+        ZipWriter w;
+        w.SetOutputPath("UnitTestsResults/reader.zip");
+        w.SetZip64(zip64 != 0);
+        w.SetCompressionLevel(level);
+        WriteSampleArchive(w);
+      }
+
+      {
+        ZipReader r;
+        ASSERT_FALSE(r.IsOpen());
+        r.OpenFile("UnitTestsResults/reader.zip");
+        ASSERT_TRUE(r.IsOpen());
+        CheckSampleArchive(r);
+      }
+
+      std::string archive;
+      Toolbox::ReadFile(archive, "UnitTestsResults/reader.zip");
+
+      {
+        ZipReader r;
+        r.OpenMemory(archive);
+        CheckSampleArchive(r);
+      }
+    }
+  }
+}
+
+
+static void ForgeUncompressedSize(std::string& archive,
+                                  size_t index,
+                                  uint32_t size)
+{
+  // Patch the header of the given entry in the central directory
+  const std::string signature("PK\x01\x02", 4);
+
+  size_t pos = archive.find(signature);
+  for (size_t i = 0; i < index; i++)
+  {
+    pos = archive.find(signature, pos + 1);
+  }
+
+  ASSERT_NE(std::string::npos, pos);
+  for (size_t i = 0; i < 4; i++)
+  {
+    archive[pos + 24 + i] = static_cast<char>((size >> (8 * i)) & 0xff);
+  }
+}
+
+
+TEST(ZipReader, Errors)
+{
+  std::string s;
+
+  ZipReader r;
+  ASSERT_THROW(r.GetFileName(0), OrthancException);
+  ASSERT_THROW(r.OpenMemory("Hello world"), OrthancException);
+  ASSERT_THROW(r.OpenMemory(std::string(100, '\0')), OrthancException);
+  ASSERT_FALSE(r.IsOpen());
+  ASSERT_THROW(r.OpenFile("UnitTestsResults/nope.zip"), OrthancException);
+
+  {
+    ZipWriter w;
+    w.SetOutputPath("UnitTestsResults/corrupted.zip");
+    w.SetCompressionLevel(9);
+    WriteSampleArchive(w);
+  }
+
+  std::string archive;
+  Toolbox::ReadFile(archive, "UnitTestsResults/corrupted.zip");
+
+  // Truncated archive: The central directory cannot be found
+  ASSERT_THROW(r.OpenMemory(archive.substr(0, archive.size() / 2)), OrthancException);
+
+  // Corruption of the content of the first entry, that is detected
+  // by its CRC32
+  std::string corrupted = archive;
+  size_t pos = corrupted.find("hello") + 5;
+  corrupted[pos] = static_cast<char>(corrupted[pos] ^ 0xff);
+  r.OpenMemory(corrupted);
+  ASSERT_EQ(3u, r.GetFilesCount());
+  ASSERT_THROW(r.ReadFile(s, 0), OrthancException);
+  r.ReadFile(s, 2);
+  ASSERT_EQ("Hello world 2", s);
+
+  // Forged central directory, that announces uncompressed sizes that
+  // do not match the content of the deflated entries
+  corrupted = archive;
+  ForgeUncompressedSize(corrupted, 0, 1000);
+  ForgeUncompressedSize(corrupted, 1, 0xfffffff0u);  // Zip bomb
+  r.OpenMemory(corrupted);
+  ASSERT_EQ(3u, r.GetFilesCount());
+  ASSERT_EQ(0xfffffff0u, r.GetUncompressedSize(1));
+  ASSERT_THROW(r.ReadFile(s, 0), OrthancException);
+  ASSERT_THROW(r.ReadFile(s, 1), OrthancException);
+  r.ReadFile(s, 2);
+  ASSERT_EQ("Hello world 2", s);
+}